@@ -0,0 +1,375 @@
+// src/bc_encode.cpp
+#include "bc_encode.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_BC_SSE2 1
+#endif
+
+namespace {
+
+// 4x4 block in SoA float layout: ch[c][pixel], c = R,G,B,A
+struct Block {
+    alignas(16) float ch[4][16];
+};
+
+void GatherBlock(const uint8_t* rgba, int w, int h, int bx, int by, Block& b)
+{
+    for (int y = 0; y < 4; ++y) {
+        const int sy = std::min(by * 4 + y, h - 1);
+        const uint8_t* row = rgba + size_t(sy) * size_t(w) * 4;
+        for (int x = 0; x < 4; ++x) {
+            const int sx = std::min(bx * 4 + x, w - 1);
+            const uint8_t* p = row + size_t(sx) * 4;
+            for (int c = 0; c < 4; ++c) b.ch[c][y * 4 + x] = float(p[c]);
+        }
+    }
+}
+
+// Endpoints along the principal axis of the block (range fit), inset by a
+// fraction of a palette step so the extremes are not wasted on outliers.
+void FitEndpoints(const Block& b, int channels, int levels, float e0[4], float e1[4])
+{
+    float mean[4] = {}, mn[4], mx[4];
+    for (int c = 0; c < channels; ++c) {
+        mn[c] = 255.0f; mx[c] = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            const float v = b.ch[c][i];
+            mean[c] += v;
+            mn[c] = std::min(mn[c], v);
+            mx[c] = std::max(mx[c], v);
+        }
+        mean[c] *= 1.0f / 16.0f;
+    }
+
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float d[4];
+        for (int c = 0; c < channels; ++c) d[c] = b.ch[c][i] - mean[c];
+        for (int r = 0; r < channels; ++r)
+            for (int c = r; c < channels; ++c) cov[r][c] += d[r] * d[c];
+    }
+    for (int r = 0; r < channels; ++r)
+        for (int c = 0; c < r; ++c) cov[r][c] = cov[c][r];
+
+    // power iteration seeded with the bounding-box diagonal
+    float axis[4] = {};
+    for (int c = 0; c < channels; ++c) axis[c] = mx[c] - mn[c];
+    for (int it = 0; it < 4; ++it) {
+        float next[4] = {};
+        for (int r = 0; r < channels; ++r)
+            for (int c = 0; c < channels; ++c) next[r] += cov[r][c] * axis[c];
+        float norm = 0.0f;
+        for (int c = 0; c < channels; ++c) norm = std::max(norm, std::fabs(next[c]));
+        if (norm < 1e-6f) break;
+        for (int c = 0; c < channels; ++c) axis[c] = next[c] / norm;
+    }
+
+    float axisLen2 = 0.0f;
+    for (int c = 0; c < channels; ++c) axisLen2 += axis[c] * axis[c];
+    if (axisLen2 < 1e-12f) {
+        // flat block
+        for (int c = 0; c < 4; ++c) e0[c] = e1[c] = (c < channels) ? mean[c] : 255.0f;
+        return;
+    }
+
+    float tmin = 1e30f, tmax = -1e30f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; ++c) t += (b.ch[c][i] - mean[c]) * axis[c];
+        tmin = std::min(tmin, t);
+        tmax = std::max(tmax, t);
+    }
+    const float inset = (tmax - tmin) / float(levels * 4);
+    tmin += inset; tmax -= inset;
+    tmin /= axisLen2; tmax /= axisLen2;
+
+    for (int c = 0; c < 4; ++c) {
+        if (c < channels) {
+            e0[c] = std::clamp(mean[c] + axis[c] * tmin, 0.0f, 255.0f);
+            e1[c] = std::clamp(mean[c] + axis[c] * tmax, 0.0f, 255.0f);
+        } else {
+            e0[c] = e1[c] = 255.0f;
+        }
+    }
+}
+
+// Nearest palette step for every pixel: project onto e0->e1 and round.
+void ProjectIndices(const Block& b, const float e0[4], const float e1[4],
+                    int channels, int levels, uint8_t idx[16])
+{
+    float d[4] = {};
+    float dd = 0.0f;
+    for (int c = 0; c < channels; ++c) { d[c] = e1[c] - e0[c]; dd += d[c] * d[c]; }
+    if (dd < 1e-6f) { std::memset(idx, 0, 16); return; }
+    const float scale = float(levels - 1) / dd;
+
+#ifdef HDRV_BC_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 half   = _mm_set1_ps(0.5f);
+    const __m128i lo    = _mm_setzero_si128();
+    const __m128i hi    = _mm_set1_epi32(levels - 1);
+    for (int i = 0; i < 16; i += 4) {
+        __m128 t = _mm_setzero_ps();
+        for (int c = 0; c < channels; ++c) {
+            const __m128 v = _mm_sub_ps(_mm_load_ps(&b.ch[c][i]), _mm_set1_ps(e0[c]));
+            t = _mm_add_ps(t, _mm_mul_ps(v, _mm_set1_ps(d[c])));
+        }
+        __m128i q = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(t, vscale), half));
+        // clamp to [0, levels-1]; values are tiny so the epi16 ops are exact
+        q = _mm_max_epi16(_mm_min_epi16(q, hi), lo);
+        alignas(16) int32_t out[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(out), q);
+        for (int k = 0; k < 4; ++k) idx[i + k] = uint8_t(out[k]);
+    }
+#else
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; ++c) t += (b.ch[c][i] - e0[c]) * d[c];
+        const int q = int(t * scale + 0.5f);
+        idx[i] = uint8_t(std::clamp(q, 0, levels - 1));
+    }
+#endif
+}
+
+// ---- BC1 ----
+
+inline uint16_t Pack565(const float c[4])
+{
+    const int r = int(c[0] * (31.0f / 255.0f) + 0.5f);
+    const int g = int(c[1] * (63.0f / 255.0f) + 0.5f);
+    const int b = int(c[2] * (31.0f / 255.0f) + 0.5f);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+inline void Unpack565(uint16_t v, float c[4])
+{
+    const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = float((r << 3) | (r >> 2));
+    c[1] = float((g << 2) | (g >> 4));
+    c[2] = float((b << 3) | (b >> 2));
+    c[3] = 255.0f;
+}
+
+void EncodeBC1Block(const Block& b, uint8_t* out)
+{
+    float e0[4], e1[4];
+    FitEndpoints(b, 3, 4, e0, e1);
+
+    uint16_t c0 = Pack565(e0), c1 = Pack565(e1);
+    uint32_t bits = 0;
+    if (c0 != c1) {
+        // 4-colour mode needs c0 > c1
+        if (c0 < c1) std::swap(c0, c1);
+        Unpack565(c0, e0);
+        Unpack565(c1, e1);
+        uint8_t lin[16];
+        ProjectIndices(b, e0, e1, 3, 4, lin);
+        static const uint8_t kOrder[4] = { 0, 2, 3, 1 };   // linear step -> BC1 index
+        for (int i = 0; i < 16; ++i) bits |= uint32_t(kOrder[lin[i]]) << (2 * i);
+    }
+
+    out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+    std::memcpy(out + 4, &bits, 4);
+}
+
+void DecodeBC1Block(const uint8_t* in, uint8_t px[16][4])
+{
+    const uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+    const uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+    float a[4], b[4];
+    Unpack565(c0, a);
+    Unpack565(c1, b);
+    uint8_t pal[4][4];
+    for (int c = 0; c < 4; ++c) {
+        pal[0][c] = uint8_t(a[c]);
+        pal[1][c] = uint8_t(b[c]);
+        if (c0 > c1) {
+            pal[2][c] = uint8_t((2 * int(a[c]) + int(b[c])) / 3);
+            pal[3][c] = uint8_t((int(a[c]) + 2 * int(b[c])) / 3);
+        } else {
+            pal[2][c] = uint8_t((int(a[c]) + int(b[c])) / 2);
+            pal[3][c] = 0;   // transparent black
+        }
+    }
+    uint32_t bits; std::memcpy(&bits, in + 4, 4);
+    for (int i = 0; i < 16; ++i) std::memcpy(px[i], pal[(bits >> (2 * i)) & 3], 4);
+}
+
+// ---- BC7 mode 6 ----
+
+const int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BitWriter {
+    uint64_t w[2] = {};
+    int pos = 0;
+    void put(uint32_t v, int n) {
+        const uint64_t bits = uint64_t(v) & ((uint64_t(1) << n) - 1);
+        const int word = pos >> 6, shift = pos & 63;
+        w[word] |= bits << shift;
+        if (shift + n > 64) w[word + 1] |= bits >> (64 - shift);
+        pos += n;
+    }
+};
+
+struct BitReader {
+    uint64_t w[2];
+    int pos = 0;
+    uint32_t get(int n) {
+        const int word = pos >> 6, shift = pos & 63;
+        uint64_t v = w[word] >> shift;
+        if (shift + n > 64) v |= w[word + 1] << (64 - shift);
+        pos += n;
+        return uint32_t(v & ((uint64_t(1) << n) - 1));
+    }
+};
+
+// 7-bit endpoint + shared p-bit; pick the p-bit that lands closest
+void QuantizeEndpoint7P(const float e[4], uint8_t q[4], int& pbit)
+{
+    float bestErr = 1e30f;
+    for (int p = 0; p < 2; ++p) {
+        uint8_t t[4];
+        float err = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            const int v = std::clamp(int((e[c] - float(p)) * 0.5f + 0.5f), 0, 127);
+            t[c] = uint8_t(v);
+            const float d = float((v << 1) | p) - e[c];
+            err += d * d;
+        }
+        if (err < bestErr) { bestErr = err; std::memcpy(q, t, 4); pbit = p; }
+    }
+}
+
+void EncodeBC7Block(const Block& b, uint8_t* out)
+{
+    float e0[4], e1[4];
+    FitEndpoints(b, 4, 16, e0, e1);
+
+    uint8_t q0[4], q1[4];
+    int p0 = 0, p1 = 0;
+    QuantizeEndpoint7P(e0, q0, p0);
+    QuantizeEndpoint7P(e1, q1, p1);
+    for (int c = 0; c < 4; ++c) {
+        e0[c] = float((q0[c] << 1) | p0);
+        e1[c] = float((q1[c] << 1) | p1);
+    }
+
+    uint8_t idx[16];
+    ProjectIndices(b, e0, e1, 4, 16, idx);
+
+    // anchor (pixel 0) index is stored with 3 bits: its MSB must be 0
+    if (idx[0] & 8) {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; ++i) idx[i] = uint8_t(15 - idx[i]);
+    }
+
+    BitWriter bw;
+    bw.put(1u << 6, 7);                         // mode 6
+    for (int c = 0; c < 4; ++c) { bw.put(q0[c], 7); bw.put(q1[c], 7); }
+    bw.put(uint32_t(p0), 1);
+    bw.put(uint32_t(p1), 1);
+    bw.put(idx[0], 3);
+    for (int i = 1; i < 16; ++i) bw.put(idx[i], 4);
+    std::memcpy(out, bw.w, 16);
+}
+
+void DecodeBC7Block(const uint8_t* in, uint8_t px[16][4])
+{
+    BitReader br;
+    std::memcpy(br.w, in, 16);
+    if (br.get(7) != (1u << 6)) {
+        // not produced by us; mark as magenta so it is obvious
+        for (int i = 0; i < 16; ++i) { px[i][0] = 255; px[i][1] = 0; px[i][2] = 255; px[i][3] = 255; }
+        return;
+    }
+    uint32_t q0[4], q1[4];
+    for (int c = 0; c < 4; ++c) { q0[c] = br.get(7); q1[c] = br.get(7); }
+    const uint32_t p0 = br.get(1), p1 = br.get(1);
+    int e0[4], e1[4];
+    for (int c = 0; c < 4; ++c) { e0[c] = int((q0[c] << 1) | p0); e1[c] = int((q1[c] << 1) | p1); }
+    for (int i = 0; i < 16; ++i) {
+        const int w = kBC7Weights4[br.get(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+            px[i][c] = uint8_t(((64 - w) * e0[c] + w * e1[c] + 32) >> 6);
+    }
+}
+
+} // namespace
+
+void EncodeBC(const uint8_t* rgba, int w, int h, BcFormat fmt, BcImage& out)
+{
+    out.format = fmt;
+    out.srcW   = w;
+    out.srcH   = h;
+    out.width  = (w + 3) & ~3;
+    out.height = (h + 3) & ~3;
+    out.blocks.resize(out.RowPitch() * size_t(out.BlockRows()));
+    if (w <= 0 || h <= 0) return;
+
+    const int blocksX = out.width / 4;
+    const int bytes   = out.BlockBytes();
+    const int minRows = std::max(1, 4096 / blocksX);
+
+    ParallelForBands(out.BlockRows(), minRows, [&](int, int by0, int by1) {
+        HDRV_TRACE_SCOPE("bc band");
+        Block b;
+        for (int by = by0; by < by1; ++by) {
+            uint8_t* dst = out.blocks.data() + size_t(by) * out.RowPitch();
+            for (int bx = 0; bx < blocksX; ++bx, dst += bytes) {
+                GatherBlock(rgba, w, h, bx, by, b);
+                if (fmt == BcFormat::BC1) EncodeBC1Block(b, dst);
+                else                      EncodeBC7Block(b, dst);
+            }
+        }
+    });
+}
+
+void DecodeBC(const BcImage& img, std::vector<uint8_t>& rgba)
+{
+    rgba.assign(size_t(img.srcW) * size_t(img.srcH) * 4, 0);
+    const int blocksX = img.width / 4;
+    for (int by = 0; by < img.BlockRows(); ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const uint8_t* src = img.blocks.data() + size_t(by) * img.RowPitch()
+                               + size_t(bx) * size_t(img.BlockBytes());
+            uint8_t px[16][4];
+            if (img.format == BcFormat::BC1) DecodeBC1Block(src, px);
+            else                             DecodeBC7Block(src, px);
+            for (int y = 0; y < 4; ++y) {
+                const int sy = by * 4 + y;
+                if (sy >= img.srcH) break;
+                for (int x = 0; x < 4; ++x) {
+                    const int sx = bx * 4 + x;
+                    if (sx >= img.srcW) break;
+                    std::memcpy(&rgba[(size_t(sy) * img.srcW + sx) * 4], px[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+double BcPsnr(const uint8_t* rgba, int w, int h, const BcImage& img)
+{
+    std::vector<uint8_t> dec;
+    DecodeBC(img, dec);
+    double sse = 0.0;
+    const size_t n = size_t(w) * size_t(h);
+    for (size_t i = 0; i < n; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const double d = double(rgba[i * 4 + c]) - double(dec[i * 4 + c]);
+            sse += d * d;
+        }
+    }
+    if (sse <= 0.0) return 99.0;
+    const double mse = sse / double(n * 3);
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,32 @@
+// src/bc_encode.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Block-compressed texture payload. Dimensions are padded up to whole 4x4
+// blocks (D3D12 requires it for BC textures); srcW/srcH keep the real size
+// so the renderer can scale UVs to hide the padding.
+enum class BcFormat { BC1, BC7 };
+
+struct BcImage {
+    BcFormat             format = BcFormat::BC7;
+    int                  srcW = 0, srcH = 0;
+    int                  width = 0, height = 0;   // multiples of 4
+    std::vector<uint8_t> blocks;
+
+    int    BlockBytes() const { return format == BcFormat::BC1 ? 8 : 16; }
+    size_t RowPitch()   const { return size_t(width / 4) * size_t(BlockBytes()); }
+    int    BlockRows()  const { return height / 4; }
+};
+
+// Encode an RGBA8 image. BC1 drops alpha (use it for opaque photos), BC7
+// uses mode 6 only: a single RGBA subset with 4-bit indices, which is the
+// fast interactive setting. Block rows are split across threads.
+void EncodeBC(const uint8_t* rgba, int w, int h, BcFormat fmt, BcImage& out);
+
+// Decode back to RGBA8 (w*h of the source size); used for quality checks.
+void DecodeBC(const BcImage& img, std::vector<uint8_t>& rgba);
+
+// PSNR of the encoded image against the source over RGB, in dB.
+double BcPsnr(const uint8_t* rgba, int w, int h, const BcImage& img);
@@ -0,0 +1,197 @@
+// src/buffer_pool.cpp
+#include "buffer_pool.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Idle buffers beyond this are returned to the OS instead of pooled; the
+// least recently used classes make room first
+constexpr size_t kMaxIdleBytes = size_t(768) << 20;
+
+std::mutex                               g_mutex;
+std::map<size_t, std::vector<void*>>     g_idle;   // class size -> idle buffers
+std::map<size_t, uint64_t>               g_used;   // class size -> tick of its last alloc/free
+std::unordered_map<void*, size_t>        g_live;   // pooled pointer -> class size
+PoolStats                                g_stats;
+uint64_t                                 g_tick = 0;
+
+// Round up to 2^k, 1.25*2^k, 1.5*2^k or 1.75*2^k: at most 25% slack, and
+// images of similar dimensions land in the same class.
+size_t SizeClass(size_t bytes)
+{
+    size_t base = kPoolMinBytes;
+    while (base * 2 <= bytes) base *= 2;
+    const size_t quarter = base / 4;
+    const size_t steps   = (bytes - base + quarter - 1) / quarter;
+    return base + steps * quarter;
+}
+
+void* OsAlloc(size_t bytes)
+{
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+    // large sequential pixel buffers: fewer TLB misses, fewer faults
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+#endif
+}
+
+void OsFree(void* p, size_t bytes)
+{
+#ifdef _WIN32
+    (void)bytes;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, bytes);
+#endif
+}
+
+// Take idle buffers of the least recently used classes other than `keep`
+// until `bytes` more fit under the cap; false if they cannot. Caller holds
+// g_mutex and frees `evicted` after dropping it.
+bool MakeIdleRoom(size_t bytes, size_t keep, std::vector<std::pair<void*, size_t>>& evicted)
+{
+    while (g_stats.idleBytes + bytes > kMaxIdleBytes) {
+        auto victim = g_idle.end();
+        for (auto it = g_idle.begin(); it != g_idle.end(); ++it)
+            if (it->first != keep && !it->second.empty() &&
+                (victim == g_idle.end() || g_used[it->first] < g_used[victim->first]))
+                victim = it;
+        if (victim == g_idle.end()) return false;
+        evicted.emplace_back(victim->second.back(), victim->first);
+        victim->second.pop_back();
+        g_stats.idleBytes -= victim->first;
+    }
+    return true;
+}
+
+size_t SmallUsableSize(void* p)
+{
+#ifdef _WIN32
+    return _msize(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+} // namespace
+
+void* PoolAlloc(size_t bytes)
+{
+    if (bytes < kPoolMinBytes) return std::malloc(bytes ? bytes : 1);
+
+    const size_t cls = SizeClass(bytes);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        ++g_stats.largeAllocs;
+        g_used[cls] = ++g_tick;
+        auto it = g_idle.find(cls);
+        if (it != g_idle.end() && !it->second.empty()) {
+            void* p = it->second.back();
+            it->second.pop_back();
+            g_stats.idleBytes -= cls;
+            g_stats.liveBytes += cls;
+            ++g_stats.reused;
+            g_live.emplace(p, cls);
+            return p;
+        }
+    }
+
+    void* p = OsAlloc(cls);
+    if (!p) return nullptr;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_stats.liveBytes += cls;
+    g_live.emplace(p, cls);
+    return p;
+}
+
+void PoolFree(void* p)
+{
+    if (!p) return;
+    size_t cls = 0;
+    std::vector<std::pair<void*, size_t>> evicted;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_live.find(p);
+        if (it != g_live.end()) {
+            cls = it->second;
+            g_live.erase(it);
+            g_stats.liveBytes -= cls;
+            g_used[cls] = ++g_tick;
+            if (MakeIdleRoom(cls, cls, evicted)) {
+                g_idle[cls].push_back(p);
+                g_stats.idleBytes += cls;
+                p = nullptr;
+            }
+        }
+    }
+    for (auto& [q, bytes] : evicted) OsFree(q, bytes);
+    if (!p) return;
+    if (cls) OsFree(p, cls);
+    else     std::free(p);
+}
+
+void* PoolRealloc(void* p, size_t newBytes)
+{
+    if (!p) return PoolAlloc(newBytes);
+    if (newBytes == 0) { PoolFree(p); return nullptr; }
+
+    size_t cls = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        auto it = g_live.find(p);
+        if (it != g_live.end()) cls = it->second;
+    }
+
+    size_t oldBytes;
+    if (cls) {
+        if (newBytes <= cls) return p;      // still fits its class
+        oldBytes = cls;
+    } else {
+        if (newBytes < kPoolMinBytes) return std::realloc(p, newBytes);
+        oldBytes = SmallUsableSize(p);
+    }
+
+    void* q = PoolAlloc(newBytes);
+    if (!q) return nullptr;                 // like realloc, p stays valid
+    std::memcpy(q, p, oldBytes < newBytes ? oldBytes : newBytes);
+    PoolFree(p);
+    return q;
+}
+
+void PoolTrim()
+{
+    std::map<size_t, std::vector<void*>> idle;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        idle.swap(g_idle);
+        g_stats.idleBytes = 0;
+    }
+    for (auto& [cls, bufs] : idle)
+        for (void* p : bufs) OsFree(p, cls);
+}
+
+PoolStats GetPoolStats()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_stats;
+}
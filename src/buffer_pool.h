@@ -0,0 +1,60 @@
+// src/buffer_pool.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Size-classed pool of large, page-aligned buffers shared by decode (stb's
+// STBI_MALLOC hooks), resize (STBIR_MALLOC) and g_pixels. Navigating between
+// photos of similar size reuses the same few hundred MB instead of paying
+// page faults and zeroing on every image. Idle buffers are capped; past the
+// cap the least recently used size classes are returned to the OS first, so
+// a folder of differently sized images takes over the pool. Requests below
+// kPoolMinBytes go straight to malloc.
+constexpr size_t kPoolMinBytes = 1u << 20;
+
+void* PoolAlloc(size_t bytes);
+void* PoolRealloc(void* p, size_t newBytes);
+void  PoolFree(void* p);
+
+// Drop every idle buffer back to the OS (on opening another folder, and
+// when the caches of the old rendition are flushed).
+void  PoolTrim();
+
+struct PoolStats {
+    uint64_t largeAllocs = 0;   // pooled-size requests
+    uint64_t reused      = 0;   // ...served from an idle buffer
+    size_t   idleBytes   = 0;   // held for reuse
+    size_t   liveBytes   = 0;   // handed out right now
+    double   ReuseRate() const { return largeAllocs ? double(reused) / double(largeAllocs) : 0.0; }
+};
+PoolStats GetPoolStats();
+
+// std::allocator replacement backed by the pool. construct() default-
+// initializes, so resize() on a pixel buffer does not zero memory that the
+// decoder is about to overwrite anyway.
+template <class T>
+struct PoolAllocator {
+    using value_type = T;
+    PoolAllocator() = default;
+    template <class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* p = PoolAlloc(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) { PoolFree(p); }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0) ::new (static_cast<void*>(p)) U;
+        else ::new (static_cast<void*>(p)) U(static_cast<Args&&>(args)...);
+    }
+
+    template <class U> bool operator==(const PoolAllocator<U>&) const { return true; }
+    template <class U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+using PixelBuffer = std::vector<uint8_t, PoolAllocator<uint8_t>>;
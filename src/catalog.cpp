@@ -0,0 +1,339 @@
+// src/catalog.cpp
+#include "catalog.h"
+#include "exif.h"
+#include "image_formats.h"
+#include "parallel.h"
+#include "trace.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <shlobj.h>         // SHGetKnownFolderPath
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <unordered_map>
+
+#include "stb_image.h"
+
+namespace {
+
+constexpr char     kMagic[8] = { 'H', 'D', 'R', 'V', 'C', 'A', 'T', 0 };
+constexpr uint32_t kVersion  = 1;
+
+// Enough for the Exif segment and the SOF marker of nearly every JPEG
+constexpr size_t kProbeBytes = 64 * 1024;
+
+// Dimensions and capture time from the head of a new or changed file
+void ProbeFile(const std::wstring& path, CatalogEntry& e)
+{
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file) return;
+    std::vector<uint8_t> head(kProbeBytes);
+    head.resize(fread(head.data(), 1, head.size(), file));
+    fclose(file);
+
+    int w = 0, h = 0, comp = 0;
+    if (stbi_info_from_memory(head.data(), int(head.size()), &w, &h, &comp)) {
+        e.width  = uint32_t(w);
+        e.height = uint32_t(h);
+    }
+    uint64_t stamp = 0;
+    if (FindExifDateTime(head.data(), head.size(), stamp)) e.captured = stamp;
+}
+
+bool HasImageExtension(const wchar_t* name)
+{
+    const wchar_t* dot = std::wcsrchr(name, L'.');
+    if (!dot) return false;
+    std::wstring ext(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+    return IsImageExtension(ext);
+}
+
+// Everything gathered by the walk before it is written out
+struct Builder {
+    std::vector<CatalogString> roots;
+    std::vector<CatalogDir>    dirs;
+    std::vector<CatalogEntry>  entries;
+    std::vector<wchar_t>       strings;
+
+    CatalogString Add(std::wstring_view s)
+    {
+        CatalogString r{ uint32_t(strings.size()), uint32_t(s.size()) };
+        strings.insert(strings.end(), s.begin(), s.end());
+        return r;
+    }
+};
+
+struct FoundFile {
+    std::wstring name;
+    uint64_t     size;
+    int64_t      mtime;
+};
+
+bool WriteAll(FILE* f, const void* data, size_t bytes)
+{
+    return bytes == 0 || fwrite(data, 1, bytes, f) == bytes;
+}
+
+} // namespace
+
+bool Catalog::Open(const std::wstring& file)
+{
+    Close();
+    HANDLE h = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    m_file = h;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(h, &size) || size.QuadPart < LONGLONG(sizeof(CatalogHeader))) { Close(); return false; }
+    m_mapping = CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) { Close(); return false; }
+    m_view = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_view) { Close(); return false; }
+
+    // sections must fill the file exactly; anything else is a stale or torn file
+    const auto* hdr = reinterpret_cast<const CatalogHeader*>(m_view);
+    const uint64_t bytes = uint64_t(size.QuadPart);
+    if (std::memcmp(hdr->magic, kMagic, sizeof(kMagic)) != 0 || hdr->version != kVersion ||
+        hdr->entryCount > bytes / sizeof(CatalogEntry) || hdr->stringChars > bytes / sizeof(wchar_t)) {
+        Close();
+        return false;
+    }
+    const uint64_t rootsAt   = sizeof(CatalogHeader);
+    const uint64_t dirsAt    = rootsAt + uint64_t(hdr->rootCount) * sizeof(CatalogString);
+    const uint64_t entriesAt = dirsAt + uint64_t(hdr->dirCount) * sizeof(CatalogDir);
+    const uint64_t stringsAt = entriesAt + hdr->entryCount * sizeof(CatalogEntry);
+    if (stringsAt + hdr->stringChars * sizeof(wchar_t) != bytes) { Close(); return false; }
+
+    m_header  = hdr;
+    m_roots   = reinterpret_cast<const CatalogString*>(m_view + rootsAt);
+    m_dirs    = reinterpret_cast<const CatalogDir*>(m_view + dirsAt);
+    m_entries = reinterpret_cast<const CatalogEntry*>(m_view + entriesAt);
+    m_strings = reinterpret_cast<const wchar_t*>(m_view + stringsAt);
+
+    // every offset and index is checked once here, so Path(), Name() and
+    // Find() can trust them; the entry pass is a sequential read of the map
+    auto inPool = [&](CatalogString s) { return uint64_t(s.offset) + s.length <= hdr->stringChars; };
+    for (size_t i = 0; i < hdr->rootCount; ++i)
+        if (!inPool(m_roots[i])) { Close(); return false; }
+    for (size_t i = 0; i < hdr->dirCount; ++i)
+        if (!inPool(m_dirs[i].path) || uint64_t(m_dirs[i].first) + m_dirs[i].count > hdr->entryCount) {
+            Close();
+            return false;
+        }
+    for (uint64_t i = 0; i < hdr->entryCount; ++i)
+        if (!inPool(m_entries[i].name) || m_entries[i].dir >= hdr->dirCount) { Close(); return false; }
+    return true;
+}
+
+void Catalog::Close()
+{
+    if (m_view) UnmapViewOfFile(m_view);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    m_file = m_mapping = nullptr;
+    m_view    = nullptr;
+    m_header  = nullptr;
+    m_roots   = nullptr;
+    m_dirs    = nullptr;
+    m_entries = nullptr;
+    m_strings = nullptr;
+}
+
+std::wstring Catalog::Path(size_t i) const
+{
+    const CatalogEntry& e = m_entries[i];
+    const std::wstring_view dir = Str(m_dirs[e.dir].path), name = Str(e.name);
+    std::wstring path;
+    path.reserve(dir.size() + 1 + name.size());
+    path.append(dir).append(1, L'\\').append(name);
+    return path;
+}
+
+long long Catalog::Find(uint32_t dir, std::wstring_view name) const
+{
+    const CatalogDir& d = m_dirs[dir];
+    size_t lo = d.first, hi = size_t(d.first) + d.count;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        const int c = Str(m_entries[mid].name).compare(name);
+        if (c == 0) return (long long)mid;
+        if (c < 0) lo = mid + 1; else hi = mid;
+    }
+    return -1;
+}
+
+bool BuildCatalog(const std::vector<std::wstring>& roots, const Catalog& previous,
+                  const std::wstring& outFile, const std::atomic<bool>& stop,
+                  CatalogBuildStats& stats)
+{
+    HDRV_TRACE_SCOPE("catalog build");
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // previous directories by path, for the mtime diff
+    std::unordered_map<std::wstring, uint32_t> oldDirs;
+    for (size_t i = 0; i < previous.DirCount(); ++i)
+        oldDirs.emplace(std::wstring(previous.Str(previous.Dir(i).path)), uint32_t(i));
+
+    Builder b;
+    std::vector<size_t> toProbe;          // entries that need their header read
+    std::vector<std::wstring> pending;    // directories still to walk (depth first)
+    std::vector<FoundFile> files;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+        std::wstring root = *it;
+        while (root.size() > 3 && (root.back() == L'\\' || root.back() == L'/')) root.pop_back();
+        pending.push_back(root);
+    }
+    for (const std::wstring& root : roots) b.roots.push_back(b.Add(root));
+
+    while (!pending.empty()) {
+        if (stop) return false;
+        const std::wstring dir = std::move(pending.back());
+        pending.pop_back();
+
+        // one FindFirstFileEx pass yields names, sizes and mtimes without a stat per file
+        files.clear();
+        std::vector<std::wstring> subdirs;
+        WIN32_FIND_DATAW fd;
+        HANDLE find = FindFirstFileExW((dir + L"\\*").c_str(), FindExInfoBasic, &fd,
+                                       FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+        if (find == INVALID_HANDLE_VALUE) continue;
+        do {
+            if (fd.cFileName[0] == L'.') continue;            // ".", ".." and hidden-by-convention
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                // junctions and symlinks could loop back into the tree
+                if (!(fd.dwFileAttributes & (FILE_ATTRIBUTE_REPARSE_POINT | FILE_ATTRIBUTE_SYSTEM)))
+                    subdirs.push_back(dir + L"\\" + fd.cFileName);
+            } else if (HasImageExtension(fd.cFileName)) {
+                files.push_back({ fd.cFileName,
+                                  (uint64_t(fd.nFileSizeHigh) << 32) | fd.nFileSizeLow,
+                                  int64_t((uint64_t(fd.ftLastWriteTime.dwHighDateTime) << 32) |
+                                          fd.ftLastWriteTime.dwLowDateTime) });
+            }
+        } while (FindNextFileW(find, &fd));
+        FindClose(find);
+
+        std::sort(subdirs.rbegin(), subdirs.rend());          // popped back in name order
+        for (auto& s : subdirs) pending.push_back(std::move(s));
+        if (files.empty()) continue;
+
+        std::sort(files.begin(), files.end(),
+                  [](const FoundFile& x, const FoundFile& y) { return x.name < y.name; });
+        const auto old = oldDirs.find(dir);
+        CatalogDir d{ b.Add(dir), uint32_t(b.entries.size()), uint32_t(files.size()) };
+        for (const FoundFile& f : files) {
+            CatalogEntry e{};
+            e.size  = f.size;
+            e.mtime = f.mtime;
+            e.name  = b.Add(f.name);
+            e.dir   = uint32_t(b.dirs.size());
+            const long long prev = old != oldDirs.end() ? previous.Find(old->second, f.name) : -1;
+            if (prev >= 0 && previous.Entry(size_t(prev)).size == f.size &&
+                previous.Entry(size_t(prev)).mtime == f.mtime) {
+                const CatalogEntry& p = previous.Entry(size_t(prev));
+                e.width    = p.width;
+                e.height   = p.height;
+                e.captured = p.captured;
+                ++stats.reused;
+            } else {
+                toProbe.push_back(b.entries.size());
+            }
+            b.entries.push_back(e);
+        }
+        b.dirs.push_back(d);
+        stats.files += files.size();
+    }
+    stats.dirs   = b.dirs.size();
+    stats.probed = toProbe.size();
+
+    // header reads are I/O bound and independent: spread them over every core
+    {
+        HDRV_TRACE_SCOPE("catalog probe");
+        ParallelForBands(int(toProbe.size()), 64, [&](int, int begin, int end) {
+            for (int i = begin; i < end && !stop; ++i) {
+                CatalogEntry& e = b.entries[toProbe[i]];
+                const std::wstring_view dir = std::wstring_view(b.strings.data() + b.dirs[e.dir].path.offset,
+                                                                b.dirs[e.dir].path.length);
+                std::wstring path(dir);
+                path.append(1, L'\\').append(b.strings.data() + e.name.offset, e.name.length);
+                ProbeFile(path, e);
+            }
+        });
+    }
+    if (stop) return false;
+
+    CatalogHeader hdr{};
+    std::memcpy(hdr.magic, kMagic, sizeof(kMagic));
+    hdr.version     = kVersion;
+    hdr.rootCount   = uint32_t(b.roots.size());
+    hdr.dirCount    = uint32_t(b.dirs.size());
+    hdr.entryCount  = b.entries.size();
+    hdr.stringChars = b.strings.size();
+
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, outFile.c_str(), L"wb") != 0 || !f) return false;
+    bool ok = WriteAll(f, &hdr, sizeof(hdr)) &&
+              WriteAll(f, b.roots.data(),   b.roots.size()   * sizeof(CatalogString)) &&
+              WriteAll(f, b.dirs.data(),    b.dirs.size()    * sizeof(CatalogDir)) &&
+              WriteAll(f, b.entries.data(), b.entries.size() * sizeof(CatalogEntry)) &&
+              WriteAll(f, b.strings.data(), b.strings.size() * sizeof(wchar_t));
+    ok = fclose(f) == 0 && ok;
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return ok;
+}
+
+std::wstring DefaultCatalogPath()
+{
+    PWSTR base = nullptr;
+    std::wstring dir;
+    if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &base))) dir = base;
+    CoTaskMemFree(base);
+    if (dir.empty()) return L"library.cat";
+    dir += L"\\HDRViewer";
+    CreateDirectoryW(dir.c_str(), nullptr);
+    return dir + L"\\library.cat";
+}
+
+void CatalogUpdater::Start(const std::vector<std::wstring>& roots, const std::wstring& catalogFile)
+{
+    Stop();
+    m_catalogFile  = catalogFile;
+    m_stats.files  = 0;
+    m_stats.dirs   = m_stats.reused = m_stats.probed = 0;
+    m_stats.ms     = 0.0;
+    m_stop         = false;
+    m_done         = false;
+    m_ok           = false;
+    m_thread = std::thread([this, roots] {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+        TraceSetThreadName("catalog");
+        Catalog previous;               // its own mapping; the UI keeps reading the old one
+        previous.Open(m_catalogFile);
+        m_ok   = BuildCatalog(roots, previous, m_catalogFile + L".new", m_stop, m_stats);
+        m_done = true;
+    });
+}
+
+void CatalogUpdater::Stop()
+{
+    m_stop = true;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool CatalogUpdater::TakeFinished(bool& ok)
+{
+    if (!m_thread.joinable() || !m_done) return false;
+    m_thread.join();
+    ok = m_ok;
+    return true;
+}
+
+bool CatalogUpdater::Commit()
+{
+    return MoveFileExW((m_catalogFile + L".new").c_str(), m_catalogFile.c_str(),
+                       MOVEFILE_REPLACE_EXISTING) != 0;
+}
@@ -0,0 +1,134 @@
+// src/catalog.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Library catalog: every image under one or more root folders, with the
+// metadata needed to list and sort them, in one file that is memory-mapped
+// on startup. Layout (little-endian, 8-byte aligned sections):
+//
+//   CatalogHeader
+//   CatalogString roots[rootCount]
+//   CatalogDir    dirs[dirCount]
+//   CatalogEntry  entries[entryCount]   grouped by dir, sorted by name within
+//   wchar_t       strings[stringChars]  paths and names, not terminated
+struct CatalogHeader {
+    char     magic[8];              // "HDRVCAT\0"
+    uint32_t version;
+    uint32_t rootCount;
+    uint32_t dirCount;
+    uint32_t reserved;
+    uint64_t entryCount;
+    uint64_t stringChars;
+};
+
+struct CatalogString {
+    uint32_t offset, length;        // in wchar_t, into the string pool
+};
+
+struct CatalogDir {
+    CatalogString path;             // absolute, no trailing separator
+    uint32_t      first, count;     // entry range
+};
+
+struct CatalogEntry {
+    uint64_t      size;
+    int64_t       mtime;            // FILETIME ticks
+    uint64_t      captured;         // Exif YYYYMMDDhhmmss, 0 if unknown
+    CatalogString name;
+    uint32_t      dir;
+    uint32_t      width, height;    // 0 when the header probe could not tell
+    uint32_t      reserved;
+};
+static_assert(sizeof(CatalogEntry) == 48, "catalog entries are a fixed 48 bytes");
+
+// Read-only view of a catalog file. Opening maps the file and checks the
+// header and every table's offsets; nothing is parsed or copied.
+class Catalog {
+public:
+    Catalog() = default;
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+    ~Catalog() { Close(); }
+
+    bool Open(const std::wstring& file);
+    void Close();
+    bool IsOpen() const { return m_view != nullptr; }
+
+    size_t Count()     const { return m_header ? size_t(m_header->entryCount) : 0; }
+    size_t DirCount()  const { return m_header ? m_header->dirCount : 0; }
+    size_t RootCount() const { return m_header ? m_header->rootCount : 0; }
+
+    const CatalogEntry& Entry(size_t i) const { return m_entries[i]; }
+    const CatalogDir&   Dir(size_t i)   const { return m_dirs[i]; }
+    std::wstring_view   Str(CatalogString s) const { return { m_strings + s.offset, s.length }; }
+    std::wstring_view   Root(size_t i)  const { return Str(m_roots[i]); }
+    std::wstring_view   Name(size_t i)  const { return Str(m_entries[i].name); }
+    std::wstring        Path(size_t i)  const;
+
+    // Entry of `name` in directory `dir`, or -1 (binary search)
+    long long Find(uint32_t dir, std::wstring_view name) const;
+
+private:
+    void*                m_file    = nullptr;   // HANDLEs
+    void*                m_mapping = nullptr;
+    const uint8_t*       m_view    = nullptr;
+    const CatalogHeader* m_header  = nullptr;
+    const CatalogString* m_roots   = nullptr;
+    const CatalogDir*    m_dirs    = nullptr;
+    const CatalogEntry*  m_entries = nullptr;
+    const wchar_t*       m_strings = nullptr;
+};
+
+struct CatalogBuildStats {
+    std::atomic<size_t> files{0};   // images found so far
+    size_t dirs   = 0;
+    size_t reused = 0;              // size + mtime unchanged: metadata copied
+    size_t probed = 0;              // new or changed: header read
+    double ms     = 0.0;
+};
+
+// Walk `roots` recursively and write a complete catalog to `outFile`.
+// Files whose size and mtime match `previous` (which may be closed) keep
+// their metadata; only new or changed files are opened to read dimensions
+// and capture time. False on I/O failure or when `stop` is raised.
+bool BuildCatalog(const std::vector<std::wstring>& roots, const Catalog& previous,
+                  const std::wstring& outFile, const std::atomic<bool>& stop,
+                  CatalogBuildStats& stats);
+
+// %LOCALAPPDATA%\HDRViewer\library.cat (the folder is created if needed)
+std::wstring DefaultCatalogPath();
+
+// Rebuilds a catalog on a background thread. The result is written next
+// to the catalog; Commit() swaps it in on the calling thread, which must
+// have closed its own mapping of the old file first.
+class CatalogUpdater {
+public:
+    ~CatalogUpdater() { Stop(); }
+
+    void Start(const std::vector<std::wstring>& roots, const std::wstring& catalogFile);
+    void Stop();
+
+    bool   Running() const { return m_thread.joinable() && !m_done; }
+    size_t Found()   const { return m_stats.files; }
+
+    // True once per run when the build has finished (ok or not)
+    bool TakeFinished(bool& ok);
+    // Replace the catalog file with the finished build
+    bool Commit();
+
+    const CatalogBuildStats& Stats() const { return m_stats; }
+
+private:
+    std::wstring      m_catalogFile;
+    CatalogBuildStats m_stats;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_done{false};
+    bool              m_ok = false;
+    std::thread       m_thread;
+};
@@ -0,0 +1,379 @@
+// src/color_profile.cpp
+#include "color_profile.h"
+#include "inflate.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_COLOR_SSE2 1
+#endif
+
+namespace {
+
+// Largest profile taken from a PNG iCCP chunk (matrix profiles are ~0.5-3 KB,
+// LUT profiles rarely exceed a few hundred KB)
+constexpr size_t kMaxProfileBytes = 4 * 1024 * 1024;
+
+inline uint32_t ReadBE16(const uint8_t* p) { return uint32_t(p[0] << 8) | p[1]; }
+inline uint32_t ReadBE32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+inline double ReadS15F16(const uint8_t* p) { return int32_t(ReadBE32(p)) / 65536.0; }
+
+constexpr uint32_t Sig(const char (&s)[5])
+{
+    return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) |
+           (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+}
+
+double LinearToSrgb(double v) { return v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055; }
+
+// sRGB primaries adapted to the D50 PCS (Bradford), as in the sRGB profile
+constexpr double kSrgbToXyz[3][3] = {
+    { 0.4360747, 0.3850649, 0.1430804 },
+    { 0.2225045, 0.7168786, 0.0606169 },
+    { 0.0139322, 0.0971045, 0.7141733 },
+};
+
+bool Invert3x3(const double m[3][3], double out[3][3])
+{
+    const double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                       m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                       m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (std::fabs(det) < 1e-12) return false;
+    const double inv = 1.0 / det;
+    out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+    out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+    out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+    out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    return true;
+}
+
+// One tone response curve: encoded -> linear
+struct ToneCurve {
+    int                 type = 0;       // para function type 0..4, or -1 for a sampled curv
+    double              g = 1.0, a = 1.0, b = 0.0, c = 0.0, d = 0.0, e = 0.0, f = 0.0;
+    std::vector<double> table;
+
+    double Eval(double x) const
+    {
+        if (type < 0) {
+            const double pos = x * double(table.size() - 1);
+            const size_t i = std::min(size_t(pos), table.size() - 2);
+            return table[i] + (table[i + 1] - table[i]) * (pos - double(i));
+        }
+        auto pw = [&](double v) { return std::pow(std::max(0.0, a * v + b), g); };
+        switch (type) {
+        case 0:  return std::pow(x, g);
+        case 1:  return x >= -b / a ? pw(x) : 0.0;
+        case 2:  return x >= -b / a ? pw(x) + c : c;
+        case 3:  return x >= d ? pw(x) : c * x;
+        default: return x >= d ? pw(x) + e : c * x + f;
+        }
+    }
+};
+
+// What the conversion needs from a matrix/TRC RGB profile
+struct IccModel {
+    double      toXyz[3][3];            // columns: rXYZ, gXYZ, bXYZ
+    ToneCurve   trc[3];
+    std::string description;
+};
+
+bool ParseCurve(const uint8_t* p, size_t n, ToneCurve& curve)
+{
+    if (n < 12) return false;
+    const uint32_t type = ReadBE32(p);
+    if (type == Sig("curv")) {
+        const uint32_t count = ReadBE32(p + 8);
+        if (count > (n - 12) / 2) return false;
+        if (count == 0) { curve.type = 0; curve.g = 1.0; return true; }
+        if (count == 1) { curve.type = 0; curve.g = ReadBE16(p + 12) / 256.0; return true; }
+        curve.type = -1;
+        curve.table.resize(count);
+        for (uint32_t i = 0; i < count; ++i) curve.table[i] = ReadBE16(p + 12 + i * 2) / 65535.0;
+        return true;
+    }
+    if (type == Sig("para")) {
+        static const int kParams[5] = { 1, 3, 4, 5, 7 };
+        const int fn = int(ReadBE16(p + 8));
+        if (fn > 4 || n < 12 + size_t(kParams[fn]) * 4) return false;
+        double v[7] = { 1.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        for (int i = 0; i < kParams[fn]; ++i) v[i] = ReadS15F16(p + 12 + i * 4);
+        curve.type = fn;
+        curve.g = v[0]; curve.a = v[1]; curve.b = v[2]; curve.c = v[3];
+        curve.d = v[4]; curve.e = v[5]; curve.f = v[6];
+        if (fn > 0 && curve.a == 0.0) return false;
+        return true;
+    }
+    return false;
+}
+
+// ASCII rendering of a desc (v2) or mluc (v4) tag, first record only
+std::string ParseDescription(const uint8_t* p, size_t n)
+{
+    std::string out;
+    if (n < 12) return out;
+    const uint32_t type = ReadBE32(p);
+    if (type == Sig("desc")) {
+        const uint32_t count = ReadBE32(p + 8);
+        if (count > n - 12) return out;
+        for (uint32_t i = 0; i < count && p[12 + i]; ++i) out += char(p[12 + i]);
+    } else if (type == Sig("mluc") && n >= 28) {
+        const uint32_t bytes = ReadBE32(p + 20), off = ReadBE32(p + 24);
+        if (off > n || bytes > n - off) return out;
+        for (uint32_t i = 0; i + 1 < bytes; i += 2) {
+            const uint32_t ch = ReadBE16(p + off + i);
+            if (!ch) break;
+            out += ch < 128 ? char(ch) : '?';
+        }
+    }
+    return out;
+}
+
+bool ParseIcc(const std::vector<uint8_t>& icc, IccModel& m)
+{
+    const uint8_t* d = icc.data();
+    const size_t len = icc.size();
+    if (len < 132 || ReadBE32(d + 36) != Sig("acsp")) return false;
+    if (ReadBE32(d + 16) != Sig("RGB ") || ReadBE32(d + 20) != Sig("XYZ ")) return false;
+    const uint32_t tags = ReadBE32(d + 128);
+    if (tags > (len - 132) / 12) return false;
+
+    auto findTag = [&](uint32_t sig, const uint8_t*& p, size_t& n) {
+        for (uint32_t i = 0; i < tags; ++i) {
+            const uint8_t* e = d + 132 + size_t(i) * 12;
+            if (ReadBE32(e) != sig) continue;
+            const uint32_t off = ReadBE32(e + 4), size = ReadBE32(e + 8);
+            if (off > len || size > len - off || size < 8) return false;
+            p = d + off;
+            n = size;
+            return true;
+        }
+        return false;
+    };
+
+    static const uint32_t kColumns[3] = { Sig("rXYZ"), Sig("gXYZ"), Sig("bXYZ") };
+    static const uint32_t kCurves[3]  = { Sig("rTRC"), Sig("gTRC"), Sig("bTRC") };
+    for (int k = 0; k < 3; ++k) {
+        const uint8_t* p;
+        size_t n;
+        if (!findTag(kColumns[k], p, n) || n < 20 || ReadBE32(p) != Sig("XYZ ")) return false;
+        for (int r = 0; r < 3; ++r) m.toXyz[r][k] = ReadS15F16(p + 8 + r * 4);
+        if (!findTag(kCurves[k], p, n) || !ParseCurve(p, n, m.trc[k])) return false;
+    }
+
+    const uint8_t* p;
+    size_t n;
+    if (findTag(Sig("desc"), p, n)) m.description = ParseDescription(p, n);
+    if (m.description.empty()) m.description = "embedded profile";
+    return true;
+}
+
+// Within rounding of sRGB: colorants to ~3 digits and every 8-bit code
+// round-tripping to within half a code
+bool IsSrgb(const IccModel& m)
+{
+    for (int r = 0; r < 3; ++r)
+        for (int k = 0; k < 3; ++k)
+            if (std::fabs(m.toXyz[r][k] - kSrgbToXyz[r][k]) > 0.003) return false;
+    for (const ToneCurve& curve : m.trc)
+        for (int i = 0; i < 256; ++i)
+            if (std::fabs(LinearToSrgb(std::clamp(curve.Eval(i / 255.0), 0.0, 1.0)) * 255.0 - i) > 0.5)
+                return false;
+    return true;
+}
+
+uint64_t HashBytes(const uint8_t* p, size_t n)
+{
+    uint64_t h = 1469598103934665603ull;    // FNV-1a
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+struct CachedTransform {
+    uint64_t                              hash;
+    size_t                                size;
+    std::shared_ptr<const ColorTransform> transform;   // nullptr: nothing to do
+};
+
+constexpr size_t kMaxCachedTransforms = 16;
+std::mutex                   g_transformMutex;
+std::vector<CachedTransform> g_transforms;     // most recent last
+
+bool FindJpegProfile(const uint8_t* d, size_t len, std::vector<uint8_t>& icc)
+{
+    struct Chunk { int seq; const uint8_t* p; size_t n; };
+    std::vector<Chunk> chunks;
+    int count = 0;
+    size_t pos = 2;
+    while (pos + 4 <= len && d[pos] == 0xFF) {
+        const int m = d[pos + 1];
+        if (m == 0xFF) { ++pos; continue; }             // fill byte
+        if (m == 0xDA || m == 0xD9) break;              // scan reached
+        const size_t segLen = ReadBE16(d + pos + 2);
+        if (segLen < 2 || pos + 2 + segLen > len) break;
+        if (m == 0xE2 && segLen > 16 && std::memcmp(d + pos + 4, "ICC_PROFILE\0", 12) == 0) {
+            chunks.push_back({ d[pos + 16], d + pos + 18, segLen - 16 });
+            count = d[pos + 17];
+        }
+        pos += 2 + segLen;
+    }
+    if (chunks.empty() || int(chunks.size()) != count) return false;
+    std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) { return a.seq < b.seq; });
+    icc.clear();
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].seq != int(i) + 1) return false;
+        icc.insert(icc.end(), chunks[i].p, chunks[i].p + chunks[i].n);
+    }
+    return true;
+}
+
+bool FindPngProfile(const uint8_t* d, size_t len, std::vector<uint8_t>& icc)
+{
+    size_t pos = 8;
+    while (len - pos >= 12) {
+        const uint32_t clen = ReadBE32(d + pos);
+        const uint32_t type = ReadBE32(d + pos + 4);
+        if (clen > len - pos - 12) return false;
+        if (type == Sig("IDAT") || type == Sig("IEND")) return false;
+        if (type == Sig("iCCP")) {
+            const uint8_t* body = d + pos + 8;
+            const uint8_t* nul  = static_cast<const uint8_t*>(std::memchr(body, 0, clen));
+            if (!nul || size_t(nul - body) + 2 > clen || nul[1] != 0) return false;   // method 0 = zlib
+            const size_t zlen = clen - size_t(nul - body) - 2;
+            size_t n = 0;
+            icc.resize(kMaxProfileBytes);
+            if (!InflateZlibBounded(nul + 2, zlen, icc.data(), icc.size(), n)) return false;
+            icc.resize(n);
+            icc.shrink_to_fit();
+            return true;
+        }
+        pos += size_t(clen) + 12;
+    }
+    return false;
+}
+
+} // namespace
+
+bool FindIccProfile(const uint8_t* data, size_t len, std::vector<uint8_t>& icc)
+{
+    if (len >= 4 && data[0] == 0xFF && data[1] == 0xD8)
+        return FindJpegProfile(data, len, icc);
+    if (len >= 8 && std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0)
+        return FindPngProfile(data, len, icc);
+    return false;
+}
+
+std::shared_ptr<const ColorTransform> GetColorTransform(const std::vector<uint8_t>& icc)
+{
+    const uint64_t hash = HashBytes(icc.data(), icc.size());
+    std::lock_guard<std::mutex> lock(g_transformMutex);
+    for (size_t i = 0; i < g_transforms.size(); ++i) {
+        if (g_transforms[i].hash != hash || g_transforms[i].size != icc.size()) continue;
+        CachedTransform hit = g_transforms[i];
+        g_transforms.erase(g_transforms.begin() + ptrdiff_t(i));
+        g_transforms.push_back(hit);
+        return hit.transform;
+    }
+
+    std::shared_ptr<ColorTransform> xf;
+    IccModel model;
+    double fromXyz[3][3];
+    if (ParseIcc(icc, model) && !IsSrgb(model) && Invert3x3(kSrgbToXyz, fromXyz)) {
+        // source linear RGB -> sRGB linear RGB through the D50 PCS
+        double m[3][3];
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+                m[r][c] = fromXyz[r][0] * model.toXyz[0][c] + fromXyz[r][1] * model.toXyz[1][c] +
+                          fromXyz[r][2] * model.toXyz[2][c];
+
+        xf = std::make_shared<ColorTransform>();
+        xf->m_description = model.description;
+        for (int k = 0; k < 3; ++k)
+            for (int v = 0; v < 256; ++v)
+                xf->m_toLinear[k][v] = float(model.trc[k].Eval(v / 255.0));
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) xf->m_matrix[c][r] = float(m[r][c]);
+            xf->m_matrix[c][3] = 0.0f;
+        }
+        for (int i = 0; i < ColorTransform::kEncodeSize; ++i)
+            xf->m_encode[i] = uint8_t(LinearToSrgb(double(i) / (ColorTransform::kEncodeSize - 1)) * 255.0 + 0.5);
+    }
+
+    if (g_transforms.size() >= kMaxCachedTransforms) g_transforms.erase(g_transforms.begin());
+    g_transforms.push_back({ hash, icc.size(), xf });
+    return xf;
+}
+
+std::shared_ptr<const ColorTransform> EmbeddedColorTransform(const uint8_t* data, size_t len)
+{
+    std::vector<uint8_t> icc;
+    if (!FindIccProfile(data, len, icc)) return nullptr;
+    return GetColorTransform(icc);
+}
+
+void ColorTransform::Apply(uint8_t* rgba, int w, int h) const
+{
+    if (w <= 0 || h <= 0) return;
+    // ~64K pixels per band minimum so thumbnails stay on their worker
+    const int minRows = std::max(1, 65536 / w);
+    ParallelForBands(h, minRows, [&](int, int y0, int y1) {
+        ApplyRows(rgba + size_t(y0) * size_t(w) * 4, size_t(y1 - y0) * size_t(w));
+    });
+}
+
+void ColorTransform::ApplyRows(uint8_t* rgba, size_t pixels) const
+{
+    constexpr float kScale = float(kEncodeSize - 1);
+
+    // runs of one color (skies, backgrounds, borders) reuse the last result
+    uint32_t lastKey = 0xFFFFFFFFu;
+    uint8_t  out[3] = {};
+#ifdef HDRV_COLOR_SSE2
+    const __m128 col0 = _mm_loadu_ps(m_matrix[0]);
+    const __m128 col1 = _mm_loadu_ps(m_matrix[1]);
+    const __m128 col2 = _mm_loadu_ps(m_matrix[2]);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(kScale), half = _mm_set1_ps(0.5f);
+    alignas(16) int32_t idx[4];
+#endif
+    for (size_t i = 0; i < pixels; ++i) {
+        uint8_t* p = rgba + i * 4;
+        const uint32_t key = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16);
+        if (key != lastKey) {
+            lastKey = key;
+#ifdef HDRV_COLOR_SSE2
+            __m128 v = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(col0, _mm_set1_ps(m_toLinear[0][p[0]])),
+                _mm_mul_ps(col1, _mm_set1_ps(m_toLinear[1][p[1]]))),
+                _mm_mul_ps(col2, _mm_set1_ps(m_toLinear[2][p[2]])));
+            v = _mm_min_ps(_mm_max_ps(v, zero), one);
+            _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+            out[0] = m_encode[idx[0]];
+            out[1] = m_encode[idx[1]];
+            out[2] = m_encode[idx[2]];
+#else
+            const float r = m_toLinear[0][p[0]], g = m_toLinear[1][p[1]], b = m_toLinear[2][p[2]];
+            for (int k = 0; k < 3; ++k) {
+                const float v = m_matrix[0][k] * r + m_matrix[1][k] * g + m_matrix[2][k] * b;
+                out[k] = m_encode[int(std::min(std::max(v, 0.0f), 1.0f) * kScale + 0.5f)];
+            }
+#endif
+        }
+        p[0] = out[0];
+        p[1] = out[1];
+        p[2] = out[2];
+    }
+}
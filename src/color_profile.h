@@ -0,0 +1,53 @@
+// src/color_profile.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Leading bytes of a file that FindIccProfile needs in practice: JPEG
+// APP2 and PNG iCCP both come before the image data
+constexpr size_t kProfileHeadBytes = 256 * 1024;
+
+// Embedded ICC profile of a JPEG (APP2 "ICC_PROFILE" chunks, joined in
+// sequence order) or PNG (zlib-compressed iCCP). Partial reads are fine.
+bool FindIccProfile(const uint8_t* data, size_t len, std::vector<uint8_t>& icc);
+
+// Converts RGBA8 from a source RGB space to sRGB, the space the swap chain
+// presents. Built once per distinct profile from its matrix/TRC model
+// (rXYZ/gXYZ/bXYZ + rTRC/gTRC/bTRC, curv or para) as precomputed tables:
+// a 256-entry linearization per channel, the source -> sRGB matrix through
+// the D50 PCS, and a kEncodeSize-entry sRGB encode. Pixels go through them
+// one SSE2 matrix multiply each, rows split across all cores, alpha
+// untouched. Exact to within a code for every 8-bit input.
+class ColorTransform {
+public:
+    static constexpr int kEncodeSize = 4096;
+
+    // Profile name from its desc tag, for the HUD
+    const std::string& Description() const { return m_description; }
+
+    // In place
+    void Apply(uint8_t* rgba, int w, int h) const;
+
+private:
+    friend std::shared_ptr<const ColorTransform> GetColorTransform(const std::vector<uint8_t>& icc);
+
+    void ApplyRows(uint8_t* rgba, size_t pixels) const;
+
+    std::string m_description;
+    float       m_toLinear[3][256];
+    float       m_matrix[3][4];             // column per source channel, padded for SSE
+    uint8_t     m_encode[kEncodeSize];      // linear [0,1] -> sRGB byte
+};
+
+// Transform for an ICC profile, or nullptr when there is nothing to do:
+// the profile matches sRGB within rounding, is not an RGB matrix/TRC
+// profile (LUT-based A2B0 profiles are not interpreted), or is malformed.
+// Results are cached by profile contents, so a folder shot on one camera
+// builds its table once.
+std::shared_ptr<const ColorTransform> GetColorTransform(const std::vector<uint8_t>& icc);
+
+// FindIccProfile + GetColorTransform over a file's leading bytes
+std::shared_ptr<const ColorTransform> EmbeddedColorTransform(const uint8_t* data, size_t len);
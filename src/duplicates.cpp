@@ -0,0 +1,252 @@
+// src/duplicates.cpp
+#include "duplicates.h"
+#include "thumbnails.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "stb_image_resize2.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_PHASH_SSE2 1
+#endif
+
+namespace {
+
+constexpr int kHashInput = 32;      // DCT input side
+constexpr int kHashFreqs = 8;       // low frequencies kept per axis
+
+// Files are decoded to fit this box before the 32x32 squash; the reduced
+// decode gets there with the codec's own 1/8 scaling for most photos
+constexpr int kHashDecodeSize = 128;
+
+// DCT-II basis, transposed: g_basis[x][u] = c(u) cos((2x + 1) u pi / 64)
+struct DctBasis {
+    alignas(16) float m[kHashInput][kHashFreqs];
+    DctBasis()
+    {
+        const double pi = 3.14159265358979323846;
+        for (int x = 0; x < kHashInput; ++x)
+            for (int u = 0; u < kHashFreqs; ++u)
+                m[x][u] = float((u == 0 ? std::sqrt(1.0 / kHashInput) : std::sqrt(2.0 / kHashInput)) *
+                                std::cos((2 * x + 1) * u * pi / (2 * kHashInput)));
+    }
+};
+const DctBasis g_basis;
+
+// out[r][0..7] = sum_k in[r][k] * basis[k][0..7] for `rows` rows. Applied
+// once along rows and once along columns (via the transposed first pass),
+// it gives the top-left 8x8 of the 2D DCT without computing the rest.
+void ProjectRows(const float* in, int rows, int stride, int step, float (*out)[kHashFreqs])
+{
+    for (int r = 0; r < rows; ++r) {
+        const float* row = in + r * stride;
+#ifdef HDRV_PHASH_SSE2
+        __m128 lo = _mm_setzero_ps(), hi = _mm_setzero_ps();
+        for (int k = 0; k < kHashInput; ++k) {
+            const __m128 v = _mm_set1_ps(row[k * step]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(v, _mm_load_ps(g_basis.m[k])));
+            hi = _mm_add_ps(hi, _mm_mul_ps(v, _mm_load_ps(g_basis.m[k] + 4)));
+        }
+        _mm_storeu_ps(out[r], lo);
+        _mm_storeu_ps(out[r] + 4, hi);
+#else
+        for (int u = 0; u < kHashFreqs; ++u) out[r][u] = 0.0f;
+        for (int k = 0; k < kHashInput; ++k)
+            for (int u = 0; u < kHashFreqs; ++u) out[r][u] += row[k * step] * g_basis.m[k][u];
+#endif
+    }
+}
+
+int Find(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i) i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+} // namespace
+
+uint64_t PerceptualHash(const uint8_t* rgba, int w, int h)
+{
+    // luma at source size, then squash (aspect is deliberately dropped)
+    std::vector<uint8_t> luma(size_t(w) * h);
+    for (size_t i = 0; i < luma.size(); ++i) {
+        const uint8_t* p = rgba + i * 4;
+        luma[i] = uint8_t((p[0] * 54 + p[1] * 183 + p[2] * 19) >> 8);
+    }
+    uint8_t small[kHashInput * kHashInput];
+    stbir_resize_uint8_linear(luma.data(), w, h, w, small, kHashInput, kHashInput, kHashInput, STBIR_1CHANNEL);
+
+    float px[kHashInput * kHashInput];
+    for (int i = 0; i < kHashInput * kHashInput; ++i) px[i] = float(small[i]);
+
+    // rows: rowsT[y][u]; columns: coef[u][v] from rowsT read down column u
+    float rowsT[kHashInput][kHashFreqs];
+    ProjectRows(px, kHashInput, kHashInput, 1, rowsT);
+    float coef[kHashFreqs][kHashFreqs];
+    ProjectRows(&rowsT[0][0], kHashFreqs, 1, kHashFreqs, coef);
+
+    // median of the 63 AC terms; DC only tracks overall brightness
+    float ac[kHashFreqs * kHashFreqs - 1];
+    for (int i = 1; i < kHashFreqs * kHashFreqs; ++i) ac[i - 1] = (&coef[0][0])[i];
+    std::nth_element(ac, ac + 31, ac + 63);
+    const float median = ac[31];
+
+    uint64_t hash = 0;
+    for (int i = 1; i < kHashFreqs * kHashFreqs; ++i)
+        if ((&coef[0][0])[i] > median) hash |= uint64_t(1) << i;
+    return hash;
+}
+
+void HashIndex::Insert(uint64_t hash, int id)
+{
+    if (m_nodes.empty()) {
+        m_nodes.push_back({ hash, id, 0 });
+        return;
+    }
+    int node = 0;
+    for (;;) {
+        const int d = HammingDistance(hash, m_nodes[node].hash);
+        int child = m_nodes[node].firstChild;
+        while (child >= 0 && m_nodes[child].dist != d) child = m_nodes[child].nextSibling;
+        if (child < 0) {
+            Node n{ hash, id, d };
+            n.nextSibling = m_nodes[node].firstChild;
+            m_nodes[node].firstChild = int(m_nodes.size());
+            m_nodes.push_back(n);
+            return;
+        }
+        node = child;
+    }
+}
+
+void HashIndex::Query(uint64_t hash, int maxDist, std::vector<int>& out) const
+{
+    if (m_nodes.empty()) return;
+    std::vector<int> stack{ 0 };
+    while (!stack.empty()) {
+        const Node& n = m_nodes[stack.back()];
+        stack.pop_back();
+        const int d = HammingDistance(hash, n.hash);
+        if (d <= maxDist) out.push_back(n.id);
+        for (int c = n.firstChild; c >= 0; c = m_nodes[c].nextSibling)
+            if (std::abs(m_nodes[c].dist - d) <= maxDist) stack.push_back(c);
+    }
+}
+
+int DuplicateGroups::Files() const
+{
+    int n = 0;
+    for (const auto& g : groups) n += int(g.size());
+    return n;
+}
+
+DuplicateGroups FindDuplicateGroups(const std::vector<uint64_t>& hashes,
+                                    const std::vector<uint8_t>& valid, int maxDist)
+{
+    const int n = int(hashes.size());
+    HashIndex index;
+    for (int i = 0; i < n; ++i)
+        if (valid[i]) index.Insert(hashes[i], i);
+
+    std::vector<int> parent(static_cast<size_t>(n));
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<int> near;
+    for (int i = 0; i < n; ++i) {
+        if (!valid[i]) continue;
+        near.clear();
+        index.Query(hashes[i], maxDist, near);
+        for (int j : near) {
+            const int a = Find(parent, i), b = Find(parent, j);
+            if (a != b) parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    // roots are the smallest index of their set, so a forward pass yields
+    // groups ordered by first file with members in index order
+    DuplicateGroups out;
+    std::vector<int> groupOf(static_cast<size_t>(n), -1);
+    for (int i = 0; i < n; ++i) {
+        if (!valid[i]) continue;
+        const int root = Find(parent, i);
+        if (groupOf[root] < 0) {
+            groupOf[root] = int(out.groups.size());
+            out.groups.emplace_back();
+        }
+        out.groups[groupOf[root]].push_back(i);
+    }
+    out.groups.erase(std::remove_if(out.groups.begin(), out.groups.end(),
+                                    [](const std::vector<int>& g) { return g.size() < 2; }),
+                     out.groups.end());
+    return out;
+}
+
+void DuplicateFinder::Start(const FileList& files)
+{
+    Stop();
+    m_files = files;
+    m_hashes.assign(files.size(), 0);
+    m_valid.assign(files.size(), 0);
+    m_groups   = {};
+    m_ms       = 0.0;
+    m_next     = 0;
+    m_hashed   = 0;
+    m_stop     = false;
+    m_finished = false;
+    m_reported = false;
+    m_start    = std::chrono::steady_clock::now();
+
+    const int workers = std::max(1, std::min(int(std::thread::hardware_concurrency()), int(files.size())));
+    m_running = workers;
+    for (int i = 0; i < workers; ++i) m_threads.emplace_back([this] { Worker(); });
+}
+
+void DuplicateFinder::Stop()
+{
+    m_stop = true;
+    for (auto& t : m_threads) t.join();
+    m_threads.clear();
+}
+
+bool DuplicateFinder::TakeFinished()
+{
+    if (!m_finished || m_reported) return false;
+    m_reported = true;
+    Stop();
+    return true;
+}
+
+void DuplicateFinder::Worker()
+{
+    // every core, but never ahead of the render thread
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+    TraceSetThreadName("phash");
+
+    for (int i; !m_stop && (i = m_next++) < int(m_files.size());) {
+        HDRV_TRACE_SCOPE("phash");
+        Thumbnail t;
+        if (MakeThumbnail(m_files[i], kHashDecodeSize, t, false)) {
+            m_hashes[i] = PerceptualHash(t.rgba.data(), t.w, t.h);
+            m_valid[i]  = 1;
+        }
+        ++m_hashed;
+    }
+
+    // the last worker out groups the hashes (each slot was written by one thread)
+    if (--m_running == 0 && !m_stop) {
+        HDRV_TRACE_SCOPE("phash group");
+        m_groups = FindDuplicateGroups(m_hashes, m_valid, kDuplicateDistance);
+        m_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+        m_finished = true;
+    }
+}
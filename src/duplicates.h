@@ -0,0 +1,99 @@
+// src/duplicates.h
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_list.h"
+
+// Hashes at most this far apart (of 64 bits) count as the same picture:
+// re-exports, resizes, light edits and burst neighbours
+constexpr int kDuplicateDistance = 10;
+
+// 64-bit DCT perceptual hash (pHash) of an RGBA8 image of any size: luma
+// squashed to 32x32, 2D DCT, one bit per low-frequency coefficient above
+// the median. Similar images land a few bits apart.
+uint64_t PerceptualHash(const uint8_t* rgba, int w, int h);
+
+inline int HammingDistance(uint64_t a, uint64_t b)
+{
+    uint64_t x = a ^ b;
+    int n = 0;
+    for (; x; x &= x - 1) ++n;
+    return n;
+}
+
+// BK-tree over 64-bit hashes under Hamming distance. Each child edge is
+// labelled with its distance to the parent, so a query within r only
+// descends edges labelled d(query, node) +- r.
+class HashIndex {
+public:
+    void Insert(uint64_t hash, int id);
+    // ids of every hash within maxDist of `hash` (appended, including itself)
+    void Query(uint64_t hash, int maxDist, std::vector<int>& out) const;
+    size_t Size() const { return m_nodes.size(); }
+
+private:
+    struct Node {
+        uint64_t hash;
+        int      id;
+        int      dist;              // to the parent
+        int      firstChild  = -1;
+        int      nextSibling = -1;
+    };
+    std::vector<Node> m_nodes;      // m_nodes[0] is the root
+};
+
+// Files whose hashes link within kDuplicateDistance, transitively.
+// Groups are ordered by their first file; members by index.
+struct DuplicateGroups {
+    std::vector<std::vector<int>> groups;
+    int Files() const;
+};
+
+DuplicateGroups FindDuplicateGroups(const std::vector<uint64_t>& hashes,
+                                    const std::vector<uint8_t>& valid, int maxDist);
+
+// Hashes a folder on every core at below-normal priority, from a reduced
+// decode of each file, then groups near-duplicates. Start() returns at once;
+// the render thread polls Finished() and reads Groups() afterwards.
+class DuplicateFinder {
+public:
+    ~DuplicateFinder() { Stop(); }
+
+    void Start(const FileList& files);
+    void Stop();
+
+    bool Running()  const { return !m_threads.empty() && !m_finished; }
+    // True once per run, when the groups are ready
+    bool TakeFinished();
+
+    int    Hashed() const { return m_hashed; }
+    int    Total()  const { return int(m_files.size()); }
+    double Ms()     const { return m_ms; }
+
+    // Valid after TakeFinished(); indices are into the list given to Start()
+    const FileList&        Files()  const { return m_files; }
+    const DuplicateGroups& Groups() const { return m_groups; }
+
+private:
+    void Worker();
+
+    FileList                  m_files;
+    std::vector<uint64_t>     m_hashes;
+    std::vector<uint8_t>      m_valid;
+    DuplicateGroups           m_groups;
+    double                    m_ms = 0.0;
+
+    std::atomic<int>          m_next{0};
+    std::atomic<int>          m_hashed{0};
+    std::atomic<int>          m_running{0};
+    std::atomic<bool>         m_finished{false};
+    std::atomic<bool>         m_stop{false};
+    bool                      m_reported = false;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<std::thread>  m_threads;
+};
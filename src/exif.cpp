@@ -0,0 +1,191 @@
+// src/exif.cpp
+#include "exif.h"
+
+#include <cstring>
+
+namespace {
+
+inline int ReadBE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+// The TIFF structure inside an Exif segment, in either byte order
+struct TiffReader {
+    const uint8_t* base = nullptr;
+    size_t         len  = 0;
+    bool           le   = false;
+
+    uint32_t U16(size_t off) const {
+        const uint8_t* p = base + off;
+        return le ? uint32_t(p[0] | (p[1] << 8)) : uint32_t((p[0] << 8) | p[1]);
+    }
+    uint32_t U32(size_t off) const {
+        return le ? U16(off) | (U16(off + 2) << 16) : (U16(off) << 16) | U16(off + 2);
+    }
+
+    // Value of a LONG/SHORT `tag` in the IFD at `ifd`; false if absent
+    bool FindTag(uint32_t ifd, uint32_t tag, uint32_t& value) const {
+        if (size_t(ifd) + 2 > len) return false;
+        const uint32_t n = U16(ifd);
+        if (size_t(ifd) + 2 + size_t(n) * 12 > len) return false;
+        for (uint32_t i = 0; i < n; ++i) {
+            const size_t e = size_t(ifd) + 2 + size_t(i) * 12;
+            if (U16(e) != tag) continue;
+            const uint32_t type = U16(e + 2);
+            if (type == 3)      value = U16(e + 8);     // SHORT
+            else if (type == 4) value = U32(e + 8);     // LONG
+            else return false;
+            return true;
+        }
+        return false;
+    }
+
+    // Value of a RATIONAL (type 5) or SRATIONAL (type 10) `tag`; false if
+    // absent or the denominator is zero
+    bool FindRational(uint32_t ifd, uint32_t tag, double& value) const {
+        if (size_t(ifd) + 2 > len) return false;
+        const uint32_t n = U16(ifd);
+        if (size_t(ifd) + 2 + size_t(n) * 12 > len) return false;
+        for (uint32_t i = 0; i < n; ++i) {
+            const size_t e = size_t(ifd) + 2 + size_t(i) * 12;
+            if (U16(e) != tag) continue;
+            const uint32_t type = U16(e + 2);
+            if (type != 5 && type != 10) return false;
+            const size_t at = size_t(U32(e + 8));
+            if (at + 8 > len) return false;
+            const uint32_t num = U32(at), den = U32(at + 4);
+            if (den == 0) return false;
+            value = type == 5 ? double(num) / double(den) : double(int32_t(num)) / double(int32_t(den));
+            return true;
+        }
+        return false;
+    }
+
+    // Text of an ASCII `tag` in the IFD at `ifd` (count includes the NUL)
+    bool FindAscii(uint32_t ifd, uint32_t tag, const char*& text, uint32_t& count) const {
+        if (size_t(ifd) + 2 > len) return false;
+        const uint32_t n = U16(ifd);
+        if (size_t(ifd) + 2 + size_t(n) * 12 > len) return false;
+        for (uint32_t i = 0; i < n; ++i) {
+            const size_t e = size_t(ifd) + 2 + size_t(i) * 12;
+            if (U16(e) != tag) continue;
+            if (U16(e + 2) != 2) return false;
+            count = U32(e + 4);
+            const size_t at = count <= 4 ? e + 8 : size_t(U32(e + 8));
+            if (at + count > len) return false;
+            text = reinterpret_cast<const char*>(base + at);
+            return true;
+        }
+        return false;
+    }
+
+    // Offset of the IFD following the one at `ifd`, 0 at the end
+    uint32_t NextIfd(uint32_t ifd) const {
+        if (size_t(ifd) + 2 > len) return 0;
+        const size_t at = size_t(ifd) + 2 + size_t(U16(ifd)) * 12;
+        return at + 4 <= len ? U32(at) : 0;
+    }
+};
+
+// Locate the TIFF block of the first Exif APP1 segment, or the file itself
+// for TIFF-based camera RAW (CR2, NEF, ARW, DNG, ORF, RW2, ...)
+bool FindExifTiff(const uint8_t* d, size_t len, TiffReader& t)
+{
+    if (len >= 8 && ((d[0] == 'I' && d[1] == 'I') || (d[0] == 'M' && d[1] == 'M'))) {
+        t.base = d;
+        t.len  = len;
+        t.le   = d[0] == 'I';
+        const uint32_t magic = t.U16(2);
+        return magic == 42 || magic == 0x4F52 || magic == 0x5352 || magic == 0x55;
+    }
+    if (len < 4 || d[0] != 0xFF || d[1] != 0xD8) return false;
+    size_t pos = 2;
+    while (pos + 4 <= len && d[pos] == 0xFF) {
+        const int m = d[pos + 1];
+        if (m == 0xDA || m == 0xD9) return false;       // scan reached: no Exif
+        const size_t segLen = size_t(ReadBE16(d + pos + 2));
+        if (segLen < 2) return false;
+        if (m == 0xE1 && segLen >= 16 && pos + 2 + segLen <= len &&
+            std::memcmp(d + pos + 4, "Exif\0\0", 6) == 0) {
+            t.base = d + pos + 10;
+            t.len  = segLen - 8;
+            if (t.base[0] == 'I' && t.base[1] == 'I')      t.le = true;
+            else if (t.base[0] == 'M' && t.base[1] == 'M') t.le = false;
+            else return false;
+            return t.U16(2) == 42;
+        }
+        pos += 2 + segLen;
+    }
+    return false;
+}
+
+} // namespace
+
+bool FindExifThumbnail(const uint8_t* jpeg, size_t len,
+                       const uint8_t*& thumb, size_t& thumbLen)
+{
+    TiffReader t;
+    if (!FindExifTiff(jpeg, len, t)) return false;
+    const uint32_t ifd1 = t.NextIfd(t.U32(4));
+    if (ifd1 == 0) return false;
+
+    uint32_t off = 0, size = 0;
+    if (!t.FindTag(ifd1, 0x0201, off) || !t.FindTag(ifd1, 0x0202, size)) return false;
+    if (size < 4 || size_t(off) + size > t.len) return false;
+    const uint8_t* p = t.base + off;
+    if (p[0] != 0xFF || p[1] != 0xD8) return false;     // TIFF/raw previews are not handled
+    thumb    = p;
+    thumbLen = size;
+    return true;
+}
+
+bool FindExifDateTime(const uint8_t* jpeg, size_t len, uint64_t& stamp)
+{
+    TiffReader t;
+    if (!FindExifTiff(jpeg, len, t)) return false;
+    const uint32_t ifd0 = t.U32(4);
+
+    // "YYYY:MM:DD HH:MM:SS": keep the 14 digits. Unset dates are written
+    // as spaces or zeros and fail here.
+    auto parse = [&](uint32_t ifd, uint32_t tag) {
+        const char* text = nullptr;
+        uint32_t count = 0;
+        if (!t.FindAscii(ifd, tag, text, count) || count < 19) return false;
+        uint64_t v = 0;
+        int digits = 0;
+        for (uint32_t i = 0; i < 19; ++i) {
+            const char c = text[i];
+            if (c >= '0' && c <= '9') { v = v * 10 + uint64_t(c - '0'); ++digits; }
+            else if (c != ':' && c != ' ') return false;
+        }
+        if (digits != 14 || v == 0) return false;
+        stamp = v;
+        return true;
+    };
+
+    // DateTimeOriginal in the Exif IFD, else the IFD0 DateTime
+    uint32_t exifIfd = 0;
+    return (t.FindTag(ifd0, 0x8769, exifIfd) && parse(exifIfd, 0x9003)) || parse(ifd0, 0x0132);
+}
+
+bool FindExifOrientation(const uint8_t* jpeg, size_t len, uint32_t& orientation)
+{
+    TiffReader t;
+    if (!FindExifTiff(jpeg, len, t)) return false;
+    uint32_t v = 0;
+    if (!t.FindTag(t.U32(4), 0x0112, v) || v < 1 || v > 8) return false;
+    orientation = v;
+    return true;
+}
+
+bool FindExifExposure(const uint8_t* jpeg, size_t len, ExifExposure& out)
+{
+    TiffReader t;
+    if (!FindExifTiff(jpeg, len, t)) return false;
+    uint32_t exifIfd = 0;
+    if (!t.FindTag(t.U32(4), 0x8769, exifIfd)) return false;
+    out = ExifExposure{};
+    uint32_t iso = 0;
+    t.FindRational(exifIfd, 0x829A, out.seconds);       // ExposureTime
+    t.FindRational(exifIfd, 0x829D, out.fNumber);       // FNumber
+    if (t.FindTag(exifIfd, 0x8827, iso)) out.iso = iso; // ISOSpeedRatings
+    return out.seconds > 0.0;
+}
@@ -0,0 +1,41 @@
+// src/exif.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Embedded JPEG preview from a JPEG's APP1 "Exif" segment (IFD1,
+// JPEGInterchangeFormat/Length). Cameras write a ~160x120 preview there,
+// which is enough for a grid cell without touching the main scan.
+// `thumb` points into `jpeg`; only the leading bytes up to the first scan
+// are needed, so callers can pass a partial read of the file. TIFF-based
+// camera RAW files are read the same way, from their own IFD0 and IFD1.
+bool FindExifThumbnail(const uint8_t* jpeg, size_t len,
+                       const uint8_t*& thumb, size_t& thumbLen);
+
+// Capture time from DateTimeOriginal (or IFD0 DateTime) as the decimal
+// number YYYYMMDDhhmmss, which sorts chronologically. Same partial-read
+// rules as FindExifThumbnail.
+bool FindExifDateTime(const uint8_t* jpeg, size_t len, uint64_t& stamp);
+
+// Raw Orientation tag (IFD0 0x0112, 1-8) telling how to turn the stored
+// pixels upright. Same partial-read rules as FindExifThumbnail.
+bool FindExifOrientation(const uint8_t* jpeg, size_t len, uint32_t& orientation);
+
+// Exposure settings from the Exif IFD; zero where a tag is missing
+struct ExifExposure {
+    double seconds = 0.0;       // ExposureTime
+    double fNumber = 0.0;
+    double iso     = 0.0;
+
+    // Light gathered relative to ISO 100 at f/1, for ordering a bracket and
+    // scaling its frames; 0 without an exposure time
+    double Relative() const {
+        if (seconds <= 0.0) return 0.0;
+        const double n = fNumber > 0.0 ? fNumber : 1.0;
+        return seconds * (iso > 0.0 ? iso / 100.0 : 1.0) / (n * n);
+    }
+};
+
+// False without an ExposureTime. Same partial-read rules as
+// FindExifThumbnail.
+bool FindExifExposure(const uint8_t* jpeg, size_t len, ExifExposure& out);
@@ -0,0 +1,322 @@
+// src/file_list.cpp
+#include "file_list.h"
+#include "trace.h"
+
+#include <cstdio>
+#include <cwchar>
+#include <random>
+
+namespace {
+
+constexpr uint32_t kEmpty = UINT32_MAX;
+
+// Where the file name starts: after the last separator
+size_t NameStart(const std::wstring& path)
+{
+    const size_t s = path.find_last_of(L"\\/");
+    return s == std::wstring::npos ? 0 : s + 1;
+}
+
+// Walks the characters of a path held as folder prefix + name
+struct PathCursor {
+    const wchar_t* seg[2];
+    uint32_t       len[2];
+    int            s = 0;
+    uint32_t       i = 0;
+
+    bool Next(wchar_t& c)
+    {
+        while (s < 2 && i == len[s]) { ++s; i = 0; }
+        if (s == 2) return false;
+        c = seg[s][i++];
+        return true;
+    }
+};
+
+// What a std::wstring costs: the object, plus its heap block when the
+// characters do not fit inline (block rounded to 16 bytes, 16-byte header)
+size_t StringBytes(const std::wstring& s)
+{
+    const char* d = reinterpret_cast<const char*>(s.data());
+    const char* o = reinterpret_cast<const char*>(&s);
+    if (d >= o && d < o + sizeof(s)) return sizeof(s);
+    return sizeof(s) + (((s.capacity() + 1) * sizeof(wchar_t) + 15) & ~size_t(15)) + 16;
+}
+
+// FNV-1a, then a murmur finalizer so the low bits used as the slot index
+// are well spread
+uint64_t HashChars(const wchar_t* s, size_t len, uint64_t seed)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < len; ++i) h = (h ^ uint64_t(uint16_t(s[i]))) * 0x100000001B3ull;
+    h ^= seed;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Linear probe for `match` from hash; kEmpty when the chain ends first
+template <class Match>
+uint32_t Probe(const std::vector<uint32_t>& slots, uint64_t hash, Match match)
+{
+    if (slots.empty()) return kEmpty;
+    const size_t mask = slots.size() - 1;
+    for (size_t i = size_t(hash) & mask;; i = (i + 1) & mask)
+        if (slots[i] == kEmpty || match(slots[i])) return slots[i];
+}
+
+void Place(std::vector<uint32_t>& slots, uint64_t hash, uint32_t id)
+{
+    const size_t mask = slots.size() - 1;
+    size_t i = size_t(hash) & mask;
+    while (slots[i] != kEmpty) i = (i + 1) & mask;
+    slots[i] = id;
+}
+
+double Ms(int64_t t0) { return double(TraceNowNs() - t0) / 1e6; }
+
+} // namespace
+
+void FileList::clear()
+{
+    m_chars.clear();
+    m_dirs.clear();
+    std::fill(m_dirSlots.begin(), m_dirSlots.end(), kEmpty);
+    m_lastDir = kEmpty;
+    m_entries.clear();
+    m_order.clear();
+    m_pos.clear();
+    std::fill(m_slots.begin(), m_slots.end(), kEmpty);
+}
+
+void FileList::reserve(size_t n)
+{
+    m_entries.reserve(n);
+    m_order.reserve(n);
+    m_pos.reserve(n);
+    m_chars.reserve(n * 16);    // a typical camera file name
+    size_t slots = 64;
+    while (slots < n * 2) slots *= 2;
+    if (slots > m_slots.size()) Rehash(slots);
+}
+
+FileList::Span FileList::Store(const wchar_t* s, size_t len)
+{
+    const Span span{ uint32_t(m_chars.size()), uint32_t(len) };
+    m_chars.insert(m_chars.end(), s, s + len);
+    return span;
+}
+
+uint32_t FileList::InternDir(const wchar_t* s, size_t len)
+{
+    if (m_lastDir != kEmpty) {
+        const Span& d = m_dirs[m_lastDir];
+        if (d.len == len && std::wmemcmp(m_chars.data() + d.off, s, len) == 0) return m_lastDir;
+    }
+    const uint64_t h = HashChars(s, len, 0);
+    uint32_t dir = FindDir(s, len, h);
+    if (dir == kEmpty) {
+        // folders are few: the table is kept at most a quarter full
+        if ((m_dirs.size() + 1) * 4 > m_dirSlots.size()) {
+            m_dirSlots.assign(std::max<size_t>(16, m_dirSlots.size() * 2), kEmpty);
+            for (uint32_t d = 0; d < m_dirs.size(); ++d)
+                Place(m_dirSlots, HashChars(m_chars.data() + m_dirs[d].off, m_dirs[d].len, 0), d);
+        }
+        dir = uint32_t(m_dirs.size());
+        m_dirs.push_back(Store(s, len));
+        Place(m_dirSlots, h, dir);
+    }
+    return m_lastDir = dir;
+}
+
+uint32_t FileList::FindDir(const wchar_t* s, size_t len, uint64_t hash) const
+{
+    return Probe(m_dirSlots, hash, [&](uint32_t d) {
+        return m_dirs[d].len == len && std::wmemcmp(m_chars.data() + m_dirs[d].off, s, len) == 0;
+    });
+}
+
+uint64_t FileList::Hash(uint32_t dir, const wchar_t* name, size_t len) const
+{
+    return HashChars(name, len, uint64_t(dir) * 0x9E3779B97F4A7C15ull);
+}
+
+bool FileList::Equal(uint32_t id, uint32_t dir, const wchar_t* name, size_t len) const
+{
+    const Entry& e = m_entries[id];
+    return e.dir == dir && e.name.len == len && std::wmemcmp(m_chars.data() + e.name.off, name, len) == 0;
+}
+
+int FileList::Lookup(uint32_t dir, const wchar_t* name, size_t len, uint64_t hash) const
+{
+    const uint32_t id = Probe(m_slots, hash, [&](uint32_t id) { return Equal(id, dir, name, len); });
+    return id == kEmpty ? -1 : int(id);
+}
+
+void FileList::Rehash(size_t slots)
+{
+    m_slots.assign(slots, kEmpty);
+    for (uint32_t id = 0; id < m_entries.size(); ++id) {
+        const Entry& e = m_entries[id];
+        Place(m_slots, Hash(e.dir, m_chars.data() + e.name.off, e.name.len), id);
+    }
+}
+
+uint32_t FileList::push_back(const std::wstring& path)
+{
+    const size_t n0 = NameStart(path);
+    const uint32_t dir = InternDir(path.data(), n0);
+    const wchar_t* name = path.data() + n0;
+    const size_t len = path.size() - n0;
+
+    // at most half full, so probes stay short
+    if ((m_entries.size() + 1) * 2 > m_slots.size()) Rehash(std::max<size_t>(64, m_slots.size() * 2));
+    const uint64_t h = Hash(dir, name, len);
+    const int known = Lookup(dir, name, len, h);
+    if (known >= 0) return uint32_t(known);
+
+    const uint32_t id = uint32_t(m_entries.size());
+    m_entries.push_back({ dir, Store(name, len) });
+    m_pos.push_back(uint32_t(m_order.size()));
+    m_order.push_back(id);
+    Place(m_slots, h, id);
+    return id;
+}
+
+int FileList::Find(const std::wstring& path) const
+{
+    const size_t n0 = NameStart(path);
+    uint32_t dir = m_lastDir;
+    if (dir == kEmpty || m_dirs[dir].len != n0 || std::wmemcmp(m_chars.data() + m_dirs[dir].off, path.data(), n0) != 0) {
+        dir = FindDir(path.data(), n0, HashChars(path.data(), n0, 0));
+        if (dir == kEmpty) return -1;
+    }
+    const wchar_t* name = path.data() + n0;
+    const size_t len = path.size() - n0;
+    const int id = Lookup(dir, name, len, Hash(dir, name, len));
+    return id < 0 ? -1 : int(m_pos[id]);
+}
+
+std::wstring FileList::Path(uint32_t id) const
+{
+    const Entry& e = m_entries[id];
+    const Span& d = m_dirs[e.dir];
+    std::wstring out;
+    out.reserve(d.len + e.name.len);
+    out.append(m_chars.data() + d.off, d.len);
+    out.append(m_chars.data() + e.name.off, e.name.len);
+    return out;
+}
+
+std::wstring FileList::Name(uint32_t id) const
+{
+    const Entry& e = m_entries[id];
+    return std::wstring(m_chars.data() + e.name.off, e.name.len);
+}
+
+int FileList::Compare(uint32_t a, uint32_t b) const
+{
+    const Entry& ea = m_entries[a];
+    const Entry& eb = m_entries[b];
+    const wchar_t* base = m_chars.data();
+    if (ea.dir == eb.dir) {
+        const uint32_t n = std::min(ea.name.len, eb.name.len);
+        const int c = std::wmemcmp(base + ea.name.off, base + eb.name.off, n);
+        return c ? c : int(ea.name.len) - int(eb.name.len);
+    }
+    const Span& da = m_dirs[ea.dir];
+    const Span& db = m_dirs[eb.dir];
+    const uint32_t n = std::min(da.len, db.len);
+    if (const int c = std::wmemcmp(base + da.off, base + db.off, n)) return c;
+    // one folder is a prefix of the other: go on into the names
+    PathCursor pa{ { base + da.off, base + ea.name.off }, { da.len, ea.name.len }, 0, n };
+    PathCursor pb{ { base + db.off, base + eb.name.off }, { db.len, eb.name.len }, 0, n };
+    for (;;) {
+        wchar_t ca, cb;
+        const bool ha = pa.Next(ca), hb = pb.Next(cb);
+        if (!ha || !hb) return int(ha) - int(hb);
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+}
+
+size_t FileList::MemoryBytes() const
+{
+    return m_chars.capacity() * sizeof(wchar_t) + m_dirs.capacity() * sizeof(Span) +
+           m_entries.capacity() * sizeof(Entry) +
+           (m_order.capacity() + m_pos.capacity() + m_slots.capacity() + m_dirSlots.capacity()) * sizeof(uint32_t);
+}
+
+std::string FileListBench(size_t entries)
+{
+    // a library of 500-image event folders grouped by year, visited in a
+    // shuffled order so neither structure sees folders back to back
+    static const wchar_t* kEvents[] = { L"Holiday", L"Birthday", L"Hiking", L"Wedding", L"City walk", L"Garden" };
+    std::vector<std::wstring> paths;
+    paths.reserve(entries);
+    wchar_t buf[160];
+    for (size_t i = 0; i < entries; ++i) {
+        const size_t folder = i / 500;
+        swprintf(buf, 160, L"D:\\Photos\\Library\\%04zu\\%04zu-%02zu %ls\\IMG_%07zu.%ls", 2000 + folder / 100,
+                 2000 + folder / 100, folder % 100, kEvents[folder % 6], i, i % 5 ? L"JPG" : L"CR3");
+        paths.emplace_back(buf);
+    }
+    std::mt19937 rng(7);
+    std::shuffle(paths.begin(), paths.end(), rng);
+
+    size_t chars = 0;
+    for (const std::wstring& p : paths) chars += p.size();
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%zu paths, avg %.1f characters\n", entries, entries ? double(chars) / entries : 0.0);
+    report += line;
+
+    int64_t t0 = TraceNowNs();
+    std::vector<std::wstring> vec;
+    for (const std::wstring& p : paths) vec.push_back(p);
+    const double vecBuild = Ms(t0);
+    size_t vecBytes = vec.capacity() * sizeof(std::wstring);
+    for (const std::wstring& p : vec) vecBytes += StringBytes(p) - sizeof(p);
+
+    t0 = TraceNowNs();
+    FileList list;
+    for (const std::wstring& p : paths) list.push_back(p);
+    const double listBuild = Ms(t0);
+
+    snprintf(line, sizeof(line), "%-28s %10.1f MB  build %7.1f ms\n", "std::vector<std::wstring>", vecBytes / 1048576.0, vecBuild);
+    report += line;
+    snprintf(line, sizeof(line), "%-28s %10.1f MB  build %7.1f ms  (%zu folders, %.1f bytes/entry)\n", "FileList",
+             list.MemoryBytes() / 1048576.0, listBuild, list.Folders(),
+             entries ? double(list.MemoryBytes()) / entries : 0.0);
+    report += line;
+
+    // finding a path's position: std::find compares against every entry,
+    // so it gets far fewer queries
+    std::uniform_int_distribution<size_t> pick(0, entries ? entries - 1 : 0);
+    const int slowQueries = 200, fastQueries = 200000;
+    size_t found = 0;
+    t0 = TraceNowNs();
+    for (int q = 0; q < slowQueries && entries; ++q)
+        found += std::find(vec.begin(), vec.end(), paths[pick(rng)]) != vec.end();
+    const double vecFind = Ms(t0) / slowQueries;
+    t0 = TraceNowNs();
+    for (int q = 0; q < fastQueries && entries; ++q) found += list.Find(paths[pick(rng)]) >= 0;
+    const double listFind = Ms(t0) / fastQueries;
+    snprintf(line, sizeof(line), "find: std::find %.3f ms, FileList::Find %.3f us  (%zu found)\n", vecFind,
+             listFind * 1000.0, found);
+    report += line;
+
+    // the by-name sort (descending, as the viewer sorts)
+    t0 = TraceNowNs();
+    std::sort(vec.begin(), vec.end(), std::greater<std::wstring>());
+    const double vecSort = Ms(t0);
+    t0 = TraceNowNs();
+    list.Sort([&](uint32_t a, uint32_t b) { return list.Compare(a, b) > 0; });
+    const double listSort = Ms(t0);
+    bool same = vec.size() == list.size();
+    for (size_t i = 0; same && i < vec.size(); i += 997) same = vec[i] == list[i];
+    snprintf(line, sizeof(line), "sort by name: vector %.1f ms, FileList %.1f ms  (%s)\n", vecSort, listSort,
+             same ? "same order" : "ORDER DIFFERS");
+    report += line;
+    return report;
+}
@@ -0,0 +1,76 @@
+// src/file_list.h
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The viewer's list of image paths, stored compactly for folders and
+// libraries of a million files. Each folder prefix is interned once; file
+// names live back to back in one UTF-16 arena, so an entry is a folder id
+// and a name span (12 bytes) instead of a heap-allocated full path. Entries
+// keep the id push_back() gave them while the list is re-sorted, and
+// open-addressing hashes of folders and of (folder, name) find a path's
+// position without comparing against every entry.
+class FileList {
+public:
+    size_t size()  const { return m_order.size(); }
+    bool   empty() const { return m_order.empty(); }
+    void   clear();
+    void   reserve(size_t n);
+
+    // Full path of the entry at list position `pos`
+    std::wstring operator[](size_t pos) const { return Path(m_order[pos]); }
+
+    uint32_t     IdAt(size_t pos)   const { return m_order[pos]; }
+    size_t       PosOf(uint32_t id) const { return m_pos[id]; }
+    std::wstring Path(uint32_t id)  const;
+    std::wstring Name(uint32_t id)  const;
+
+    // Appends `path` and returns its id; a path already listed keeps its
+    // id and position
+    uint32_t push_back(const std::wstring& path);
+
+    // List position of `path`, or -1
+    int Find(const std::wstring& path) const;
+
+    // Reorder by less(idA, idB); ids stay, positions change
+    template <class Less> void Sort(Less less)
+    {
+        std::sort(m_order.begin(), m_order.end(), less);
+        for (size_t i = 0; i < m_order.size(); ++i) m_pos[m_order[i]] = uint32_t(i);
+    }
+    // Full-path order (<0, 0, >0) of two entries without building the strings
+    int Compare(uint32_t a, uint32_t b) const;
+
+    size_t Folders()     const { return m_dirs.size(); }
+    // Heap bytes held, capacity included
+    size_t MemoryBytes() const;
+
+private:
+    struct Span  { uint32_t off, len; };        // into m_chars
+    struct Entry { uint32_t dir; Span name; };
+
+    Span     Store(const wchar_t* s, size_t len);
+    uint32_t InternDir(const wchar_t* s, size_t len);
+    uint32_t FindDir(const wchar_t* s, size_t len, uint64_t hash) const;
+    uint64_t Hash(uint32_t dir, const wchar_t* name, size_t len) const;
+    bool     Equal(uint32_t id, uint32_t dir, const wchar_t* name, size_t len) const;
+    int      Lookup(uint32_t dir, const wchar_t* name, size_t len, uint64_t hash) const;   // id or -1
+    void     Rehash(size_t slots);
+
+    std::vector<wchar_t>  m_chars;              // folder prefixes and names
+    std::vector<Span>     m_dirs;               // folder prefix, trailing separator included
+    std::vector<uint32_t> m_dirSlots;           // hash table of folder ids
+    uint32_t              m_lastDir = UINT32_MAX;   // enumeration appends folder by folder
+    std::vector<Entry>    m_entries;            // by id
+    std::vector<uint32_t> m_order;              // list position -> id
+    std::vector<uint32_t> m_pos;                // id -> list position
+    std::vector<uint32_t> m_slots;              // hash table of ids; UINT32_MAX is empty
+};
+
+// Builds `entries` synthetic library paths both as std::vector<std::wstring>
+// and as a FileList and reports memory, build, lookup and sort costs of each
+// (for --filelist-bench)
+std::string FileListBench(size_t entries);
@@ -0,0 +1,260 @@
+// src/file_search.cpp
+#include "file_search.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <string_view>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace {
+
+// Fuzzy answers stop here; past this many a query is not narrowing anything
+constexpr size_t kMaxFuzzy = 500;
+
+std::wstring Lower(const std::wstring& s)
+{
+    std::wstring out(s);
+    for (wchar_t& c : out) c = wchar_t(std::towlower(c));
+    return out;
+}
+
+inline bool Contains(const wchar_t* s, uint32_t len, const std::wstring& q)
+{
+    return std::wstring_view(s, len).find(q) != std::wstring_view::npos;
+}
+
+inline uint64_t Trigram(const wchar_t* p)
+{
+    return (uint64_t(p[0] & 0xFFFF) << 32) | (uint64_t(p[1] & 0xFFFF) << 16) | uint64_t(p[2] & 0xFFFF);
+}
+
+} // namespace
+
+uint32_t NameIndex::Add(const std::wstring& name)
+{
+    const uint32_t id = uint32_t(m_names.size());
+    const std::wstring s = Lower(name);
+    m_names.push_back({ uint32_t(m_chars.size()), uint32_t(s.size()) });
+    m_chars.insert(m_chars.end(), s.begin(), s.end());
+    m_alive.push_back(1);
+    ++m_live;
+
+    for (size_t i = 0; i + 3 <= s.size(); ++i) {
+        // ids only grow, so the lists stay sorted; a repeated trigram is listed once
+        std::vector<uint32_t>& list = m_postings[Trigram(&s[i])];
+        if (list.empty() || list.back() != id) list.push_back(id);
+    }
+    return id;
+}
+
+void NameIndex::Remove(uint32_t id)
+{
+    if (id >= m_alive.size() || !m_alive[id]) return;
+    m_alive[id] = 0;
+    --m_live;
+    ++m_dead;
+    if (m_dead > 4096 && m_dead > m_live) Compact();
+}
+
+void NameIndex::Compact()
+{
+    HDRV_TRACE_SCOPE("name index compact");
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        std::vector<uint32_t>& list = it->second;
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t id) { return !m_alive[id]; }), list.end());
+        it = list.empty() ? m_postings.erase(it) : std::next(it);
+    }
+    // ids stay as they are; only the live names' characters are kept
+    std::vector<wchar_t> chars;
+    chars.reserve(m_chars.size());
+    for (uint32_t id = 0; id < m_names.size(); ++id) {
+        Span& n = m_names[id];
+        const uint32_t off = uint32_t(chars.size());
+        if (m_alive[id]) chars.insert(chars.end(), m_chars.begin() + n.off, m_chars.begin() + n.off + n.len);
+        n = { off, m_alive[id] ? n.len : 0 };
+    }
+    m_chars.swap(chars);
+    m_dead = 0;
+}
+
+bool NameIndex::Query(const std::wstring& query, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    const std::wstring q = Lower(query);
+    if (q.empty()) return true;
+
+    if (q.size() < 3) {
+        // too short to have a trigram: a scan, still only a few ms for 100k names
+        for (uint32_t id = 0; id < m_names.size(); ++id)
+            if (m_alive[id] && Contains(m_chars.data() + m_names[id].off, m_names[id].len, q)) out.push_back(id);
+        return true;
+    }
+
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i + 3 <= q.size(); ++i) keys.push_back(Trigram(&q[i]));
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (uint64_t k : keys) {
+        auto it = m_postings.find(k);
+        if (it != m_postings.end()) lists.push_back(&it->second);
+    }
+
+    // substring: every trigram present, then the names themselves checked
+    // for the trigrams being contiguous
+    if (lists.size() == keys.size()) {
+        std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+        std::vector<uint32_t> cand(*lists[0]), next;
+        for (size_t l = 1; l < lists.size() && !cand.empty(); ++l) {
+            // the candidates are the shorter side: binary search onward in the longer list
+            const std::vector<uint32_t>& list = *lists[l];
+            next.clear();
+            auto from = list.begin();
+            for (uint32_t id : cand) {
+                from = std::lower_bound(from, list.end(), id);
+                if (from == list.end()) break;
+                if (*from == id) next.push_back(id);
+            }
+            cand.swap(next);
+        }
+        for (uint32_t id : cand)
+            if (m_alive[id] && Contains(m_chars.data() + m_names[id].off, m_names[id].len, q)) out.push_back(id);
+        if (!out.empty()) return true;
+    }
+
+    // fuzzy: names holding at least 60% of the query's trigrams, most first,
+    // then closest in length
+    const size_t need = std::max<size_t>(2, (keys.size() * 3 + 4) / 5);
+    if (keys.size() < 2 || lists.size() < need) return false;
+    std::vector<uint16_t> hits(m_names.size());
+    std::vector<uint32_t> touched;
+    for (const auto* list : lists)
+        for (uint32_t id : *list)
+            if (hits[id]++ == 0) touched.push_back(id);
+    for (uint32_t id : touched)
+        if (m_alive[id] && hits[id] >= need) out.push_back(id);
+
+    const auto gap = [&](uint32_t id) {
+        const size_t len = m_names[id].len;
+        return len > q.size() ? len - q.size() : q.size() - len;
+    };
+    std::sort(out.begin(), out.end(), [&](uint32_t a, uint32_t b) {
+        if (hits[a] != hits[b]) return hits[a] > hits[b];
+        if (gap(a) != gap(b)) return gap(a) < gap(b);
+        return a < b;
+    });
+    if (out.size() > kMaxFuzzy) out.resize(kMaxFuzzy);
+    return false;
+}
+
+void FileSearch::SetFiles(const FileList& files)
+{
+    Stop();
+    m_files = files;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_gen;
+    }
+    m_reached  = 0;
+    m_stop     = false;
+    m_building = true;
+    const uint32_t gen = m_gen;
+    m_thread = std::thread([this, gen] { Worker(gen); });
+}
+
+void FileSearch::Stop()
+{
+    m_stop = true;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void FileSearch::Query(const std::wstring& query, Result& out) const
+{
+    HDRV_TRACE_SCOPE("name search");
+    const int64_t t0 = TraceNowNs();
+    std::vector<uint32_t> ids;
+    out.indices.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        out.fuzzy = !m_index.Query(query, ids);
+        // names not yet reached in the current list have stale positions
+        for (uint32_t id : ids)
+            if (m_listGen[id] == m_gen) out.indices.push_back(m_listIndex[id]);
+    }
+    if (!out.fuzzy) std::sort(out.indices.begin(), out.indices.end());
+    out.ms = double(TraceNowNs() - t0) / 1e6;
+}
+
+void FileSearch::Worker(uint32_t gen)
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+    TraceSetThreadName("name index");
+    HDRV_TRACE_SCOPE("name index");
+    const int64_t t0 = TraceNowNs();
+    int added = 0, removed = 0;
+
+    // name ids by the new list's entry ids; the old list's entries it kept
+    std::vector<uint32_t> nameOf(m_files.size());
+    std::vector<uint8_t>  kept(m_indexed.size());
+    std::vector<uint32_t> fresh;
+
+    // in chunks, so a query typed meanwhile waits for one chunk at most
+    constexpr size_t kChunk = 4096;
+    for (size_t i0 = 0; i0 < m_files.size(); i0 += kChunk) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop) {
+            // the indexed list stays the old one, so take back what this run added
+            for (uint32_t name : fresh) m_index.Remove(name);
+            return;
+        }
+        const size_t i1 = std::min(m_files.size(), i0 + kChunk);
+        for (size_t i = i0; i < i1; ++i) {
+            const uint32_t id  = m_files.IdAt(i);
+            const int      old = m_indexed.Find(m_files[i]);
+            uint32_t name;
+            if (old >= 0) {
+                const uint32_t oldId = m_indexed.IdAt(size_t(old));
+                name = m_nameOf[oldId];
+                kept[oldId] = 1;
+            } else {
+                name = m_index.Add(m_files.Name(id));
+                fresh.push_back(name);
+                if (name >= m_listIndex.size()) {
+                    m_listIndex.resize(name + 1);
+                    m_listGen.resize(name + 1);
+                }
+                ++added;
+            }
+            nameOf[id]        = name;
+            m_listIndex[name] = int(i);
+            m_listGen[name]   = gen;
+        }
+        m_reached = int(i1);
+    }
+
+    {
+        // whatever the new list did not keep has left it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t oldId = 0; oldId < kept.size(); ++oldId) {
+            if (kept[oldId]) continue;
+            m_index.Remove(m_nameOf[oldId]);
+            ++removed;
+        }
+    }
+    m_indexed = m_files;
+    m_nameOf.swap(nameOf);
+
+    m_added    = added;
+    m_removed  = removed;
+    m_syncMs   = double(TraceNowNs() - t0) / 1e6;
+    m_building = false;
+    ++m_done;
+}
@@ -0,0 +1,94 @@
+// src/file_search.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "file_list.h"
+
+// Case-insensitive index of file names by their three-character substrings
+// (trigrams). Each trigram keeps an ascending list of the names containing
+// it, so a query intersects a few lists, shortest first, and compares only
+// the names left over. Names come and go one at a time; removed ones are
+// skipped until there are enough of them to compact the lists and the
+// name arena.
+class NameIndex {
+public:
+    uint32_t Add(const std::wstring& name);     // returns the name's id
+    void     Remove(uint32_t id);
+    size_t   Size() const { return m_live; }
+
+    // Ids of the names containing `query`, ascending. Returns false when
+    // there are none: `out` then holds the names sharing most of the
+    // query's trigrams, best first, which catches typos and swapped digits.
+    bool Query(const std::wstring& query, std::vector<uint32_t>& out) const;
+
+private:
+    void Compact();
+
+    struct Span { uint32_t off, len; };
+
+    std::vector<wchar_t>      m_chars;          // lowercased names back to back
+    std::vector<Span>         m_names;          // by id, into m_chars
+    std::vector<uint8_t>      m_alive;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_postings;
+    size_t m_live = 0, m_dead = 0;
+};
+
+// Keeps a NameIndex of file names in step with the viewer's file list.
+// SetFiles() returns at once; a background thread diffs the new list
+// against the indexed one through its path hash, indexing only the files
+// that were added and dropping the ones that went, so a re-sort or a
+// library refresh costs a lookup per file. Query() may run meanwhile and answers from the files
+// of the new list reached so far.
+class FileSearch {
+public:
+    ~FileSearch() { Stop(); }
+
+    void SetFiles(const FileList& files);
+    void Stop();
+
+    struct Result {
+        std::vector<int> indices;   // into the list last given to SetFiles
+        bool             fuzzy = false;
+        double           ms    = 0.0;
+    };
+    // Substring matches in list order, else fuzzy ones best first
+    void Query(const std::wstring& query, Result& out) const;
+
+    bool     Building()   const { return m_building; }
+    int      Indexed()    const { return m_reached; }
+    int      Total()      const { return int(m_files.size()); }
+    // Bumped each time a list is fully indexed
+    uint32_t Generation() const { return m_done; }
+
+    // Last completed sync
+    int    Added()   const { return m_added; }
+    int    Removed() const { return m_removed; }
+    double SyncMs()  const { return m_syncMs; }
+
+private:
+    void Worker(uint32_t gen);
+
+    FileList                  m_files;          // the list being (or last) indexed
+    FileList                  m_indexed;        // the last list indexed in full (worker only)
+    std::vector<uint32_t>     m_nameOf;         // m_indexed id -> name id (worker only)
+
+    mutable std::mutex        m_mutex;          // guards the members below
+    NameIndex                 m_index;
+    std::vector<int>          m_listIndex;      // id -> position in m_files
+    std::vector<uint32_t>     m_listGen;        // id -> list that position is from
+    uint32_t                  m_gen = 0;
+
+    std::atomic<int>          m_reached{0};
+    std::atomic<uint32_t>     m_done{0};
+    std::atomic<bool>         m_building{false};
+    std::atomic<bool>         m_stop{false};
+    std::atomic<int>          m_added{0}, m_removed{0};
+    std::atomic<double>       m_syncMs{0.0};
+    std::thread               m_thread;
+};
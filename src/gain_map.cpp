@@ -0,0 +1,331 @@
+// src/gain_map.cpp
+#include "gain_map.h"
+#include "half_float.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stb_image.h"
+
+namespace {
+
+constexpr int kGainSteps = 1024;    // boost table entries per channel
+
+inline int ReadBE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+// Leading APP segment whose payload starts with `sig` (sigLen bytes,
+// NULs included); false once the scan is reached
+bool FindAppSegment(const uint8_t* d, size_t len, int marker, const char* sig, size_t sigLen,
+                    const uint8_t*& payload, size_t& payloadLen)
+{
+    if (len < 4 || d[0] != 0xFF || d[1] != 0xD8) return false;
+    size_t pos = 2;
+    while (pos + 4 <= len && d[pos] == 0xFF) {
+        const int m = d[pos + 1];
+        if (m == 0xDA || m == 0xD9) return false;
+        const size_t segLen = size_t(ReadBE16(d + pos + 2));
+        if (segLen < 2) return false;
+        if (m == marker && segLen >= 2 + sigLen && pos + 2 + segLen <= len &&
+            std::memcmp(d + pos + 4, sig, sigLen) == 0) {
+            payload    = d + pos + 4 + sigLen;
+            payloadLen = segLen - 2 - sigLen;
+            return true;
+        }
+        pos += 2 + segLen;
+    }
+    return false;
+}
+
+bool FindXmp(const uint8_t* d, size_t len, std::string_view& xmp)
+{
+    static const char kSig[] = "http://ns.adobe.com/xap/1.0/";
+    const uint8_t* p = nullptr;
+    size_t n = 0;
+    if (!FindAppSegment(d, len, 0xE1, kSig, sizeof(kSig), p, n)) return false;
+    xmp = std::string_view(reinterpret_cast<const char*>(p), n);
+    return true;
+}
+
+// Second image of the MP Index IFD (tag 0xB002, 16-byte entries of
+// attribute, size, offset, two dependents). Offsets count from the TIFF
+// header that follows "MPF\0".
+bool FindMpfImage(const uint8_t* d, size_t len, uint64_t& offset, uint64_t& size)
+{
+    const uint8_t* t = nullptr;
+    size_t tlen = 0;
+    if (!FindAppSegment(d, len, 0xE2, "MPF", 4, t, tlen) || tlen < 8) return false;
+    bool le;
+    if (t[0] == 'I' && t[1] == 'I')      le = true;
+    else if (t[0] == 'M' && t[1] == 'M') le = false;
+    else return false;
+    auto u16 = [&](size_t off) {
+        return le ? uint32_t(t[off] | (t[off + 1] << 8)) : uint32_t((t[off] << 8) | t[off + 1]);
+    };
+    auto u32 = [&](size_t off) {
+        return le ? u16(off) | (u16(off + 2) << 16) : (u16(off) << 16) | u16(off + 2);
+    };
+    if (u16(2) != 42) return false;
+    const size_t ifd = u32(4);
+    if (ifd + 2 > tlen) return false;
+    const uint32_t n = u16(ifd);
+    if (ifd + 2 + size_t(n) * 12 > tlen) return false;
+    for (uint32_t i = 0; i < n; ++i) {
+        const size_t e = ifd + 2 + size_t(i) * 12;
+        if (u16(e) != 0xB002) continue;
+        const size_t count = u32(e + 4), at = u32(e + 8);
+        if (count < 32 || at + 32 > tlen) return false;
+        size   = u32(at + 16 + 4);
+        offset = u32(at + 16 + 8);
+        if (offset == 0 || size == 0) return false;
+        offset += uint64_t(t - d);
+        return true;
+    }
+    return false;
+}
+
+// Body of hdrgm:`name`, written either as an attribute or as an element
+bool XmpField(std::string_view xmp, const char* name, std::string_view& body)
+{
+    const std::string key = std::string("hdrgm:") + name;
+    for (size_t at = xmp.find(key); at != std::string_view::npos; at = xmp.find(key, at + 1)) {
+        const size_t p = at + key.size();
+        if (p + 1 >= xmp.size()) return false;
+        if (xmp[p] == '=' && (xmp[p + 1] == '"' || xmp[p + 1] == '\'')) {
+            const size_t end = xmp.find(xmp[p + 1], p + 2);
+            if (end == std::string_view::npos) return false;
+            body = xmp.substr(p + 2, end - p - 2);
+            return true;
+        }
+        if (xmp[p] == '>' && at > 0 && xmp[at - 1] == '<') {
+            const size_t end = xmp.find("</" + key, p);
+            if (end == std::string_view::npos) return false;
+            body = xmp.substr(p + 1, end - p - 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+float ParseFloat(std::string_view s)
+{
+    char buf[48] = {};
+    std::memcpy(buf, s.data(), std::min(s.size(), sizeof(buf) - 1));
+    return std::strtof(buf, nullptr);
+}
+
+// Up to three numbers for hdrgm:`name`, one per rdf:li when it is a list;
+// how many were found
+int XmpValues(std::string_view xmp, const char* name, float v[3])
+{
+    std::string_view body;
+    if (!XmpField(xmp, name, body)) return 0;
+    int n = 0;
+    for (size_t li = body.find("<rdf:li"); li != std::string_view::npos && n < 3; li = body.find("<rdf:li", li + 1)) {
+        const size_t open = body.find('>', li);
+        if (open == std::string_view::npos) break;
+        v[n++] = ParseFloat(body.substr(open + 1));
+    }
+    if (n == 0) v[n++] = ParseFloat(body);
+    return n;
+}
+
+// Read hdrgm:`name` into `dst` (three channels) if present
+void ReadChannels(std::string_view xmp, const char* name, float dst[3], int& channels)
+{
+    float v[3];
+    const int n = XmpValues(xmp, name, v);
+    if (n == 0) return;
+    for (int c = 0; c < 3; ++c) dst[c] = n == 3 ? v[c] : v[0];
+    if (n == 3) channels = 3;
+}
+
+// Length of the GainMap item in the primary's XMP container directory
+bool FindContainerLength(std::string_view xmp, uint64_t& length)
+{
+    const size_t sem = xmp.find("Item:Semantic=\"GainMap\"");
+    if (sem == std::string_view::npos) return false;
+    const size_t open = xmp.rfind('<', sem), close = xmp.find('>', sem);
+    if (open == std::string_view::npos || close == std::string_view::npos) return false;
+    const std::string_view item = xmp.substr(open, close - open);
+    const size_t at = item.find("Item:Length=\"");
+    if (at == std::string_view::npos) return false;
+    char buf[24] = {};
+    const std::string_view digits = item.substr(at + 13);
+    std::memcpy(buf, digits.data(), std::min(digits.size(), sizeof(buf) - 1));
+    length = std::strtoull(buf, nullptr, 10);
+    return length > 0;
+}
+
+// Everything a pass needs besides the pixels: channel c of a pixel with
+// base code z and interpolated map value g comes out as
+// sdr[c][z] * mult[c][g * kGainSteps / 255] - offsetHdr[c]
+struct GainTables {
+    float mult[3][kGainSteps + 1];
+    float sdr[3][256];              // linear base plus offsetSdr
+    float alpha[256];
+};
+
+void BuildTables(const GainMapMetadata& m, float weight, GainTables& t)
+{
+    for (int z = 0; z < 256; ++z) {
+        const double v = z / 255.0;
+        const float lin = float(v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4));
+        for (int c = 0; c < 3; ++c) t.sdr[c][z] = lin + m.offsetSdr[c];
+        t.alpha[z] = z / 255.0f;
+    }
+    for (int c = 0; c < 3; ++c) {
+        const double invGamma = 1.0 / std::max(m.gamma[c], 1e-3f);
+        for (int i = 0; i <= kGainSteps; ++i) {
+            const double r = std::pow(double(i) / kGainSteps, invGamma);
+            const double logBoost = m.gainMapMin[c] + (m.gainMapMax[c] - m.gainMapMin[c]) * r;
+            t.mult[c][i] = float(std::exp2(logBoost * weight));
+        }
+    }
+}
+
+} // namespace
+
+bool FindGainMapImage(const uint8_t* jpeg, size_t len, uint64_t fileLen, uint64_t& offset, uint64_t& size)
+{
+    if (!FindMpfImage(jpeg, len, offset, size)) {
+        std::string_view xmp;
+        if (!FindXmp(jpeg, len, xmp) || !FindContainerLength(xmp, size) || size >= fileLen) return false;
+        offset = fileLen - size;    // the gain map is the container's last item
+    }
+    return size >= 4 && offset + size <= fileLen;
+}
+
+bool ParseGainMapMetadata(const uint8_t* jpeg, size_t len, GainMapMetadata& out)
+{
+    std::string_view xmp;
+    if (!FindXmp(jpeg, len, xmp)) return false;
+    GainMapMetadata m;
+    float v[3];
+    if (XmpValues(xmp, "GainMapMax", v) == 0) return false;
+    ReadChannels(xmp, "GainMapMax", m.gainMapMax, m.channels);
+    ReadChannels(xmp, "GainMapMin", m.gainMapMin, m.channels);
+    ReadChannels(xmp, "Gamma", m.gamma, m.channels);
+    ReadChannels(xmp, "OffsetSDR", m.offsetSdr, m.channels);
+    ReadChannels(xmp, "OffsetHDR", m.offsetHdr, m.channels);
+    // capacity defaults to the largest boost in the map
+    m.hdrCapacityMax = std::max({ m.gainMapMax[0], m.gainMapMax[1], m.gainMapMax[2] });
+    if (XmpValues(xmp, "HDRCapacityMax", v) > 0) m.hdrCapacityMax = v[0];
+    if (XmpValues(xmp, "HDRCapacityMin", v) > 0) m.hdrCapacityMin = v[0];
+    std::string_view body;
+    if (XmpField(xmp, "BaseRenditionIsHDR", body))
+        m.baseIsHdr = !body.empty() && (body[0] == 'T' || body[0] == 't');
+    out = m;
+    return true;
+}
+
+bool DecodeGainMap(const uint8_t* primary, size_t primaryLen, const uint8_t* gain, size_t gainLen, GainMap& out)
+{
+    HDRV_TRACE_SCOPE("gain map decode");
+    const int64_t t0 = TraceNowNs();
+    GainMapMetadata meta;
+    if (!ParseGainMapMetadata(gain, gainLen, meta) && !ParseGainMapMetadata(primary, primaryLen, meta))
+        return false;
+    if (meta.baseIsHdr) return false;   // would need the inverse map; show the base
+    int w = 0, h = 0, comp = 0;
+    unsigned char* px = stbi_load_from_memory(gain, int(gainLen), &w, &h, &comp, 4);
+    if (!px) return false;
+    out.rgba.assign(px, px + size_t(w) * h * 4);
+    stbi_image_free(px);
+    out.w        = w;
+    out.h        = h;
+    out.meta     = meta;
+    out.decodeMs = double(TraceNowNs() - t0) / 1e6;
+    return true;
+}
+
+float GainMapWeight(const GainMapMetadata& m, float boost)
+{
+    const float logBoost = std::log2(std::max(boost, 1.0f));
+    const float span = m.hdrCapacityMax - m.hdrCapacityMin;
+    if (span <= 0.0f) return logBoost >= m.hdrCapacityMax ? 1.0f : 0.0f;
+    return std::clamp((logBoost - m.hdrCapacityMin) / span, 0.0f, 1.0f);
+}
+
+void ApplyGainMap(const uint8_t* base, int w, int h, const GainMap& gm, float weight, PixelBuffer& rgba16)
+{
+    HDRV_TRACE_SCOPE("gain map apply");
+    auto t = std::make_unique<GainTables>();
+    BuildTables(gm.meta, weight, *t);
+    rgba16.resize(size_t(w) * h * 8);
+
+    // map columns under each output column, same for every row
+    std::vector<int>   cx(size_t(w) * 2);
+    std::vector<float> cw(w);
+    for (int x = 0; x < w; ++x) {
+        const float fx = std::max(0.0f, (x + 0.5f) * gm.w / w - 0.5f);
+        const int x0 = std::min(int(fx), gm.w - 1);
+        cx[size_t(x) * 2]     = x0 * 4;
+        cx[size_t(x) * 2 + 1] = std::min(x0 + 1, gm.w - 1) * 4;
+        cw[size_t(x)]         = x0 < gm.w - 1 ? fx - x0 : 0.0f;
+    }
+    const float scale = float(kGainSteps) / 255.0f;
+    const float* off = gm.meta.offsetHdr;
+
+    ParallelForBands(h, 16, [&](int, int y0, int y1) {
+        const GainTables& tb = *t;
+        // the two map rows under an output row, blended vertically once
+        std::vector<float> vrow(size_t(gm.w) * 4);
+        for (int y = y0; y < y1; ++y) {
+            const float fy = std::max(0.0f, (y + 0.5f) * gm.h / h - 0.5f);
+            const int my = std::min(int(fy), gm.h - 1);
+            const float wy = my < gm.h - 1 ? fy - my : 0.0f;
+            const uint8_t* r0 = gm.rgba.data() + size_t(my) * gm.w * 4;
+            const uint8_t* r1 = gm.rgba.data() + size_t(std::min(my + 1, gm.h - 1)) * gm.w * 4;
+            const uint8_t* src = base + size_t(y) * w * 4;
+            uint16_t* dst = reinterpret_cast<uint16_t*>(rgba16.data()) + size_t(y) * w * 4;
+#ifdef HDRV_HALF_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 vwy = _mm_set1_ps(wy);
+            for (int gx = 0; gx < gm.w; ++gx) {
+                int32_t a, b;
+                std::memcpy(&a, r0 + gx * 4, 4);
+                std::memcpy(&b, r1 + gx * 4, 4);
+                const __m128 fa = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), zero), zero));
+                const __m128 fb = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(b), zero), zero));
+                _mm_storeu_ps(vrow.data() + gx * 4, _mm_add_ps(fa, _mm_mul_ps(_mm_sub_ps(fb, fa), vwy)));
+            }
+            const __m128 vscale = _mm_set1_ps(scale);
+            const __m128 voff = _mm_setr_ps(off[0], off[1], off[2], 0.0f);
+            const __m128 vmax = _mm_set1_ps(kHalfMax);
+            alignas(16) int32_t idx[4];
+            for (int x = 0; x < w; ++x) {
+                const __m128 g0 = _mm_loadu_ps(vrow.data() + cx[size_t(x) * 2]);
+                const __m128 g1 = _mm_loadu_ps(vrow.data() + cx[size_t(x) * 2 + 1]);
+                const __m128 g = _mm_add_ps(g0, _mm_mul_ps(_mm_sub_ps(g1, g0), _mm_set1_ps(cw[size_t(x)])));
+                _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_cvtps_epi32(_mm_mul_ps(g, vscale)));
+                const uint8_t* px = src + x * 4;
+                const __m128 s = _mm_setr_ps(tb.sdr[0][px[0]], tb.sdr[1][px[1]], tb.sdr[2][px[2]], tb.alpha[px[3]]);
+                const __m128 m = _mm_setr_ps(tb.mult[0][idx[0]], tb.mult[1][idx[1]], tb.mult[2][idx[2]], 1.0f);
+                const __m128 v = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(s, m), voff), _mm_setzero_ps()), vmax);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), FloatToHalf4(v));
+            }
+#else
+            for (int i = 0; i < gm.w * 4; ++i) vrow[size_t(i)] = r0[i] + (float(r1[i]) - r0[i]) * wy;
+            for (int x = 0; x < w; ++x) {
+                const float* g0 = vrow.data() + cx[size_t(x) * 2];
+                const float* g1 = vrow.data() + cx[size_t(x) * 2 + 1];
+                const float wx = cw[size_t(x)];
+                const uint8_t* px = src + x * 4;
+                for (int c = 0; c < 3; ++c) {
+                    const int i = int((g0[c] + (g1[c] - g0[c]) * wx) * scale + 0.5f);
+                    dst[x * 4 + c] = FloatToHalf(std::max(0.0f, tb.sdr[c][px[c]] * tb.mult[c][i] - off[c]));
+                }
+                dst[x * 4 + 3] = FloatToHalf(tb.alpha[px[3]]);
+            }
+#endif
+        }
+    });
+}
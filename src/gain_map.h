@@ -0,0 +1,56 @@
+// src/gain_map.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "buffer_pool.h"
+
+// Gain map parameters from the XMP hdrgm namespace (Adobe gain map, Ultra
+// HDR). Boosts are log2; values given once apply to all three channels.
+struct GainMapMetadata {
+    float gainMapMin[3] = { 0.0f, 0.0f, 0.0f };
+    float gainMapMax[3] = { 1.0f, 1.0f, 1.0f };
+    float gamma[3]      = { 1.0f, 1.0f, 1.0f };
+    float offsetSdr[3]  = { 1.0f / 64, 1.0f / 64, 1.0f / 64 };
+    float offsetHdr[3]  = { 1.0f / 64, 1.0f / 64, 1.0f / 64 };
+    float hdrCapacityMin = 0.0f;
+    float hdrCapacityMax = 1.0f;
+    bool  baseIsHdr = false;
+    int   channels  = 1;        // 3 when any value was given per channel
+};
+
+// Byte range of the gain map JPEG inside a gain map JPEG file, from the
+// primary image's MPF (APP2) index, or failing that the XMP GContainer
+// item length counted back from the end of the file. Only the leading
+// bytes up to the first scan are needed; `fileLen` is the whole file's.
+bool FindGainMapImage(const uint8_t* jpeg, size_t len, uint64_t fileLen, uint64_t& offset, uint64_t& size);
+
+// hdrgm parameters from a JPEG's XMP (APP1) packet, as attributes,
+// elements or per-channel rdf:Seq lists. False without hdrgm:GainMapMax.
+bool ParseGainMapMetadata(const uint8_t* jpeg, size_t len, GainMapMetadata& out);
+
+// A decoded gain map, RGBA8 (single-channel maps replicated), stored in
+// the same orientation as the base image
+struct GainMap {
+    PixelBuffer     rgba;
+    int             w = 0, h = 0;
+    GainMapMetadata meta;
+    double          decodeMs = 0.0;
+};
+
+// Decode `gain` (the bytes FindGainMapImage located) and its metadata,
+// which is read from the gain map image and else from `primary`'s leading
+// bytes. False when either is missing or the base rendition is the HDR one.
+bool DecodeGainMap(const uint8_t* primary, size_t primaryLen, const uint8_t* gain, size_t gainLen, GainMap& out);
+
+// How much of the map to apply on a display that reaches `boost` times SDR
+// white: 0 at hdrCapacityMin and below, 1 at hdrCapacityMax and above
+float GainMapWeight(const GainMapMetadata& m, float boost);
+
+// HDR rendition of `base` (RGBA8 sRGB, w x h) as RGBA16F in linear light
+// with SDR white at 1.0. The map is resampled bilinearly to w x h, so the
+// base can be at any size: full resolution, clamped to the texture limit,
+// or a preview. Boosts come from a 1024-step table per channel; rows are
+// split across all cores and each pixel's channels go through SSE2
+// together.
+void ApplyGainMap(const uint8_t* base, int w, int h, const GainMap& gm, float weight, PixelBuffer& rgba16);
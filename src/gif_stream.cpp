@@ -0,0 +1,382 @@
+// src/gif_stream.cpp
+#include "gif_stream.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Browsers treat 0/10 ms delays as "as fast as possible" and slow them down
+constexpr int kMinDelayMs     = 20;
+constexpr int kDefaultDelayMs = 100;
+
+inline int ReadLE16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+// Skip a chain of data sub-blocks; returns nullptr if it runs off the end
+const uint8_t* SkipSubBlocks(const uint8_t* p, const uint8_t* end)
+{
+    while (p < end) {
+        const int n = *p++;
+        if (n == 0) return p;
+        if (end - p < n) return nullptr;
+        p += n;
+    }
+    return nullptr;
+}
+
+// GIF LZW: variable code width from minCodeSize+1 up to 12 bits, LSB first.
+// Strings are written back to front by walking the prefix chain, so each
+// output byte is touched once. Returns the number of indices produced.
+size_t DecodeLzw(const uint8_t* in, size_t inLen, int minCodeSize, uint8_t* out, size_t outLen)
+{
+    static thread_local uint16_t prefix[4096];
+    static thread_local uint8_t  suffix[4096];
+    static thread_local uint8_t  first[4096];
+    static thread_local uint16_t length[4096];
+
+    const int clear = 1 << minCodeSize;
+    const int eoi   = clear + 1;
+    for (int i = 0; i < clear; ++i) {
+        suffix[i] = first[i] = uint8_t(i);
+        length[i] = 1;
+    }
+
+    int codeSize = minCodeSize + 1;
+    int next     = clear + 2;
+    int prev     = -1;
+    uint32_t bitbuf = 0;
+    int      bitcnt = 0;
+    size_t   pos = 0, o = 0;
+
+    for (;;) {
+        while (bitcnt < codeSize) {
+            if (pos == inLen) return o;
+            bitbuf |= uint32_t(in[pos++]) << bitcnt;
+            bitcnt += 8;
+        }
+        const int code = int(bitbuf & ((1u << codeSize) - 1));
+        bitbuf >>= codeSize;
+        bitcnt -= codeSize;
+
+        if (code == clear) {
+            codeSize = minCodeSize + 1;
+            next     = clear + 2;
+            prev     = -1;
+            continue;
+        }
+        if (code == eoi) return o;
+
+        int emit;
+        if (prev < 0) {
+            if (code >= clear) return o;
+            emit = code;
+        } else {
+            if (code > next || (code == next && next >= 4096)) return o;
+            if (next < 4096) {
+                prefix[next] = uint16_t(prev);
+                first[next]  = first[prev];
+                suffix[next] = code == next ? first[prev] : first[code];
+                length[next] = uint16_t(length[prev] + 1);
+                ++next;
+                if (next == (1 << codeSize) && codeSize < 12) ++codeSize;
+            }
+            emit = code;
+        }
+
+        // write the string for `emit` backwards, clipped to the frame
+        const size_t len = length[emit];
+        const size_t keep = std::min(len, outLen - o);
+        int c = emit;
+        for (size_t k = len; k-- > 0; c = prefix[c])
+            if (k < keep) out[o + k] = suffix[c];
+        o += keep;
+        if (o == outLen) return o;
+        prev = code;
+    }
+}
+
+} // namespace
+
+bool GifDecoder::Open(const uint8_t* data, size_t len)
+{
+    if (len < 13 || (std::memcmp(data, "GIF87a", 6) != 0 && std::memcmp(data, "GIF89a", 6) != 0))
+        return false;
+    m_data = data;
+    m_end  = data + len;
+    m_w    = ReadLE16(data + 6);
+    m_h    = ReadLE16(data + 8);
+    if (m_w <= 0 || m_h <= 0) return false;
+
+    const int packed = data[10];
+    const uint8_t* p = data + 13;
+    m_globalPalSize = 0;
+    if (packed & 0x80) {
+        m_globalPalSize = 2 << (packed & 7);
+        if (m_end - p < m_globalPalSize * 3) return false;
+        std::memcpy(m_globalPal, p, size_t(m_globalPalSize) * 3);
+        p += m_globalPalSize * 3;
+    }
+    m_firstBlock = p;
+
+    // the loop extension normally sits right before the first frame
+    m_loops = -1;
+    while (p && p < m_end && *p == 0x21 && m_end - p >= 2) {
+        if (p[1] == 0xFF && m_end - p >= 19 && p[2] == 11 &&
+            std::memcmp(p + 3, "NETSCAPE2.0", 11) == 0 && p[14] == 3 && p[15] == 1) {
+            m_loops = ReadLE16(p + 16);
+        }
+        p = SkipSubBlocks(p + 2, m_end);
+    }
+
+    Rewind();
+    return true;
+}
+
+int GifDecoder::CountFrames() const
+{
+    int frames = 0;
+    const uint8_t* p = m_firstBlock;
+    while (p && p < m_end) {
+        const int block = *p++;
+        if (block == 0x3B) break;
+        if (block == 0x21) {
+            if (p == m_end) break;
+            p = SkipSubBlocks(p + 1, m_end);
+        } else if (block == 0x2C) {
+            if (m_end - p < 10) break;
+            const int packed = p[8];
+            p += 9;
+            if (packed & 0x80) p += (2 << (packed & 7)) * 3;
+            if (p >= m_end) break;
+            p = SkipSubBlocks(p + 1, m_end);             // min code size, then data
+            if (p) ++frames;
+        } else {
+            break;
+        }
+    }
+    return frames;
+}
+
+void GifDecoder::Rewind()
+{
+    m_p = m_firstBlock;
+    m_prevDisposal = 0;
+}
+
+bool GifDecoder::Next(uint8_t* canvas, int& delayMs)
+{
+    // dispose of the previous frame
+    if (m_prevDisposal == 2 || m_prevDisposal == 3) {
+        for (int y = 0; y < m_prevH; ++y) {
+            uint8_t* row = canvas + (size_t(m_prevY + y) * m_w + m_prevX) * 4;
+            if (m_prevDisposal == 2) std::memset(row, 0, size_t(m_prevW) * 4);
+            else std::memcpy(row, m_saved.data() + size_t(y) * m_prevW * 4, size_t(m_prevW) * 4);
+        }
+    }
+    m_prevDisposal = 0;
+
+    int disposal = 0, transparent = -1;
+    delayMs = kDefaultDelayMs;
+    while (m_p && m_p < m_end) {
+        const int block = *m_p++;
+        if (block == 0x2C) {
+            if (!DecodeImage(canvas, disposal, transparent)) {
+                m_p = nullptr;
+                return false;
+            }
+            return true;
+        }
+        if (block != 0x21 || m_p == m_end) break;     // trailer or garbage
+        const int label = *m_p;
+        if (label == 0xF9 && m_end - m_p >= 6 && m_p[1] == 4) {
+            const int packed = m_p[2];
+            disposal = (packed >> 2) & 7;
+            const int delay = ReadLE16(m_p + 3) * 10;
+            delayMs = delay < kMinDelayMs ? kDefaultDelayMs : delay;
+            if (packed & 1) transparent = m_p[5];
+        }
+        m_p = SkipSubBlocks(m_p + 1, m_end);
+    }
+    m_p = nullptr;
+    return false;
+}
+
+bool GifDecoder::DecodeImage(uint8_t* canvas, int disposal, int transparent)
+{
+    if (m_end - m_p < 10) return false;
+    const int fx = ReadLE16(m_p), fy = ReadLE16(m_p + 2);
+    const int fw = ReadLE16(m_p + 4), fh = ReadLE16(m_p + 6);
+    const int packed = m_p[8];
+    m_p += 9;
+
+    const uint8_t* pal = m_globalPal;
+    int palSize = m_globalPalSize;
+    if (packed & 0x80) {
+        palSize = 2 << (packed & 7);
+        if (m_end - m_p < palSize * 3) return false;
+        pal = m_p;
+        m_p += palSize * 3;
+    }
+    if (m_p == m_end) return false;
+    const int minCodeSize = *m_p++;
+    if (minCodeSize < 1 || minCodeSize > 11) return false;
+
+    // join the data sub-blocks
+    m_lzw.clear();
+    for (;;) {
+        if (m_p == m_end) return false;
+        const int n = *m_p++;
+        if (n == 0) break;
+        if (m_end - m_p < n) return false;
+        m_lzw.insert(m_lzw.end(), m_p, m_p + n);
+        m_p += n;
+    }
+
+    // frame rect clipped to the canvas
+    const int x0 = std::min(fx, m_w), y0 = std::min(fy, m_h);
+    const int x1 = std::min(fx + fw, m_w), y1 = std::min(fy + fh, m_h);
+    if (disposal == 3) {
+        m_saved.resize(size_t(x1 - x0) * size_t(y1 - y0) * 4);
+        for (int y = y0; y < y1; ++y)
+            std::memcpy(m_saved.data() + size_t(y - y0) * (x1 - x0) * 4,
+                        canvas + (size_t(y) * m_w + x0) * 4, size_t(x1 - x0) * 4);
+    }
+    m_prevDisposal = disposal;
+    m_prevX = x0; m_prevY = y0; m_prevW = x1 - x0; m_prevH = y1 - y0;
+
+    const size_t count = size_t(fw) * size_t(fh);
+    m_indices.resize(count);
+    const size_t got = DecodeLzw(m_lzw.data(), m_lzw.size(), minCodeSize, m_indices.data(), count);
+
+    // interlaced frames store rows in four passes: 0,8,16.. 4,12.. 2,6.. 1,3..
+    static const int kStart[4] = { 0, 4, 2, 1 };
+    static const int kStep[4]  = { 8, 8, 4, 2 };
+    const bool interlaced = (packed & 0x40) != 0;
+    int pass = 0, row = 0;
+    for (int r = 0; r < fh && size_t(r) * fw < got; ++r) {
+        int y = r;
+        if (interlaced) {
+            while (pass < 4 && kStart[pass] + row * kStep[pass] >= fh) { ++pass; row = 0; }
+            if (pass == 4) break;
+            y = kStart[pass] + row * kStep[pass];
+            ++row;
+        }
+        const int cy = fy + y;
+        if (cy >= m_h) continue;
+        const uint8_t* idx = m_indices.data() + size_t(r) * fw;
+        const int n = int(std::min<size_t>(size_t(fw), got - size_t(r) * fw));
+        uint8_t* dst = canvas + (size_t(cy) * m_w) * 4;
+        for (int x = 0; x < n; ++x) {
+            const int cx = fx + x;
+            if (cx >= m_w) break;
+            const int i = idx[x];
+            if (i == transparent || i >= palSize) continue;
+            uint8_t* px = dst + size_t(cx) * 4;
+            px[0] = pal[i * 3 + 0];
+            px[1] = pal[i * 3 + 1];
+            px[2] = pal[i * 3 + 2];
+            px[3] = 255;
+        }
+    }
+    return true;
+}
+
+// ------------------------------------------------
+
+bool GifPlayer::Start(PixelBuffer&& file)
+{
+    Stop();
+    m_file = std::move(file);
+    if (!m_dec.Open(m_file.data(), m_file.size())) return false;
+    m_frameCount = m_dec.CountFrames();
+    if (m_frameCount < 2) return false;
+
+    const size_t frameBytes = size_t(m_dec.Width()) * m_dec.Height() * 4;
+    for (Slot& s : m_ring) {
+        s.rgba.resize(frameBytes);
+        s.state = SlotState::Free;
+    }
+    m_write = m_read = 0;
+    m_showing = -1;
+    m_stop = m_done = false;
+    m_nextAt = {};
+    m_thread = std::thread(&GifPlayer::Worker, this);
+    return true;
+}
+
+void GifPlayer::Stop()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    for (Slot& s : m_ring) PixelBuffer().swap(s.rgba);
+    PixelBuffer().swap(m_file);
+    m_frameCount = 0;
+}
+
+void GifPlayer::Worker()
+{
+    const size_t frameBytes = size_t(m_dec.Width()) * m_dec.Height() * 4;
+    PixelBuffer canvas(frameBytes);
+    std::memset(canvas.data(), 0, frameBytes);
+    int loopsLeft = m_dec.LoopCount();      // 0 = forever, -1 = once
+    TraceSetThreadName("gif");
+
+    for (;;) {
+        int delayMs = 0;
+        const int64_t t0 = TraceNowNs();
+        if (!m_dec.Next(canvas.data(), delayMs)) {
+            if (loopsLeft < 0 || loopsLeft == 1) break;
+            if (loopsLeft > 1) --loopsLeft;
+            m_dec.Rewind();
+            std::memset(canvas.data(), 0, frameBytes);
+            if (!m_dec.Next(canvas.data(), delayMs)) break;
+        }
+        TraceRecord("gif frame", t0, TraceNowNs());     // decode only, not the wait below
+
+        Slot& slot = m_ring[m_write];
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stop || slot.state == SlotState::Free; });
+            if (m_stop) return;
+        }
+        // the slot is ours until we mark it Ready
+        std::memcpy(slot.rgba.data(), canvas.data(), frameBytes);
+        slot.delayMs = delayMs;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot.state = SlotState::Ready;
+        }
+        m_write = (m_write + 1) % kRingSize;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+}
+
+const uint8_t* GifPlayer::Poll(std::chrono::steady_clock::time_point now)
+{
+    if (!Active()) return nullptr;
+    if (m_showing >= 0 && now < m_nextAt) return nullptr;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Slot& next = m_ring[m_read];
+    if (next.state != SlotState::Ready) return nullptr;     // decoder behind (or finished)
+
+    if (m_showing >= 0) m_ring[m_showing].state = SlotState::Free;
+    next.state = SlotState::Showing;
+    m_showing  = m_read;
+    m_read     = (m_read + 1) % kRingSize;
+    lock.unlock();
+    m_cv.notify_all();
+
+    // keep the schedule unless we fell far behind (window dragged, etc.)
+    const auto delay = std::chrono::milliseconds(next.delayMs);
+    m_nextAt = (m_nextAt + delay < now) ? now + delay : m_nextAt + delay;
+    return next.rgba.data();
+}
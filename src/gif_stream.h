@@ -0,0 +1,103 @@
+// src/gif_stream.h
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// Frame-at-a-time GIF decoder. Each Next() parses one image block, LZW-
+// decodes it and composes it onto the caller's canvas, applying the previous
+// frame's disposal first. State between calls is the read position plus a
+// copy of the area a "restore to previous" frame will need, so memory does
+// not depend on the frame count.
+class GifDecoder {
+public:
+    // `data` must outlive the decoder. Reads the header and global palette.
+    bool Open(const uint8_t* data, size_t len);
+    int  Width()  const { return m_w; }
+    int  Height() const { return m_h; }
+    // NETSCAPE2.0 loop count: 0 = forever, -1 = no extension (play once)
+    int  LoopCount() const { return m_loops; }
+
+    // Walk the block structure without decoding pixels
+    int  CountFrames() const;
+
+    // Compose the next frame onto `canvas` (Width*Height*4 RGBA8, kept by the
+    // caller between calls). False at the trailer or on a corrupt block.
+    bool Next(uint8_t* canvas, int& delayMs);
+
+    // Back to the first frame; the caller clears its canvas
+    void Rewind();
+
+private:
+    bool DecodeImage(uint8_t* canvas, int disposal, int transparent);
+
+    const uint8_t* m_data = nullptr;
+    const uint8_t* m_end  = nullptr;
+    const uint8_t* m_p    = nullptr;
+    const uint8_t* m_firstBlock = nullptr;
+    int  m_w = 0, m_h = 0;
+    int  m_loops = -1;
+    uint8_t m_globalPal[256 * 3] = {};
+    int  m_globalPalSize = 0;
+
+    // previous frame's disposal, applied at the start of the next Next()
+    int  m_prevDisposal = 0;
+    int  m_prevX = 0, m_prevY = 0, m_prevW = 0, m_prevH = 0;
+    std::vector<uint8_t> m_saved;       // canvas rect for disposal 3
+    std::vector<uint8_t> m_indices;     // one frame's palette indices
+    std::vector<uint8_t> m_lzw;         // one frame's sub-blocks joined
+};
+
+// Plays an animated GIF from a worker thread. The worker decodes ahead into
+// a ring of kRingSize composed frames and blocks when the ring is full, so
+// memory is the file plus a handful of frames however long the animation.
+// The render loop calls Poll() every frame; per-frame delays are honoured
+// there against the steady clock.
+class GifPlayer {
+public:
+    static constexpr int kRingSize = 3;
+
+    ~GifPlayer() { Stop(); }
+
+    // Takes the whole file. Returns false (and stays idle) for still or
+    // unreadable GIFs.
+    bool Start(PixelBuffer&& file);
+    void Stop();
+    bool Active() const { return m_thread.joinable(); }
+    int  Width()  const { return m_dec.Width(); }
+    int  Height() const { return m_dec.Height(); }
+    int  FrameCount() const { return m_frameCount; }
+
+    // The frame to show now if it changed since the last call, else nullptr.
+    // The pointer stays valid until the next Poll()/Stop().
+    const uint8_t* Poll(std::chrono::steady_clock::time_point now);
+
+private:
+    enum class SlotState { Free, Ready, Showing };
+    struct Slot {
+        PixelBuffer rgba;
+        int         delayMs = 100;
+        SlotState   state   = SlotState::Free;
+    };
+
+    void Worker();
+
+    PixelBuffer             m_file;
+    GifDecoder              m_dec;
+    int                     m_frameCount = 0;
+    Slot                    m_ring[kRingSize];
+    int                     m_write = 0, m_read = 0;
+    int                     m_showing = -1;
+    bool                    m_stop = false;
+    bool                    m_done = false;
+    std::chrono::steady_clock::time_point m_nextAt;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::thread             m_thread;
+};
@@ -0,0 +1,116 @@
+// src/grid_view.cpp
+#include "grid_view.h"
+
+#include <algorithm>
+#include <cmath>
+
+void GridLayout::Compute(int screenW, int screenHeight, int itemCount)
+{
+    count   = itemCount;
+    screenH = float(screenHeight);
+    cols    = std::max(1, int((screenW - kGap) / Pitch()));
+    rows    = (count + cols - 1) / cols;
+    left    = (screenW - (cols * Pitch() - kGap)) * 0.5f;
+}
+
+float GridLayout::MaxScroll() const
+{
+    const float content = kMargin * 2.0f + rows * Pitch() - kGap;
+    return std::max(0.0f, content - screenH);
+}
+
+int GridLayout::VisibleRows() const
+{
+    return std::max(1, int((screenH - kMargin) / Pitch()));
+}
+
+void GridLayout::VisibleRange(float scrollY, int& firstRow, int& lastRow) const
+{
+    firstRow = std::max(0, int(std::floor((scrollY - kMargin) / Pitch())));
+    lastRow  = std::min(rows - 1, int(std::floor((scrollY + screenH - kMargin) / Pitch())));
+}
+
+int GridLayout::HitTest(float x, float y, float scrollY) const
+{
+    const float cx = x - left, cy = y + scrollY - kMargin;
+    if (cx < 0.0f || cy < 0.0f) return -1;
+    const int col = int(cx / Pitch()), row = int(cy / Pitch());
+    if (col >= cols || cx - col * Pitch() > kCell || cy - row * Pitch() > kCell) return -1;
+    const int index = row * cols + col;
+    return index < count ? index : -1;
+}
+
+float GridLayout::ScrollToShow(int index, float scrollY) const
+{
+    const float top = kMargin + (index / cols) * Pitch();
+    if (top - kGap < scrollY) scrollY = top - kGap;
+    else if (top + kCell + kGap > scrollY + screenH) scrollY = top + kCell + kGap - screenH;
+    return std::clamp(scrollY, 0.0f, MaxScroll());
+}
+
+std::vector<int> ThumbnailPriority(const GridLayout& g, float scrollY, int scrollDir, int ahead)
+{
+    std::vector<int> order;
+    if (g.rows == 0) return order;
+    int first, last;
+    g.VisibleRange(scrollY, first, last);
+
+    auto addRow = [&](int row) {
+        if (row < 0 || row >= g.rows) return;
+        const int end = std::min(g.count, (row + 1) * g.cols);
+        for (int i = row * g.cols; i < end; ++i) order.push_back(i);
+    };
+
+    // visible: middle row first, then alternately above and below it
+    const int mid = (first + last) / 2;
+    addRow(mid);
+    for (int d = 1; mid - d >= first || mid + d <= last; ++d) {
+        if (mid + d <= last)  addRow(mid + d);
+        if (mid - d >= first) addRow(mid - d);
+    }
+
+    const int behind = ahead / 2;
+    if (scrollDir < 0) {
+        for (int r = 1; r <= ahead; ++r)  addRow(first - r);
+        for (int r = 1; r <= behind; ++r) addRow(last + r);
+    } else {
+        for (int r = 1; r <= ahead; ++r)  addRow(last + r);
+        for (int r = 1; r <= behind; ++r) addRow(first - r);
+    }
+    return order;
+}
+
+void ThumbAtlas::Reset(int fileCount)
+{
+    for (Slot& s : m_slots) s = Slot{};
+    m_fileSlot.assign(size_t(std::max(0, fileCount)), -1);
+    m_used = 0;
+}
+
+int ThumbAtlas::Allocate(int file, int w, int h, uint64_t frame, int& evicted)
+{
+    evicted = -1;
+    if (file < 0 || size_t(file) >= m_fileSlot.size() || m_slots.empty()) return -1;
+
+    int slot = m_fileSlot[file];
+    if (slot < 0 && m_used < int(m_slots.size())) {
+        slot = m_used++;
+    } else if (slot < 0) {
+        // all pages full: recycle the slot drawn longest ago
+        for (int i = 0; i < int(m_slots.size()); ++i) {
+            if (m_slots[i].lastDrawn >= frame) continue;
+            if (slot < 0 || m_slots[i].lastDrawn < m_slots[slot].lastDrawn) slot = i;
+        }
+        if (slot < 0) return -1;
+        evicted = m_slots[slot].file;
+        if (evicted >= 0) m_fileSlot[evicted] = -1;
+    }
+
+    Slot& s = m_slots[slot];
+    s.file = file;
+    s.w    = std::min(w, kSlotSize);
+    s.h    = std::min(h, kSlotSize);
+    s.lastDrawn = frame;
+    m_fileSlot[file] = slot;
+    return slot;
+}
@@ -0,0 +1,85 @@
+// src/grid_view.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Contact-sheet layout: square cells in rows, centred horizontally,
+// scrolled vertically by `scrollY` pixels.
+struct GridLayout {
+    static constexpr float kCell   = 200.0f;    // thumbnail box
+    static constexpr float kGap    = 16.0f;
+    static constexpr float kMargin = 48.0f;     // above the first row
+
+    int   count = 0;
+    int   cols  = 1;
+    int   rows  = 0;
+    float left  = 0.0f;                         // x of the first column
+    float screenH = 0.0f;
+
+    void  Compute(int screenW, int screenHeight, int itemCount);
+
+    float Pitch() const { return kCell + kGap; }
+    float CellX(int index) const { return left + (index % cols) * Pitch(); }
+    float CellY(int index, float scrollY) const { return kMargin + (index / cols) * Pitch() - scrollY; }
+    float MaxScroll() const;
+    int   VisibleRows() const;
+
+    // Rows intersecting the screen at scrollY, clamped to the grid
+    void  VisibleRange(float scrollY, int& firstRow, int& lastRow) const;
+
+    // Cell under a screen point, or -1
+    int   HitTest(float x, float y, float scrollY) const;
+
+    // Scroll position that brings `index` fully on screen with the least movement
+    float ScrollToShow(int index, float scrollY) const;
+};
+
+// Generation order for the thumbnail pipeline: rows visible at scrollY
+// (from the middle of the screen outwards), then `ahead` rows in the
+// direction of travel, then half as many behind.
+std::vector<int> ThumbnailPriority(const GridLayout& g, float scrollY, int scrollDir, int ahead);
+
+// Atlas slot bookkeeping for thumbnails. Pages are kPageSize squares cut
+// into kSlotsPerRow^2 slots of kSlotSize; slots are handed out in order
+// (so pages fill one at a time and the renderer creates them lazily), and
+// once every page is full the least recently drawn slot is recycled.
+class ThumbAtlas {
+public:
+    static constexpr int kSlotSize     = 256;
+    static constexpr int kPageSize     = 2048;
+    static constexpr int kSlotsPerRow  = kPageSize / kSlotSize;
+    static constexpr int kSlotsPerPage = kSlotsPerRow * kSlotsPerRow;
+
+    struct Slot {
+        int      file = -1;
+        int      w = 0, h = 0;      // thumbnail size inside the slot
+        uint64_t lastDrawn = 0;
+    };
+
+    explicit ThumbAtlas(int maxPages) : m_slots(size_t(maxPages) * kSlotsPerPage) {}
+
+    void Reset(int fileCount);
+
+    // Slot id holding `file`, or -1
+    int  Find(int file) const { return file >= 0 && size_t(file) < m_fileSlot.size() ? m_fileSlot[file] : -1; }
+    const Slot& Get(int slot) const { return m_slots[slot]; }
+    void Touch(int slot, uint64_t frame) { m_slots[slot].lastDrawn = frame; }
+
+    // Slot for a new w x h thumbnail of `file`. `evicted` receives the file
+    // whose thumbnail was dropped to make room, or -1. Returns -1 when every
+    // slot was drawn this frame.
+    int  Allocate(int file, int w, int h, uint64_t frame, int& evicted);
+
+    int  PagesUsed() const { return (m_used + kSlotsPerPage - 1) / kSlotsPerPage; }
+    int  MaxPages()  const { return int(m_slots.size()) / kSlotsPerPage; }
+
+    static int Page(int slot)  { return slot / kSlotsPerPage; }
+    static int SlotX(int slot) { return (slot % kSlotsPerPage) % kSlotsPerRow * kSlotSize; }
+    static int SlotY(int slot) { return (slot % kSlotsPerPage) / kSlotsPerRow * kSlotSize; }
+
+private:
+    std::vector<Slot> m_slots;
+    std::vector<int>  m_fileSlot;
+    int               m_used = 0;
+};
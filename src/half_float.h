@@ -0,0 +1,37 @@
+// src/half_float.h
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_HALF_SSE2 1
+#endif
+
+// IEEE binary16 packing for the RGBA16F textures. Inputs are finite and
+// non-negative (radiance, scRGB), so there is no sign, NaN or infinity
+// handling; values past the largest half clamp to it. Multiplying by
+// 2^-112 moves the exponent bias from 127 to 15, after which the half is
+// the float's top bits, rounded to nearest. Halves below 2^-14 come out
+// as denormals the same way.
+constexpr float kHalfMax = 65504.0f;
+
+inline uint16_t FloatToHalf(float f)
+{
+    f = std::min(f, kHalfMax) * 1.92592994e-34f;
+    uint32_t bits;
+    std::memcpy(&bits, &f, 4);
+    return uint16_t((bits + 0x1000) >> 13);
+}
+
+#ifdef HDRV_HALF_SSE2
+// Four floats, already clamped to [0, kHalfMax], as four halves in the
+// low 64 bits
+inline __m128i FloatToHalf4(__m128 v)
+{
+    const __m128i bits = _mm_srli_epi32(
+        _mm_add_epi32(_mm_castps_si128(_mm_mul_ps(v, _mm_set1_ps(1.92592994e-34f))), _mm_set1_epi32(0x1000)), 13);
+    return _mm_packs_epi32(bits, bits);
+}
+#endif
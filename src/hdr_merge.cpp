@@ -0,0 +1,561 @@
+// src/hdr_merge.cpp
+#include "hdr_merge.h"
+#include "color_profile.h"
+#include "exif.h"
+#include "half_float.h"
+#include "image_formats.h"
+#include "image_stats.h"
+#include "parallel.h"
+#include "pixel_transform.h"
+#include "trace.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "stb_image.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_MERGE_SSE2 1
+#endif
+
+namespace {
+
+// Enough for the Exif segment and the SOF marker of nearly every JPEG
+constexpr size_t kProbeBytes = 64 * 1024;
+
+// Frames closer than this many stops are repeats, not bracket steps
+constexpr double kMinStepEv = 0.25;
+
+// MTB: pyramid depth (searching +-1 per level reaches +-63 pixels), the
+// smallest level side worth searching, and the band around the median
+// whose pixels are too noisy to vote
+constexpr int kAlignLevels   = 6;
+constexpr int kAlignMinSide  = 32;
+constexpr int kAlignExclude  = 4;
+
+// ---- bracket detection -----------------------------------------------------
+
+struct BracketProbe {
+    int     w = 0, h = 0;
+    int64_t seconds = -1;       // capture time, -1 without Exif
+    double  exposure = 0.0;     // ExifExposure::Relative(), 0 without Exif
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+int64_t DaysFromCivil(int64_t y, int64_t m, int64_t d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// YYYYMMDDhhmmss -> seconds, so stamps either side of midnight subtract
+int64_t StampSeconds(uint64_t stamp)
+{
+    const int64_t s  = int64_t(stamp % 100), mi = int64_t(stamp / 100 % 100), hh = int64_t(stamp / 10000 % 100);
+    const int64_t d  = int64_t(stamp / 1000000 % 100), mo = int64_t(stamp / 100000000 % 100);
+    const int64_t y  = int64_t(stamp / 10000000000ull);
+    return DaysFromCivil(y, mo, d) * 86400 + hh * 3600 + mi * 60 + s;
+}
+
+bool ProbeBracketFile(const std::wstring& path, BracketProbe& p)
+{
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file) return false;
+    std::vector<uint8_t> head(kProbeBytes);
+    head.resize(fread(head.data(), 1, head.size(), file));
+    fclose(file);
+
+    int comp = 0;
+    if (!stbi_info_from_memory(head.data(), int(head.size()), &p.w, &p.h, &comp)) return false;
+    uint64_t stamp = 0;
+    if (FindExifDateTime(head.data(), head.size(), stamp)) p.seconds = StampSeconds(stamp);
+    ExifExposure e;
+    if (FindExifExposure(head.data(), head.size(), e)) p.exposure = e.Relative();
+    return true;
+}
+
+bool SameShot(const BracketProbe& a, const BracketProbe& b)
+{
+    if (a.w != b.w || a.h != b.h) return false;
+    if (a.seconds >= 0 && b.seconds >= 0 && std::abs(a.seconds - b.seconds) > kBracketGapSeconds) return false;
+    return true;
+}
+
+bool SameExposure(double a, double b)
+{
+    return std::abs(std::log2(a / b)) < kMinStepEv;
+}
+
+// ---- frames ----------------------------------------------------------------
+
+struct Frame {
+    PixelBuffer  rgba;
+    int          w = 0, h = 0;
+    ExifExposure exposure;
+    bool         hasExposure = false;
+    double       meanLuma = 0.0;
+    double       relative = 1.0;        // light gathered, reference frame = 1
+    std::string  error;
+};
+
+// Whole file -> upright sRGB RGBA8, as the main view would show it
+bool LoadFrame(const std::wstring& path, Frame& f)
+{
+    HDRV_TRACE_SCOPE("merge frame");
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file) { f.error = "cannot open"; return false; }
+    PixelBuffer bytes;
+    DecodeResult res;
+    bool ok = false;
+    try {
+        fseek(file, 0, SEEK_END);
+        const long fileLen = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        bytes.resize(fileLen > 0 ? size_t(fileLen) : 0);
+        ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    } catch (const std::bad_alloc&) {
+        res.error = "out of memory";
+    }
+    fclose(file);
+    if (!ok) { f.error = res.error.empty() ? "read failed" : res.error; return false; }
+
+    const ImageFormat* format = SniffImageFormat(bytes.data(), std::min(bytes.size(), kSniffBytes));
+    if (!format) { f.error = "unknown format"; return false; }
+    try {
+        ok = format->decode(bytes.data(), bytes.size(), f.rgba, res);
+    } catch (const std::bad_alloc&) {
+        ok = false;
+        res.error = "out of memory";
+    }
+    if (!ok) { f.error = res.error.empty() ? "decode failed" : res.error; return false; }
+    f.w = res.w;
+    f.h = res.h;
+
+    const size_t headLen = std::min(bytes.size(), kProfileHeadBytes);
+    if (const auto xf = EmbeddedColorTransform(bytes.data(), headLen)) xf->Apply(f.rgba.data(), f.w, f.h);
+    uint32_t orientation = 1;
+    if (FindExifOrientation(bytes.data(), headLen, orientation))
+        OrientPixels(f.rgba, f.w, f.h, OrientationFromExif(orientation));
+    f.hasExposure = FindExifExposure(bytes.data(), headLen, f.exposure);
+
+    // every 8th pixel of every 8th row is plenty to rank exposures
+    uint64_t sum = 0, n = 0;
+    for (int y = 0; y < f.h; y += 8) {
+        const uint8_t* row = f.rgba.data() + size_t(y) * f.w * 4;
+        for (int x = 0; x < f.w; x += 8, ++n) sum += Luma709(row[x * 4], row[x * 4 + 1], row[x * 4 + 2]);
+    }
+    f.meanLuma = n ? double(sum) / double(n) : 0.0;
+    return true;
+}
+
+// ---- alignment (median threshold bitmaps) ----------------------------------
+
+inline int PopCount64(uint64_t v)
+{
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return int((v * 0x0101010101010101ull) >> 56);
+}
+
+struct LumaLevel {
+    int w = 0, h = 0;
+    std::vector<uint8_t> y;
+};
+
+// Threshold bits (above the median) and exclusion bits (far enough from
+// it to trust), one bit per pixel, rows padded to whole words with zeros
+struct Bitmaps {
+    int words = 0, h = 0;
+    std::vector<uint64_t> tb, eb;
+};
+
+void BuildLumaPyramid(const Frame& f, int levels, std::vector<LumaLevel>& pyr)
+{
+    pyr.assign(size_t(levels), LumaLevel{});
+    LumaLevel& base = pyr[0];
+    base.w = f.w;
+    base.h = f.h;
+    base.y.resize(size_t(f.w) * f.h);
+    ParallelForBands(f.h, 64, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* src = f.rgba.data() + size_t(y) * f.w * 4;
+            uint8_t* dst = base.y.data() + size_t(y) * f.w;
+            for (int x = 0; x < f.w; ++x) dst[x] = Luma709(src[x * 4], src[x * 4 + 1], src[x * 4 + 2]);
+        }
+    });
+    for (int l = 1; l < levels; ++l) {
+        const LumaLevel& s = pyr[size_t(l - 1)];
+        LumaLevel& d = pyr[size_t(l)];
+        d.w = s.w / 2;
+        d.h = s.h / 2;
+        d.y.resize(size_t(d.w) * d.h);
+        for (int y = 0; y < d.h; ++y) {
+            const uint8_t* r0 = s.y.data() + size_t(2 * y) * s.w;
+            const uint8_t* r1 = r0 + s.w;
+            uint8_t* dst = d.y.data() + size_t(y) * d.w;
+            for (int x = 0; x < d.w; ++x)
+                dst[x] = uint8_t((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+void BuildBitmaps(const LumaLevel& l, Bitmaps& b)
+{
+    uint64_t hist[256] = {};
+    for (uint8_t v : l.y) ++hist[v];
+    const uint64_t half = (uint64_t(l.w) * l.h + 1) / 2;
+    int median = 0;
+    for (uint64_t run = 0; median < 255 && (run += hist[median]) < half; ++median) {}
+
+    b.words = (l.w + 63) / 64;
+    b.h = l.h;
+    b.tb.resize(size_t(b.words) * l.h);
+    b.eb.resize(size_t(b.words) * l.h);
+    ParallelForBands(l.h, 256, [&](int, int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t* src = l.y.data() + size_t(y) * l.w;
+            uint64_t* tb = b.tb.data() + size_t(y) * b.words;
+            uint64_t* eb = b.eb.data() + size_t(y) * b.words;
+            int k = 0;
+#ifdef HDRV_MERGE_SSE2
+            // signed compares on bytes biased by 0x80; the bounds saturate
+            // so a median near either end never excludes everything
+            const __m128i bias = _mm_set1_epi8(char(0x80));
+            const __m128i mid  = _mm_set1_epi8(char(median ^ 0x80));
+            const __m128i hi   = _mm_set1_epi8(char(std::min(255, median + kAlignExclude) ^ 0x80));
+            const __m128i lo   = _mm_set1_epi8(char(std::max(0, median - kAlignExclude) ^ 0x80));
+            for (; (k + 1) * 64 <= l.w; ++k) {
+                uint64_t t = 0, e = 0;
+                for (int q = 0; q < 4; ++q) {
+                    const __m128i v = _mm_xor_si128(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k * 64 + q * 16)), bias);
+                    t |= uint64_t(_mm_movemask_epi8(_mm_cmpgt_epi8(v, mid))) << (q * 16);
+                    e |= uint64_t(_mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi8(v, hi), _mm_cmpgt_epi8(lo, v))))
+                         << (q * 16);
+                }
+                tb[k] = t;
+                eb[k] = e;
+            }
+#endif
+            for (; k < b.words; ++k) {
+                const int x0 = k * 64, x1 = std::min(l.w, x0 + 64);
+                uint64_t t = 0, e = 0;
+                for (int x = x0; x < x1; ++x) {
+                    const uint64_t bit = 1ull << (x - x0);
+                    t |= src[x] > median ? bit : 0;
+                    e |= std::abs(int(src[x]) - median) > kAlignExclude ? bit : 0;
+                }
+                tb[k] = t;
+                eb[k] = e;
+            }
+        }
+    });
+}
+
+// 64 bits of a padded bit row starting at bit `start`, zeros outside it
+inline uint64_t BitsAt(const uint64_t* row, int words, int start)
+{
+    const int q = start >= 0 ? start / 64 : -((63 - start) / 64);
+    const int r = start - q * 64;
+    const uint64_t lo = q >= 0 && q < words ? row[q] : 0;
+    if (r == 0) return lo;
+    const uint64_t hi = q + 1 >= 0 && q + 1 < words ? row[q + 1] : 0;
+    return (lo >> r) | (hi << (64 - r));
+}
+
+// Best of the nine shifts around (cx, cy) for `mov` against `ref`: pixel
+// (x + dx, y + dy) of `mov` is compared with (x, y) of `ref`
+void SearchShift(const Bitmaps& ref, const Bitmaps& mov, int& cx, int& cy)
+{
+    const int bands = std::max(1, ParallelBandCount(ref.h, 64));
+    std::vector<uint64_t> errors(size_t(bands) * 9, 0);
+    ParallelForBands(ref.h, 64, [&](int band, int y0, int y1) {
+        uint64_t* err = errors.data() + size_t(band) * 9;
+        for (int c = 0; c < 9; ++c) {
+            const int dx = cx + c % 3 - 1, dy = cy + c / 3 - 1;
+            uint64_t sum = 0;
+            for (int y = y0; y < y1; ++y) {
+                const int my = y + dy;
+                if (my < 0 || my >= mov.h) continue;
+                const uint64_t* rt = ref.tb.data() + size_t(y) * ref.words;
+                const uint64_t* re = ref.eb.data() + size_t(y) * ref.words;
+                const uint64_t* mt = mov.tb.data() + size_t(my) * mov.words;
+                const uint64_t* me = mov.eb.data() + size_t(my) * mov.words;
+                for (int k = 0; k < ref.words; ++k) {
+                    const int start = k * 64 + dx;
+                    sum += PopCount64((rt[k] ^ BitsAt(mt, mov.words, start)) & re[k] & BitsAt(me, mov.words, start));
+                }
+            }
+            err[c] = sum;
+        }
+    });
+    int best = 4;
+    uint64_t bestErr = UINT64_MAX;
+    for (int c = 0; c < 9; ++c) {
+        uint64_t e = 0;
+        for (int b = 0; b < bands; ++b) e += errors[size_t(b) * 9 + c];
+        if (e < bestErr || (e == bestErr && c == 4)) { bestErr = e; best = c; }
+    }
+    cx += best % 3 - 1;
+    cy += best / 3 - 1;
+}
+
+// Translation of every frame onto frames[ref]
+void AlignFrames(const std::vector<Frame>& frames, int ref, int* shiftX, int* shiftY)
+{
+    HDRV_TRACE_SCOPE("merge align");
+    int levels = 1;
+    while (levels < kAlignLevels && std::min(frames[0].w, frames[0].h) >> levels >= kAlignMinSide) ++levels;
+
+    std::vector<std::vector<Bitmaps>> bits(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        std::vector<LumaLevel> pyr;
+        BuildLumaPyramid(frames[i], levels, pyr);
+        bits[i].resize(size_t(levels));
+        for (int l = 0; l < levels; ++l) BuildBitmaps(pyr[size_t(l)], bits[i][size_t(l)]);
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        int cx = 0, cy = 0;
+        if (int(i) != ref) {
+            for (int l = levels - 1; l >= 0; --l) {
+                cx *= 2;
+                cy *= 2;
+                SearchShift(bits[size_t(ref)][size_t(l)], bits[i][size_t(l)], cx, cy);
+            }
+        }
+        shiftX[i] = cx;
+        shiftY[i] = cy;
+    }
+}
+
+// ---- merge -----------------------------------------------------------------
+
+struct MergeTables {
+    float weight[kMaxBracketFrames][256];   // hat weight
+    float value[kMaxBracketFrames][256];    // weight * radiance estimate
+    float radiance[kMaxBracketFrames][256]; // linear / relative exposure
+};
+
+void BuildTables(const std::vector<Frame>& frames, MergeTables& t)
+{
+    float lin[256];
+    for (int i = 0; i < 256; ++i) {
+        const double c = i / 255.0;
+        lin[i] = float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+    }
+    for (size_t f = 0; f < frames.size(); ++f) {
+        const float scale = float(1.0 / frames[f].relative);
+        for (int z = 0; z < 256; ++z) {
+            const float w = float(std::min(z, 255 - z));
+            t.weight[f][z]   = w;
+            t.radiance[f][z] = lin[z] * scale;
+            t.value[f][z]    = w * lin[z] * scale;
+        }
+    }
+}
+
+// Rows [y0, y1) of the output; frames sorted darkest first
+float MergeRows(const std::vector<Frame>& frames, const MergeTables& t, const int* shiftX, const int* shiftY,
+                int ref, int y0, int y1, uint16_t* out)
+{
+    const int w = frames[0].w, h = frames[0].h;
+    const int n = int(frames.size());
+    const int dark = 0, bright = n - 1;
+    const uint8_t* rows[kMaxBracketFrames];
+    float peak = 0.0f;
+#ifdef HDRV_MERGE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 alphaOne = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 maxHalf = _mm_set1_ps(kHalfMax);
+    __m128 vpeak = zero;
+#endif
+    for (int y = y0; y < y1; ++y) {
+        for (int f = 0; f < n; ++f)
+            rows[f] = frames[f].rgba.data() + size_t(std::clamp(y + shiftY[f], 0, h - 1)) * w * 4;
+        uint16_t* dst = out + size_t(y) * w * 4;
+        for (int x = 0; x < w; ++x) {
+#ifdef HDRV_MERGE_SSE2
+            __m128 num = alphaOne, den = alphaOne;
+            for (int f = 0; f < n; ++f) {
+                const uint8_t* p = rows[f] + std::clamp(x + shiftX[f], 0, w - 1) * 4;
+                num = _mm_add_ps(num, _mm_setr_ps(t.value[f][p[0]], t.value[f][p[1]], t.value[f][p[2]], 0.0f));
+                den = _mm_add_ps(den, _mm_setr_ps(t.weight[f][p[0]], t.weight[f][p[1]], t.weight[f][p[2]], 0.0f));
+            }
+            const __m128 none = _mm_cmpeq_ps(den, zero);
+            __m128 v = _mm_div_ps(num, _mm_or_ps(den, _mm_and_ps(none, one)));
+            if (_mm_movemask_ps(none)) {
+                // clipped in every frame: bright codes trust the darkest
+                // frame, dark codes the brightest
+                const uint8_t* pr = rows[ref] + std::clamp(x + shiftX[ref], 0, w - 1) * 4;
+                const uint8_t* pd = rows[dark] + std::clamp(x + shiftX[dark], 0, w - 1) * 4;
+                const uint8_t* pb = rows[bright] + std::clamp(x + shiftX[bright], 0, w - 1) * 4;
+                const __m128 fallback = _mm_setr_ps(
+                    pr[0] >= 128 ? t.radiance[dark][pd[0]] : t.radiance[bright][pb[0]],
+                    pr[1] >= 128 ? t.radiance[dark][pd[1]] : t.radiance[bright][pb[1]],
+                    pr[2] >= 128 ? t.radiance[dark][pd[2]] : t.radiance[bright][pb[2]], 1.0f);
+                v = _mm_or_ps(_mm_and_ps(none, fallback), _mm_andnot_ps(none, v));
+            }
+            v = _mm_min_ps(v, maxHalf);
+            vpeak = _mm_max_ps(vpeak, v);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), FloatToHalf4(v));
+#else
+            for (int c = 0; c < 3; ++c) {
+                float num = 0.0f, den = 0.0f;
+                for (int f = 0; f < n; ++f) {
+                    const uint8_t z = rows[f][std::clamp(x + shiftX[f], 0, w - 1) * 4 + c];
+                    num += t.value[f][z];
+                    den += t.weight[f][z];
+                }
+                float v;
+                if (den > 0.0f) {
+                    v = num / den;
+                } else {
+                    const int xr = std::clamp(x + shiftX[ref], 0, w - 1) * 4 + c;
+                    v = rows[ref][xr] >= 128
+                        ? t.radiance[dark][rows[dark][std::clamp(x + shiftX[dark], 0, w - 1) * 4 + c]]
+                        : t.radiance[bright][rows[bright][std::clamp(x + shiftX[bright], 0, w - 1) * 4 + c]];
+                }
+                peak = std::max(peak, v);
+                dst[x * 4 + c] = FloatToHalf(v);
+            }
+            dst[x * 4 + 3] = 0x3C00;    // 1.0
+#endif
+        }
+    }
+#ifdef HDRV_MERGE_SSE2
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vpeak);
+    peak = std::max({ lanes[0], lanes[1], lanes[2] });
+#endif
+    return peak;
+}
+
+} // namespace
+
+std::vector<int> FindBracket(const FileList& files, int index, int fallbackFrames)
+{
+    std::vector<int> bracket;
+    if (index < 0 || size_t(index) >= files.size()) return bracket;
+    BracketProbe cur;
+    if (!ProbeBracketFile(files[size_t(index)], cur)) return bracket;
+    bracket.push_back(index);
+
+    if (cur.exposure <= 0.0) {
+        BracketProbe prev = cur;
+        for (int i = index + 1; i < int(files.size()) && int(bracket.size()) < std::min(fallbackFrames, kMaxBracketFrames); ++i) {
+            BracketProbe p;
+            if (!ProbeBracketFile(files[size_t(i)], p) || !SameShot(prev, p)) break;
+            bracket.push_back(i);
+            prev = p;
+        }
+        return bracket;
+    }
+
+    // walk out both ways while neighbours belong to the same burst and add
+    // an exposure the bracket does not have yet
+    std::vector<double> exposures{ cur.exposure };
+    auto extend = [&](int step) {
+        BracketProbe prev = cur;
+        for (int i = index + step; i >= 0 && i < int(files.size()) && int(bracket.size()) < kMaxBracketFrames; i += step) {
+            BracketProbe p;
+            if (!ProbeBracketFile(files[size_t(i)], p) || p.exposure <= 0.0 || !SameShot(prev, p)) break;
+            if (std::any_of(exposures.begin(), exposures.end(), [&](double e) { return SameExposure(e, p.exposure); }))
+                break;
+            bracket.push_back(i);
+            exposures.push_back(p.exposure);
+            prev = p;
+        }
+    };
+    extend(-1);
+    extend(+1);
+    std::sort(bracket.begin(), bracket.end());
+    return bracket;
+}
+
+bool MergeBracket(const std::vector<std::wstring>& paths, const MergeOptions& opt,
+                  HdrImage& out, std::string& error)
+{
+    HDRV_TRACE_SCOPE("hdr merge");
+    out = HdrImage{};
+    if (paths.size() < 2 || paths.size() > size_t(kMaxBracketFrames)) {
+        error = "a bracket needs 2 to " + std::to_string(kMaxBracketFrames) + " frames";
+        return false;
+    }
+
+    // decode every frame at once; each decoder may fan out further
+    int64_t t0 = TraceNowNs();
+    std::vector<Frame> frames(paths.size());
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < paths.size(); ++i)
+            workers.emplace_back([&, i] { LoadFrame(paths[i], frames[i]); });
+        LoadFrame(paths[0], frames[0]);
+        for (auto& t : workers) t.join();
+    }
+    out.decodeMs = double(TraceNowNs() - t0) / 1e6;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (!frames[i].error.empty()) {
+            error = "frame " + std::to_string(i + 1) + ": " + frames[i].error;
+            return false;
+        }
+        if (frames[i].w != frames[0].w || frames[i].h != frames[0].h) {
+            error = "frames differ in size";
+            return false;
+        }
+    }
+
+    // darkest first; the middle frame is the reference
+    out.exifExposure = std::all_of(frames.begin(), frames.end(), [](const Frame& f) { return f.hasExposure; });
+    std::stable_sort(frames.begin(), frames.end(), [&](const Frame& a, const Frame& b) {
+        return out.exifExposure ? a.exposure.Relative() < b.exposure.Relative() : a.meanLuma < b.meanLuma;
+    });
+    const int n = int(frames.size());
+    const int ref = n / 2;
+    for (int i = 0; i < n; ++i) {
+        frames[size_t(i)].relative = out.exifExposure
+            ? frames[size_t(i)].exposure.Relative() / frames[size_t(ref)].exposure.Relative()
+            : std::exp2(opt.evStep * (i - ref));
+        out.ev[i] = std::log2(frames[size_t(i)].relative);
+    }
+
+    t0 = TraceNowNs();
+    if (opt.align) AlignFrames(frames, ref, out.shiftX, out.shiftY);
+    out.alignMs = double(TraceNowNs() - t0) / 1e6;
+
+    t0 = TraceNowNs();
+    auto tables = std::make_unique<MergeTables>();
+    BuildTables(frames, *tables);
+    out.w = frames[0].w;
+    out.h = frames[0].h;
+    out.frames = n;
+    try {
+        out.rgba16.resize(size_t(out.w) * out.h * 8);
+    } catch (const std::bad_alloc&) {
+        error = "out of memory";
+        return false;
+    }
+    {
+        HDRV_TRACE_SCOPE("merge pixels");
+        std::vector<float> peaks(size_t(std::max(1, ParallelBandCount(out.h, 32))), 0.0f);
+        uint16_t* dst = reinterpret_cast<uint16_t*>(out.rgba16.data());
+        ParallelForBands(out.h, 32, [&](int band, int y0, int y1) {
+            peaks[size_t(band)] = MergeRows(frames, *tables, out.shiftX, out.shiftY, ref, y0, y1, dst);
+        });
+        out.peak = *std::max_element(peaks.begin(), peaks.end());
+    }
+    out.mergeMs = double(TraceNowNs() - t0) / 1e6;
+    return true;
+}
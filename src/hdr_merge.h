@@ -0,0 +1,52 @@
+// src/hdr_merge.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "file_list.h"
+
+constexpr int kMaxBracketFrames = 9;
+
+// Neighbouring frames of one bracket are shot within this many seconds
+constexpr int kBracketGapSeconds = 2;
+
+// Indices (ascending) of the files around `index` that form one exposure
+// bracket: adjacent in `files`, same size, captured within
+// kBracketGapSeconds of each other and, when Exif has exposure times,
+// each exposed differently. Without exposure times the bracket is `index`
+// and the next fallbackFrames - 1 files of the same size.
+std::vector<int> FindBracket(const FileList& files, int index, int fallbackFrames);
+
+struct MergeOptions {
+    bool   align  = true;       // median threshold bitmap translation
+    double evStep = 2.0;        // between frames when Exif has no exposure
+};
+
+struct HdrImage {
+    int         w = 0, h = 0;
+    PixelBuffer rgba16;         // RGBA16F linear light, 8 bytes per pixel
+    int         frames = 0;
+    double      ev[kMaxBracketFrames]     = {};   // stops from the reference frame, darkest first
+    int         shiftX[kMaxBracketFrames] = {};   // alignment onto the reference, pixels
+    int         shiftY[kMaxBracketFrames] = {};
+    bool        exifExposure = false;             // ev[] from Exif, not evStep
+    float       peak = 0.0f;                      // brightest channel; 1.0 = reference white
+    double      decodeMs = 0.0, alignMs = 0.0, mergeMs = 0.0;
+};
+
+// Merge a bracket of SDR files into one radiance map. Each frame is
+// decoded (colour-converted and turned upright like the main view) on its
+// own thread and linearized through the sRGB curve. With `align`, frames
+// are translated onto the reference (the middle exposure) by Ward's
+// median threshold bitmaps over a 6-level pyramid, which ignores exposure
+// differences. Each output channel is then the Debevec-weighted mean of
+// the frames' radiance estimates, linear / relative exposure, with a hat
+// weight that trusts mid-tones and ignores clipped codes; pixels clipped
+// in every frame take the darkest (or brightest) frame's estimate. The
+// merge runs on row bands across all cores, with weights from per-frame
+// tables and the divide and FP16 packing in SSE2. The result is scaled so
+// the reference frame's white is 1.0.
+bool MergeBracket(const std::vector<std::wstring>& paths, const MergeOptions& opt,
+                  HdrImage& out, std::string& error);
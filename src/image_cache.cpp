@@ -0,0 +1,142 @@
+// src/image_cache.cpp
+#include "image_cache.h"
+#include "perf_stats.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+std::shared_ptr<const CachedImage> CompressedImageCache::Find(const std::wstring& path)
+{
+    auto it = m_map.find(path);
+    if (it == m_map.end()) { ++m_misses; return nullptr; }
+    ++m_hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.img;
+}
+
+void CompressedImageCache::Insert(const std::wstring& path, std::shared_ptr<const CachedImage> img)
+{
+    if (!img) return;
+    auto it = m_map.find(path);
+    if (it != m_map.end()) {
+        m_bytes -= it->second.img->bc.blocks.size();
+        m_lru.erase(it->second.lru);
+        m_map.erase(it);
+    }
+    m_lru.push_front(path);
+    m_bytes += img->bc.blocks.size();
+    m_map.emplace(path, Entry{ std::move(img), m_lru.begin() });
+    Evict();
+}
+
+void CompressedImageCache::Erase(const std::wstring& path)
+{
+    auto it = m_map.find(path);
+    if (it == m_map.end()) return;
+    m_bytes -= it->second.img->bc.blocks.size();
+    m_lru.erase(it->second.lru);
+    m_map.erase(it);
+}
+
+void CompressedImageCache::Clear()
+{
+    m_map.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+void CompressedImageCache::Evict()
+{
+    // always keep the newest entry, even if it alone exceeds the budget
+    while (m_bytes > m_budget && m_lru.size() > 1) {
+        auto it = m_map.find(m_lru.back());
+        m_bytes -= it->second.img->bc.blocks.size();
+        m_map.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+void BcEncodeWorker::Request(BcEncodeJob job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_job       = std::move(job);
+        m_hasJob    = true;
+        m_hasResult = false;
+        if (!m_thread.joinable()) {
+            m_stop   = false;
+            m_thread = std::thread(&BcEncodeWorker::Worker, this);
+        }
+    }
+    m_cv.notify_all();
+}
+
+void BcEncodeWorker::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_job       = BcEncodeJob{};
+    m_hasJob    = false;
+    m_hasResult = false;
+}
+
+bool BcEncodeWorker::TakeResult(BcEncodeResult& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult) return false;
+    out = std::move(m_result);
+    m_result    = BcEncodeResult{};
+    m_hasResult = false;
+    return true;
+}
+
+void BcEncodeWorker::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        ++m_generation;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void BcEncodeWorker::Worker()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+    TraceSetThreadName("bc encode");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] { return m_stop || m_hasJob; });
+        if (m_stop) return;
+
+        const BcEncodeJob job = std::move(m_job);
+        const uint32_t generation = m_generation;
+        m_job    = BcEncodeJob{};
+        m_hasJob = false;
+        lock.unlock();
+
+        auto img = std::make_shared<CachedImage>();
+        img->imgW = job.imgW;
+        img->imgH = job.imgH;
+        const int64_t t0 = TraceNowNs();
+        {
+            HDRV_STAGE_SCOPE(PerfStage::Encode, "bc encode");
+            EncodeBC(job.rgba.data(), job.w, job.h, job.format, img->bc);
+        }
+        img->encodeMs = (TraceNowNs() - t0) / 1e6;
+        if (job.measurePsnr) img->psnr = BcPsnr(job.rgba.data(), job.w, job.h, img->bc);
+
+        lock.lock();
+        if (generation != m_generation) continue;
+        m_result    = { job.path, job.tag, std::move(img) };
+        m_hasResult = true;
+    }
+}
@@ -0,0 +1,100 @@
+// src/image_cache.h
+#pragma once
+#include "bc_encode.h"
+#include "buffer_pool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Decoded images kept block-compressed, keyed by path. Revisiting a cached
+// image skips decode, resize and encode and uploads the blocks directly.
+// Evicts least-recently-used entries once the byte budget is exceeded.
+struct CachedImage {
+    int     imgW = 0, imgH = 0;     // original decoded size (for letterboxing)
+    BcImage bc;                     // texture-sized payload (after any clamp)
+    double  encodeMs = 0.0;
+    double  psnr     = 0.0;         // 0 when not measured
+};
+
+class CompressedImageCache {
+public:
+    explicit CompressedImageCache(size_t budgetBytes) : m_budget(budgetBytes) {}
+
+    // nullptr on miss; a hit becomes most recently used
+    std::shared_ptr<const CachedImage> Find(const std::wstring& path);
+    void Insert(const std::wstring& path, std::shared_ptr<const CachedImage> img);
+    void Erase(const std::wstring& path);
+    void Clear();
+
+    size_t   Bytes()  const { return m_bytes; }
+    size_t   Count()  const { return m_map.size(); }
+    uint64_t Hits()   const { return m_hits; }
+    uint64_t Misses() const { return m_misses; }
+
+private:
+    using Lru = std::list<std::wstring>;
+    struct Entry { std::shared_ptr<const CachedImage> img; Lru::iterator lru; };
+
+    void Evict();
+
+    size_t   m_budget;
+    size_t   m_bytes  = 0;
+    uint64_t m_hits   = 0;
+    uint64_t m_misses = 0;
+    Lru      m_lru;     // front = most recent
+    std::unordered_map<std::wstring, Entry> m_map;
+};
+
+// One image to block-compress: the texture-sized pixels, owned by the job
+struct BcEncodeJob {
+    std::wstring path;
+    PixelBuffer  rgba;
+    int          w = 0, h = 0;
+    int          imgW = 0, imgH = 0;    // original decoded size
+    BcFormat     format = BcFormat::BC7;
+    bool         measurePsnr = false;
+    uint64_t     tag = 0;               // the caller's, handed back with the result
+};
+
+struct BcEncodeResult {
+    std::wstring path;
+    uint64_t     tag = 0;
+    std::shared_ptr<const CachedImage> img;
+};
+
+// Encodes one image at a time on a background thread, so the render thread
+// shows the uncompressed texture at once and swaps the blocks in later. A
+// new Request() or Cancel() replaces a job that has not started and drops
+// the result of one that has.
+class BcEncodeWorker {
+public:
+    ~BcEncodeWorker() { Stop(); }
+
+    void Request(BcEncodeJob job);
+    void Cancel();
+
+    // The latest request's encode, once, when it is done
+    bool TakeResult(BcEncodeResult& out);
+
+    void Stop();
+
+private:
+    void Worker();
+
+    BcEncodeJob             m_job;
+    bool                    m_hasJob    = false;
+    uint32_t                m_generation = 0;
+    BcEncodeResult          m_result;
+    bool                    m_hasResult = false;
+    bool                    m_stop      = false;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::thread             m_thread;
+};
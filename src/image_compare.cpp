@@ -0,0 +1,320 @@
+// src/image_compare.cpp
+#include "image_compare.h"
+#include "image_stats.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_COMPARE_SSE2 1
+#endif
+
+namespace {
+
+// SSIM stabilizers for 8-bit data: (0.01 * 255)^2 and (0.03 * 255)^2
+constexpr double kC1 = 6.5025, kC2 = 58.5225;
+
+struct BandTotals {
+    uint64_t sse     = 0;
+    uint64_t changed = 0;
+    uint8_t  maxDiff = 0;
+    double   ssimSum = 0.0;
+    float    minSsim = 1.0f;
+};
+
+struct RowStats {
+    uint64_t sse     = 0;
+    uint64_t changed = 0;
+    uint8_t  maxDiff = 0;
+};
+
+// Differences and luma of one row
+void CompareRow(const uint8_t* a, const uint8_t* b, int w, uint8_t* diff,
+                uint8_t* lumaA, uint8_t* lumaB, RowStats& st)
+{
+    int x = 0;
+#ifdef HDRV_COMPARE_SSE2
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i lowByte = _mm_set1_epi32(0xFF);
+    const __m128i one     = _mm_set1_epi8(1);
+    const __m128i weights = _mm_setr_epi16(54, 183, 19, 0, 54, 183, 19, 0);
+    __m128i sse = zero, sseWide = zero, changed = zero, maxDiff = zero;
+
+    // Rec.709 luma of four pixels as int32 lanes, same rounding as Luma709
+    auto luma4 = [&](__m128i px) {
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), weights);   // [rg0 b0 rg1 b1]
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), weights);
+        const __m128i sLo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));             // [L0 . L1 .]
+        const __m128i sHi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+        const __m128i l = _mm_unpacklo_epi64(_mm_shuffle_epi32(sLo, _MM_SHUFFLE(3, 1, 2, 0)),
+                                             _mm_shuffle_epi32(sHi, _MM_SHUFFLE(3, 1, 2, 0)));
+        return _mm_srli_epi32(l, 8);
+    };
+
+    int sinceSpill = 0;
+    for (; x + 16 <= w; x += 16) {
+        __m128i m[4], la[4], lb[4];
+        for (int k = 0; k < 4; ++k) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + (x + 4 * k) * 4));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + (x + 4 * k) * 4));
+            const __m128i d  = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)), rgbMask);
+
+            const __m128i dLo = _mm_unpacklo_epi8(d, zero), dHi = _mm_unpackhi_epi8(d, zero);
+            sse = _mm_add_epi32(sse, _mm_add_epi32(_mm_madd_epi16(dLo, dLo), _mm_madd_epi16(dHi, dHi)));
+
+            // max over the three channels lands in each pixel's low byte
+            __m128i mx = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+            mx = _mm_max_epu8(mx, _mm_srli_epi32(mx, 16));
+            m[k]  = _mm_and_si128(mx, lowByte);
+            la[k] = luma4(va);
+            lb[k] = luma4(vb);
+        }
+        const __m128i d16 = _mm_packus_epi16(_mm_packs_epi32(m[0], m[1]), _mm_packs_epi32(m[2], m[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(diff + x), d16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lumaA + x),
+                         _mm_packus_epi16(_mm_packs_epi32(la[0], la[1]), _mm_packs_epi32(la[2], la[3])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lumaB + x),
+                         _mm_packus_epi16(_mm_packs_epi32(lb[0], lb[1]), _mm_packs_epi32(lb[2], lb[3])));
+        maxDiff = _mm_max_epu8(maxDiff, d16);
+        changed = _mm_add_epi64(changed, _mm_sad_epu8(_mm_min_epu8(d16, one), zero));
+
+        // each 32-bit lane gains at most 4 * 4 * 255^2 per step; widen well before it wraps
+        if (++sinceSpill == 512) {
+            sseWide = _mm_add_epi64(sseWide, _mm_add_epi64(_mm_unpacklo_epi32(sse, zero), _mm_unpackhi_epi32(sse, zero)));
+            sse = zero;
+            sinceSpill = 0;
+        }
+    }
+    sseWide = _mm_add_epi64(sseWide, _mm_add_epi64(_mm_unpacklo_epi32(sse, zero), _mm_unpackhi_epi32(sse, zero)));
+    alignas(16) uint64_t wide[2], cnt[2];
+    alignas(16) uint8_t  mx[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(wide), sseWide);
+    _mm_store_si128(reinterpret_cast<__m128i*>(cnt), changed);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mx), maxDiff);
+    st.sse     += wide[0] + wide[1];
+    st.changed += cnt[0] + cnt[1];
+    for (uint8_t v : mx) st.maxDiff = std::max(st.maxDiff, v);
+#endif
+    for (; x < w; ++x) {
+        const uint8_t* pa = a + size_t(x) * 4;
+        const uint8_t* pb = b + size_t(x) * 4;
+        uint8_t m = 0;
+        for (int c = 0; c < 3; ++c) {
+            const int d = std::abs(int(pa[c]) - int(pb[c]));
+            st.sse += uint64_t(d * d);
+            m = std::max(m, uint8_t(d));
+        }
+        diff[x]  = m;
+        lumaA[x] = Luma709(pa[0], pa[1], pa[2]);
+        lumaB[x] = Luma709(pb[0], pb[1], pb[2]);
+        st.changed += m != 0;
+        st.maxDiff = std::max(st.maxDiff, m);
+    }
+}
+
+// Window sums of one luma row into the running sums of its window row
+struct WindowSums { uint32_t a, b, aa, bb, ab; };
+
+void AccumulateWindows(const uint8_t* la, const uint8_t* lb, int blocksW, WindowSums* sums)
+{
+    static_assert(kSsimWindow == 8, "the SSE2 path sums 8 luma values per window");
+    for (int bx = 0; bx < blocksW; ++bx) {
+        const uint8_t* pa = la + bx * kSsimWindow;
+        const uint8_t* pb = lb + bx * kSsimWindow;
+        WindowSums& s = sums[bx];
+#ifdef HDRV_COMPARE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i a8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pa));
+        const __m128i b8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pb));
+        const __m128i a16 = _mm_unpacklo_epi8(a8, zero), b16 = _mm_unpacklo_epi8(b8, zero);
+        auto hsum = [](__m128i v) {
+            v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+            v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+            return uint32_t(_mm_cvtsi128_si32(v));
+        };
+        s.a  += uint32_t(_mm_cvtsi128_si32(_mm_sad_epu8(a8, zero)));
+        s.b  += uint32_t(_mm_cvtsi128_si32(_mm_sad_epu8(b8, zero)));
+        s.aa += hsum(_mm_madd_epi16(a16, a16));
+        s.bb += hsum(_mm_madd_epi16(b16, b16));
+        s.ab += hsum(_mm_madd_epi16(a16, b16));
+#else
+        for (int i = 0; i < kSsimWindow; ++i) {
+            s.a  += pa[i];
+            s.b  += pb[i];
+            s.aa += uint32_t(pa[i]) * pa[i];
+            s.bb += uint32_t(pb[i]) * pb[i];
+            s.ab += uint32_t(pa[i]) * pb[i];
+        }
+#endif
+    }
+}
+
+float WindowSsim(const WindowSums& s)
+{
+    constexpr double n = double(kSsimWindow * kSsimWindow);
+    const double ma = s.a / n, mb = s.b / n;
+    const double va = s.aa / n - ma * ma, vb = s.bb / n - mb * mb, cov = s.ab / n - ma * mb;
+    return float(((2.0 * ma * mb + kC1) * (2.0 * cov + kC2)) /
+                 ((ma * ma + mb * mb + kC1) * (va + vb + kC2)));
+}
+
+// Black for no difference, then blue -> red -> yellow -> white
+struct HeatRamp {
+    uint32_t rgba[256];
+    HeatRamp() {
+        static const float kStops[5][3] = { { 0, 0, 0 }, { 0.1f, 0.2f, 1 }, { 1, 0.1f, 0.1f }, { 1, 0.9f, 0 }, { 1, 1, 1 } };
+        for (int i = 0; i < 256; ++i) {
+            // square root so single-code differences are already bright
+            const float t = i == 0 ? 0.0f : 0.25f + 0.75f * std::sqrt(std::min(1.0f, i / 64.0f));
+            const float f = t * 4.0f;
+            const int   k = std::min(3, int(f));
+            const float u = f - k;
+            uint8_t c[3];
+            for (int j = 0; j < 3; ++j)
+                c[j] = uint8_t(std::lround(255.0f * (kStops[k][j] + (kStops[k + 1][j] - kStops[k][j]) * u)));
+            rgba[i] = uint32_t(c[0]) | uint32_t(c[1]) << 8 | uint32_t(c[2]) << 16 | 0xFF000000u;
+        }
+    }
+};
+
+const HeatRamp& Ramp()
+{
+    static const HeatRamp ramp;
+    return ramp;
+}
+
+} // namespace
+
+void CompareImages(const uint8_t* a, const uint8_t* b, int w, int h, CompareResult& out)
+{
+    HDRV_TRACE_SCOPE("compare");
+    const int64_t t0 = TraceNowNs();
+    out = CompareResult{};
+    out.w = w;
+    out.h = h;
+    if (w <= 0 || h <= 0) return;
+    out.diff.resize(size_t(w) * size_t(h));
+    out.blocksW = w / kSsimWindow;
+    out.blocksH = h / kSsimWindow;
+    out.ssimMap.assign(size_t(out.blocksW) * size_t(out.blocksH), 1.0f);
+
+    // one item per window row; the last one also takes the leftover rows
+    const int items = (h + kSsimWindow - 1) / kSsimWindow;
+    const int minItems = std::max(1, (1 << 18) / std::max(1, w * kSsimWindow));
+    std::vector<BandTotals> totals(size_t(std::max(1, ParallelBandCount(items, minItems))));
+    ParallelForBands(items, minItems, [&](int band, int begin, int end) {
+        std::vector<uint8_t> la(static_cast<size_t>(w)), lb(static_cast<size_t>(w));
+        std::vector<WindowSums> sums(size_t(out.blocksW));
+        BandTotals& t = totals[size_t(band)];
+        for (int by = begin; by < end; ++by) {
+            const int y0 = by * kSsimWindow, y1 = std::min(h, y0 + kSsimWindow);
+            const bool fullRow = by < out.blocksH;
+            std::fill(sums.begin(), sums.end(), WindowSums{});
+            for (int y = y0; y < y1; ++y) {
+                RowStats st;
+                const size_t row = size_t(y) * size_t(w);
+                CompareRow(a + row * 4, b + row * 4, w, out.diff.data() + row, la.data(), lb.data(), st);
+                t.sse     += st.sse;
+                t.changed += st.changed;
+                t.maxDiff  = std::max(t.maxDiff, st.maxDiff);
+                if (fullRow) AccumulateWindows(la.data(), lb.data(), out.blocksW, sums.data());
+            }
+            if (!fullRow) continue;
+            float* map = out.ssimMap.data() + size_t(by) * out.blocksW;
+            for (int bx = 0; bx < out.blocksW; ++bx) {
+                map[bx] = WindowSsim(sums[size_t(bx)]);
+                t.ssimSum += map[bx];
+                t.minSsim = std::min(t.minSsim, map[bx]);
+            }
+        }
+    });
+
+    uint64_t sse = 0;
+    double ssimSum = 0.0;
+    for (const BandTotals& t : totals) {
+        sse         += t.sse;
+        ssimSum     += t.ssimSum;
+        out.changed += t.changed;
+        out.maxDiff  = std::max(out.maxDiff, t.maxDiff);
+        out.minSsim  = std::min(out.minSsim, double(t.minSsim));
+    }
+    const double mse = double(sse) / (double(w) * h * 3.0);
+    out.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+    if (!out.ssimMap.empty()) out.ssim = ssimSum / double(out.ssimMap.size());
+    out.ms = (TraceNowNs() - t0) / 1e6;
+}
+
+void RenderDiffMap(const CompareResult& r, const uint8_t* a, PixelBuffer& rgba)
+{
+    HDRV_TRACE_SCOPE("diff map");
+    rgba.resize(size_t(r.w) * size_t(r.h) * 4);
+    const HeatRamp& ramp = Ramp();
+    ParallelForBands(r.h, std::max(1, (1 << 18) / std::max(1, r.w)), [&](int, int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const size_t row = size_t(y) * size_t(r.w);
+            const uint8_t* d  = r.diff.data() + row;
+            const uint8_t* pa = a + row * 4;
+            uint32_t* out = reinterpret_cast<uint32_t*>(rgba.data()) + row;
+            for (int x = 0; x < r.w; ++x) {
+                if (d[x]) { out[x] = ramp.rgba[d[x]]; continue; }
+                const uint32_t l = Luma709(pa[x * 4], pa[x * 4 + 1], pa[x * 4 + 2]) / 4u;
+                out[x] = l | l << 8 | l << 16 | 0xFF000000u;
+            }
+        }
+    });
+}
+
+void RenderSsimMap(const CompareResult& r, PixelBuffer& rgba)
+{
+    HDRV_TRACE_SCOPE("ssim map");
+    rgba.resize(size_t(r.w) * size_t(r.h) * 4);
+    const HeatRamp& ramp = Ramp();
+    ParallelForBands(r.h, std::max(1, (1 << 18) / std::max(1, r.w)), [&](int, int begin, int end) {
+        std::vector<uint32_t> colors(size_t(std::max(1, r.blocksW)));
+        int colorsRow = -1;
+        for (int y = begin; y < end; ++y) {
+            uint32_t* out = reinterpret_cast<uint32_t*>(rgba.data()) + size_t(y) * size_t(r.w);
+            if (r.blocksW == 0 || r.blocksH == 0) {
+                std::fill(out, out + r.w, ramp.rgba[0]);
+                continue;
+            }
+            // edge pixels outside whole windows take the nearest window
+            const int by = std::min(r.blocksH - 1, y / kSsimWindow);
+            if (by != colorsRow) {
+                for (int bx = 0; bx < r.blocksW; ++bx) {
+                    const float s = r.ssimMap[size_t(by) * r.blocksW + bx];
+                    colors[size_t(bx)] = ramp.rgba[std::clamp(int(std::lround((1.0f - s) * 512.0f)), 0, 255)];
+                }
+                colorsRow = by;
+            }
+            for (int x = 0; x < r.w; ++x) out[x] = colors[size_t(std::min(r.blocksW - 1, x / kSsimWindow))];
+        }
+    });
+}
+
+std::shared_ptr<const CompareResult> CompareCache::Find(const std::wstring& a, const std::wstring& b)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->a != a || it->b != b) continue;
+        Entry hit = std::move(*it);
+        m_entries.erase(it);
+        m_entries.push_back(std::move(hit));
+        return m_entries.back().r;
+    }
+    return nullptr;
+}
+
+void CompareCache::Insert(const std::wstring& a, const std::wstring& b, std::shared_ptr<const CompareResult> r)
+{
+    if (!r) return;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->a == a && it->b == b) { m_entries.erase(it); break; }
+    }
+    m_entries.push_back(Entry{ a, b, std::move(r) });
+    if (m_entries.size() > kEntries) m_entries.pop_front();
+}
@@ -0,0 +1,58 @@
+// src/image_compare.h
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// Side of the square luma windows SSIM is measured over
+constexpr int kSsimWindow = 8;
+
+// Pixel-for-pixel comparison of two same-sized RGBA8 images (alpha ignored)
+struct CompareResult {
+    int      w = 0, h = 0;
+    double   psnr    = 0.0;         // over RGB in dB; +inf when identical
+    double   ssim    = 1.0;         // mean over the windows
+    double   minSsim = 1.0;         // worst window
+    uint8_t  maxDiff = 0;           // largest channel difference
+    uint64_t changed = 0;           // pixels with any channel difference
+    PixelBuffer        diff;        // per pixel max |a - b| over RGB, w*h
+    std::vector<float> ssimMap;     // per window, blocksW x blocksH
+    int      blocksW = 0, blocksH = 0;
+    double   ms = 0.0;
+
+    double ChangedPct() const { return w && h ? 100.0 * double(changed) / (double(w) * h) : 0.0; }
+};
+
+// One pass over both images: absolute differences and squared error with
+// SSE2 16 bytes at a time, and Rec.709 luma sums for SSIM over
+// non-overlapping kSsimWindow windows (partial windows at the right and
+// bottom edges count toward PSNR only). Window rows are split across
+// all cores.
+void CompareImages(const uint8_t* a, const uint8_t* b, int w, int h, CompareResult& out);
+
+// Heat map of `r.diff` as RGBA8: identical pixels show A's luma dimmed so
+// the picture stays recognizable; differences ramp blue -> red -> yellow
+// -> white, with one code already clearly visible.
+void RenderDiffMap(const CompareResult& r, const uint8_t* a, PixelBuffer& rgba);
+
+// `r.ssimMap` at full size on the same ramp, 1 - SSIM as the heat
+void RenderSsimMap(const CompareResult& r, PixelBuffer& rgba);
+
+// Results for the last few (reference, other) path pairs, so flipping back
+// and forth between candidates does not recompute
+class CompareCache {
+public:
+    static constexpr size_t kEntries = 6;
+
+    std::shared_ptr<const CompareResult> Find(const std::wstring& a, const std::wstring& b);
+    void Insert(const std::wstring& a, const std::wstring& b, std::shared_ptr<const CompareResult> r);
+    void Clear() { m_entries.clear(); }
+
+private:
+    struct Entry { std::wstring a, b; std::shared_ptr<const CompareResult> r; };
+    std::deque<Entry> m_entries;    // most recent last
+};
@@ -0,0 +1,204 @@
+// src/image_formats.cpp
+#include "image_formats.h"
+#include "jpeg_parallel.h"
+#include "png_fast.h"
+#include "raw_preview.h"
+#include "stream_decode.h"
+
+#include <climits>
+#include <cstring>
+#include <unordered_set>
+
+#include "stb_image.h"
+
+namespace {
+
+// ---- probes (mirror stb_image's own *_test functions) ----
+
+bool StartsWith(const uint8_t* head, size_t len, const char* magic)
+{
+    const size_t n = std::strlen(magic);
+    return len >= n && std::memcmp(head, magic, n) == 0;
+}
+
+inline int ReadLE16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+inline int ReadLE32(const uint8_t* p) { return ReadLE16(p) | (ReadLE16(p + 2) << 16); }
+
+bool ProbeBmp(const uint8_t* head, size_t len)
+{
+    if (len < 18 || !StartsWith(head, len, "BM")) return false;
+    const int sz = ReadLE32(head + 14);
+    return sz == 12 || sz == 40 || sz == 56 || sz == 108 || sz == 124;
+}
+
+bool ProbeGif(const uint8_t* head, size_t len)
+{
+    return StartsWith(head, len, "GIF87a") || StartsWith(head, len, "GIF89a");
+}
+
+bool ProbePsd(const uint8_t* head, size_t len)
+{
+    return StartsWith(head, len, "8BPS");
+}
+
+bool ProbeHdr(const uint8_t* head, size_t len)
+{
+    return StartsWith(head, len, "#?RADIANCE\n") || StartsWith(head, len, "#?RGBE\n");
+}
+
+bool ProbePic(const uint8_t* head, size_t len)
+{
+    return len >= 92 && StartsWith(head, len, "\x53\x80\xF6\x34") &&
+           std::memcmp(head + 88, "PICT", 4) == 0;
+}
+
+bool ProbePnm(const uint8_t* head, size_t len)
+{
+    return len >= 2 && head[0] == 'P' && (head[1] == '5' || head[1] == '6');
+}
+
+// TGA has no magic number; check the header fields are plausible
+bool ProbeTga(const uint8_t* head, size_t len)
+{
+    if (len < 18) return false;
+    const int colorMapType = head[1], imageType = head[2];
+    if (colorMapType > 1) return false;
+    if (colorMapType == 1) {
+        if (imageType != 1 && imageType != 9) return false;
+        const int entryBits = head[7];
+        if (entryBits != 8 && entryBits != 15 && entryBits != 16 && entryBits != 24 && entryBits != 32)
+            return false;
+    } else if (imageType != 2 && imageType != 3 && imageType != 10 && imageType != 11) {
+        return false;
+    }
+    if (ReadLE16(head + 12) < 1 || ReadLE16(head + 14) < 1) return false;
+    const int bits = head[16];
+    if (colorMapType == 1 && bits != 8 && bits != 16) return false;
+    return bits == 8 || bits == 15 || bits == 16 || bits == 24 || bits == 32;
+}
+
+// ---- decoders ----
+
+bool DecodeStb(const uint8_t* data, size_t len, PixelBuffer& rgba, DecodeResult& res)
+{
+    if (len > size_t(INT_MAX)) { res.error = "File too large"; return false; }
+    int w = 0, h = 0, comp = 0;
+    unsigned char* px = stbi_load_from_memory(data, int(len), &w, &h, &comp, 4);
+    if (!px) {
+        res.error = stbi_failure_reason();
+        return false;
+    }
+    try {
+        rgba.resize(size_t(w) * h * 4);
+    } catch (const std::bad_alloc&) {
+        stbi_image_free(px);
+        res.error = "Out of memory while copying image";
+        return false;
+    }
+    std::memcpy(rgba.data(), px, rgba.size());
+    stbi_image_free(px);
+    res.w       = w;
+    res.h       = h;
+    res.decoder = "stb";
+    res.threads = 1;
+    return true;
+}
+
+bool DecodePng(const uint8_t* data, size_t len, PixelBuffer& rgba, DecodeResult& res)
+{
+    if (DecodePngFast(data, len, rgba, res.w, res.h)) {
+        res.decoder = "SIMD";
+        return true;
+    }
+    return DecodeStb(data, len, rgba, res);
+}
+
+bool DecodeJpeg(const uint8_t* data, size_t len, PixelBuffer& rgba, DecodeResult& res)
+{
+    if (DecodeJpegParallel(data, len, rgba, res.w, res.h, &res.threads)) {
+        res.decoder = "parallel";
+        return true;
+    }
+    return DecodeStb(data, len, rgba, res);
+}
+
+// Camera RAW in memory: the largest embedded JPEG preview, never the
+// sensor data
+bool DecodeRaw(const uint8_t* data, size_t len, PixelBuffer& rgba, DecodeResult& res)
+{
+    RawPreview p;
+    if (!FindRawPreview(data, len, 0, p)) {
+        res.error = "No embedded JPEG preview in this RAW file";
+        return false;
+    }
+    return DecodeJpeg(data + p.offset, size_t(p.size), rgba, res);
+}
+
+bool ReadRawEmbedded(const std::wstring& path, int minSize, PixelBuffer& bytes, uint32_t& orientation,
+                     std::wstring& err)
+{
+    RawPreview p;
+    if (!ReadRawPreview(path, minSize, bytes, p, err)) return false;
+    orientation = p.orientation;
+    return true;
+}
+
+// Order matters only for TGA, whose probe is a heuristic: keep it last.
+const std::vector<ImageFormat> kFormats = {
+    { "PNG",  L"*.png",                     IsPng,     DecodePng,  StreamDecodeResized, false, nullptr },
+    { "JPEG", L"*.jpg;*.jpeg;*.jpe;*.jfif", IsJpeg,    DecodeJpeg, StreamDecodeResized, false, nullptr },
+    { "BMP",  L"*.bmp;*.dib",               ProbeBmp,  DecodeStb,  StreamDecodeResized, false, nullptr },
+    { "GIF",  L"*.gif",                     ProbeGif,  DecodeStb,  StreamDecodeResized, true,  nullptr },
+    { "PSD",  L"*.psd",                     ProbePsd,  DecodeStb,  nullptr,             false, nullptr },
+    { "HDR",  L"*.hdr",                     ProbeHdr,  DecodeStb,  nullptr,             false, nullptr },
+    { "PIC",  L"*.pic",                     ProbePic,  DecodeStb,  nullptr,             false, nullptr },
+    { "PNM",  L"*.pnm;*.ppm;*.pgm",         ProbePnm,  DecodeStb,  nullptr,             false, nullptr },
+    { "RAW",  L"*.cr2;*.cr3;*.nef;*.nrw;*.arw;*.srf;*.sr2;*.dng;*.orf;*.rw2;*.pef;*.srw;*.raf",
+                                            IsRawFile, DecodeRaw,  nullptr,             false, ReadRawEmbedded },
+    { "TGA",  L"*.tga",                     ProbeTga,  DecodeStb,  nullptr,             false, nullptr },
+};
+
+} // namespace
+
+const std::vector<ImageFormat>& ImageFormats()
+{
+    return kFormats;
+}
+
+const ImageFormat* SniffImageFormat(const uint8_t* head, size_t len)
+{
+    for (const ImageFormat& f : kFormats)
+        if (f.probe(head, len)) return &f;
+    return nullptr;
+}
+
+bool IsImageExtension(const std::wstring& extLower)
+{
+    // ".ext" for every "*.ext" in the pattern lists
+    static const std::unordered_set<std::wstring> kExts = [] {
+        std::unordered_set<std::wstring> exts;
+        for (const ImageFormat& f : kFormats) {
+            std::wstring p = f.patterns;
+            size_t start = 0;
+            while (start < p.size()) {
+                size_t end = p.find(L';', start);
+                if (end == std::wstring::npos) end = p.size();
+                if (end - start > 1 && p[start] == L'*')
+                    exts.insert(p.substr(start + 1, end - start - 1));
+                start = end + 1;
+            }
+        }
+        return exts;
+    }();
+    return kExts.count(extLower) != 0;
+}
+
+std::wstring AllImagePatterns()
+{
+    std::wstring all;
+    for (const ImageFormat& f : kFormats) {
+        if (!all.empty()) all += L';';
+        all += f.patterns;
+    }
+    return all;
+}
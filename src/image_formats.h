@@ -0,0 +1,56 @@
+// src/image_formats.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// What a decoder reports back alongside the pixels
+struct DecodeResult {
+    int         w = 0, h = 0;
+    const char* decoder = "stb";    // implementation that produced the pixels
+    int         threads = 1;
+    std::string error;              // UTF-8, set when decode fails
+};
+
+// Enough leading bytes for every probe (PIC keeps its tag at offset 88)
+constexpr size_t kSniffBytes = 128;
+
+using ProbeFn         = bool (*)(const uint8_t* head, size_t len);
+using DecodeFn        = bool (*)(const uint8_t* data, size_t len, PixelBuffer& rgba, DecodeResult& res);
+using DecodeReducedFn = bool (*)(const std::wstring& path, int dstW, int dstH,
+                                 PixelBuffer& rgba, std::wstring& err);
+using ReadEmbeddedFn  = bool (*)(const std::wstring& path, int minSize, PixelBuffer& bytes,
+                                 uint32_t& orientation, std::wstring& err);
+
+// One entry per container format. The file type is picked by probing the
+// first kSniffBytes, never by extension; extensions only drive the open
+// dialog filter and folder enumeration. To speed up a format, swap its
+// decode (or add a decodeReduced) here; everything else goes through stb.
+struct ImageFormat {
+    const char*     name;
+    const wchar_t*  patterns;       // dialog patterns, e.g. L"*.jpg;*.jpeg"
+    ProbeFn         probe;
+    DecodeFn        decode;         // whole file in memory -> RGBA8
+    DecodeReducedFn decodeReduced;  // straight to dstW x dstH, or nullptr
+    bool            animated;       // may hold more frames (played by GifPlayer)
+    // The file wraps another image that is shown in its place (RAW
+    // previews): read just its bytes, preferring the smallest whose long
+    // side reaches minSize (0: the largest), for decoding as whatever
+    // SniffImageFormat says they are. `orientation` is Exif-style, 0 when
+    // the wrapper has none. Or nullptr.
+    ReadEmbeddedFn  readEmbedded;
+};
+
+const std::vector<ImageFormat>& ImageFormats();
+
+// First format whose probe accepts `head`, or nullptr
+const ImageFormat* SniffImageFormat(const uint8_t* head, size_t len);
+
+// Lower-case extension with dot (".png") of any registered format
+bool IsImageExtension(const std::wstring& extLower);
+
+// All registered patterns joined with ';', for an "all images" filter
+std::wstring AllImagePatterns();
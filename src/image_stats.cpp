@@ -0,0 +1,146 @@
+// src/image_stats.cpp
+#include "image_stats.h"
+#include "parallel.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_STATS_SSE2 1
+#endif
+
+namespace {
+
+struct BandStats {
+    uint32_t luma[256];
+    uint32_t rgb[3][256];
+    uint8_t  minC[4], maxC[4];
+    uint8_t  minLuma, maxLuma;
+    uint64_t clippedHigh, clippedLow;
+};
+
+inline void AccumulatePixel(BandStats& s, const uint8_t* p, uint8_t y)
+{
+    ++s.luma[y];
+    ++s.rgb[0][p[0]];
+    ++s.rgb[1][p[1]];
+    ++s.rgb[2][p[2]];
+    s.clippedHigh += (p[0] == 255) | (p[1] == 255) | (p[2] == 255);
+    s.clippedLow  += (p[0] | p[1] | p[2]) == 0;
+}
+
+// One band: copy + min/max + luma in SIMD, histogram scatter scalar.
+void ProcessBand(uint8_t* dst, const uint8_t* src, size_t pixels, BandStats& s)
+{
+    std::memset(&s, 0, sizeof(s));
+    std::memset(s.minC, 255, sizeof(s.minC));
+    s.minLuma = 255;
+
+    size_t i = 0;
+#ifdef HDRV_STATS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wts  = _mm_setr_epi16(54, 183, 19, 0, 54, 183, 19, 0);
+    __m128i vmin = _mm_set1_epi8(char(0xFF));
+    __m128i vmax = zero;
+    __m128i lmin = _mm_set1_epi32(255);
+    __m128i lmax = zero;
+    alignas(16) uint32_t y4[4];
+
+    for (; i + 4 <= pixels; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        if (dst != src) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), v);
+
+        vmin = _mm_min_epu8(vmin, v);
+        vmax = _mm_max_epu8(vmax, v);
+
+        // (54R + 183G) and (19B) per pixel, then fold the pairs
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), wts);
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), wts);
+        const __m128 lof = _mm_castsi128_ps(lo), hif = _mm_castsi128_ps(hi);
+        __m128i y = _mm_add_epi32(
+            _mm_castps_si128(_mm_shuffle_ps(lof, hif, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(lof, hif, _MM_SHUFFLE(3, 1, 3, 1))));
+        y = _mm_srli_epi32(y, 8);
+        _mm_store_si128(reinterpret_cast<__m128i*>(y4), y);
+
+        // SSE2 has no 32-bit min/max; the values fit in 16 bits so use epi16
+        lmin = _mm_min_epi16(lmin, y);
+        lmax = _mm_max_epi16(lmax, y);
+
+        const uint8_t* p = src + i * 4;
+        AccumulatePixel(s, p + 0,  uint8_t(y4[0]));
+        AccumulatePixel(s, p + 4,  uint8_t(y4[1]));
+        AccumulatePixel(s, p + 8,  uint8_t(y4[2]));
+        AccumulatePixel(s, p + 12, uint8_t(y4[3]));
+    }
+
+    alignas(16) uint8_t mn[16], mx[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(mn), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mx), vmax);
+    for (int k = 0; k < 16; ++k) {
+        s.minC[k & 3] = std::min(s.minC[k & 3], mn[k]);
+        s.maxC[k & 3] = std::max(s.maxC[k & 3], mx[k]);
+    }
+    alignas(16) uint32_t lmn[4], lmx[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lmn), lmin);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lmx), lmax);
+    if (i > 0) {
+        for (int k = 0; k < 4; ++k) {
+            s.minLuma = std::min<uint8_t>(s.minLuma, uint8_t(lmn[k]));
+            s.maxLuma = std::max<uint8_t>(s.maxLuma, uint8_t(lmx[k]));
+        }
+    }
+#endif
+
+    // scalar tail (and the whole band without SSE2)
+    for (; i < pixels; ++i) {
+        const uint8_t* p = src + i * 4;
+        if (dst != src) std::memcpy(dst + i * 4, p, 4);
+        for (int c = 0; c < 4; ++c) {
+            s.minC[c] = std::min(s.minC[c], p[c]);
+            s.maxC[c] = std::max(s.maxC[c], p[c]);
+        }
+        const uint8_t y = Luma709(p[0], p[1], p[2]);
+        s.minLuma = std::min(s.minLuma, y);
+        s.maxLuma = std::max(s.maxLuma, y);
+        AccumulatePixel(s, p, y);
+    }
+}
+
+} // namespace
+
+void CopyPixelsWithStats(uint8_t* dst, const uint8_t* src, int w, int h, ImageStats& stats)
+{
+    stats = ImageStats{};
+    if (w <= 0 || h <= 0) return;
+
+    // ~64K pixels per band minimum so tiny images stay single-threaded
+    const int minRows = std::max(1, 65536 / w);
+    std::vector<BandStats> bands(size_t(std::max(1, ParallelBandCount(h, minRows))));
+
+    ParallelForBands(h, minRows, [&](int band, int y0, int y1) {
+        const size_t off = size_t(y0) * size_t(w) * 4;
+        ProcessBand(dst + off, src + off, size_t(y1 - y0) * size_t(w), bands[size_t(band)]);
+    });
+
+    // merge band partials
+    for (const BandStats& b : bands) {
+        for (int i = 0; i < 256; ++i) {
+            stats.luma[i]   += b.luma[i];
+            stats.rgb[0][i] += b.rgb[0][i];
+            stats.rgb[1][i] += b.rgb[1][i];
+            stats.rgb[2][i] += b.rgb[2][i];
+        }
+        for (int c = 0; c < 3; ++c) {
+            stats.minRGB[c] = std::min(stats.minRGB[c], b.minC[c]);
+            stats.maxRGB[c] = std::max(stats.maxRGB[c], b.maxC[c]);
+        }
+        stats.minAlpha = std::min(stats.minAlpha, b.minC[3]);
+        stats.minLuma = std::min(stats.minLuma, b.minLuma);
+        stats.maxLuma = std::max(stats.maxLuma, b.maxLuma);
+        stats.clippedHigh += b.clippedHigh;
+        stats.clippedLow  += b.clippedLow;
+    }
+    stats.pixelCount = uint64_t(w) * uint64_t(h);
+}
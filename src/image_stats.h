@@ -0,0 +1,33 @@
+// src/image_stats.h
+#pragma once
+#include <cstdint>
+
+// Per-image statistics for the histogram overlay. LoadImage takes the
+// decoder's buffer without copying it, so they are gathered in one
+// read-only sweep over the final pixels; none of them depend on pixel
+// order, so orientation does not matter.
+struct ImageStats {
+    uint32_t luma[256]   = {};
+    uint32_t rgb[3][256] = {};
+    uint8_t  minLuma = 255, maxLuma = 0;
+    uint8_t  minRGB[3] = { 255, 255, 255 };
+    uint8_t  maxRGB[3] = { 0, 0, 0 };
+    uint8_t  minAlpha  = 255;       // 255 => fully opaque
+    uint64_t clippedHigh = 0;   // pixels with any of R/G/B at 255
+    uint64_t clippedLow  = 0;   // pixels with R, G and B all at 0
+    uint64_t pixelCount  = 0;
+
+    double ClippedHighPct() const { return pixelCount ? 100.0 * double(clippedHigh) / double(pixelCount) : 0.0; }
+    double ClippedLowPct()  const { return pixelCount ? 100.0 * double(clippedLow)  / double(pixelCount) : 0.0; }
+};
+
+// Rec.709 luma in 8-bit fixed point (weights sum to 256).
+inline uint8_t Luma709(uint8_t r, uint8_t g, uint8_t b)
+{
+    return uint8_t((54u * r + 183u * g + 19u * b) >> 8);
+}
+
+// Copy w*h RGBA8 pixels from src to dst and fill `stats` in the same traversal.
+// Rows are split across threads; each band keeps private histograms that are
+// merged at the end. dst may equal src to gather stats only.
+void CopyPixelsWithStats(uint8_t* dst, const uint8_t* src, int w, int h, ImageStats& stats);
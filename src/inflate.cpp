@@ -0,0 +1,306 @@
+// src/inflate.cpp
+#include "inflate.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr int kFastBits = 10;
+constexpr int kFastMask = (1 << kFastBits) - 1;
+
+const uint16_t kLenBase[29]  = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+const uint8_t  kLenExtra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+const uint16_t kDistBase[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,
+                                 1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+const uint8_t  kDistExtra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+inline uint32_t BitReverse(uint32_t v, int bits)
+{
+    v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+    v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+    v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+    v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+    return v >> (16 - bits);
+}
+
+// Canonical Huffman decoder: codes up to kFastBits resolve with one table
+// lookup, longer ones walk the per-length limits.
+struct Huffman {
+    uint16_t fast[1 << kFastBits];   // (len << 9) | symbol, 0 = slow path
+    uint16_t firstCode[17];
+    uint16_t firstSymbol[17];
+    uint32_t maxCode[18];            // exclusive, left-justified to 16 bits
+    uint8_t  size[288];
+    uint16_t value[288];
+
+    bool Build(const uint8_t* lengths, int num)
+    {
+        int counts[17] = {};
+        std::memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < num; ++i) ++counts[lengths[i]];
+        counts[0] = 0;
+        for (int i = 1; i < 16; ++i)
+            if (counts[i] > (1 << i)) return false;
+
+        int nextCode[16];
+        int code = 0, k = 0;
+        for (int i = 1; i < 16; ++i) {
+            nextCode[i]    = code;
+            firstCode[i]   = uint16_t(code);
+            firstSymbol[i] = uint16_t(k);
+            code += counts[i];
+            if (counts[i] && code - 1 >= (1 << i)) return false;
+            maxCode[i] = uint32_t(code) << (16 - i);
+            code <<= 1;
+            k += counts[i];
+        }
+        maxCode[16] = 0x10000;
+
+        for (int sym = 0; sym < num; ++sym) {
+            const int s = lengths[sym];
+            if (!s) continue;
+            const int c = nextCode[s] - firstCode[s] + firstSymbol[s];
+            size[c]  = uint8_t(s);
+            value[c] = uint16_t(sym);
+            if (s <= kFastBits) {
+                const uint16_t entry = uint16_t((s << 9) | sym);
+                for (uint32_t j = BitReverse(uint32_t(nextCode[s]), s); j < (1u << kFastBits); j += (1u << s))
+                    fast[j] = entry;
+            }
+            ++nextCode[s];
+        }
+        return true;
+    }
+};
+
+struct Inflater {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t       bitbuf  = 0;
+    int            bitcnt  = 0;
+    size_t         overrun = 0;     // zero bytes fed past the end of input
+    uint8_t*       outStart;
+    uint8_t*       out;
+    uint8_t*       outEnd;
+    bool           exact = true;    // stream must fill the output exactly
+
+    // Top up to >= 56 bits. Bits above bitcnt always mirror the bytes at p,
+    // so the 8-byte load can OR over them.
+    inline void Refill()
+    {
+        if (end - p >= 8) {
+            uint64_t v;
+            std::memcpy(&v, p, 8);              // little-endian targets only
+            bitbuf |= v << bitcnt;
+            p += (63 - bitcnt) >> 3;
+            bitcnt |= 56;
+            return;
+        }
+        while (bitcnt <= 56) {
+            uint64_t byte = 0;
+            if (p < end) byte = *p++;
+            else         ++overrun;
+            bitbuf |= byte << bitcnt;
+            bitcnt += 8;
+        }
+    }
+
+    inline uint32_t Bits(int n)
+    {
+        if (bitcnt < n) Refill();
+        const uint32_t v = uint32_t(bitbuf & ((uint64_t(1) << n) - 1));
+        bitbuf >>= n;
+        bitcnt -= n;
+        return v;
+    }
+
+    inline int Decode(const Huffman& h)
+    {
+        if (bitcnt < 16) Refill();
+        const uint16_t e = h.fast[bitbuf & kFastMask];
+        if (e) {
+            const int len = e >> 9;
+            bitbuf >>= len;
+            bitcnt -= len;
+            return e & 511;
+        }
+        const uint32_t k = BitReverse(uint32_t(bitbuf & 0xFFFF), 16);
+        int s = kFastBits + 1;
+        while (k >= h.maxCode[s]) ++s;
+        if (s >= 16) return -1;
+        const int c = int(k >> (16 - s)) - h.firstCode[s] + h.firstSymbol[s];
+        if (c < 0 || c >= 288 || h.size[c] != s) return -1;
+        bitbuf >>= s;
+        bitcnt -= s;
+        return h.value[c];
+    }
+
+    bool Stored()
+    {
+        // drop to a byte boundary; whole bytes still in bitbuf come first
+        Bits(bitcnt & 7);
+        uint32_t len  = Bits(16);
+        uint32_t nlen = Bits(16);
+        if ((len ^ 0xFFFF) != nlen) return false;
+        if (size_t(outEnd - out) < len) return false;
+        while (len && bitcnt >= 8) {
+            *out++ = uint8_t(bitbuf);
+            bitbuf >>= 8;
+            bitcnt -= 8;
+            --len;
+        }
+        if (len) {
+            // bitbuf is drained; clear its look-ahead bits, p is about to jump
+            bitbuf = 0;
+            if (size_t(end - p) < len) return false;
+            std::memcpy(out, p, len);
+            out += len;
+            p   += len;
+        }
+        return true;
+    }
+
+    bool Codes(const Huffman& lit, const Huffman& dist)
+    {
+        for (;;) {
+            int sym = Decode(lit);
+            if (sym < 0) return false;
+            if (sym < 256) {
+                if (out == outEnd) return false;
+                *out++ = uint8_t(sym);
+                continue;
+            }
+            if (sym == 256) return true;
+            sym -= 257;
+            if (sym >= 29) return false;
+            size_t len = kLenBase[sym] + Bits(kLenExtra[sym]);
+            const int dsym = Decode(dist);
+            if (dsym < 0 || dsym >= 30) return false;
+            const size_t d = kDistBase[dsym] + Bits(kDistExtra[dsym]);
+            if (d > size_t(out - outStart) || len > size_t(outEnd - out)) return false;
+
+            const uint8_t* src = out - d;
+            if (d >= 8 && size_t(outEnd - out) >= len + 8) {
+                // 8-byte chunks may run past the match; those bytes get
+                // overwritten by whatever comes next
+                uint8_t* dst = out;
+                for (size_t i = 0; i < len; i += 8) {
+                    uint64_t v;
+                    std::memcpy(&v, src + i, 8);
+                    std::memcpy(dst + i, &v, 8);
+                }
+                out += len;
+            } else if (d == 1) {
+                std::memset(out, *src, len);
+                out += len;
+            } else {
+                while (len--) *out++ = *src++;
+            }
+        }
+    }
+
+    bool Dynamic(Huffman& lit, Huffman& dist)
+    {
+        static const uint8_t kOrder[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+        const int hlit  = int(Bits(5)) + 257;
+        const int hdist = int(Bits(5)) + 1;
+        const int hclen = int(Bits(4)) + 4;
+
+        uint8_t clen[19] = {};
+        for (int i = 0; i < hclen; ++i) clen[kOrder[i]] = uint8_t(Bits(3));
+        Huffman clh;
+        if (!clh.Build(clen, 19)) return false;
+
+        uint8_t lens[288 + 32] = {};
+        int n = 0;
+        while (n < hlit + hdist) {
+            const int c = Decode(clh);
+            if (c < 0) return false;
+            if (c < 16) { lens[n++] = uint8_t(c); continue; }
+            int rep; uint8_t fill = 0;
+            if (c == 16) {
+                if (n == 0) return false;
+                rep  = 3 + int(Bits(2));
+                fill = lens[n - 1];
+            } else if (c == 17) {
+                rep = 3 + int(Bits(3));
+            } else {
+                rep = 11 + int(Bits(7));
+            }
+            if (n + rep > hlit + hdist) return false;
+            std::memset(lens + n, fill, size_t(rep));
+            n += rep;
+        }
+        if (!lens[256]) return false;
+        return lit.Build(lens, hlit) && dist.Build(lens + hlit, hdist);
+    }
+
+    bool Run()
+    {
+        Huffman lit, dist;
+        for (;;) {
+            const uint32_t last  = Bits(1);
+            const uint32_t type  = Bits(2);
+            bool ok;
+            if (type == 0) {
+                ok = Stored();
+            } else if (type == 1) {
+                uint8_t lens[288 + 32];
+                std::memset(lens,       8, 144);
+                std::memset(lens + 144, 9, 112);
+                std::memset(lens + 256, 7, 24);
+                std::memset(lens + 280, 8, 8);
+                std::memset(lens + 288, 5, 32);
+                ok = lit.Build(lens, 288) && dist.Build(lens + 288, 32) && Codes(lit, dist);
+            } else if (type == 2) {
+                ok = Dynamic(lit, dist) && Codes(lit, dist);
+            } else {
+                ok = false;
+            }
+            if (!ok) return false;
+            // consumed more bits than the input had
+            if (overrun * 8 > size_t(bitcnt)) return false;
+            if (last) return !exact || out == outEnd;
+        }
+    }
+};
+
+} // namespace
+
+bool InflateRaw(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen)
+{
+    Inflater z;
+    z.p        = in;
+    z.end      = in + inLen;
+    z.outStart = out;
+    z.out      = out;
+    z.outEnd   = out + outLen;
+    return z.Run();
+}
+
+bool InflateZlib(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen)
+{
+    if (inLen < 2) return false;
+    const int cmf = in[0], flg = in[1];
+    if ((cmf * 256 + flg) % 31 != 0) return false;
+    if ((cmf & 15) != 8 || (flg & 32)) return false;   // deflate only, no preset dictionary
+    return InflateRaw(in + 2, inLen - 2, out, outLen);
+}
+
+bool InflateZlibBounded(const uint8_t* in, size_t inLen, uint8_t* out, size_t maxLen, size_t& outLen)
+{
+    if (inLen < 2) return false;
+    const int cmf = in[0], flg = in[1];
+    if ((cmf * 256 + flg) % 31 != 0) return false;
+    if ((cmf & 15) != 8 || (flg & 32)) return false;
+    Inflater z;
+    z.p        = in + 2;
+    z.end      = in + inLen;
+    z.outStart = out;
+    z.out      = out;
+    z.outEnd   = out + maxLen;
+    z.exact    = false;
+    if (!z.Run()) return false;
+    outLen = size_t(z.out - out);
+    return true;
+}
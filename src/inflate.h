@@ -0,0 +1,20 @@
+// src/inflate.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// zlib (RFC 1950) stream -> exactly outLen bytes. The caller knows the
+// decompressed size up front (PNG scanlines, ICC profiles), so output goes
+// straight into its buffer with no growth/realloc. Uses a 64-bit bit buffer,
+// 10-bit Huffman fast tables and word-at-a-time match copies.
+// Returns false on corrupt input or if the stream does not produce exactly
+// outLen bytes.
+bool InflateZlib(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen);
+
+// Same for a raw DEFLATE (RFC 1951) stream without the zlib header.
+bool InflateRaw(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen);
+
+// zlib stream whose size is only bounded (PNG iCCP carries no length):
+// inflates at most maxLen bytes into out and reports how many it produced.
+// Fails if the stream would produce more.
+bool InflateZlibBounded(const uint8_t* in, size_t inLen, uint8_t* out, size_t maxLen, size_t& outLen);
@@ -0,0 +1,174 @@
+// src/inverse_tonemap.cpp
+#include "inverse_tonemap.h"
+#include "half_float.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr int kLumaSteps = 4096;    // gain table entries, 12-bit luminance
+
+float SrgbToLinear(int code)
+{
+    const double c = code / 255.0;
+    return float(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+}
+
+} // namespace
+
+float ItmCurveNits(const ItmParams& p, float y)
+{
+    const float knee  = std::clamp(p.knee, 0.0f, 0.95f);
+    const float extra = std::max(0.0f, p.peakNits - p.paperNits);
+    float nits = p.paperNits * y;
+    if (y > knee) {
+        const float t = (y - knee) / (1.0f - knee);
+        nits += extra * t * t;      // zero slope at the knee, peakNits at y = 1
+    }
+    return nits;
+}
+
+// Everything a pass needs besides the pixels: output channel c of a pixel
+// with codes z and luminance index i is a[z_c] + b[z_c] * gain[i]
+struct InverseToneMapper::Tables {
+    float   a[256];                 // per-channel expansion, weighted by 1 - saturation
+    float   b[256];                 // linear value, weighted by saturation
+    float   alpha[256];
+    float   lin[256];
+    float   gain[kLumaSteps];       // luminance expansion / luminance, in scRGB
+    uint8_t kneeCode = 255;         // codes below this never reach the knee
+};
+
+void InverseToneMapper::BuildTables(const ItmParams& p, Tables& t) const
+{
+    const float sat = std::clamp(p.saturation, 0.0f, 1.0f);
+    const float knee = std::clamp(p.knee, 0.0f, 0.95f);
+    t.kneeCode = 255;
+    for (int z = 255; z >= 0; --z) {
+        t.lin[z]   = SrgbToLinear(z);
+        t.a[z]     = (1.0f - sat) * ItmCurveNits(p, t.lin[z]) / kScRgbNits;
+        t.b[z]     = sat * t.lin[z];
+        t.alpha[z] = z / 255.0f;
+        // one luminance step of margin, so rounding into the gain table
+        // never lands a skipped pixel past the knee
+        if (t.lin[z] >= knee - 1.0f / (kLumaSteps - 1)) t.kneeCode = uint8_t(z);
+    }
+    t.gain[0] = p.paperNits / kScRgbNits;
+    for (int i = 1; i < kLumaSteps; ++i) {
+        const float y = float(i) / (kLumaSteps - 1);
+        t.gain[i] = ItmCurveNits(p, y) / (y * kScRgbNits);
+    }
+}
+
+void InverseToneMapper::SetImage(const uint8_t* rgba, int w, int h)
+{
+    m_w = w;
+    m_h = h;
+    m_src.assign(rgba, rgba + size_t(w) * h * 4);
+    m_luma.clear();
+    m_rowMax.clear();
+    m_valid = false;
+}
+
+const PixelBuffer& InverseToneMapper::Apply(const ItmParams& p)
+{
+    if (m_valid && p == m_params) {
+        lastPass   = "cached";
+        lastMs     = 0.0;
+        lastPixels = 0;
+        return m_out;
+    }
+    HDRV_TRACE_SCOPE("inverse tone map");
+    const int64_t t0 = TraceNowNs();
+    auto t = std::make_unique<Tables>();
+    BuildTables(p, *t);
+
+    // the luminance index is made once per image, by the first pass
+    const bool index = m_luma.empty();
+    const ItmParams& q = m_params;
+    const bool highlights = !index && m_valid && p.paperNits == q.paperNits && p.knee == q.knee &&
+                            p.saturation == q.saturation;
+    if (index) {
+        m_luma.resize(size_t(m_w) * m_h);
+        m_rowMax.assign(size_t(m_h), 0);
+    }
+    m_out.resize(size_t(m_w) * m_h * 8);
+
+    const int bands = std::max(1, ParallelBandCount(m_h, 16));
+    std::vector<uint64_t> written(size_t(bands), 0);
+    ParallelForBands(m_h, 16, [&](int band, int y0, int y1) {
+        const Tables& tb = *t;
+        uint64_t count = 0;
+        for (int y = y0; y < y1; ++y) {
+            if (highlights && m_rowMax[size_t(y)] < tb.kneeCode) continue;
+            const uint8_t* src = m_src.data() + size_t(y) * m_w * 4;
+            uint16_t* luma = m_luma.data() + size_t(y) * m_w;
+            uint16_t* dst = reinterpret_cast<uint16_t*>(m_out.data()) + size_t(y) * m_w * 4;
+            uint8_t rowMax = 0;
+            for (int x = 0; x < m_w; ++x) {
+                const uint8_t* px = src + x * 4;
+                const uint8_t hi = std::max({ px[0], px[1], px[2] });
+                if (highlights && hi < tb.kneeCode) continue;
+                if (index) {
+                    const float lum = 0.2126f * tb.lin[px[0]] + 0.7152f * tb.lin[px[1]] + 0.0722f * tb.lin[px[2]];
+                    luma[x] = uint16_t(std::min(kLumaSteps - 1, int(lum * (kLumaSteps - 1) + 0.5f)));
+                    rowMax = std::max(rowMax, hi);
+                }
+                const float g = tb.gain[luma[x]];
+#ifdef HDRV_HALF_SSE2
+                const __m128 a = _mm_setr_ps(tb.a[px[0]], tb.a[px[1]], tb.a[px[2]], tb.alpha[px[3]]);
+                const __m128 b = _mm_setr_ps(tb.b[px[0]], tb.b[px[1]], tb.b[px[2]], 0.0f);
+                const __m128 v = _mm_min_ps(_mm_add_ps(a, _mm_mul_ps(b, _mm_set1_ps(g))), _mm_set1_ps(kHalfMax));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), FloatToHalf4(v));
+#else
+                for (int c = 0; c < 3; ++c) dst[x * 4 + c] = FloatToHalf(tb.a[px[c]] + tb.b[px[c]] * g);
+                dst[x * 4 + 3] = FloatToHalf(tb.alpha[px[3]]);
+#endif
+                ++count;
+            }
+            if (index) m_rowMax[size_t(y)] = rowMax;
+        }
+        written[size_t(band)] = count;
+    });
+
+    m_params   = p;
+    m_valid    = true;
+    lastPass   = highlights ? "highlights" : "full";
+    lastMs     = double(TraceNowNs() - t0) / 1e6;
+    lastPixels = 0;
+    for (uint64_t c : written) lastPixels += c;
+    return m_out;
+}
+
+std::shared_ptr<InverseToneMapper> ItmCache::Find(const std::wstring& path)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->path != path) continue;
+        Entry hit = std::move(*it);
+        m_entries.erase(it);
+        m_entries.push_back(std::move(hit));
+        return m_entries.back().m;
+    }
+    return nullptr;
+}
+
+void ItmCache::Insert(const std::wstring& path, std::shared_ptr<InverseToneMapper> m)
+{
+    if (!m) return;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->path == path) { m_entries.erase(it); break; }
+    }
+    m_entries.push_back(Entry{ path, std::move(m) });
+    if (m_entries.size() > kEntries) m_entries.pop_front();
+}
+
+void ItmCache::Erase(const std::wstring& path)
+{
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [&](const Entry& e) { return e.path == path; }),
+                    m_entries.end());
+}
@@ -0,0 +1,86 @@
+// src/inverse_tonemap.h
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// scRGB puts 1.0 at 80 nits
+constexpr float kScRgbNits = 80.0f;
+
+// Shape of the SDR -> HDR expansion. Linear luminance Y in [0, 1] maps to
+// paperNits * Y up to `knee`; above it the highlights rise on a curve
+// that leaves the knee with the same slope and reaches peakNits at SDR
+// white.
+struct ItmParams {
+    float peakNits   = 1000.0f;
+    float paperNits  = 200.0f;     // where SDR content sits (diffuse white)
+    float knee       = 0.6f;       // linear luminance where expansion starts
+    float saturation = 1.0f;       // 1: scale RGB by the luminance gain (hue and
+                                   // saturation kept), 0: expand each channel alone
+
+    bool operator==(const ItmParams& o) const {
+        return peakNits == o.peakNits && paperNits == o.paperNits && knee == o.knee && saturation == o.saturation;
+    }
+    bool operator!=(const ItmParams& o) const { return !(*this == o); }
+};
+
+// Output nits for linear SDR luminance `y` (0..1)
+float ItmCurveNits(const ItmParams& p, float y);
+
+// Inverse tone mapping of one RGBA8 (sRGB) image into RGBA16F scRGB.
+// Pixels go through per-code tables (sRGB decode, per-channel expansion)
+// and a 4096-entry luminance gain table, four channels at a time in SSE2
+// with rows split across all cores. The first Apply also stores each
+// pixel's quantized luminance and each row's brightest code; after that a
+// new peak only rewrites pixels above the knee, and any other change
+// rebuilds the tables and reruns the cheap pass. Asking for the
+// parameters of the last result returns it unchanged.
+class InverseToneMapper {
+public:
+    // Keeps its own copy of `rgba`
+    void SetImage(const uint8_t* rgba, int w, int h);
+
+    // RGBA16F, w*h*8 bytes, valid until the next Apply or SetImage
+    const PixelBuffer& Apply(const ItmParams& p);
+
+    int    Width() const  { return m_w; }
+    int    Height() const { return m_h; }
+    size_t Bytes() const  { return m_src.size() + m_luma.size() * 2 + m_out.size(); }
+
+    // What the last Apply did, for the HUD and --itm-bench
+    const char* lastPass = "";      // "full", "highlights" or "cached"
+    double      lastMs   = 0.0;
+    uint64_t    lastPixels = 0;     // pixels written
+
+private:
+    struct Tables;
+    void BuildTables(const ItmParams& p, Tables& t) const;
+
+    PixelBuffer           m_src;
+    int                   m_w = 0, m_h = 0;
+    std::vector<uint16_t, PoolAllocator<uint16_t>> m_luma;  // per pixel, 12-bit linear luminance
+    std::vector<uint8_t>  m_rowMax; // per row, brightest channel code
+    PixelBuffer           m_out;
+    ItmParams             m_params;
+    bool                  m_valid = false;
+};
+
+// Mappers for the last few paths, so going back to an image (or turning
+// expansion off and on) reuses its output and luminance index
+class ItmCache {
+public:
+    static constexpr size_t kEntries = 2;
+
+    std::shared_ptr<InverseToneMapper> Find(const std::wstring& path);
+    void Insert(const std::wstring& path, std::shared_ptr<InverseToneMapper> m);
+    void Erase(const std::wstring& path);
+    void Clear() { m_entries.clear(); }
+
+private:
+    struct Entry { std::wstring path; std::shared_ptr<InverseToneMapper> m; };
+    std::deque<Entry> m_entries;    // most recent last
+};
@@ -0,0 +1,197 @@
+// src/jpeg_parallel.cpp
+#include "jpeg_parallel.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "stb_image.h"
+
+namespace {
+
+// Below this the thread start-up and header copies eat the gain
+constexpr size_t kMinParallelPixels = size_t(2) << 20;
+
+struct JpegLayout {
+    int    width = 0, height = 0;
+    size_t sofPos  = 0;             // offset of the SOF marker
+    size_t sosPos  = 0;             // offset of the SOS marker
+    size_t scanPos = 0;             // first entropy-coded byte
+    int    restartInterval = 0;     // MCUs per interval
+    int    mcuW = 0, mcuH = 0;
+    int    mcusPerRow = 0, mcuRows = 0;
+    bool   verticalChroma = false;  // some component has V < Vmax
+    std::vector<size_t> intervalBegin, intervalEnd;
+};
+
+inline int ReadBE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+bool ParseHeaders(const uint8_t* d, size_t len, JpegLayout& L)
+{
+    size_t pos = 2;
+    bool sawSof = false;
+    for (;;) {
+        if (pos + 4 > len || d[pos] != 0xFF) return false;
+        while (pos + 1 < len && d[pos + 1] == 0xFF) ++pos;     // fill bytes
+        if (pos + 4 > len) return false;
+        const int m = d[pos + 1];
+        if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) { pos += 2; continue; }
+        const size_t segLen = size_t(ReadBE16(d + pos + 2));
+        if (segLen < 2 || pos + 2 + segLen > len) return false;
+        const uint8_t* seg = d + pos + 4;
+
+        if (m == 0xC0 || m == 0xC1) {
+            if (sawSof || segLen < 8 || seg[0] != 8) return false;
+            sawSof   = true;
+            L.sofPos = pos;
+            L.height = ReadBE16(seg + 1);
+            L.width  = ReadBE16(seg + 3);
+            const int nc = seg[5];
+            if (L.width == 0 || L.height == 0) return false;   // DNL-sized
+            if ((nc != 1 && nc != 3 && nc != 4) || segLen != size_t(8 + 3 * nc)) return false;
+            int hmax = 1, vmax = 1;
+            for (int i = 0; i < nc; ++i) {
+                const int hs = seg[7 + 3 * i] >> 4, vs = seg[7 + 3 * i] & 15;
+                if (hs < 1 || hs > 4 || vs < 1 || vs > 4) return false;
+                hmax = std::max(hmax, hs);
+                vmax = std::max(vmax, vs);
+            }
+            for (int i = 0; i < nc; ++i)
+                if ((seg[7 + 3 * i] & 15) != vmax) L.verticalChroma = true;
+            if (nc == 1) { L.mcuW = L.mcuH = 8; }      // non-interleaved: one block per MCU
+            else         { L.mcuW = 8 * hmax; L.mcuH = 8 * vmax; }
+        } else if ((m >= 0xC2 && m <= 0xCF) && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+            return false;                               // progressive, lossless, arithmetic
+        } else if (m == 0xDD) {
+            if (segLen != 4) return false;
+            L.restartInterval = ReadBE16(seg);
+        } else if (m == 0xDA) {
+            if (!sawSof) return false;
+            // one interleaved scan covering every component
+            if (seg[0] != d[L.sofPos + 9]) return false;
+            L.sosPos  = pos;
+            L.scanPos = pos + 2 + segLen;
+            return L.restartInterval > 0;
+        } else if (m == 0xD9) {
+            return false;
+        }
+        pos += 2 + segLen;
+    }
+}
+
+// Record where every restart interval starts and ends in the scan. RSTn
+// markers cannot be faked by entropy data thanks to 0xFF00 byte stuffing.
+bool FindIntervals(const uint8_t* d, size_t len, JpegLayout& L)
+{
+    L.mcusPerRow = (L.width  + L.mcuW - 1) / L.mcuW;
+    L.mcuRows    = (L.height + L.mcuH - 1) / L.mcuH;
+    const long long mcus = (long long)L.mcusPerRow * L.mcuRows;
+    const size_t expected = size_t((mcus + L.restartInterval - 1) / L.restartInterval);
+    L.intervalBegin.reserve(expected);
+    L.intervalEnd.reserve(expected);
+
+    L.intervalBegin.push_back(L.scanPos);
+    size_t i = L.scanPos;
+    for (;;) {
+        const uint8_t* ff = static_cast<const uint8_t*>(std::memchr(d + i, 0xFF, len - i));
+        if (!ff || size_t(ff - d) + 1 >= len) return false;
+        i = size_t(ff - d);
+        const int m = d[i + 1];
+        if (m == 0x00 || m == 0xFF) { i += 1 + (m == 0x00); continue; }
+        L.intervalEnd.push_back(i);
+        if (m >= 0xD0 && m <= 0xD7) {
+            if (L.intervalBegin.size() == expected) return false;
+            L.intervalBegin.push_back(i + 2);
+            i += 2;
+            continue;
+        }
+        // a second scan or DNL would change what the bands mean
+        return m == 0xD9 && L.intervalBegin.size() == expected;
+    }
+}
+
+} // namespace
+
+bool IsJpeg(const uint8_t* data, size_t len)
+{
+    return len >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+bool DecodeJpegParallel(const uint8_t* data, size_t len, PixelBuffer& rgba,
+                        int& outW, int& outH, int* bandsUsed, int maxBands)
+{
+    if (!IsJpeg(data, len)) return false;
+    JpegLayout L;
+    if (!ParseHeaders(data, len, L)) return false;
+    if (size_t(L.width) * size_t(L.height) < kMinParallelPixels) return false;
+    if (!FindIntervals(data, len, L)) return false;
+
+    // MCU rows where a restart interval begins, i.e. legal cut points
+    const int step  = L.restartInterval / std::gcd(L.restartInterval, L.mcusPerRow);
+    const int units = (L.mcuRows + step - 1) / step;
+    // with context rows a band re-decodes up to 2 units, so keep bands >= 4 units
+    const int minUnits = L.verticalChroma ? 4 : 1;
+    const int bands    = ParallelBandCount(units, minUnits, maxBands);
+    if (bands < 2) return false;
+
+    PixelBuffer out;
+    try {
+        out.resize(size_t(L.width) * size_t(L.height) * 4);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+
+    const int ctx = L.verticalChroma ? step : 0;
+    const int totalIntervals = int(L.intervalBegin.size());
+    std::atomic<bool> failed{ false };
+
+    ParallelForBands(units, minUnits, maxBands, [&](int, int u0, int u1) {
+        HDRV_TRACE_SCOPE("jpeg band");
+        const int r0 = u0 * step;                                   // kept MCU rows
+        const int r1 = std::min(u1 * step, L.mcuRows);
+        const int s  = r0 > 0 ? r0 - ctx : 0;                      // decoded MCU rows
+        const int e  = std::min(r1 < L.mcuRows ? r1 + ctx : r1, L.mcuRows);
+        const int i0 = int((long long)s * L.mcusPerRow / L.restartInterval);
+        const int i1 = e == L.mcuRows ? totalIntervals
+                                      : int((long long)e * L.mcusPerRow / L.restartInterval);
+        const int subTop = s * L.mcuH;
+        const int subH   = std::min(e * L.mcuH, L.height) - subTop;
+
+        // headers (SOF height patched) + SOS + this band's intervals + EOI
+        std::vector<uint8_t> sub;
+        const size_t scanBytes = L.intervalEnd[size_t(i1 - 1)] - L.intervalBegin[size_t(i0)];
+        sub.reserve(L.scanPos + scanBytes + 2);
+        sub.insert(sub.end(), data, data + L.scanPos);
+        sub[L.sofPos + 5] = uint8_t(subH >> 8);
+        sub[L.sofPos + 6] = uint8_t(subH);
+        sub.insert(sub.end(), data + L.intervalBegin[size_t(i0)], data + L.intervalEnd[size_t(i1 - 1)]);
+        sub.push_back(0xFF);
+        sub.push_back(0xD9);
+
+        int bw = 0, bh = 0, bc = 0;
+        unsigned char* px = stbi_load_from_memory(sub.data(), int(sub.size()), &bw, &bh, &bc, 4);
+        if (!px || bw != L.width || bh != subH) {
+            failed = true;
+            stbi_image_free(px);
+            return;
+        }
+        const int keepTop = r0 * L.mcuH;
+        const int keepBot = std::min(r1 * L.mcuH, L.height);
+        const size_t rowBytes = size_t(L.width) * 4;
+        std::memcpy(out.data() + size_t(keepTop) * rowBytes,
+                    px + size_t(keepTop - subTop) * rowBytes,
+                    size_t(keepBot - keepTop) * rowBytes);
+        stbi_image_free(px);
+    });
+    if (failed) return false;
+
+    rgba.swap(out);
+    outW = L.width;
+    outH = L.height;
+    if (bandsUsed) *bandsUsed = bands;
+    return true;
+}
@@ -0,0 +1,22 @@
+// src/jpeg_parallel.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "buffer_pool.h"
+
+bool IsJpeg(const uint8_t* data, size_t len);
+
+// Multithreaded decode of baseline JPEGs that carry restart markers (DRI).
+// The entropy-coded scan is cut at restart markers that fall on MCU-row
+// boundaries; each band becomes a self-contained JPEG (original headers,
+// SOF height patched) that stb_image decodes on its own thread. When chroma
+// is vertically subsampled, bands decode one aligned MCU row of context on
+// each side so the upsampler sees the same neighbours and the output matches
+// a single stbi_load_from_memory call bit for bit.
+// Returns false (outputs untouched) for progressive files, files without
+// usable restart intervals, small images, or any decode error; the caller
+// then runs stb's sequential path. `bandsUsed` receives the thread count;
+// `maxBands` caps it (0: one per hardware thread).
+bool DecodeJpegParallel(const uint8_t* data, size_t len, PixelBuffer& rgba,
+                        int& w, int& h, int* bandsUsed = nullptr, int maxBands = 0);
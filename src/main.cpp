@@ -12,7 +12,9 @@
 #include <cstdint>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <algorithm>        // for std::clamp
+#include <cmath>
 #include <filesystem>       // C++17
 #include <cstdio>           // for FILE*
 #include <chrono>    // for steady_clock
@@ -24,10 +26,48 @@
 #include <vector>
 #include <unordered_set>
 #include <algorithm>
+#include <unordered_map>
+#include <shellapi.h>    // CommandLineToArgvW
 #include <ShellScalingAPI.h>   // or <Shcore.h> on some SDKs
 #pragma comment(lib, "Shcore.lib")
 using Microsoft::WRL::ComPtr;
 
+#include "buffer_pool.h"
+#include "image_stats.h"
+#include "bc_encode.h"
+#include "image_cache.h"
+#include "stream_decode.h"
+#include "image_formats.h"
+#include "gif_stream.h"
+#include "thumbnails.h"
+#include "grid_view.h"
+#include "trace.h"
+#include "perf_stats.h"
+#include "upload_ring.h"
+#include "duplicates.h"
+#include "catalog.h"
+#include "task_graph.h"
+#include "color_profile.h"
+#include "view_resample.h"
+#include "pixel_transform.h"
+#include "exif.h"
+#include "image_compare.h"
+#include "hdr_merge.h"
+#include "inverse_tonemap.h"
+#include "gain_map.h"
+#include "file_list.h"
+#include "file_search.h"
+#include "png_fast.h"
+#include "jpeg_parallel.h"
+
+
+// Route stb's large allocations (decode output, zlib/idat buffers, resize
+// scratch) through the reusable buffer pool
+#define STBI_MALLOC(sz)                PoolAlloc(sz)
+#define STBI_REALLOC(p, newsz)         PoolRealloc(p, newsz)
+#define STBI_FREE(p)                   PoolFree(p)
+#define STBIR_MALLOC(size, user_data)  ((void)(user_data), PoolAlloc(size))
+#define STBIR_FREE(ptr, user_data)     ((void)(user_data), PoolFree(ptr))
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE2_IMPLEMENTATION
@@ -65,11 +105,21 @@ HANDLE                       g_fenceEvent = nullptr;
 Microsoft::WRL::ComPtr<ID3D12RootSignature> g_textRootSig;
 Microsoft::WRL::ComPtr<ID3D12PipelineState> g_textPSO;
 
-// persistent overlay buffers
-Microsoft::WRL::ComPtr<ID3D12Resource> g_textVB, g_textIB;
-void* g_textVBMapped = nullptr;
+// persistent overlay buffers: one upload VB per frame in flight (DXGI lets
+// the CPU run up to three frames ahead), so a frame only writes vertices the
+// GPU has finished drawing
+static constexpr UINT kOverlayFrames = 3;
+struct OverlayVB {
+    Microsoft::WRL::ComPtr<ID3D12Resource> res;
+    void*  mapped   = nullptr;
+    UINT   capacity = 0;
+    UINT   used     = 0;   // bytes appended by the frame filling it
+    UINT64 freeAt   = 0;   // g_fence value of the last frame that drew from it
+};
+OverlayVB g_textVBs[kOverlayFrames];
+UINT      g_textVBFrame = 0;   // the VB this frame appends into
+Microsoft::WRL::ComPtr<ID3D12Resource> g_textIB;
 void* g_textIBMapped = nullptr;
-UINT  g_textVBCapacity = 0;
 UINT  g_textIBCapacity = 0;
 
 
@@ -80,7 +130,7 @@ enum class SortMode { ByName, ByDateModified, ByDateCreated };
 static SortMode g_sortMode = SortMode::ByName;
 
 // ---- new globals for “next/prev” support ----
-static std::vector<std::wstring> g_fileList;
+static FileList                  g_fileList;        // interned folders, one name arena
 static int                       g_currentFileIndex = 0;
 
 // Track cursor movement time for hide
@@ -124,9 +174,221 @@ static std::string BuildInfoLine(const std::wstring& path) {
 
 
 // Image data globals
-std::vector<uint8_t>         g_pixels;
+PixelBuffer                  g_pixels;   // pooled, not zeroed on resize
 int                          g_imgW = 0, g_imgH = 0;
 
+// Largest texture we create; bigger images are downscaled to fit
+static constexpr int kMaxTexDim = 16384;
+
+// Fit w x h inside kMaxTexDim keeping aspect; returns false if no clamp needed
+static bool ClampToMaxTexture(int w, int h, int& outW, int& outH) {
+    outW = w; outH = h;
+    if (w <= kMaxTexDim && h <= kMaxTexDim) return false;
+    const double sx = double(kMaxTexDim) / double(w);
+    const double sy = double(kMaxTexDim) / double(h);
+    const double s  = (sx < sy) ? sx : sy;
+    outW = std::max(1, int(std::floor(w * s)));
+    outH = std::max(1, int(std::floor(h * s)));
+    return true;
+}
+
+// Histogram / clipping stats per path, from the read-only sweep that ends LoadImage
+static std::unordered_map<std::wstring, ImageStats> g_statsCache;
+static bool g_drawHistogram = false;
+
+// Which decoder produced g_pixels and how long it took, for the info overlay
+struct DecodeInfo {
+    const char* format  = "";
+    const char* path    = "stb";
+    double      ms      = 0.0;
+    int         threads = 1;
+};
+static DecodeInfo g_lastDecode;
+
+// Embedded profile of the last load and what converting it to sRGB cost
+struct ColorInfo {
+    std::string profile;            // empty: untagged or already sRGB
+    double      ms = 0.0;
+    double      megapixels = 0.0;
+};
+static ColorInfo g_lastColor;
+
+// Exposure bracket merged into the FP16 texture on screen (X). Its pixels
+// only live on the GPU; any load or cache hit ends it.
+static bool     g_hdrActive = false;
+static HdrImage g_hdr;              // everything but rgba16, for the info line
+static float    g_hdrEv     = 0.0f; // display exposure, stops from the reference frame
+static double   g_hdrEvStep = 2.0;  // assumed bracket step without Exif (Shift+X)
+
+// --hdr: FP16 back buffers in scRGB (linear, 1.0 = 80 nits) so the
+// viewer drives an HDR display itself instead of relying on a driver
+// overlay. SDR images then sit at the paper white of g_itmParams.
+static bool g_scRgb = false;
+
+// Inverse tone mapping (E) of SDR images to scRGB, on the CPU, shown in
+// place of the image texture while on. Results are kept per image.
+static bool                               g_itmOn    = false;
+static bool                               g_texScRgb = false;   // texture on screen is already scRGB (g_itm output)
+static ItmParams                          g_itmParams;
+static ItmCache                           g_itmCache;
+static std::shared_ptr<InverseToneMapper> g_itm;
+
+// Ultra HDR / gain map JPEGs (U): the current file's gain map, turned with
+// g_pixels. With --hdr its HDR rendition is shown in place of the base
+// image (and of inverse tone mapping).
+static bool    g_gainMapOn    = true;
+static GainMap g_gainMap;               // w == 0 when the file has none
+static bool    g_gainMapShown = false;  // texture on screen is the HDR rendition
+static double  g_gainMapMs    = 0.0;    // last apply
+
+static DXGI_FORMAT BackBufferFormat()
+{
+    return g_scRgb ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM;
+}
+
+// The image pass blends and writes linear light: through an sRGB view of
+// the 8-bit buffers, or straight into the FP16 ones
+static DXGI_FORMAT ImageRtvFormat()
+{
+    return g_scRgb ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+}
+
+// Shader multiplier that puts SDR white where it belongs on the swap chain
+static float SdrWhite()
+{
+    return g_scRgb ? g_itmParams.paperNits / kScRgbNits : 1.0f;
+}
+
+// Multiplier the image pixel shader applies to linear colour
+static float DisplayExposure()
+{
+    if (g_hdrActive) return SdrWhite() * std::exp2(g_hdrEv);
+    return g_texScRgb ? 1.0f : SdrWhite();
+}
+
+// Convert g_pixels out of the profile embedded in the file's leading bytes
+static void ConvertToDisplayColors(const uint8_t* head, size_t len)
+{
+    g_lastColor = ColorInfo{};
+    const std::shared_ptr<const ColorTransform> xf = EmbeddedColorTransform(head, len);
+    if (!xf) return;
+    HDRV_STAGE_SCOPE(PerfStage::Color, "color convert");
+    const int64_t t0 = TraceNowNs();
+    xf->Apply(g_pixels.data(), g_imgW, g_imgH);
+    g_lastColor.profile    = xf->Description();
+    g_lastColor.ms         = (TraceNowNs() - t0) / 1e6;
+    g_lastColor.megapixels = double(g_imgW) * g_imgH / 1e6;
+}
+
+// Rotations and mirrors the user applied (, . M) this session, on top of
+// each file's Exif orientation
+static std::unordered_map<std::wstring, Orientation> g_userOrient;
+
+// Turn g_pixels upright: the Exif orientation in the file's leading bytes
+// (or `container`'s, when a RAW file says how to turn its preview), then
+// the user's own turn of this file
+static void OrientToDisplay(const uint8_t* head, size_t len, const std::wstring& wpath, uint32_t container = 0)
+{
+    uint32_t exif = container;
+    if (exif == 0 && !FindExifOrientation(head, len, exif)) exif = 1;
+    Orientation o = OrientationFromExif(exif);
+    const auto user = g_userOrient.find(wpath);
+    if (user != g_userOrient.end()) o = Combine(o, user->second);
+    if (o == Orientation::Normal) return;
+    HDRV_STAGE_SCOPE(PerfStage::Orient, "orient");
+#ifdef HDRV_DECODE_VERIFY
+    {
+        PixelBuffer ref(g_pixels.size());
+        const auto t0 = std::chrono::steady_clock::now();
+        OrientPixelsNaive(g_pixels.data(), g_imgW, g_imgH, o, ref.data());
+        const auto t1 = std::chrono::steady_clock::now();
+        PixelBuffer fast = g_pixels;
+        int w = g_imgW, h = g_imgH;
+        OrientPixels(fast, w, h, o);
+        const auto t2 = std::chrono::steady_clock::now();
+        const double naiveMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        const double fastMs  = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        char msg[256];
+        snprintf(msg, sizeof(msg), "orient %s %dx%d %.2f ms, naive %.2f ms, speedup %.2fx, %s\n",
+                 OrientationName(o), g_imgW, g_imgH, fastMs, naiveMs, naiveMs / std::max(0.001, fastMs),
+                 memcmp(ref.data(), fast.data(), ref.size()) == 0 ? "identical" : "MISMATCH");
+        OutputDebugStringA(msg);
+    }
+#endif
+    OrientPixels(g_pixels, g_imgW, g_imgH, o);
+    if (g_gainMap.w > 0) OrientPixels(g_gainMap.rgba, g_gainMap.w, g_gainMap.h, o);
+}
+
+// Performance HUD (P): frame times, the last load's stage breakdown and load
+// latencies, all fed by the perf_stats counters
+static bool             g_drawHud = false;
+static FrameTimeStats   g_frameTimes;
+static LatencyHistogram g_loadLatency;
+static PerfSnapshot     g_loadStartSnap, g_lastLoad;
+static int64_t          g_loadStartNs = 0;
+static double           g_lastLoadMs  = 0.0;
+static bool             g_loadPending = false;
+
+static void MarkLoadStart()
+{
+    g_loadStartSnap = PerfCollect();
+    g_loadStartNs   = TraceNowNs();
+    g_loadPending   = true;
+}
+
+// The new image is on the GPU: close the window MarkLoadStart opened
+static void MarkLoadEnd()
+{
+    if (!g_loadPending) return;
+    g_loadPending = false;
+    PerfAdd(PerfCounter::Loads, 1);
+    g_lastLoad   = PerfCollect() - g_loadStartSnap;
+    g_lastLoadMs = (TraceNowNs() - g_loadStartNs) / 1e6;
+    g_loadLatency.Add(g_lastLoadMs);
+}
+
+// One-line status message shown briefly at the bottom of the screen
+static std::string                           g_toast;
+static std::chrono::steady_clock::time_point g_toastUntil;
+
+static void ShowToast(std::string text)
+{
+    g_toast      = std::move(text);
+    g_toastUntil = std::chrono::steady_clock::now() + std::chrono::seconds(4);
+}
+
+// Write the trace spans recorded so far to %TEMP%\HDRViewer-trace.json
+// (open in chrome://tracing or ui.perfetto.dev)
+static bool DumpTrace(std::wstring& path)
+{
+    wchar_t dir[MAX_PATH];
+    const DWORD n = GetTempPathW(MAX_PATH, dir);
+    path = (n > 0 && n < MAX_PATH) ? std::wstring(dir, n) : std::wstring();
+    path += L"HDRViewer-trace.json";
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, path.c_str(), L"wb") != 0 || !f) return false;
+    const bool ok = TraceWriteJson(f);
+    return fclose(f) == 0 && ok;
+}
+
+// Animated GIF playback; idle for still images
+static GifPlayer g_gif;
+
+// Contact-sheet grid (G). Thumbnails are generated in the background and
+// packed into atlas pages at SRV heap descriptors 1..kMaxAtlasPages.
+static constexpr int kMaxAtlasPages = 16;       // 16 MB each, ~1000 thumbnails
+static bool                 g_gridMode       = false;
+static bool                 g_gridFilesDirty = true;   // g_fileList changed since SetFiles
+static GridLayout           g_grid;
+static float                g_gridScroll = 0.0f, g_gridScrollTarget = 0.0f;
+static int                  g_gridScrollDir = 1;
+static int                  g_gridSel = 0;
+static int                  g_gridPrioRow = -1, g_gridPrioDir = 0;   // last Prioritize() inputs
+static uint64_t             g_gridFrame = 0;
+static ThumbnailPipeline    g_thumbs;
+static ThumbAtlas           g_atlas(kMaxAtlasPages);
+static std::vector<uint8_t> g_thumbFailed;
+
 // Track zoom interval and mouse position
 float g_zoom       = 1.0f;    // current, used for rendering
 float g_targetZoom = 1.0f;    // goal, set by wheel
@@ -149,6 +411,30 @@ int g_screenH = 0;
 float  g_baseScaleX = 1.0f;
 float  g_baseScaleY = 1.0f;
 
+// Fraction of the texture holding real pixels (BC textures are padded to 4x4)
+float  g_uvScaleX = 1.0f;
+float  g_uvScaleY = 1.0f;
+
+// Block compression for browsing: smaller uploads + a compressed image cache
+static bool                               g_blockCompress = false;
+static CompressedImageCache               g_bcCache(256ull * 1024 * 1024);
+static std::shared_ptr<const CachedImage> g_curBc;   // what is on screen, if compressed
+static BcEncodeWorker                     g_bcEncoder;
+static uint64_t                           g_imageUploads = 0;   // UploadTexture calls so far
+
+static void UpdateLetterbox() {
+    float imgAspect    = float(g_imgW) / float(g_imgH);
+    float screenAspect = float(g_screenW) / float(g_screenH);
+    g_baseScaleX = g_baseScaleY = 1.0f;
+    if (imgAspect > screenAspect) {
+        // image is wider → pillarbox vertically
+        g_baseScaleY = screenAspect / imgAspect;
+    } else {
+        // image taller → letterbox horizontally
+        g_baseScaleX = imgAspect / screenAspect;
+    }
+}
+
 static void UpdateClientSize(HWND hWnd) {
     RECT rc; GetClientRect(hWnd, &rc);
     g_screenW = std::max<int>(1, rc.right  - rc.left);
@@ -163,6 +449,9 @@ cbuffer TransformCB : register(b0)
     float scaleY;
     float offX;
     float offY;
+    float uvScaleX;
+    float uvScaleY;
+    float exposure;
 };
 
 struct VSOut {
@@ -188,12 +477,19 @@ VSOut VSMain(uint vid : SV_VertexID)
     VSOut o;
     // apply zoom‐center translation
     o.pos = float4(quadPos[vid] + float2(offX, offY), 0, 1);
-    o.uv  = quadUV[vid];
+    o.uv  = quadUV[vid] * float2(uvScaleX, uvScaleY);
     return o;
 }
 )";
 
 static const char* g_PS = R"(
+cbuffer TransformCB : register(b0)
+{
+    float4 transform;
+    float2 uvScale;
+    float  exposure;
+};
+
 struct VSOut { float4 pos : SV_POSITION; float2 uv : TEXCOORD; };
 
 Texture2D    tex  : register(t0);
@@ -201,8 +497,10 @@ SamplerState samp : register(s0);
 
 float4 PSMain(VSOut vsIn) : SV_TARGET
 {
-    // sample with the UVs we generated in the VS
-    return tex.Sample(samp, vsIn.uv);
+    // sample with the UVs we generated in the VS; textures are linear here
+    // (sRGB formats decode on sampling), so exposure is a plain multiply
+    float4 c = tex.Sample(samp, vsIn.uv);
+    return float4(c.rgb * exposure, c.a);
 }
 )";
 
@@ -231,6 +529,72 @@ static D3D12_INPUT_ELEMENT_DESC g_TextIL[] = {
     { "COLOR",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 8,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 };
 
+// ==== sprite shaders (pixel-space textured triangles, grid thumbnails) ====
+static const char* g_VS_Sprite = R"(
+cbuffer ScreenCB : register(b0) { float2 invScreen; float white; };
+struct VSIn  { float2 pos : POSITION; float2 uv : TEXCOORD; };
+struct VSOut { float4 pos : SV_POSITION; float2 uv : TEXCOORD; };
+VSOut VSMain(VSIn i) {
+    float2 ndc = float2(i.pos.x * invScreen.x * 2.0f - 1.0f,
+                        1.0f - i.pos.y * invScreen.y * 2.0f);
+    VSOut o; o.pos = float4(ndc, 0, 1); o.uv = i.uv; return o;
+}
+)";
+
+// atlas pages are _SRGB, so samples are linear like the image's and are
+// scaled to SDR white the same way
+static const char* g_PS_Sprite = R"(
+cbuffer ScreenCB : register(b0) { float2 invScreen; float white; };
+Texture2D    tex  : register(t0);
+SamplerState samp : register(s0);
+struct VSOut { float4 pos : SV_POSITION; float2 uv : TEXCOORD; };
+float4 PSMain(VSOut i) : SV_TARGET {
+    float4 c = tex.Sample(samp, i.uv);
+    return float4(c.rgb * white, c.a);
+}
+)";
+
+struct SpriteVertex { float x, y; float u, v; };
+
+static D3D12_INPUT_ELEMENT_DESC g_SpriteIL[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+};
+
+Microsoft::WRL::ComPtr<ID3D12RootSignature> g_spriteRootSig;
+Microsoft::WRL::ComPtr<ID3D12PipelineState> g_spritePSO;
+
+// Shader bytecode, compiled by startup tasks ahead of the pipelines
+struct ShaderBlobs {
+    ComPtr<ID3DBlob> vs, ps, textVS, textPS, spriteVS, spritePS;
+};
+static ShaderBlobs g_shaders;
+
+static bool CompileShader(const char* src, const char* entry, const char* target, ComPtr<ID3DBlob>& out)
+{
+    ComPtr<ID3DBlob> err;
+    if (SUCCEEDED(D3DCompile(src, strlen(src), nullptr, nullptr, nullptr, entry, target, 0, 0, &out, &err)))
+        return true;
+    const char* msg = err ? reinterpret_cast<const char*>(err->GetBufferPointer()) : "Unknown shader compile error";
+    MessageBoxA(nullptr, msg, "Shader Compile Error", MB_OK | MB_ICONERROR);
+    return false;
+}
+
+// Startup phases, ms from the moment the file was picked (the dialog waits
+// on the user, so it is not part of time-to-first-frame)
+struct StartupPhase {
+    const char* name;
+    double      startMs, endMs;
+};
+static std::vector<StartupPhase> g_startupPhases;
+static int64_t                   g_startupNs    = 0;
+static double                    g_firstFrameMs = 0.0;     // first frame showing the image
+
+static void RecordStartupPhase(const char* name, int64_t startNs, int64_t endNs)
+{
+    g_startupPhases.push_back({ name, (startNs - g_startupNs) / 1e6, (endNs - g_startupNs) / 1e6 });
+}
+
 static void EnablePerMonitorV2DpiAwarenessEarly() {
     // Prefer Per-Monitor V2 on Win10+; fall back gracefully if unavailable.
     HMODULE user32 = LoadLibraryW(L"user32.dll");
@@ -277,193 +641,991 @@ inline void ThrowIfFailed(HRESULT hr) {
 }
 
 
-void CreateTextureFromPixels()
+// Block until `fence` reaches `value`; returns at once when it already has
+static void WaitForFence(ID3D12Fence* fence, UINT64 value)
 {
-    if (g_imgW <= 0 || g_imgH <= 0 || g_pixels.empty())
-        return;
+    if (fence->GetCompletedValue() >= value) return;
+    ThrowIfFailed(fence->SetEventOnCompletion(value, g_fenceEvent));
+    HDRV_STAGE_SCOPE(PerfStage::GpuWait, "gpu wait");
+    WaitForSingleObject(g_fenceEvent, INFINITE);
+}
 
-    // 1) Clamp size (keep aspect) only if needed
-    constexpr int kMaxTexDim = 16384;
-    const int srcW = g_imgW, srcH = g_imgH;
-    int dstW = srcW, dstH = srcH;
+// Run a closed copy list on the main queue and block until it is done.
+// Signals the frame timeline, which only ever advances on this queue.
+static void ExecuteAndWait(ID3D12GraphicsCommandList* list)
+{
+    ID3D12CommandList* lists[] = { list };
+    g_cmdQueue->ExecuteCommandLists(1, lists);
+    ThrowIfFailed(g_cmdQueue->Signal(g_fence.Get(), ++g_fenceValue));
+    WaitForFence(g_fence.Get(), g_fenceValue);
+}
 
-    if (srcW > kMaxTexDim || srcH > kMaxTexDim) {
-        const double sx = double(kMaxTexDim) / double(srcW);
-        const double sy = double(kMaxTexDim) / double(srcH);
-        const double s  = (sx < sy) ? sx : sy;
-        dstW = std::max(1, int(std::floor(srcW * s)));
-        dstH = std::max(1, int(std::floor(srcH * s)));
-    }
+// ---- asynchronous image uploads ----
+// Images are copied on a dedicated copy queue out of one persistent staging
+// buffer. Ring regions and copy allocators retire as g_copyFence advances;
+// the new texture is swapped in by PublishPendingTexture() once its copy has
+// landed, so loading never blocks the UI thread on the GPU.
+static constexpr UINT64 kUploadRingSize = 128ull * 1024 * 1024;   // one ~32 MP RGBA8 image
+static ComPtr<ID3D12CommandQueue>        g_copyQueue;
+static ComPtr<ID3D12Fence>               g_copyFence;
+static UINT64                            g_copyFenceValue = 0;
+static ComPtr<ID3D12GraphicsCommandList> g_copyList;
+static ComPtr<ID3D12Resource>            g_uploadRingBuffer;
+static UploadRing                        g_uploadRing(kUploadRingSize);
+static FenceRetireQueue<ComPtr<ID3D12CommandAllocator>> g_copyAllocators;
+static FenceRetireQueue<ComPtr<ID3D12Resource>> g_copyRetire;    // on g_copyFence: oversize staging, superseded loads
+static FenceRetireQueue<ComPtr<ID3D12Resource>> g_frameRetire;   // on g_fence: textures older frames may sample
+static FenceRetireQueue<ComPtr<ID3D12Resource>> g_animTextures;  // on g_fence: animation frame textures to refill
+
+struct PendingTexture {
+    ComPtr<ID3D12Resource> tex;
+    UINT64 fence      = 0;
+    float  uvScaleX   = 1.0f, uvScaleY   = 1.0f;
+    float  baseScaleX = 1.0f, baseScaleY = 1.0f;   // letterbox of the image it shows
+    bool   scRgb      = false;                      // pixels already in scRGB units
+    bool   anim       = false;                      // an animation frame texture
+};
+static PendingTexture g_pendingTex;
+static bool           g_texIsAnim = false;          // g_texture goes back to g_animTextures
 
-    // 2) Optional CPU resize (only if we actually clamped)
-    const uint8_t* uploadData = g_pixels.data();
-    std::vector<uint8_t> resized; // keep alive until copy completes
-    if (dstW != srcW || dstH != srcH) {
-        resized.resize(size_t(dstW) * size_t(dstH) * 4);
+// The image SRV alternates between heap slot 0 and the slot after the atlas
+// pages, so a publish never rewrites a descriptor an in-flight frame reads
+static constexpr int kImageSrvSlotB = 1 + kMaxAtlasPages;
+static int    g_imageSrvSlot    = 0;
+static UINT64 g_imageSlotFreeAt = 0;   // g_fence value after which the inactive slot is unused
 
-        // v2 API signature:
-        // stbir_resize_uint8_srgb(in, w, h, strideB, out, W, H, strideB, STBIR_RGBA)
-        stbir_resize_uint8_srgb(
-            g_pixels.data(), srcW, srcH, srcW * 4,
-            resized.data(),  dstW, dstH, dstW * 4,
-            STBIR_RGBA
-        );
+// Letterbox of the texture on screen; g_baseScale follows g_imgW/H, which
+// already describe the next image while its upload is in flight
+static float g_texScaleX = 1.0f, g_texScaleY = 1.0f;
 
-        uploadData = resized.data();
+static D3D12_CPU_DESCRIPTOR_HANDLE ImageSrvCpu(int slot)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE h = g_srvHeap->GetCPUDescriptorHandleForHeapStart();
+    h.ptr += SIZE_T(slot) * g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return h;
+}
+
+static D3D12_GPU_DESCRIPTOR_HANDLE ImageSrvGpu(int slot)
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE h = g_srvHeap->GetGPUDescriptorHandleForHeapStart();
+    h.ptr += UINT64(slot) * g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return h;
+}
+
+static void CreateUploadQueue()
+{
+    D3D12_COMMAND_QUEUE_DESC desc{};
+    desc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    ThrowIfFailed(g_device->CreateCommandQueue(&desc, IID_PPV_ARGS(&g_copyQueue)));
+    ThrowIfFailed(g_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_copyFence)));
+    ThrowIfFailed(g_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(kUploadRingSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&g_uploadRingBuffer)
+    ));
+}
+
+// Free staging space, allocators and textures whose fences have passed
+static void RetireUploads()
+{
+    const UINT64 copyDone = g_copyFence->GetCompletedValue();
+    g_uploadRing.Retire(copyDone);
+    g_copyRetire.Release(copyDone);
+    g_frameRetire.Release(g_fence->GetCompletedValue());
+    // the animation is over: its spare textures go once no frame samples them
+    if (!g_texIsAnim && !g_pendingTex.anim) g_animTextures.Release(g_fence->GetCompletedValue());
+}
+
+// Staging for one upload: a slice of the ring, or a dedicated buffer for an
+// image larger than the whole ring (freed once its copy lands)
+static ID3D12Resource* AllocateStaging(UINT64 size, UINT64& offset)
+{
+    if (size <= g_uploadRing.Capacity()) {
+        RetireUploads();
+        // ring still full of copies in flight: wait for the oldest to land
+        while (!g_uploadRing.Allocate(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, offset)) {
+            WaitForFence(g_copyFence.Get(), g_uploadRing.OldestFence());
+            RetireUploads();
+        }
+        return g_uploadRingBuffer.Get();
     }
 
-    OutputDebugStringA("CreateTextureFromPixels called\n");
+    ComPtr<ID3D12Resource> buffer;
+    ThrowIfFailed(g_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(size),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&buffer)
+    ));
+    ID3D12Resource* raw = buffer.Get();
+    g_copyRetire.Push(std::move(buffer), g_copyFenceValue + 1);
+    offset = 0;
+    return raw;
+}
 
-    // 3) Create DEFAULT heap texture (dstW/dstH <= 16384)
+// Reset the shared copy list on an allocator the copy queue has finished with
+static ID3D12GraphicsCommandList* BeginCopy()
+{
+    ComPtr<ID3D12CommandAllocator> alloc;
+    if (g_copyAllocators.PopCompleted(g_copyFence->GetCompletedValue(), alloc)) {
+        ThrowIfFailed(alloc->Reset());
+    } else {
+        ThrowIfFailed(g_device->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&alloc)));
+    }
+    if (!g_copyList) {
+        ThrowIfFailed(g_device->CreateCommandList(
+            0, D3D12_COMMAND_LIST_TYPE_COPY, alloc.Get(), nullptr, IID_PPV_ARGS(&g_copyList)));
+    } else {
+        ThrowIfFailed(g_copyList->Reset(alloc.Get(), nullptr));
+    }
+    g_copyAllocators.Push(std::move(alloc), g_copyFenceValue + 1);
+    return g_copyList.Get();
+}
+
+// Close and submit the copy list; returns the fence value it completes at
+static UINT64 SubmitCopy()
+{
+    ThrowIfFailed(g_copyList->Close());
+    ID3D12CommandList* lists[] = { g_copyList.Get() };
+    g_copyQueue->ExecuteCommandLists(1, lists);
+    ThrowIfFailed(g_copyQueue->Signal(g_copyFence.Get(), ++g_copyFenceValue));
+    g_uploadRing.Submit(g_copyFenceValue);
+    return g_copyFenceValue;
+}
+
+// Create a DEFAULT heap texture from CPU data and queue it to replace
+// g_texture. rowPitch/rowCount describe the source rows (block rows for BC
+// formats); `scRgb` marks pixels already in scRGB units (ITM output).
+// `animTex`, if given, is an animation frame texture of this size to fill
+// instead; it returns to g_animTextures once replaced on screen.
+// Returns once the copy is submitted; the texture goes on screen at the
+// first PublishPendingTexture() after it lands.
+static void UploadTexture(const void* data, int texW, int texH, DXGI_FORMAT format,
+                          SIZE_T rowPitch, UINT rowCount, float uvScaleX, float uvScaleY,
+                          bool scRgb = false, ComPtr<ID3D12Resource> animTex = nullptr)
+{
+    HDRV_STAGE_SCOPE(PerfStage::Upload, "upload");
+    ++g_imageUploads;
+    // a load that never reached the screen is dropped once its copy is done
+    if (g_pendingTex.tex) g_copyRetire.Push(std::move(g_pendingTex.tex), g_pendingTex.fence);
+    const bool anim = animTex != nullptr;
+
+    // 3) Create DEFAULT heap texture (texW/texH <= 16384)
     D3D12_RESOURCE_DESC texDesc = {};
     texDesc.Dimension        = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    texDesc.Width            = static_cast<UINT64>(dstW);
-    texDesc.Height           = static_cast<UINT>(dstH);
+    texDesc.Width            = static_cast<UINT64>(texW);
+    texDesc.Height           = static_cast<UINT>(texH);
     texDesc.DepthOrArraySize = 1;
     texDesc.MipLevels        = 1; // (set >1 if you add mips later)
-    texDesc.Format           = DXGI_FORMAT_R8G8B8A8_UNORM; // keep your format
+    texDesc.Format           = format;
     texDesc.SampleDesc       = {1, 0};
     texDesc.Layout           = D3D12_TEXTURE_LAYOUT_UNKNOWN;
     texDesc.Flags            = D3D12_RESOURCE_FLAG_NONE;
 
-    Microsoft::WRL::ComPtr<ID3D12Resource> tex;
-    ThrowIfFailed(g_device->CreateCommittedResource(
+    // COMMON: promoted to COPY_DEST on the copy queue, decays back when the
+    // copy completes, then promoted to PIXEL_SHADER_RESOURCE by the first draw
+    // (a reused frame texture has decayed to COMMON after its last draw)
+    Microsoft::WRL::ComPtr<ID3D12Resource> tex = std::move(animTex);
+    if (!tex) ThrowIfFailed(g_device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
         &texDesc,
-        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_COMMON,
         nullptr,
         IID_PPV_ARGS(&tex)
     ));
 
-    // 4) Create UPLOAD heap for the copy
-    const UINT64 uploadSize = GetRequiredIntermediateSize(tex.Get(), 0, 1);
-    Microsoft::WRL::ComPtr<ID3D12Resource> uploadHeap;
-    ThrowIfFailed(g_device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&uploadHeap)
-    ));
-
-    // 5) Record copy on a throwaway allocator/list (NO globals touched)
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> alloc;
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> list;
-    ThrowIfFailed(g_device->CreateCommandAllocator(
-        D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&alloc)));
-    ThrowIfFailed(g_device->CreateCommandList(
-        0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-        alloc.Get(), nullptr, IID_PPV_ARGS(&list)));
+    // 4) Sub-allocate staging and record the copy
+    UINT64 offset = 0;
+    ID3D12Resource* staging = AllocateStaging(GetRequiredIntermediateSize(tex.Get(), 0, 1), offset);
 
     D3D12_SUBRESOURCE_DATA sub = {};
-    sub.pData      = uploadData;
-    sub.RowPitch   = SIZE_T(dstW) * 4;
-    sub.SlicePitch = SIZE_T(dstW) * SIZE_T(dstH) * 4;
+    sub.pData      = data;
+    sub.RowPitch   = rowPitch;
+    sub.SlicePitch = rowPitch * rowCount;
+    UpdateSubresources(BeginCopy(), tex.Get(), staging, offset, 0, 1, &sub);
+
+    // 5) Submit; the source data has been copied into staging already
+    g_pendingTex.fence      = SubmitCopy();
+    g_pendingTex.tex        = std::move(tex);
+    g_pendingTex.uvScaleX   = uvScaleX;
+    g_pendingTex.uvScaleY   = uvScaleY;
+    g_pendingTex.baseScaleX = g_baseScaleX;
+    g_pendingTex.baseScaleY = g_baseScaleY;
+    g_pendingTex.scRgb      = scRgb;
+    g_pendingTex.anim       = anim;
+}
 
-    UpdateSubresources(list.Get(), tex.Get(), uploadHeap.Get(), 0, 0, 1, &sub);
-    list->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-        tex.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-    ThrowIfFailed(list->Close());
+// Swap in the pending texture if its copy has landed and the SRV slot it
+// will use is no longer read by frames in flight. Called once per frame.
+static void PublishPendingTexture()
+{
+    if (!g_pendingTex.tex) return;
+    if (g_copyFence->GetCompletedValue() < g_pendingTex.fence) return;
+    if (g_fence->GetCompletedValue() < g_imageSlotFreeAt) return;
 
-    ID3D12CommandList* lists[] = { list.Get() };
-    g_cmdQueue->ExecuteCommandLists(1, lists);
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format                  = g_pendingTex.tex->GetDesc().Format;
+    srvDesc.ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels     = 1;
+
+    const int slot = g_imageSrvSlot == 0 ? kImageSrvSlotB : 0;
+    g_device->CreateShaderResourceView(g_pendingTex.tex.Get(), &srvDesc, ImageSrvCpu(slot));
+
+    // frames up to g_fenceValue may still sample the old texture and slot
+    if (g_texture) (g_texIsAnim ? g_animTextures : g_frameRetire).Push(std::move(g_texture), g_fenceValue);
+    g_imageSlotFreeAt = g_fenceValue;
+    g_imageSrvSlot    = slot;
+
+    g_texture   = std::move(g_pendingTex.tex);
+    g_uvScaleX  = g_pendingTex.uvScaleX;
+    g_uvScaleY  = g_pendingTex.uvScaleY;
+    g_texScaleX = g_pendingTex.baseScaleX;
+    g_texScaleY = g_pendingTex.baseScaleY;
+    g_texScRgb  = g_pendingTex.scRgb;
+    g_texIsAnim = g_pendingTex.anim;
+    g_pendingTex = PendingTexture{};
+}
+
+// ---- A/B compare ----
+// C pins the current image as the reference (A); every image shown after
+// it (B) is compared with A at A's size, and V cycles what is drawn: A and
+// B split at the cursor under one zoom/pan, the difference heat map, or
+// the SSIM map. Results are cached per (A, B) pair.
+enum class CompareView : uint8_t { Split, Diff, Ssim };
+
+struct CompareState {
+    std::wstring path;                  // reference; empty: compare is off
+    PixelBuffer  pixels;                // A, as shown when pinned
+    int          w = 0, h = 0;
+    CompareView  view = CompareView::Split;
+    std::shared_ptr<const CompareResult> result;       // A against the current image
+    ComPtr<ID3D12Resource>               tex;          // in srvSlot
+    CompareView                          texView = CompareView::Split;
+    std::shared_ptr<const CompareResult> texResult;    // the map tex shows
+    // the next texture, its copy in flight
+    ComPtr<ID3D12Resource>               pendingTex;
+    UINT64                               pendingFence = 0;
+    CompareView                          pendingView  = CompareView::Split;
+    std::shared_ptr<const CompareResult> pendingResult;
+};
+static CompareState g_cmp;
+static CompareCache g_cmpCache;
+static int          g_cmpSplitX = 0;   // screen x of the A|B divide, follows the mouse
+
+// Like the image and the view, the compare SRV alternates between two
+// slots so a publish never rewrites a descriptor in use
+static constexpr int kCompareSrvSlot = 4 + kMaxAtlasPages;
+static int    g_cmpSrvSlot    = kCompareSrvSlot;
+static UINT64 g_cmpSlotFreeAt = 0;
+
+static bool CompareActive() { return !g_cmp.path.empty(); }
+
+static const char* CompareViewName(CompareView v)
+{
+    return v == CompareView::Split ? "A | B" : v == CompareView::Diff ? "difference" : "SSIM";
+}
 
-    // 6) **Local** fence to wait for the copy (prevents stutter/deadlocks)
-    Microsoft::WRL::ComPtr<ID3D12Fence> localFence;
-    ThrowIfFailed(g_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&localFence)));
-    HANDLE localEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!localEvent) { throw std::runtime_error("CreateEvent failed"); }
+// Queue a texture of `rgba` on the copy queue to show as `view` of
+// `result`; PublishCompare() swaps it in once it has landed
+static void UploadCompareTexture(const uint8_t* rgba, int w, int h, CompareView view,
+                                 std::shared_ptr<const CompareResult> result)
+{
+    HDRV_TRACE_SCOPE("compare upload");
+    PixelBuffer resized;
+    int dstW = w, dstH = h;
+    if (ClampToMaxTexture(w, h, dstW, dstH)) {
+        resized.resize(size_t(dstW) * size_t(dstH) * 4);
+        stbir_resize_uint8_srgb(rgba, w, h, w * 4, resized.data(), dstW, dstH, dstW * 4, STBIR_RGBA);
+        rgba = resized.data();
+    }
+    ComPtr<ID3D12Resource> tex;
+    ThrowIfFailed(g_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, UINT64(dstW), UINT(dstH), 1, 1),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&tex)
+    ));
+    UINT64 offset = 0;
+    ID3D12Resource* staging = AllocateStaging(GetRequiredIntermediateSize(tex.Get(), 0, 1), offset);
+    D3D12_SUBRESOURCE_DATA sub = {};
+    sub.pData      = rgba;
+    sub.RowPitch   = LONG_PTR(dstW) * 4;
+    sub.SlicePitch = sub.RowPitch * dstH;
+    UpdateSubresources(BeginCopy(), tex.Get(), staging, offset, 0, 1, &sub);
+
+    if (g_cmp.pendingTex) g_copyRetire.Push(std::move(g_cmp.pendingTex), g_cmp.pendingFence);
+    g_cmp.pendingFence  = SubmitCopy();
+    g_cmp.pendingTex    = std::move(tex);
+    g_cmp.pendingView   = view;
+    g_cmp.pendingResult = std::move(result);
+}
 
-    const UINT64 fenceValue = 1;
-    ThrowIfFailed(g_cmdQueue->Signal(localFence.Get(), fenceValue));
-    ThrowIfFailed(localFence->SetEventOnCompletion(fenceValue, localEvent));
-    WaitForSingleObject(localEvent, INFINITE);
-    CloseHandle(localEvent);
+// Swap in the uploaded compare texture once its copy has landed and the
+// slot it goes to is free. Called once per frame.
+static void PublishCompare()
+{
+    if (!g_cmp.pendingTex) return;
+    if (g_copyFence->GetCompletedValue() < g_cmp.pendingFence) return;
+    if (g_fence->GetCompletedValue() < g_cmpSlotFreeAt) return;
 
-    // 7) Create/overwrite SRV in your SRV heap
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
     srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Format                  = texDesc.Format;
+    srvDesc.Format                  = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
     srvDesc.ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D;
     srvDesc.Texture2D.MipLevels     = 1;
+    const int slot = g_cmpSrvSlot == kCompareSrvSlot ? kCompareSrvSlot + 1 : kCompareSrvSlot;
+    g_device->CreateShaderResourceView(g_cmp.pendingTex.Get(), &srvDesc, ImageSrvCpu(slot));
+
+    if (g_cmp.tex) g_frameRetire.Push(std::move(g_cmp.tex), g_fenceValue);
+    g_cmpSlotFreeAt = g_fenceValue;
+    g_cmpSrvSlot    = slot;
+    g_cmp.tex       = std::move(g_cmp.pendingTex);
+    g_cmp.texView   = g_cmp.pendingView;
+    g_cmp.texResult = std::move(g_cmp.pendingResult);
+}
 
-    g_device->CreateShaderResourceView(
-        tex.Get(), &srvDesc,
-        g_srvHeap->GetCPUDescriptorHandleForHeapStart()
-    );
-
-    // 8) Publish texture
-    g_texture = tex;
-
-    // uploadHeap/alloc/list go out of scope here (safe after fence)
+// Make the compare texture show A (split) or the current result's map
+static void SyncCompareTexture()
+{
+    const CompareView want = g_cmp.result ? g_cmp.view : CompareView::Split;
+    const std::shared_ptr<const CompareResult> result = want == CompareView::Split ? nullptr : g_cmp.result;
+    // the texture on its way counts as shown
+    if (g_cmp.pendingTex ? g_cmp.pendingView == want && g_cmp.pendingResult == result
+                         : g_cmp.tex && g_cmp.texView == want && g_cmp.texResult == result) return;
+    if (want == CompareView::Split) {
+        UploadCompareTexture(g_cmp.pixels.data(), g_cmp.w, g_cmp.h, want, nullptr);
+    } else {
+        PixelBuffer map;
+        if (want == CompareView::Diff) RenderDiffMap(*g_cmp.result, g_cmp.pixels.data(), map);
+        else                           RenderSsimMap(*g_cmp.result, map);
+        UploadCompareTexture(map.data(), g_cmp.w, g_cmp.h, want, result);
+    }
 }
 
-void CreateTextPipeline()
+// Compare A with the image now in g_pixels (after any load or turn)
+static void RefreshCompare()
 {
-    // root sig: 2 float constants (invScreen)
-    D3D12_ROOT_PARAMETER param{};
-    param.ParameterType            = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-    param.Constants.Num32BitValues = 2;
-    param.Constants.ShaderRegister = 0; // b0
-    param.ShaderVisibility         = D3D12_SHADER_VISIBILITY_VERTEX;
+    if (!CompareActive()) return;
+    g_cmp.result.reset();
+    if (!g_pixels.empty() && !g_fileList.empty()) {
+        const std::wstring& path = g_fileList[g_currentFileIndex];
+        g_cmp.result = g_cmpCache.Find(g_cmp.path, path);
+        if (!g_cmp.result) {
+            // B at A's size, so exports at another resolution still line up
+            const uint8_t* b = g_pixels.data();
+            PixelBuffer resized;
+            if (g_imgW != g_cmp.w || g_imgH != g_cmp.h) {
+                HDRV_STAGE_SCOPE(PerfStage::Resize, "compare resize");
+                resized.resize(size_t(g_cmp.w) * size_t(g_cmp.h) * 4);
+                stbir_resize_uint8_srgb(g_pixels.data(), g_imgW, g_imgH, g_imgW * 4,
+                                        resized.data(), g_cmp.w, g_cmp.h, g_cmp.w * 4, STBIR_RGBA);
+                b = resized.data();
+            }
+            auto r = std::make_shared<CompareResult>();
+            CompareImages(g_cmp.pixels.data(), b, g_cmp.w, g_cmp.h, *r);
+            g_cmpCache.Insert(g_cmp.path, path, r);
+            g_cmp.result = std::move(r);
+        }
+    }
+    SyncCompareTexture();
+}
 
-    D3D12_ROOT_SIGNATURE_DESC rs{};
-    rs.NumParameters = 1;
-    rs.pParameters   = &param;
-    rs.Flags         = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+// ---- exact-resolution resample of the visible region ----
+// The image texture has one mip and is sampled bilinearly, which shimmers on
+// fine detail zoomed out and offers no reconstruction filter zoomed in. Once
+// zoom and pan settle, the visible part of g_pixels is resampled at screen
+// resolution in the background and drawn 1:1 over the image; any movement
+// hides it again and cancels the job in flight.
+static ViewResampler                     g_viewResampler;
+static bool                              g_viewResample = true;     // F: Lanczos3, Mitchell, off
+static ResampleFilter                    g_viewFilter   = ResampleFilter::Lanczos3;
+static std::shared_ptr<const ViewResult> g_view;                   // shown while the viewport matches it
+static ComPtr<ID3D12Resource>            g_viewTex;
+static std::shared_ptr<const ViewResult> g_pendingView;            // its copy is in flight
+static ComPtr<ID3D12Resource>            g_pendingViewTex;
+static UINT64                            g_pendingViewFence = 0;
+static std::chrono::steady_clock::time_point g_viewMovedAt;
+static constexpr auto kViewSettle = std::chrono::milliseconds(100);
+
+// Like the image, the view SRV alternates between two slots (after the
+// second image slot) so a publish never rewrites a descriptor in use
+static constexpr int kViewSrvSlot = 2 + kMaxAtlasPages;
+static int    g_viewSrvSlot    = kViewSrvSlot;
+static UINT64 g_viewSlotFreeAt = 0;
+
+// Screen rect the image quad covers now, rounded to whole pixels, and the
+// part of g_pixels behind it
+static bool CurrentViewRequest(ViewRequest& req)
+{
+    if (g_imgW <= 0 || g_imgH <= 0 || g_pixels.size() < size_t(g_imgW) * size_t(g_imgH) * 4) return false;
+    const double W = g_screenW, H = g_screenH;
+    const double hx = double(g_texScaleX) * g_zoom, hy = double(g_texScaleY) * g_zoom;
+    const double left = (g_offX - hx + 1.0) * 0.5 * W, right  = (g_offX + hx + 1.0) * 0.5 * W;
+    const double top  = (1.0 - g_offY - hy) * 0.5 * H, bottom = (1.0 - g_offY + hy) * 0.5 * H;
+    const int x0 = std::max(0, int(std::lround(left))), x1 = std::min(g_screenW, int(std::lround(right)));
+    const int y0 = std::max(0, int(std::lround(top))),  y1 = std::min(g_screenH, int(std::lround(bottom)));
+    if (x1 - x0 < 1 || y1 - y0 < 1) return false;
+
+    req.pixels = g_pixels.data();
+    req.srcW   = g_imgW;
+    req.srcH   = g_imgH;
+    req.s0     = (x0 - left) / (right - left);
+    req.s1     = (x1 - left) / (right - left);
+    req.t0     = (y0 - top) / (bottom - top);
+    req.t1     = (y1 - top) / (bottom - top);
+    req.dstX   = x0;
+    req.dstY   = y0;
+    req.dstW   = x1 - x0;
+    req.dstH   = y1 - y0;
+    req.filter = g_viewFilter;
+    return true;
+}
 
-    ComPtr<ID3DBlob> rsBlob, errBlob;
-    ThrowIfFailed(D3D12SerializeRootSignature(&rs, D3D_ROOT_SIGNATURE_VERSION_1, &rsBlob, &errBlob));
-    ThrowIfFailed(g_device->CreateRootSignature(0, rsBlob->GetBufferPointer(), rsBlob->GetBufferSize(),
-                                                IID_PPV_ARGS(&g_textRootSig)));
+// Copy a finished view into a texture of its own on the copy queue
+static void UploadView(std::shared_ptr<const ViewResult> view)
+{
+    HDRV_TRACE_SCOPE("view upload");
+    const ViewRequest& r = view->request;
+    ComPtr<ID3D12Resource> tex;
+    ThrowIfFailed(g_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, UINT64(r.dstW), UINT(r.dstH), 1, 1),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&tex)
+    ));
 
-    // compile shaders
-    ComPtr<ID3DBlob> vs, ps, err;
-    ThrowIfFailed(D3DCompile(g_VS_Text, strlen(g_VS_Text), nullptr, nullptr, nullptr,
-                             "VSMain", "vs_5_0", 0, 0, &vs, &err));
-    ThrowIfFailed(D3DCompile(g_PS_Text, strlen(g_PS_Text), nullptr, nullptr, nullptr,
-                             "PSMain", "ps_5_0", 0, 0, &ps, &err));
+    UINT64 offset = 0;
+    ID3D12Resource* staging = AllocateStaging(GetRequiredIntermediateSize(tex.Get(), 0, 1), offset);
+    D3D12_SUBRESOURCE_DATA sub = {};
+    sub.pData      = view->rgba.data();
+    sub.RowPitch   = LONG_PTR(r.dstW) * 4;
+    sub.SlicePitch = sub.RowPitch * r.dstH;
+    UpdateSubresources(BeginCopy(), tex.Get(), staging, offset, 0, 1, &sub);
+
+    if (g_pendingViewTex) g_copyRetire.Push(std::move(g_pendingViewTex), g_pendingViewFence);
+    g_pendingViewFence = SubmitCopy();
+    g_pendingViewTex   = std::move(tex);
+    g_pendingView      = std::move(view);
+}
 
-    // PSO (alpha-blended triangles)
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
-    pso.pRootSignature        = g_textRootSig.Get();
-    pso.VS                    = { vs->GetBufferPointer(), vs->GetBufferSize() };
-    pso.PS                    = { ps->GetBufferPointer(), ps->GetBufferSize() };
-    pso.InputLayout           = { g_TextIL, _countof(g_TextIL) };
-    pso.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pso.NumRenderTargets      = 1;
-    pso.RTVFormats[0]         = DXGI_FORMAT_R8G8B8A8_UNORM;
-    pso.SampleDesc.Count      = 1;
-    pso.SampleMask            = UINT_MAX;
+// Swap in the uploaded view once its copy has landed
+static void PublishView()
+{
+    if (!g_pendingViewTex) return;
+    if (g_copyFence->GetCompletedValue() < g_pendingViewFence) return;
+    if (g_fence->GetCompletedValue() < g_viewSlotFreeAt) return;
 
-    D3D12_RASTERIZER_DESC rast{};
-    rast.FillMode = D3D12_FILL_MODE_SOLID;
-    rast.CullMode = D3D12_CULL_MODE_NONE;
-    rast.DepthClipEnable = TRUE;
-    pso.RasterizerState = rast;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format                  = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    srvDesc.ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels     = 1;
+    const int slot = g_viewSrvSlot == kViewSrvSlot ? kViewSrvSlot + 1 : kViewSrvSlot;
+    g_device->CreateShaderResourceView(g_pendingViewTex.Get(), &srvDesc, ImageSrvCpu(slot));
+
+    if (g_viewTex) g_frameRetire.Push(std::move(g_viewTex), g_fenceValue);
+    g_viewSlotFreeAt = g_fenceValue;
+    g_viewSrvSlot    = slot;
+    g_viewTex        = std::move(g_pendingViewTex);
+    g_view           = std::move(g_pendingView);
+}
 
-    D3D12_BLEND_DESC blend{};
-    auto& rt = blend.RenderTarget[0];
-    rt.BlendEnable           = TRUE;
-    rt.SrcBlend              = D3D12_BLEND_SRC_ALPHA;
-    rt.DestBlend             = D3D12_BLEND_INV_SRC_ALPHA;
-    rt.BlendOp               = D3D12_BLEND_OP_ADD;
-    rt.SrcBlendAlpha         = D3D12_BLEND_ONE;
-    rt.DestBlendAlpha        = D3D12_BLEND_INV_SRC_ALPHA;
-    rt.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
-    rt.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-    pso.BlendState = blend;
+// g_pixels is about to change: stop reading it and forget every view of it
+static void ResetView()
+{
+    g_viewResampler.Reset();
+    g_view.reset();
+    g_pendingView.reset();
+    if (g_pendingViewTex) g_copyRetire.Push(std::move(g_pendingViewTex), g_pendingViewFence);
+    g_viewMovedAt = std::chrono::steady_clock::now();
+}
 
-    pso.DepthStencilState.DepthEnable   = FALSE;
-    pso.DepthStencilState.StencilEnable = FALSE;
+// The resample is of the SDR g_pixels at paper white, so it may only stand
+// in for a texture made from them; an expanded (E), gain map (U) or merged
+// (X) image on screen has highlights above it that the view would clip
+static bool ViewMatchesTexture()
+{
+    return !g_texScRgb && !g_gainMapShown && !g_hdrActive;
+}
 
-    ThrowIfFailed(g_device->CreateGraphicsPipelineState(&pso, IID_PPV_ARGS(&g_textPSO)));
+// Once per frame, after the zoom/pan step: cancel while moving, request a
+// resample once settled, upload whatever finished
+static void UpdateView()
+{
+    PublishView();
+    const auto now = std::chrono::steady_clock::now();
+    // a quarter pixel of remaining motion is invisible; call it settled
+    const float pxX = 0.5f * g_screenW, pxY = 0.5f * g_screenH;
+    const bool moving =
+        std::fabs(g_zoom - g_targetZoom) * std::max(g_texScaleX * pxX, g_texScaleY * pxY) > 0.25f ||
+        std::fabs(g_offX - g_targetOffX) * pxX > 0.25f || std::fabs(g_offY - g_targetOffY) * pxY > 0.25f;
+    if (!g_viewResample || g_gridMode || g_gif.Active() || g_pendingTex.tex || CompareActive() ||
+        !ViewMatchesTexture() || moving) {
+        g_viewResampler.Cancel();
+        g_viewMovedAt = now;
+        return;
+    }
+    // land exactly on the target so the settled view stays put
+    g_zoom = g_targetZoom;
+    g_offX = g_targetOffX;
+    g_offY = g_targetOffY;
+
+    ViewRequest req;
+    if (!CurrentViewRequest(req)) return;
+    if ((g_view && g_view->request.Same(req)) || (g_pendingView && g_pendingView->request.Same(req))) return;
+    std::shared_ptr<const ViewResult> done;
+    if (g_viewResampler.TakeResult(done) && done->request.Same(req)) {
+        UploadView(std::move(done));
+        return;
+    }
+    if (now - g_viewMovedAt < kViewSettle || g_viewResampler.Pending(req)) return;
+    g_viewResampler.Request(req);
+    if (g_viewResampler.TakeResult(done)) UploadView(std::move(done));     // cached view
 }
 
-void CreateOrResizeTextBuffers(UINT vbBytesNeeded, UINT ibBytesNeeded)
+// Draw the resampled view 1:1 over the image if it matches the viewport
+static void DrawView(ID3D12GraphicsCommandList* cl)
+{
+    ViewRequest req;
+    if (CompareActive() || !ViewMatchesTexture() || !g_view || !g_viewTex || !CurrentViewRequest(req) ||
+        !g_view->request.Same(req)) return;
+    const ViewRequest& r = g_view->request;
+    const float W = float(g_screenW), H = float(g_screenH);
+    const float t[7] = { r.dstW / W, r.dstH / H,
+                         (r.dstX + 0.5f * r.dstW) / W * 2.0f - 1.0f,
+                         1.0f - (r.dstY + 0.5f * r.dstH) / H * 2.0f,
+                         1.0f, 1.0f, SdrWhite() };
+    cl->SetGraphicsRootDescriptorTable(0, ImageSrvGpu(g_viewSrvSlot));
+    cl->SetGraphicsRoot32BitConstants(1, 7, t, 0);
+    cl->DrawInstanced(4, 1, 0, 0);
+}
+
+// Split: B everywhere, then A again left of the divide, under the same
+// transform `t`. The maps replace the image.
+static void DrawCompare(ID3D12GraphicsCommandList* cl, const float t[7], const D3D12_RECT& full)
+{
+    const float tc[7] = { t[0], t[1], t[2], t[3], 1.0f, 1.0f, SdrWhite() };
+    if (g_cmp.texView == CompareView::Split) {
+        cl->DrawInstanced(4, 1, 0, 0);
+        const D3D12_RECT left = { full.left, full.top, std::clamp(LONG(g_cmpSplitX), full.left, full.right), full.bottom };
+        cl->RSSetScissorRects(1, &left);
+    }
+    cl->SetGraphicsRootDescriptorTable(0, ImageSrvGpu(g_cmpSrvSlot));
+    cl->SetGraphicsRoot32BitConstants(1, 7, tc, 0);
+    cl->DrawInstanced(4, 1, 0, 0);
+    cl->RSSetScissorRects(1, &full);
+}
+
+// Show the next animation frame. Frames cycle through a few textures of
+// the animation's size: each one is filled on the copy queue from the
+// upload ring and published like any upload, and goes back to the pool
+// once the frames that sampled it have retired, so playback never waits
+// on the GPU.
+static void UpdateTexturePixels(const uint8_t* rgba, int w, int h)
+{
+    HDRV_TRACE_SCOPE("frame upload");
+    ComPtr<ID3D12Resource> tex;
+    while (g_animTextures.PopCompleted(g_fence->GetCompletedValue(), tex)) {
+        const D3D12_RESOURCE_DESC desc = tex->GetDesc();
+        if (desc.Width == UINT64(w) && desc.Height == UINT(h)) break;
+        tex.Reset();    // left from an animation of another size
+    }
+    if (!tex) ThrowIfFailed(g_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, UINT64(w), UINT(h), 1, 1),
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&tex)
+    ));
+    UploadTexture(rgba, w, h, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, SIZE_T(w) * 4, UINT(h), 1.0f, 1.0f, false,
+                  std::move(tex));
+}
+
+static void UploadCompressed(const BcImage& bc)
+{
+    UploadTexture(bc.blocks.data(), bc.width, bc.height,
+                  bc.format == BcFormat::BC1 ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM_SRGB,
+                  bc.RowPitch(), UINT(bc.BlockRows()),
+                  float(bc.srcW) / float(bc.width), float(bc.srcH) / float(bc.height));
+}
+
+// Queue g_itm's output for the current parameters as the image texture
+static void UploadItmOutput()
+{
+    const PixelBuffer& out = g_itm->Apply(g_itmParams);
+    UploadTexture(out.data(), g_itm->Width(), g_itm->Height(), DXGI_FORMAT_R16G16B16A16_FLOAT,
+                  SIZE_T(g_itm->Width()) * 8, UINT(g_itm->Height()), 1.0f, 1.0f, true);
+}
+
+// E: expand `rgba` (the image at upload size) to scRGB and queue it as
+// the image texture. False when expansion is off or does not apply.
+static bool UploadInverseToneMapped(const uint8_t* rgba, int w, int h)
+{
+    if (!g_itmOn || !g_scRgb || g_gif.Active() || CompareActive() || g_fileList.empty()) return false;
+    g_itm = std::make_shared<InverseToneMapper>();
+    g_itm->SetImage(rgba, w, h);
+    g_itmCache.Insert(g_fileList[g_currentFileIndex], g_itm);
+    UploadItmOutput();
+    return true;
+}
+
+// Ultra HDR: rebuild the HDR rendition of `rgba` (the image at upload
+// size) from the file's gain map and queue it as the image texture. False
+// without a map or off the scRGB swap chain.
+static bool UploadGainMapped(const uint8_t* rgba, int w, int h)
+{
+    g_gainMapShown = false;
+    if (!g_gainMapOn || !g_scRgb || g_gainMap.w <= 0 || g_gif.Active() || CompareActive()) return false;
+    const int64_t t0 = TraceNowNs();
+    PixelBuffer hdr;
+    ApplyGainMap(rgba, w, h, g_gainMap,
+                 GainMapWeight(g_gainMap.meta, g_itmParams.peakNits / g_itmParams.paperNits), hdr);
+    g_gainMapMs = double(TraceNowNs() - t0) / 1e6;
+    UploadTexture(hdr.data(), w, h, DXGI_FORMAT_R16G16B16A16_FLOAT, SIZE_T(w) * 8, UINT(h), 1.0f, 1.0f);
+    g_gainMapShown = true;
+    return true;
+}
+
+void CreateTextureFromPixels()
+{
+    if (g_imgW <= 0 || g_imgH <= 0 || g_pixels.empty())
+        return;
+    HDRV_TRACE_SCOPE("CreateTextureFromPixels");
+
+    // 1) Clamp size (keep aspect) only if needed
+    const int srcW = g_imgW, srcH = g_imgH;
+    int dstW, dstH;
+    ClampToMaxTexture(srcW, srcH, dstW, dstH);
+
+    // 2) Optional CPU resize (only if we actually clamped)
+    const uint8_t* uploadData = g_pixels.data();
+    PixelBuffer resized; // keep alive until copy completes
+    if (dstW != srcW || dstH != srcH) {
+        HDRV_STAGE_SCOPE(PerfStage::Resize, "resize");
+        resized.resize(size_t(dstW) * size_t(dstH) * 4);
+
+        // v2 API signature:
+        // stbir_resize_uint8_srgb(in, w, h, strideB, out, W, H, strideB, STBIR_RGBA)
+        stbir_resize_uint8_srgb(
+            g_pixels.data(), srcW, srcH, srcW * 4,
+            resized.data(),  dstW, dstH, dstW * 4,
+            STBIR_RGBA
+        );
+
+        uploadData = resized.data();
+    }
+
+    OutputDebugStringA("CreateTextureFromPixels called\n");
+
+    g_curBc.reset();
+    if (UploadGainMapped(uploadData, dstW, dstH) || UploadInverseToneMapped(uploadData, dstW, dstH)) {
+        MarkLoadEnd();
+        return;
+    }
+    UploadTexture(uploadData, dstW, dstH, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+                  SIZE_T(dstW) * 4, UINT(dstH), 1.0f, 1.0f);
+    MarkLoadEnd();
+
+    // animations re-upload RGBA8 every frame, so never compress (or cache)
+    // them. The RGBA8 texture shows meanwhile; PollBcEncode() swaps the
+    // blocks in if nothing else has been uploaded since.
+    if (g_blockCompress && !g_fileList.empty() && !g_gif.Active()) {
+        // BC1 when the stats pass saw no alpha, BC7 otherwise
+        BcEncodeJob job;
+        job.path = g_fileList[g_currentFileIndex];
+        auto st = g_statsCache.find(job.path);
+        const bool opaque = st != g_statsCache.end() && st->second.minAlpha == 255;
+        if (!resized.empty()) job.rgba = std::move(resized);
+        else job.rgba.assign(uploadData, uploadData + size_t(dstW) * size_t(dstH) * 4);
+        job.w           = dstW;
+        job.h           = dstH;
+        job.imgW        = srcW;
+        job.imgH        = srcH;
+        job.format      = opaque ? BcFormat::BC1 : BcFormat::BC7;
+        job.measurePsnr = g_drawText;
+        job.tag         = g_imageUploads;
+        g_bcEncoder.Request(std::move(job));
+    }
+}
+
+// A background encode is done: cache it, and show it in place of the
+// RGBA8 texture it was made from if that is still the latest upload
+static void PollBcEncode()
+{
+    BcEncodeResult r;
+    if (!g_bcEncoder.TakeResult(r)) return;
+    g_bcCache.Insert(r.path, r.img);
+    if (r.tag != g_imageUploads) return;
+    UploadCompressed(r.img->bc);
+    g_curBc = std::move(r.img);
+}
+
+// Root signature + PSO for the image quad (shaders from g_shaders)
+static bool CreateMainPipeline()
+{
+    // Root signature
+    {
+        D3D12_DESCRIPTOR_RANGE range{};
+        range.RangeType                         = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        range.NumDescriptors                    = 1;
+        range.BaseShaderRegister                = 0;
+        range.RegisterSpace                     = 0;
+        range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+        // 1) SRV parameter (t0)
+        D3D12_ROOT_PARAMETER srvParam{};
+        srvParam.ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        srvParam.DescriptorTable.NumDescriptorRanges = 1;
+        srvParam.DescriptorTable.pDescriptorRanges   = &range;
+        srvParam.ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // 2) 32‐bit constants for scaleX/scaleY (b0)
+        D3D12_ROOT_PARAMETER scaleParam{};
+        scaleParam.ParameterType                    = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        scaleParam.Constants.Num32BitValues         = 7;  // scaleX, scaleY, offX, offY, uvScaleX, uvScaleY, exposure
+        scaleParam.Constants.ShaderRegister         = 0; // b0
+        scaleParam.Constants.RegisterSpace          = 0;
+        scaleParam.ShaderVisibility                 = D3D12_SHADER_VISIBILITY_ALL;
+
+        // 3) Static sampler as before
+        D3D12_STATIC_SAMPLER_DESC sampDesc{};
+        sampDesc.Filter         = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+        sampDesc.AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampDesc.AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampDesc.AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+        sampDesc.ShaderRegister = 0;
+        sampDesc.RegisterSpace  = 0;
+        sampDesc.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // 4) Pack into array
+        D3D12_ROOT_PARAMETER params[2] = { srvParam, scaleParam };
+
+        // 5) Build & serialize
+        D3D12_ROOT_SIGNATURE_DESC rsDesc{};
+        rsDesc.NumParameters     = 2;
+        rsDesc.pParameters       = params;
+        rsDesc.NumStaticSamplers = 1;
+        rsDesc.pStaticSamplers   = &sampDesc;
+        rsDesc.Flags             = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+
+        ComPtr<ID3DBlob> rsBlob, errBlob;
+        D3D12SerializeRootSignature(
+          &rsDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rsBlob, &errBlob);
+        g_device->CreateRootSignature(
+          0, rsBlob->GetBufferPointer(),
+          rsBlob->GetBufferSize(),
+          IID_PPV_ARGS(&g_rootSig));
+    }
+
+    // PSO (with explicit states + error check)
+    {
+        ID3DBlob* vsBlob = g_shaders.vs.Get();
+        ID3DBlob* psBlob = g_shaders.ps.Get();
+
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
+        psoDesc.pRootSignature        = g_rootSig.Get();
+        psoDesc.VS                    = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
+        psoDesc.PS                    = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
+
+        // Explicit default rasterizer state
+        D3D12_RASTERIZER_DESC rastDesc{};
+        rastDesc.FillMode              = D3D12_FILL_MODE_SOLID;
+        rastDesc.CullMode              = D3D12_CULL_MODE_NONE;
+        rastDesc.FrontCounterClockwise = FALSE;
+        rastDesc.DepthClipEnable       = TRUE;
+        psoDesc.RasterizerState        = rastDesc;
+
+        // Explicit default blend state
+        D3D12_RENDER_TARGET_BLEND_DESC rtbd{};
+        rtbd.BlendEnable           = FALSE;
+        rtbd.LogicOpEnable         = FALSE;
+        rtbd.SrcBlend              = D3D12_BLEND_ONE;
+        rtbd.DestBlend             = D3D12_BLEND_ZERO;
+        rtbd.BlendOp               = D3D12_BLEND_OP_ADD;
+        rtbd.SrcBlendAlpha         = D3D12_BLEND_ONE;
+        rtbd.DestBlendAlpha        = D3D12_BLEND_ZERO;
+        rtbd.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
+        rtbd.LogicOp               = D3D12_LOGIC_OP_NOOP;
+        rtbd.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+
+        D3D12_BLEND_DESC blendDesc{};
+        blendDesc.AlphaToCoverageEnable   = FALSE;
+        blendDesc.IndependentBlendEnable  = FALSE;
+        blendDesc.RenderTarget[0]         = rtbd;
+        psoDesc.BlendState                = blendDesc;
+
+        psoDesc.DepthStencilState.DepthEnable   = FALSE;
+        psoDesc.DepthStencilState.StencilEnable = FALSE;
+        psoDesc.SampleMask             = UINT_MAX;
+        psoDesc.PrimitiveTopologyType  = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        psoDesc.NumRenderTargets       = 1;
+        // sRGB view: blending and the encode on write happen in linear light
+        psoDesc.RTVFormats[0]          = ImageRtvFormat();
+        psoDesc.SampleDesc.Count       = 1;
+        psoDesc.InputLayout            = { nullptr, 0 };
+
+        // Create PSO and check errors
+        HRESULT hr = g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&g_pipelineState));
+        if (FAILED(hr)) {
+            wchar_t buf[128];
+            swprintf_s(buf, L"CreateGraphicsPipelineState failed: 0x%08X", hr);
+            MessageBoxW(nullptr, buf, L"PSO Error", MB_OK | MB_ICONERROR);
+            return false;
+        }
+    }
+    return true;
+}
+
+void CreateTextPipeline()
+{
+    // root sig: 2 float constants (invScreen)
+    D3D12_ROOT_PARAMETER param{};
+    param.ParameterType            = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    param.Constants.Num32BitValues = 2;
+    param.Constants.ShaderRegister = 0; // b0
+    param.ShaderVisibility         = D3D12_SHADER_VISIBILITY_VERTEX;
+
+    D3D12_ROOT_SIGNATURE_DESC rs{};
+    rs.NumParameters = 1;
+    rs.pParameters   = &param;
+    rs.Flags         = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+
+    ComPtr<ID3DBlob> rsBlob, errBlob;
+    ThrowIfFailed(D3D12SerializeRootSignature(&rs, D3D_ROOT_SIGNATURE_VERSION_1, &rsBlob, &errBlob));
+    ThrowIfFailed(g_device->CreateRootSignature(0, rsBlob->GetBufferPointer(), rsBlob->GetBufferSize(),
+                                                IID_PPV_ARGS(&g_textRootSig)));
+
+    ID3DBlob* vs = g_shaders.textVS.Get();
+    ID3DBlob* ps = g_shaders.textPS.Get();
+
+    // PSO (alpha-blended triangles)
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
+    pso.pRootSignature        = g_textRootSig.Get();
+    pso.VS                    = { vs->GetBufferPointer(), vs->GetBufferSize() };
+    pso.PS                    = { ps->GetBufferPointer(), ps->GetBufferSize() };
+    pso.InputLayout           = { g_TextIL, _countof(g_TextIL) };
+    pso.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    pso.NumRenderTargets      = 1;
+    pso.RTVFormats[0]         = BackBufferFormat();
+    pso.SampleDesc.Count      = 1;
+    pso.SampleMask            = UINT_MAX;
+
+    D3D12_RASTERIZER_DESC rast{};
+    rast.FillMode = D3D12_FILL_MODE_SOLID;
+    rast.CullMode = D3D12_CULL_MODE_NONE;
+    rast.DepthClipEnable = TRUE;
+    pso.RasterizerState = rast;
+
+    D3D12_BLEND_DESC blend{};
+    auto& rt = blend.RenderTarget[0];
+    rt.BlendEnable           = TRUE;
+    rt.SrcBlend              = D3D12_BLEND_SRC_ALPHA;
+    rt.DestBlend             = D3D12_BLEND_INV_SRC_ALPHA;
+    rt.BlendOp               = D3D12_BLEND_OP_ADD;
+    rt.SrcBlendAlpha         = D3D12_BLEND_ONE;
+    rt.DestBlendAlpha        = D3D12_BLEND_INV_SRC_ALPHA;
+    rt.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
+    rt.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+    pso.BlendState = blend;
+
+    pso.DepthStencilState.DepthEnable   = FALSE;
+    pso.DepthStencilState.StencilEnable = FALSE;
+
+    ThrowIfFailed(g_device->CreateGraphicsPipelineState(&pso, IID_PPV_ARGS(&g_textPSO)));
+}
+
+// Same as the text pipeline plus one SRV table: alpha-blended textured
+// triangles in screen pixels, used for atlas thumbnails. They write linear
+// light through the image pass's render target view.
+void CreateSpritePipeline()
+{
+    D3D12_DESCRIPTOR_RANGE range{};
+    range.RangeType                         = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    range.NumDescriptors                    = 1;
+    range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
+
+    D3D12_ROOT_PARAMETER params[2] = {};
+    params[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    params[0].DescriptorTable.NumDescriptorRanges = 1;
+    params[0].DescriptorTable.pDescriptorRanges   = &range;
+    params[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+    params[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    params[1].Constants.Num32BitValues            = 3;    // invScreen, white
+    params[1].Constants.ShaderRegister            = 0;    // b0
+    params[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+    D3D12_STATIC_SAMPLER_DESC samp{};
+    samp.Filter           = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+    samp.AddressU         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    samp.AddressV         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    samp.AddressW         = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    samp.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+    D3D12_ROOT_SIGNATURE_DESC rs{};
+    rs.NumParameters     = 2;
+    rs.pParameters       = params;
+    rs.NumStaticSamplers = 1;
+    rs.pStaticSamplers   = &samp;
+    rs.Flags             = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+
+    ComPtr<ID3DBlob> rsBlob, errBlob;
+    ThrowIfFailed(D3D12SerializeRootSignature(&rs, D3D_ROOT_SIGNATURE_VERSION_1, &rsBlob, &errBlob));
+    ThrowIfFailed(g_device->CreateRootSignature(0, rsBlob->GetBufferPointer(), rsBlob->GetBufferSize(),
+                                                IID_PPV_ARGS(&g_spriteRootSig)));
+
+    ID3DBlob* vs = g_shaders.spriteVS.Get();
+    ID3DBlob* ps = g_shaders.spritePS.Get();
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC pso{};
+    pso.pRootSignature        = g_spriteRootSig.Get();
+    pso.VS                    = { vs->GetBufferPointer(), vs->GetBufferSize() };
+    pso.PS                    = { ps->GetBufferPointer(), ps->GetBufferSize() };
+    pso.InputLayout           = { g_SpriteIL, _countof(g_SpriteIL) };
+    pso.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    pso.NumRenderTargets      = 1;
+    pso.RTVFormats[0]         = ImageRtvFormat();
+    pso.SampleDesc.Count      = 1;
+    pso.SampleMask            = UINT_MAX;
+
+    D3D12_RASTERIZER_DESC rast{};
+    rast.FillMode        = D3D12_FILL_MODE_SOLID;
+    rast.CullMode        = D3D12_CULL_MODE_NONE;
+    rast.DepthClipEnable = TRUE;
+    pso.RasterizerState  = rast;
+
+    D3D12_BLEND_DESC blend{};
+    auto& rt = blend.RenderTarget[0];
+    rt.BlendEnable           = TRUE;
+    rt.SrcBlend              = D3D12_BLEND_SRC_ALPHA;
+    rt.DestBlend             = D3D12_BLEND_INV_SRC_ALPHA;
+    rt.BlendOp               = D3D12_BLEND_OP_ADD;
+    rt.SrcBlendAlpha         = D3D12_BLEND_ONE;
+    rt.DestBlendAlpha        = D3D12_BLEND_INV_SRC_ALPHA;
+    rt.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
+    rt.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+    pso.BlendState = blend;
+
+    pso.DepthStencilState.DepthEnable   = FALSE;
+    pso.DepthStencilState.StencilEnable = FALSE;
+
+    ThrowIfFailed(g_device->CreateGraphicsPipelineState(&pso, IID_PPV_ARGS(&g_spritePSO)));
+}
+
+void CreateOrResizeTextBuffers(UINT vbBytesNeeded, UINT ibBytesNeeded)
 {
     auto makeBuf = [&](UINT bytes, ComPtr<ID3D12Resource>& res, void*& mapped, UINT& cap)
     {
@@ -481,10 +1643,84 @@ void CreateOrResizeTextBuffers(UINT vbBytesNeeded, UINT ibBytesNeeded)
         ThrowIfFailed(res->Map(0, nullptr, &mapped)); // keep mapped
     };
 
-    makeBuf(vbBytesNeeded, g_textVB, g_textVBMapped, g_textVBCapacity);
+    OverlayVB& vb = g_textVBs[g_textVBFrame];
+    makeBuf(vbBytesNeeded, vb.res, vb.mapped, vb.capacity);
     makeBuf(ibBytesNeeded, g_textIB, g_textIBMapped, g_textIBCapacity);
 }
 
+// Start this frame's overlays in the next VB of the ring, once the GPU is
+// done with the frame that last drew from it
+static void BeginOverlayVB()
+{
+    g_textVBFrame = (g_textVBFrame + 1) % kOverlayFrames;
+    OverlayVB& vb = g_textVBs[g_textVBFrame];
+    WaitForFence(g_fence.Get(), vb.freeAt);
+    vb.used = 0;
+}
+
+// Copy a batch of vertices into this frame's next slice of its upload VB.
+// Text, overlay rects and grid sprites all share it.
+static void AppendOverlayVB(const void* data, UINT vbBytes, D3D12_GPU_VIRTUAL_ADDRESS& va)
+{
+    // When a batch does not fit, the frame carries on in a buffer twice the
+    // size; draws already recorded keep the old one, retired with the fence
+    // this frame signals.
+    OverlayVB& vb = g_textVBs[g_textVBFrame];
+    if (!vb.res || vb.capacity < vb.used + vbBytes) {
+        if (vb.res) g_frameRetire.Push(std::move(vb.res), g_fenceValue + 1);
+        vb.capacity = (std::max)({ vbBytes, vb.capacity * 2, 1024u * 1024u });
+        vb.used     = 0;
+        vb.mapped   = nullptr;
+        ThrowIfFailed(g_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(vb.capacity),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&vb.res)));
+        ThrowIfFailed(vb.res->Map(0, nullptr, &vb.mapped));
+    }
+    std::memcpy(static_cast<uint8_t*>(vb.mapped) + vb.used, data, vbBytes);
+    va = vb.res->GetGPUVirtualAddress() + vb.used;
+    vb.used += vbBytes;
+}
+
+// Append a batch of overlay triangles to the persistent upload VB and draw it.
+// Several batches per frame are fine: each gets its own slice of the VB.
+void SubmitOverlayVerts(ID3D12GraphicsCommandList* cl, const std::vector<TextVertex>& verts)
+{
+    if (verts.empty()) return;
+    const UINT vbBytes = (UINT)(verts.size() * sizeof(TextVertex));
+    D3D12_GPU_VIRTUAL_ADDRESS va;
+    AppendOverlayVB(verts.data(), vbBytes, va);
+
+    // set state for text
+    cl->SetPipelineState(g_textPSO.Get());
+    cl->SetGraphicsRootSignature(g_textRootSig.Get());
+
+    float invScreen[2] = { 1.0f / float(g_screenW), 1.0f / float(g_screenH) };
+    cl->SetGraphicsRoot32BitConstants(0, 2, invScreen, 0);
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{ va, vbBytes, (UINT)sizeof(TextVertex) };
+
+    cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    cl->IASetVertexBuffers(0, 1, &vbv);
+    cl->DrawInstanced((UINT)verts.size(), 1, 0, 0);
+}
+
+// Two triangles covering [x0,x1]x[y0,y1] in screen pixels
+static void AppendOverlayRect(std::vector<TextVertex>& verts,
+                              float x0, float y0, float x1, float y1,
+                              float r, float g, float b, float a)
+{
+    verts.push_back({ x0, y0, r,g,b,a });
+    verts.push_back({ x1, y0, r,g,b,a });
+    verts.push_back({ x0, y1, r,g,b,a });
+    verts.push_back({ x0, y1, r,g,b,a });
+    verts.push_back({ x1, y0, r,g,b,a });
+    verts.push_back({ x1, y1, r,g,b,a });
+}
+
 // Centered + scaled overlay (no index buffer)
 void DrawOverlayText(ID3D12GraphicsCommandList* cl, const char* text,
                      float scale /*e.g. 2.0f*/, float centerX, float centerY, 
@@ -543,99 +1779,769 @@ void DrawOverlayText(ID3D12GraphicsCommandList* cl, const char* text,
         addTri(x2,y2, x1,y1, x3,y3);
     }
 
-    const UINT vbBytes = (UINT)(verts.size() * sizeof(TextVertex));
+    SubmitOverlayVerts(cl, verts);
+}
 
-    // persistent upload VB (re-use across frames)
-    if (!g_textVB || g_textVBCapacity < vbBytes) {
-        g_textVBCapacity = (std::max)(vbBytes, 256u * 1024u);
-        g_textVB.Reset();
-        g_textVBMapped = nullptr;
+// Luma + RGB histogram panel with clipping percentages (bottom-left corner)
+void DrawHistogramOverlay(ID3D12GraphicsCommandList* cl, const ImageStats& st)
+{
+    const float binW   = 2.0f;
+    const float panelW = 256.0f * binW;
+    const float panelH = 200.0f;
+    const float x0 = 40.0f;
+    const float y1 = float(g_screenH) - 40.0f;   // panel bottom
+    const float y0 = y1 - panelH;
+
+    // normalize by the tallest interior bin; 0 and 255 usually spike on
+    // clipped images and would flatten everything else
+    uint32_t peak = 1;
+    for (int i = 1; i < 255; ++i) {
+        peak = std::max({ peak, st.luma[i], st.rgb[0][i], st.rgb[1][i], st.rgb[2][i] });
+    }
+
+    std::vector<TextVertex> verts;
+    verts.reserve(6 * (1 + 256 * 4));
+    AppendOverlayRect(verts, x0 - 8, y0 - 8, x0 + panelW + 8, y1 + 8, 0, 0, 0, 0.6f);
+
+    auto series = [&](const uint32_t* hist, float r, float g, float b, float a) {
+        for (int i = 0; i < 256; ++i) {
+            if (!hist[i]) continue;
+            const float hgt = std::min(1.0f, float(hist[i]) / float(peak)) * panelH;
+            const float bx  = x0 + i * binW;
+            AppendOverlayRect(verts, bx, y1 - hgt, bx + binW, y1, r, g, b, a);
+        }
+    };
+    series(st.luma,   0.8f, 0.8f, 0.8f, 0.5f);
+    series(st.rgb[0], 1.0f, 0.2f, 0.2f, 0.35f);
+    series(st.rgb[1], 0.2f, 1.0f, 0.2f, 0.35f);
+    series(st.rgb[2], 0.3f, 0.4f, 1.0f, 0.35f);
+    SubmitOverlayVerts(cl, verts);
+
+    char line[128];
+    snprintf(line, sizeof(line), "Clipped  highlights %.2f%%  shadows %.2f%%  |  Luma %u-%u",
+             st.ClippedHighPct(), st.ClippedLowPct(), unsigned(st.minLuma), unsigned(st.maxLuma));
+    DrawOverlayText(cl, line, 2.0f, x0 + panelW * 0.5f, y0 - 24.0f, 1, 1, 1, 1.0f);
+}
+
+// The A|B divide, the compare line and what is being compared
+static void DrawCompareOverlay(ID3D12GraphicsCommandList* cl)
+{
+    if (g_cmp.view == CompareView::Split || !g_cmp.result) {
+        std::vector<TextVertex> line;
+        const float x = float(std::clamp(g_cmpSplitX, 0, g_screenW));
+        AppendOverlayRect(line, x - 1.0f, 0.0f, x + 1.0f, float(g_screenH), 1, 1, 1, 0.8f);
+        SubmitOverlayVerts(cl, line);
+    }
+    const std::wstring a = std::filesystem::path(g_cmp.path).filename().wstring();
+    const std::wstring b = g_fileList.empty() ? std::wstring()
+                                              : std::filesystem::path(g_fileList[g_currentFileIndex]).filename().wstring();
+    char text[384];
+    if (const CompareResult* r = g_cmp.result.get()) {
+        char psnr[32];
+        if (std::isinf(r->psnr)) snprintf(psnr, sizeof(psnr), "identical");
+        else                     snprintf(psnr, sizeof(psnr), "PSNR %.2f dB", r->psnr);
+        snprintf(text, sizeof(text), "A %.60s  vs  B %.60s  |  %s  SSIM %.4f (min %.3f)  |  max diff %u, %.2f%% changed  |  %.0f ms  |  %s",
+                 NarrowAscii(a).c_str(), NarrowAscii(b).c_str(), psnr, r->ssim, r->minSsim,
+                 unsigned(r->maxDiff), r->ChangedPct(), r->ms, CompareViewName(g_cmp.view));
+    } else {
+        snprintf(text, sizeof(text), "A %.60s  |  B not loaded", NarrowAscii(a).c_str());
+    }
+    DrawOverlayText(cl, text, 2.0f, 0.5f * g_screenW, g_screenH - 100.0f, 1, 1, 1, 1.0f);
+}
+
+// ---- contact-sheet grid rendering ----
+
+// Pages are filled on the copy queue while frames sample other slots of
+// them, so they allow simultaneous access and stay in COMMON. A frame waits
+// on the GPU for the copies it may draw; copies into a slot older frames
+// may still sample wait for those frames.
+static ComPtr<ID3D12Resource> g_atlasPages[kMaxAtlasPages];
+static UINT64                 g_atlasCopyFence = 0;     // g_copyFence value of the last thumbnail copies
+static UINT64                 g_atlasResetAt   = 0;     // g_fence value after which no frame reads old slots
+
+// At most this many finished thumbnails reach the GPU per frame, so a burst
+// from the workers costs a few small copies instead of a visible hitch
+static constexpr size_t kThumbUploadsPerFrame = 16;
+
+static D3D12_CPU_DESCRIPTOR_HANDLE AtlasSrvCpu(int page)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE h = g_srvHeap->GetCPUDescriptorHandleForHeapStart();
+    h.ptr += SIZE_T(1 + page) * g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return h;
+}
+
+static D3D12_GPU_DESCRIPTOR_HANDLE AtlasSrvGpu(int page)
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE h = g_srvHeap->GetGPUDescriptorHandleForHeapStart();
+    h.ptr += UINT64(1 + page) * g_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return h;
+}
+
+// Pages are created the first time the atlas hands out one of their slots
+static void EnsureAtlasPages()
+{
+    for (int p = 0; p < g_atlas.PagesUsed(); ++p) {
+        if (g_atlasPages[p]) continue;
+        const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(
+            DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, ThumbAtlas::kPageSize, ThumbAtlas::kPageSize, 1, 1, 1, 0,
+            D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS);
         ThrowIfFailed(g_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(g_textVBCapacity),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
+            &desc,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
-            IID_PPV_ARGS(&g_textVB)));
-        ThrowIfFailed(g_textVB->Map(0, nullptr, &g_textVBMapped));
+            IID_PPV_ARGS(&g_atlasPages[p])));
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srv = {};
+        srv.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        srv.Format                  = desc.Format;
+        srv.ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D;
+        srv.Texture2D.MipLevels     = 1;
+        g_device->CreateShaderResourceView(g_atlasPages[p].Get(), &srv, AtlasSrvCpu(p));
     }
-    std::memcpy(g_textVBMapped, verts.data(), vbBytes);
+}
 
-    // set state for text
-    cl->SetPipelineState(g_textPSO.Get());
-    cl->SetGraphicsRootSignature(g_textRootSig.Get());
+// Move finished thumbnails into atlas slots: staged in the upload ring and
+// copied in one batch on the copy queue. The CPU never waits; the copy queue
+// waits for frames in flight only when a slot they may sample is refilled.
+static void UploadThumbnails()
+{
+    std::vector<ThumbResult> results;
+    if (!g_thumbs.TakeResults(results, kThumbUploadsPerFrame)) return;
+    HDRV_TRACE_SCOPE("thumbnail upload");
+
+    struct PendingCopy { int slot; const ThumbResult* thumb; };
+    std::vector<PendingCopy> copies;
+    bool reused = false;
+    for (ThumbResult& r : results) {
+        if (!r.ok) { g_thumbFailed[r.index] = 1; continue; }
+        int evicted = -1;
+        const int slot = g_atlas.Allocate(r.index, r.thumb.w, r.thumb.h, g_gridFrame, evicted);
+        if (slot < 0) { g_thumbs.Invalidate(r.index); continue; }
+        if (evicted >= 0) {
+            g_thumbs.Invalidate(evicted);
+            g_gridPrioRow = -1;     // re-queue it if it is still wanted
+            reused = true;
+        }
+        copies.push_back({ slot, &r });
+    }
+    if (copies.empty()) return;
+    EnsureAtlasPages();
+
+    // a slot is far smaller than the ring, so staging always comes from it
+    static_assert(UINT64(ThumbAtlas::kSlotSize) * ThumbAtlas::kSlotSize * 4 <= kUploadRingSize,
+                  "an atlas slot must fit in the upload ring");
+    ID3D12GraphicsCommandList* list = BeginCopy();
+    uint8_t* ring = nullptr;
+    ThrowIfFailed(g_uploadRingBuffer->Map(0, nullptr, reinterpret_cast<void**>(&ring)));
+    for (const PendingCopy& c : copies) {
+        const ThumbAtlas::Slot& s = g_atlas.Get(c.slot);
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT fp = {};
+        fp.Footprint.Format   = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        fp.Footprint.Width    = UINT(s.w);
+        fp.Footprint.Height   = UINT(s.h);
+        fp.Footprint.Depth    = 1;
+        fp.Footprint.RowPitch = (UINT(s.w) * 4 + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) &
+                                ~UINT(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+        ID3D12Resource* staging = AllocateStaging(UINT64(fp.Footprint.RowPitch) * s.h, fp.Offset);
+        const Thumbnail& t = c.thumb->thumb;
+        for (int y = 0; y < s.h; ++y)
+            std::memcpy(ring + fp.Offset + UINT64(y) * fp.Footprint.RowPitch,
+                        t.rgba.data() + size_t(y) * t.w * 4, size_t(s.w) * 4);
+
+        CD3DX12_TEXTURE_COPY_LOCATION dst(g_atlasPages[ThumbAtlas::Page(c.slot)].Get(), 0);
+        CD3DX12_TEXTURE_COPY_LOCATION src(staging, fp);
+        list->CopyTextureRegion(&dst, UINT(ThumbAtlas::SlotX(c.slot)), UINT(ThumbAtlas::SlotY(c.slot)), 0,
+                                &src, nullptr);
+    }
+    g_uploadRingBuffer->Unmap(0, nullptr);
 
-    float invScreen[2] = { 1.0f / float(g_screenW), 1.0f / float(g_screenH) };
-    cl->SetGraphicsRoot32BitConstants(0, 2, invScreen, 0);
+    // an evicted slot may be drawn by every frame submitted so far, the
+    // slots of an emptied atlas by those before the reset
+    const UINT64 readersDone = std::max(reused ? g_fenceValue : 0, g_atlasResetAt);
+    if (readersDone > g_fence->GetCompletedValue()) ThrowIfFailed(g_copyQueue->Wait(g_fence.Get(), readersDone));
+    g_atlasCopyFence = SubmitCopy();
+}
 
-    D3D12_VERTEX_BUFFER_VIEW vbv{
-        g_textVB->GetGPUVirtualAddress(), vbBytes, (UINT)sizeof(TextVertex)
-    };
+// Re-send the generation order when the rows that will be on screen once the
+// scroll settles, or the scroll direction, changed
+static void UpdateGridPriority()
+{
+    int first, last;
+    g_grid.VisibleRange(g_gridScrollTarget, first, last);
+    if (first == g_gridPrioRow && g_gridScrollDir == g_gridPrioDir) return;
+    g_gridPrioRow = first;
+    g_gridPrioDir = g_gridScrollDir;
+    g_thumbs.Prioritize(ThumbnailPriority(g_grid, g_gridScrollTarget, g_gridScrollDir,
+                                          2 * g_grid.VisibleRows()));
+}
 
+static void SubmitSpriteVerts(ID3D12GraphicsCommandList* cl, int page, const std::vector<SpriteVertex>& verts)
+{
+    if (verts.empty()) return;
+    const UINT vbBytes = (UINT)(verts.size() * sizeof(SpriteVertex));
+    D3D12_GPU_VIRTUAL_ADDRESS va;
+    AppendOverlayVB(verts.data(), vbBytes, va);
+
+    cl->SetPipelineState(g_spritePSO.Get());
+    cl->SetGraphicsRootSignature(g_spriteRootSig.Get());
+    cl->SetGraphicsRootDescriptorTable(0, AtlasSrvGpu(page));
+    const float screen[3] = { 1.0f / float(g_screenW), 1.0f / float(g_screenH), SdrWhite() };
+    cl->SetGraphicsRoot32BitConstants(1, 3, screen, 0);
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{ va, vbBytes, (UINT)sizeof(SpriteVertex) };
     cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     cl->IASetVertexBuffers(0, 1, &vbv);
     cl->DrawInstanced((UINT)verts.size(), 1, 0, 0);
 }
 
+// Visible cells as one draw per atlas page; cells still waiting for their
+// thumbnail get a placeholder, failed ones a dim red tile. `rtv` is the
+// overlays' view of the back buffer, `imageRtv` the linear one thumbnails
+// are written through.
+void DrawGrid(ID3D12GraphicsCommandList* cl, D3D12_CPU_DESCRIPTOR_HANDLE rtv, D3D12_CPU_DESCRIPTOR_HANDLE imageRtv)
+{
+    ++g_gridFrame;
+    const float cell = GridLayout::kCell;
+    const float invPage = 1.0f / float(ThumbAtlas::kPageSize);
+
+    std::vector<TextVertex> boxes;
+    std::vector<SpriteVertex> sprites[kMaxAtlasPages];
+    int first, last;
+    g_grid.VisibleRange(g_gridScroll, first, last);
+    const int end = std::min(g_grid.count, (last + 1) * g_grid.cols);
+    for (int i = first * g_grid.cols; i < end; ++i) {
+        const float x = g_grid.CellX(i), y = g_grid.CellY(i, g_gridScroll);
+        const int slot = g_atlas.Find(i);
+        if (slot < 0) {
+            if (g_thumbFailed[i]) AppendOverlayRect(boxes, x, y, x + cell, y + cell, 0.35f, 0.08f, 0.08f, 1.0f);
+            else                  AppendOverlayRect(boxes, x, y, x + cell, y + cell, 0.12f, 0.13f, 0.16f, 1.0f);
+            continue;
+        }
+        g_atlas.Touch(slot, g_gridFrame);
+
+        // fit the thumbnail into the cell, centred
+        const ThumbAtlas::Slot& s = g_atlas.Get(slot);
+        const float k  = std::min(cell / s.w, cell / s.h);
+        const float x0 = x + (cell - s.w * k) * 0.5f, x1 = x0 + s.w * k;
+        const float y0 = y + (cell - s.h * k) * 0.5f, y1 = y0 + s.h * k;
+        // half-texel inset keeps bilinear taps off the neighbouring slot
+        const float u0 = (ThumbAtlas::SlotX(slot) + 0.5f) * invPage;
+        const float v0 = (ThumbAtlas::SlotY(slot) + 0.5f) * invPage;
+        const float u1 = (ThumbAtlas::SlotX(slot) + s.w - 0.5f) * invPage;
+        const float v1 = (ThumbAtlas::SlotY(slot) + s.h - 0.5f) * invPage;
+        auto& v = sprites[ThumbAtlas::Page(slot)];
+        v.push_back({ x0, y0, u0, v0 });
+        v.push_back({ x1, y0, u1, v0 });
+        v.push_back({ x0, y1, u0, v1 });
+        v.push_back({ x0, y1, u0, v1 });
+        v.push_back({ x1, y0, u1, v0 });
+        v.push_back({ x1, y1, u1, v1 });
+    }
+    SubmitOverlayVerts(cl, boxes);
+    cl->OMSetRenderTargets(1, &imageRtv, FALSE, nullptr);
+    for (int p = 0; p < kMaxAtlasPages; ++p) SubmitSpriteVerts(cl, p, sprites[p]);
+    cl->OMSetRenderTargets(1, &rtv, FALSE, nullptr);
+
+    // selection frame
+    std::vector<TextVertex> frame;
+    const float sx = g_grid.CellX(g_gridSel), sy = g_grid.CellY(g_gridSel, g_gridScroll), b = 4.0f;
+    AppendOverlayRect(frame, sx - b * 2, sy - b * 2, sx + cell + b * 2, sy - b,        1, 1, 1, 1);
+    AppendOverlayRect(frame, sx - b * 2, sy + cell + b, sx + cell + b * 2, sy + cell + b * 2, 1, 1, 1, 1);
+    AppendOverlayRect(frame, sx - b * 2, sy - b, sx - b, sy + cell + b,               1, 1, 1, 1);
+    AppendOverlayRect(frame, sx + cell + b, sy - b, sx + cell + b * 2, sy + cell + b, 1, 1, 1, 1);
+    SubmitOverlayVerts(cl, frame);
+
+    char line[256];
+    const std::string name = NarrowAscii(std::filesystem::path(g_fileList[g_gridSel]).filename().wstring());
+    snprintf(line, sizeof(line), "%s  (%d / %d)", name.c_str(), g_gridSel + 1, g_grid.count);
+    DrawOverlayText(cl, line, 2.0f, 0.5f * g_screenW, g_screenH - 20.0f, 1, 1, 1, 1.0f);
+
+    if (g_drawText) {
+        snprintf(line, sizeof(line), "Thumbnails: %d generated (%.0f%% EXIF), %.1f ms avg on %d workers  |  "
+                 "atlas %d/%d pages",
+                 g_thumbs.Generated(),
+                 g_thumbs.Generated() ? 100.0 * g_thumbs.FromExif() / g_thumbs.Generated() : 0.0,
+                 g_thumbs.AvgMs(), g_thumbs.Workers(), g_atlas.PagesUsed(), g_atlas.MaxPages());
+        DrawOverlayText(cl, line, 2.0f, 0.5f * g_screenW, 20.0f, 0, 1, 0, 1.0f);
+    }
+}
+
+// ---- performance HUD ----
+
+// DrawOverlayText centres its text; the HUD wants it left-aligned at x
+static void DrawOverlayTextLeft(ID3D12GraphicsCommandList* cl, const char* text, float scale,
+                                float x, float centerY, float r, float g, float b, float a)
+{
+    const float w = stb_easy_font_width(const_cast<char*>(text)) * scale;
+    DrawOverlayText(cl, text, scale, x + w * 0.5f, centerY, r, g, b, a);
+}
+
+static double ResourceMB(ID3D12Resource* res)
+{
+    if (!res) return 0.0;
+    const D3D12_RESOURCE_DESC desc = res->GetDesc();
+    return g_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes / 1048576.0;
+}
+
+// Top-right panel: frame-time percentiles and graph, the last load by stage,
+// load-latency histogram, resident memory and cache hit rates. Everything
+// here reads aggregates kept anyway, so showing it does not change timings.
+void DrawPerfHud(ID3D12GraphicsCommandList* cl)
+{
+    const float panelW = 740.0f, lineH = 24.0f;
+    const float x0 = float(g_screenW) - panelW - 40.0f;
+    const float graphH = 60.0f, histH = 50.0f;
+    float y = 40.0f;
+
+    std::vector<TextVertex> verts;
+    AppendOverlayRect(verts, x0 - 10, y - 10, x0 + panelW + 10, y + 17 * lineH + graphH + histH + 20,
+                      0, 0, 0, 0.65f);
+
+    // frame-time graph: one bar per frame, 50 ms full height, 16.7 ms marked
+    const float graphTop = y + lineH;
+    const float barW = panelW / FrameTimeStats::kFrames;
+    for (int i = 0; i < g_frameTimes.Size(); ++i) {
+        const float ms  = g_frameTimes.At(i);
+        const float hgt = std::min(1.0f, ms / 50.0f) * graphH;
+        const float bx  = x0 + i * barW;
+        if (ms <= 17.5f)      AppendOverlayRect(verts, bx, graphTop + graphH - hgt, bx + barW, graphTop + graphH, 0.2f, 0.9f, 0.3f, 0.8f);
+        else if (ms <= 34.0f) AppendOverlayRect(verts, bx, graphTop + graphH - hgt, bx + barW, graphTop + graphH, 1.0f, 0.8f, 0.1f, 0.8f);
+        else                  AppendOverlayRect(verts, bx, graphTop + graphH - hgt, bx + barW, graphTop + graphH, 1.0f, 0.2f, 0.2f, 0.8f);
+    }
+    const float vsyncY = graphTop + graphH - (16.7f / 50.0f) * graphH;
+    AppendOverlayRect(verts, x0, vsyncY, x0 + panelW, vsyncY + 1.0f, 1, 1, 1, 0.4f);
+
+    // load-latency histogram
+    const float histTop = graphTop + graphH + 5 * lineH;
+    const float bucketW = panelW / LatencyHistogram::kBuckets;
+    uint32_t peak = 1;
+    for (int i = 0; i < LatencyHistogram::kBuckets; ++i) peak = std::max(peak, g_loadLatency.Bucket(i));
+    for (int i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        const float hgt = histH * g_loadLatency.Bucket(i) / float(peak);
+        const float bx  = x0 + i * bucketW;
+        AppendOverlayRect(verts, bx + 4, histTop + histH - hgt, bx + bucketW - 4, histTop + histH, 0.4f, 0.6f, 1.0f, 0.8f);
+    }
+    SubmitOverlayVerts(cl, verts);
+
+    char line[192];
+    snprintf(line, sizeof(line), "Frame ms  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f",
+             g_frameTimes.Percentile(0.50f), g_frameTimes.Percentile(0.95f),
+             g_frameTimes.Percentile(0.99f), g_frameTimes.Percentile(1.0f));
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 0.5f, 1, 1, 1, 1);
+
+    y = graphTop + graphH + lineH * 0.5f;
+    const double decodeMs = g_lastLoad.StageMs(PerfStage::Decode);
+    const double mpps = decodeMs > 0.0 ? g_lastLoad.Count(PerfCounter::DecodedPixels) / 1000.0 / decodeMs : 0.0;
+    snprintf(line, sizeof(line), "Last load %.1f ms  |  decode %.0f MP/s (%s %s)",
+             g_lastLoadMs, mpps, g_lastDecode.format, g_lastDecode.path);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 0.5f, 1, 1, 1, 1);
+
+    // stage breakdown, five per line
+    for (int row = 0; row < 2; ++row) {
+        line[0] = 0;
+        for (int k = row * 5; k < row * 5 + 5 && k < kPerfStages; ++k) {
+            char part[48];
+            snprintf(part, sizeof(part), "%s%s %.1f", line[0] ? "  " : "",
+                     PerfStageName(PerfStage(k)), g_lastLoad.StageMs(PerfStage(k)));
+            strncat_s(line, part, _TRUNCATE);
+        }
+        DrawOverlayTextLeft(cl, line, 2.0f, x0, y + (row + 1.5f) * lineH, 0.8f, 0.9f, 1, 1);
+    }
+    snprintf(line, sizeof(line), "Load latency (%u loads)", g_loadLatency.Total());
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + 3.5f * lineH, 1, 1, 1, 1);
+    for (int i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        snprintf(line, sizeof(line), "%s %u", LatencyHistogram::Label(i), g_loadLatency.Bucket(i));
+        DrawOverlayText(cl, line, 1.5f, x0 + (i + 0.5f) * bucketW, histTop + histH + lineH * 0.5f, 0.8f, 0.9f, 1, 1);
+    }
+
+    y = histTop + histH + lineH;
+    double atlasMB = 0.0;
+    for (const auto& page : g_atlasPages) atlasMB += ResourceMB(page.Get());
+    snprintf(line, sizeof(line), "Memory  pixels %.0f MB  texture %.0f MB  atlas %.0f MB  staging %.0f/%.0f MB",
+             g_pixels.capacity() / 1048576.0, ResourceMB(g_texture.Get()), atlasMB,
+             g_uploadRing.Used() / 1048576.0, g_uploadRing.Capacity() / 1048576.0);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 0.5f, 1, 1, 1, 1);
+
+    const PoolStats ps = GetPoolStats();
+    snprintf(line, sizeof(line), "Pool  live %.0f MB  idle %.0f MB  reuse %.0f%%   File list  %zu in %zu folders  %.1f MB",
+             ps.liveBytes / 1048576.0, ps.idleBytes / 1048576.0, ps.ReuseRate() * 100.0, g_fileList.size(),
+             g_fileList.Folders(), g_fileList.MemoryBytes() / 1048576.0);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 1.5f, 1, 1, 1, 1);
+
+    const uint64_t lookups = g_bcCache.Hits() + g_bcCache.Misses();
+    snprintf(line, sizeof(line), "BC cache  %.0f%% hit  %zu images  %.0f MB",
+             lookups ? 100.0 * g_bcCache.Hits() / lookups : 0.0, g_bcCache.Count(), g_bcCache.Bytes() / 1048576.0);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 2.5f, 1, 1, 1, 1);
+
+    const PerfSnapshot total = PerfCollect();
+    const uint64_t thumbs = total.Count(PerfCounter::Thumbnails);
+    snprintf(line, sizeof(line), "Thumbnails  %llu made  %.1f ms each (worker time)",
+             (unsigned long long)thumbs, thumbs ? total.Count(PerfCounter::ThumbnailNs) / 1e6 / thumbs : 0.0);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 3.5f, 1, 1, 1, 1);
+
+    if (g_lastColor.profile.empty())
+        snprintf(line, sizeof(line), "Color  sRGB or untagged, no conversion");
+    else
+        snprintf(line, sizeof(line), "Color  %.40s -> sRGB  %.1f ms (%.2f ms/MP)", g_lastColor.profile.c_str(),
+                 g_lastColor.ms, g_lastColor.ms / std::max(0.001, g_lastColor.megapixels));
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 4.5f, 1, 1, 1, 1);
+
+    if (!g_viewResample)
+        snprintf(line, sizeof(line), "View  resample off, GPU bilinear");
+    else if (g_view)
+        snprintf(line, sizeof(line), "View  %s %dx%d  %.1f ms", ResampleFilterName(g_view->request.filter),
+                 g_view->request.dstW, g_view->request.dstH, g_view->ms);
+    else
+        snprintf(line, sizeof(line), "View  %s, waiting for the viewport to settle", ResampleFilterName(g_viewFilter));
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 5.5f, 1, 1, 1, 1);
+
+    // startup phases as start-end ms after the file pick, five per line
+    snprintf(line, sizeof(line), "Startup  first frame %.0f ms after the file pick", g_firstFrameMs);
+    DrawOverlayTextLeft(cl, line, 2.0f, x0, y + lineH * 6.5f, 1, 1, 1, 1);
+    for (size_t row = 0; row * 5 < g_startupPhases.size(); ++row) {
+        line[0] = 0;
+        for (size_t k = row * 5; k < row * 5 + 5 && k < g_startupPhases.size(); ++k) {
+            const StartupPhase& ph = g_startupPhases[k];
+            char part[64];
+            snprintf(part, sizeof(part), "%s%s %.0f-%.0f", line[0] ? "   " : "", ph.name, ph.startMs, ph.endMs);
+            strncat_s(line, part, _TRUNCATE);
+        }
+        DrawOverlayTextLeft(cl, line, 1.5f, x0, y + lineH * (7.5f + row * 0.8f), 0.8f, 0.9f, 1, 1);
+    }
+}
+
+
+// ------------------------------------------------
+static void ShowDecodeError(const std::string& utf8)
+{
+    int wlen = MultiByteToWideChar(
+        CP_UTF8, 0,
+        utf8.c_str(), -1,
+        nullptr, 0
+    );
+    std::wstring werr(wlen, L'\0');
+    MultiByteToWideChar(
+        CP_UTF8, 0,
+        utf8.c_str(), -1,
+        &werr[0], wlen
+    );
+    MessageBoxW(nullptr,
+                werr.c_str(),
+                L"LoadImage Error",
+                MB_OK | MB_ICONERROR);
+}
+
+// Find and decode the gain map of a file whose leading `len` bytes are
+// `head`; `file`, when open, supplies the map if it lies past them
+static void LoadGainMap(const uint8_t* head, size_t len, FILE* file, uint64_t fileLen)
+{
+    uint64_t off = 0, size = 0;
+    if (!g_scRgb || !FindGainMapImage(head, len, fileLen, off, size)) return;
+    PixelBuffer tail;
+    const uint8_t* gain = nullptr;
+    if (off + size <= len) {
+        gain = head + off;
+    } else {
+        if (!file) return;
+        tail.resize(size_t(size));
+        if (_fseeki64(file, int64_t(off), SEEK_SET) != 0 || fread(tail.data(), 1, tail.size(), file) != tail.size())
+            return;
+        gain = tail.data();
+    }
+    if (!DecodeGainMap(head, len, gain, size_t(size), g_gainMap)) g_gainMap = GainMap{};
+}
+
+// Load an image from disk into g_pixels, g_imgW, g_imgH.
+// The decoder is chosen from the file's first bytes (see image_formats.h).
+// Build with HDRV_DECODE_VERIFY to also decode every file that went through
+// a fast path with plain stb, compare bit for bit and log both timings to
+// the debugger.
+bool LoadImage(const std::wstring& wpath) {
+    HDRV_TRACE_SCOPE("LoadImage");
+    MarkLoadStart();
+    if (g_statsCache.size() >= 512) g_statsCache.clear();
+    g_gif.Stop();
+    ResetView();
+    g_hdrActive = false;
+    g_gainMap   = GainMap{};
+
+    // 1) Open the file as wide-char
+    const int64_t tOpen = TraceNowNs();
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, wpath.c_str(), L"rb") != 0 || !file) {
+        MessageBoxW(nullptr,
+                    L"Failed to open image file",
+                    wpath.c_str(),
+                    MB_OK | MB_ICONERROR);
+        return false;
+    }
+
+    // 2) Sniff the format; unknown files fail here, before any full read
+    uint8_t head[kSniffBytes] = {};
+    const size_t headLen = fread(head, 1, sizeof(head), file);
+    fseek(file, 0, SEEK_SET);
+    const ImageFormat* format = SniffImageFormat(head, headLen);
+    const int64_t tSniffed = TraceNowNs();
+    TraceRecord("open", tOpen, tSniffed);
+    PerfAddStage(PerfStage::Open, tSniffed - tOpen);
+    if (!format) {
+        fclose(file);
+        ShowDecodeError("Unsupported image format");
+        return false;
+    }
+
+    // 3) Oversized images: decode straight to texture size instead of
+    //    materializing the full-resolution buffer (often several GB)
+    int infoW = 0, infoH = 0, infoComp = 0;
+    int fitW, fitH;
+    if (format->decodeReduced &&
+        stbi_info_from_file(file, &infoW, &infoH, &infoComp) &&
+        ClampToMaxTexture(infoW, infoH, fitW, fitH)) {
+        std::vector<uint8_t> profileHead(kProfileHeadBytes);
+        fseek(file, 0, SEEK_SET);
+        profileHead.resize(fread(profileHead.data(), 1, profileHead.size(), file));
+        _fseeki64(file, 0, SEEK_END);
+        LoadGainMap(profileHead.data(), profileHead.size(), file, uint64_t(_ftelli64(file)));
+        fclose(file);
+        std::wstring err;
+        const auto t0 = std::chrono::steady_clock::now();
+        bool ok;
+        {
+            HDRV_STAGE_SCOPE(PerfStage::Decode, "decode (streamed)");
+            ok = format->decodeReduced(wpath, fitW, fitH, g_pixels, err);
+        }
+        if (!ok) {
+            g_pixels.clear();
+            MessageBoxW(nullptr, err.c_str(), L"LoadImage Error", MB_OK | MB_ICONERROR);
+            return false;
+        }
+        g_lastDecode = { format->name, "streamed", std::chrono::duration<double, std::milli>(
+                             std::chrono::steady_clock::now() - t0).count(), 1 };
+        PerfAdd(PerfCounter::DecodedPixels, uint64_t(infoW) * uint64_t(infoH));
+        g_imgW = fitW;
+        g_imgH = fitH;
+        ConvertToDisplayColors(profileHead.data(), profileHead.size());
+        OrientToDisplay(profileHead.data(), profileHead.size(), wpath);
+        // the resize already produced g_pixels; one read-only sweep for the stats
+        HDRV_STAGE_SCOPE(PerfStage::Stats, "stats");
+        CopyPixelsWithStats(g_pixels.data(), g_pixels.data(), g_imgW, g_imgH, g_statsCache[wpath]);
+        return true;
+    }
+
+    // 4) Read the whole file and hand it to the format's decoder. RAW files
+    //    are shown by their embedded preview: only its bytes are read (plus
+    //    a few small reads of the container) and decoded as what they are.
+    PixelBuffer bytes;
+    PixelBuffer decoded;
+    DecodeResult res;
+    const char* container = format->name;
+    uint32_t containerOrientation = 0;
+    bool ok = false;
+    try {
+        const int64_t tRead = TraceNowNs();
+        if (format->readEmbedded) {
+            std::wstring err;
+            if (!format->readEmbedded(wpath, 0, bytes, containerOrientation, err)) {
+                res.error = NarrowAscii(err);
+            } else {
+                format = SniffImageFormat(bytes.data(), std::min(bytes.size(), kSniffBytes));
+                if (!format || format->readEmbedded) res.error = "Unsupported embedded preview";
+            }
+        } else {
+            fseek(file, 0, SEEK_END);
+            const long fileLen = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            bytes.resize(fileLen > 0 ? size_t(fileLen) : 0);
+            if (fread(bytes.data(), 1, bytes.size(), file) != bytes.size()) res.error = "Failed to read image file";
+        }
+        if (res.error.empty()) {
+            const int64_t tReadDone = TraceNowNs();
+            TraceRecord("read", tRead, tReadDone);
+            PerfAddStage(PerfStage::Read, tReadDone - tRead);
+            HDRV_STAGE_SCOPE(PerfStage::Decode, "decode");
+            const auto t0 = std::chrono::steady_clock::now();
+            ok = format->decode(bytes.data(), bytes.size(), decoded, res);
+            g_lastDecode = { container, res.decoder, std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - t0).count(), res.threads };
+        }
+    } catch (const std::bad_alloc&) {
+        res.error = "Out of memory while loading image";
+    }
+    fclose(file);
+
+    // 5) Error-report if it failed
+    if (!ok) {
+        ShowDecodeError(res.error);
+        return false;
+    }
+
+#ifdef HDRV_DECODE_VERIFY
+    if (strcmp(res.decoder, "stb") != 0) {
+        const auto t1 = std::chrono::steady_clock::now();
+        int sw = 0, sh = 0, sc = 0;
+        unsigned char* ref = stbi_load_from_memory(bytes.data(), int(bytes.size()), &sw, &sh, &sc, 4);
+        const double stbMs = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - t1).count();
+        const bool same = ref && sw == res.w && sh == res.h &&
+                          memcmp(ref, decoded.data(), size_t(res.w) * res.h * 4) == 0;
+        stbi_image_free(ref);
+        char msg[256];
+        snprintf(msg, sizeof(msg), "%s %dx%d %s %.2f ms (%d threads), stb %.2f ms, speedup %.2fx, %s\n",
+                 format->name, res.w, res.h, res.decoder, g_lastDecode.ms, res.threads, stbMs,
+                 stbMs / std::max(0.001, g_lastDecode.ms), same ? "identical" : "MISMATCH");
+        OutputDebugStringA(msg);
+    }
+#endif
+
+    // 6) Take the decoder's buffer (a swap, no copy), convert it to sRGB and
+    //    turn it upright, then sweep the final pixels once for the stats
+    g_pixels.swap(decoded);
+    g_imgW = res.w;
+    g_imgH = res.h;
+    PerfAdd(PerfCounter::DecodedPixels, uint64_t(res.w) * uint64_t(res.h));
+    LoadGainMap(bytes.data(), bytes.size(), nullptr, bytes.size());
+    ConvertToDisplayColors(bytes.data(), bytes.size());
+    OrientToDisplay(bytes.data(), bytes.size(), wpath, containerOrientation);
+    {
+        HDRV_STAGE_SCOPE(PerfStage::Stats, "stats");
+        CopyPixelsWithStats(g_pixels.data(), g_pixels.data(), g_imgW, g_imgH, g_statsCache[wpath]);
+    }
+
+    // 7) Animations keep the file and play from a worker; stays idle for
+    //    single-frame files and canvases we would have to downscale
+    int fitW, fitH;
+    if (format->animated && !ClampToMaxTexture(g_imgW, g_imgH, fitW, fitH))
+        g_gif.Start(std::move(bytes));
+    return true;
+}
+
+// ---- library mode: every image under the catalogued root folders ----
+static Catalog        g_catalog;
+static CatalogUpdater g_catalogUpdater;
+static bool           g_libraryMode = false;
+
+// FILETIME ticks as the YYYYMMDDhhmmss form Exif capture times use
+static uint64_t FileTimeStamp(int64_t ticks)
+{
+    FILETIME utc{ DWORD(uint64_t(ticks)), DWORD(uint64_t(ticks) >> 32) }, local;
+    SYSTEMTIME st;
+    if (!FileTimeToLocalFileTime(&utc, &local) || !FileTimeToSystemTime(&local, &st)) return 0;
+    return ((((uint64_t(st.wYear) * 100 + st.wMonth) * 100 + st.wDay) * 100 + st.wHour) * 100 +
+            st.wMinute) * 100 + st.wSecond;
+}
+
+// ---- file name search ----
+// / or Ctrl+F types a query over the file names (a trigram index kept in
+// step with g_fileList on a background thread); the matches then narrow
+// what the arrow keys and clicks step through until Esc.
+static FileSearch         g_search;
+static bool               g_searchTyping = false;
+static std::wstring       g_searchQuery;            // empty: no filter
+static FileSearch::Result g_searchHits;             // indices into g_fileList
+static uint32_t           g_searchGen = 0;          // index generation of g_searchHits
+
+static void ShowSearchToast()
+{
+    char msg[256];
+    const std::string q = NarrowAscii(g_searchQuery);
+    const int n = int(g_searchHits.indices.size());
+    if (g_searchTyping) {
+        char state[96] = "";
+        if (g_search.Building())
+            snprintf(state, sizeof(state), "  (indexing %d / %d)", g_search.Indexed(), g_search.Total());
+        snprintf(msg, sizeof(msg), "Search: %s_   %d %s (%.2f ms)%s  -  Enter keeps, Esc clears",
+                 q.c_str(), n, g_searchHits.fuzzy ? "similar names" : "matches", g_searchHits.ms, state);
+    } else {
+        snprintf(msg, sizeof(msg), "Filter \"%s\": %d of %zu images%s  -  Left/Right step through them, Esc clears",
+                 q.c_str(), n, g_fileList.size(), g_searchHits.fuzzy ? " (similar names)" : "");
+    }
+    ShowToast(msg);
+}
+
+static void RunSearch()
+{
+    g_searchGen = g_search.Generation();
+    g_search.Query(g_searchQuery, g_searchHits);
+}
+
+// Called wherever g_fileList is rebuilt: the index only takes in the
+// difference. A new folder drops the filter; a re-sort or library refresh
+// keeps it and re-runs the query (again once indexing catches up).
+static void SyncSearch(bool keepFilter)
+{
+    g_search.SetFiles(g_fileList);
+    if (!keepFilter) {
+        g_searchTyping = false;
+        g_searchQuery.clear();
+    }
+    if (g_searchQuery.empty()) g_searchHits = {};
+    else RunSearch();
+}
+
+// Rebuild g_fileList from the catalog in the current sort order, from the
+// mapped metadata alone (no file system calls), and keep `keepPath` current
+static void BuildLibraryList(const std::wstring& keepPath)
+{
+    HDRV_TRACE_SCOPE("library list");
+    const size_t n = g_catalog.Count();
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = uint32_t(i);
 
-// ------------------------------------------------
-// Load an image from disk into g_pixels, g_imgW, g_imgH
-bool LoadImage(const std::wstring& wpath) {
-    // 1) Open the file as wide-char
-    FILE* file = nullptr;
-    if (_wfopen_s(&file, wpath.c_str(), L"rb") != 0 || !file) {
-        MessageBoxW(nullptr,
-                    L"Failed to open image file",
-                    wpath.c_str(),
-                    MB_OK | MB_ICONERROR);
-        return false;
+    switch (g_sortMode) {
+    case SortMode::ByName: {
+        // entries are sorted by name within each directory already
+        std::vector<uint32_t> dirs(g_catalog.DirCount()), rank(g_catalog.DirCount());
+        for (size_t d = 0; d < dirs.size(); ++d) dirs[d] = uint32_t(d);
+        std::sort(dirs.begin(), dirs.end(), [](uint32_t a, uint32_t b) {
+            return g_catalog.Str(g_catalog.Dir(a).path) < g_catalog.Str(g_catalog.Dir(b).path);
+        });
+        for (size_t r = 0; r < dirs.size(); ++r) rank[dirs[r]] = uint32_t(r);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const uint32_t ra = rank[g_catalog.Entry(a).dir], rb = rank[g_catalog.Entry(b).dir];
+            return ra != rb ? ra > rb : a > b;      // descending, like the folder view
+        });
+        break;
+    }
+    case SortMode::ByDateModified:
+        std::sort(order.begin(), order.end(), [](uint32_t a, uint32_t b) {
+            return g_catalog.Entry(a).mtime > g_catalog.Entry(b).mtime;
+        });
+        break;
+    case SortMode::ByDateCreated: {
+        // capture time where the file has one, else its modification time
+        std::vector<uint64_t> when(n);
+        for (size_t i = 0; i < n; ++i) {
+            const CatalogEntry& e = g_catalog.Entry(i);
+            when[i] = e.captured ? e.captured : FileTimeStamp(e.mtime);
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return when[a] > when[b]; });
+        break;
+    }
     }
 
-    // 2) Let STB read from that FILE*
-    int channels = 0;
-    unsigned char* data = stbi_load_from_file(
-        file,
-        &g_imgW, &g_imgH,
-        &channels, 4
-    );
-    fclose(file);
+    g_fileList.clear();
+    g_fileList.reserve(n);
+    for (uint32_t i : order) g_fileList.push_back(g_catalog.Path(i));
+    g_currentFileIndex = std::max(0, g_fileList.Find(keepPath));
+    g_gridFilesDirty = true;
+}
 
-    // 3) Error-report if it failed
-    if (!data) {
-        const char* err = stbi_failure_reason();
-        int wlen = MultiByteToWideChar(
-            CP_UTF8, 0,
-            err, -1,
-            nullptr, 0
-        );
-        std::wstring werr(wlen, L'\0');
-        MultiByteToWideChar(
-            CP_UTF8, 0,
-            err, -1,
-            &werr[0], wlen
-        );
-        MessageBoxW(nullptr,
-                    werr.c_str(),
-                    L"LoadImage Error",
-                    MB_OK | MB_ICONERROR);
-        return false;
-    }
+static std::vector<std::wstring> LibraryRoots()
+{
+    std::vector<std::wstring> roots;
+    for (size_t i = 0; i < g_catalog.RootCount(); ++i) roots.emplace_back(g_catalog.Root(i));
+    return roots;
+}
 
-    // 4) Copy into your pixel buffer
-    size_t sz = size_t(g_imgW) * g_imgH * 4;
-    try {
-        g_pixels.assign(data, data + sz);
-    } catch (const std::bad_alloc&) {
-        MessageBoxW(nullptr,
-                    L"Out of memory while copying image",
-                    L"LoadImage Error",
-                    MB_OK | MB_ICONERROR);
-        stbi_image_free(data);
-        return false;
+// First image of the library list that decodes (library startup)
+static bool LoadFirstLibraryImage()
+{
+    for (int i = 0; i < int(g_fileList.size()); ++i) {
+        if (LoadImage(g_fileList[i])) { g_currentFileIndex = i; return true; }
     }
-    stbi_image_free(data);
-
-    return true;
+    return false;
 }
 
 // helper to get creation FILETIME for a path
@@ -654,45 +2560,46 @@ static FILETIME GetCreationTime(const std::wstring& path)
 
 auto sortFiles = [&](){
     namespace fs = std::filesystem;
+    if (g_libraryMode) {
+        // the catalog already holds every key; never stat a whole library
+        BuildLibraryList(g_fileList.empty() ? std::wstring() : g_fileList[g_currentFileIndex]);
+        return;
+    }
+    // entry ids are 0..size-1 whatever the order, so the date keys are
+    // read once per file rather than once per comparison
+    const uint32_t n = uint32_t(g_fileList.size());
     switch (g_sortMode) {
     case SortMode::ByName:
-        std::sort(g_fileList.begin(), g_fileList.end(),
-                  std::greater<std::wstring>()); 
+        g_fileList.Sort([](uint32_t a, uint32_t b) { return g_fileList.Compare(a, b) > 0; });
         break;
 
-    case SortMode::ByDateModified:
-        std::sort(g_fileList.begin(), g_fileList.end(),
-            [&](auto &a, auto &b){
-                return fs::last_write_time(a)
-                     > fs::last_write_time(b);  // descending
-            });
+    case SortMode::ByDateModified: {
+        std::vector<fs::file_time_type> when(n);
+        for (uint32_t id = 0; id < n; ++id) {
+            std::error_code ec;
+            when[id] = fs::last_write_time(g_fileList.Path(id), ec);
+        }
+        g_fileList.Sort([&](uint32_t a, uint32_t b) { return when[a] > when[b]; });  // descending
         break;
+    }
 
-    case SortMode::ByDateCreated:
-        std::sort(g_fileList.begin(), g_fileList.end(),
-            [&](auto &a, auto &b){
-                FILETIME ca = GetCreationTime(a);
-                FILETIME cb = GetCreationTime(b);
-                ULARGE_INTEGER ua = {};
-                ua.LowPart  = ca.dwLowDateTime;
-                ua.HighPart = ca.dwHighDateTime;
-                ULARGE_INTEGER ub = {};
-                ub.LowPart  = cb.dwLowDateTime;
-                ub.HighPart = cb.dwHighDateTime;
-                return ua.QuadPart > ub.QuadPart;  // descending
-            });
+    case SortMode::ByDateCreated: {
+        std::vector<uint64_t> when(n);
+        for (uint32_t id = 0; id < n; ++id) {
+            FILETIME c = GetCreationTime(g_fileList.Path(id));
+            ULARGE_INTEGER u = {};
+            u.LowPart  = c.dwLowDateTime;
+            u.HighPart = c.dwHighDateTime;
+            when[id] = u.QuadPart;
+        }
+        g_fileList.Sort([&](uint32_t a, uint32_t b) { return when[a] > when[b]; });  // descending
         break;
     }
+    }
 };
 
-static bool HasExt(const std::wstring& extLower) {
-    static const std::unordered_set<std::wstring> kExts = {
-        L".png", L".jpg", L".jpeg"
-    };
-    return kExts.count(extLower) != 0;
-}
-
-bool OpenFileDialogAndLoad()
+// Show the open dialog; false if the user cancelled
+static bool PickImageFile(std::wstring& selectedPath)
 {
     // Init COM for the file dialog
     HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
@@ -702,12 +2609,21 @@ bool OpenFileDialogAndLoad()
     hr = CoCreateInstance(CLSID_FileOpenDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&dlg));
     if (FAILED(hr)) { if (didInitCOM) CoUninitialize(); return false; }
 
-    // Filters: only PNG and JPG
-    COMDLG_FILTERSPEC filters[] = {
-        { L"Images (png, jpg)", L"*.png;*.jpg;*.jpeg" },
-        { L"All Files", L"*.*" }
-    };
-    dlg->SetFileTypes(ARRAYSIZE(filters), filters);
+    // Filters: every registered format together, then one per format
+    const auto& formats = ImageFormats();
+    std::vector<std::wstring> names;
+    names.reserve(formats.size() + 1);
+    const std::wstring allPatterns = AllImagePatterns();
+    names.push_back(L"Images");
+    for (const ImageFormat& f : formats)
+        names.push_back(std::wstring(f.name, f.name + strlen(f.name)) + L" (" + f.patterns + L")");
+
+    std::vector<COMDLG_FILTERSPEC> filters;
+    filters.push_back({ names[0].c_str(), allPatterns.c_str() });
+    for (size_t i = 0; i < formats.size(); ++i)
+        filters.push_back({ names[i + 1].c_str(), formats[i].patterns });
+    filters.push_back({ L"All Files", L"*.*" });
+    dlg->SetFileTypes(UINT(filters.size()), filters.data());
     dlg->SetFileTypeIndex(1); // default to Images
     dlg->SetOptions(FOS_FORCEFILESYSTEM | FOS_FILEMUSTEXIST);
 
@@ -721,14 +2637,23 @@ bool OpenFileDialogAndLoad()
     PWSTR pszPath = nullptr;
     if (FAILED(item->GetDisplayName(SIGDN_FILESYSPATH, &pszPath))) { if (didInitCOM) CoUninitialize(); return false; }
 
-    std::wstring selectedPath(pszPath);
+    selectedPath = pszPath;
     CoTaskMemFree(pszPath);
+    if (didInitCOM) CoUninitialize();
+    return true;
+}
 
-    // Enumerate PNG/JPG images in same folder
+// Make the picked file's folder the file list: every image of a registered
+// format in it, sorted, with the picked file current
+static void ScanFolder(const std::wstring& selectedPath)
+{
+    HDRV_TRACE_SCOPE("scan folder");
+    // Enumerate images of every registered format in the same folder
     namespace fs = std::filesystem;
     fs::path selected(selectedPath);
     fs::path folder = selected.parent_path();
 
+    g_libraryMode = false;
     g_fileList.clear();
     std::error_code ec;
     for (fs::directory_iterator it(folder, ec), end; it != end; it.increment(ec)) {
@@ -737,18 +2662,27 @@ bool OpenFileDialogAndLoad()
         auto p = it->path();
         std::wstring ext = p.extension().wstring();
         std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
-        if (HasExt(ext)) g_fileList.push_back(p.wstring());
+        if (IsImageExtension(ext)) g_fileList.push_back(p.wstring());
     }
 
     sortFiles();
+    g_gridFilesDirty = true;
+    SyncSearch(false);
+
+    g_currentFileIndex = std::max(0, g_fileList.Find(selected.wstring()));
+}
 
-    auto it = std::find(g_fileList.begin(), g_fileList.end(), selected.wstring());
-    g_currentFileIndex = (it == g_fileList.end()) ? 0 : int(std::distance(g_fileList.begin(), it));
+bool OpenFileDialogAndLoad()
+{
+    std::wstring selectedPath;
+    if (!PickImageFile(selectedPath)) return false;
+    ScanFolder(selectedPath);
+    // idle pool buffers are sized for the last folder's images
+    PoolTrim();
 
     bool ok = false;
     if (!g_fileList.empty()) ok = LoadImage(g_fileList[g_currentFileIndex]);
 
-    if (didInitCOM) CoUninitialize();
     if (!ok) {
         MessageBoxW(nullptr, L"LoadImage failed", L"Error", MB_OK | MB_ICONERROR);
         return false;
@@ -756,6 +2690,520 @@ bool OpenFileDialogAndLoad()
     return true;
 }
 
+// Make g_fileList[index] (wrapped) the current image: decode it, or reuse its
+// block-compressed copy when compression is on, then letterbox and upload.
+static void ShowImage(int index)
+{
+    if (g_fileList.empty()) return;
+    const int n = int(g_fileList.size());
+    g_currentFileIndex = ((index % n) + n) % n;
+    const std::wstring& path = g_fileList[g_currentFileIndex];
+
+    // an expanded image comes back from its cached mapping without a decode
+    const bool expand = g_itmOn && g_scRgb;
+    if (expand && !CompareActive()) {
+        if (auto mapped = g_itmCache.Find(path)) {
+            MarkLoadStart();
+            g_gif.Stop();
+            ResetView();
+            g_hdrActive = false;
+            g_pixels.clear();
+            g_gainMap = GainMap{};
+            g_gainMapShown = false;
+            g_imgW = mapped->Width();
+            g_imgH = mapped->Height();
+            UpdateLetterbox();
+            g_itm = std::move(mapped);
+            UploadItmOutput();
+            g_curBc.reset();
+            g_lastDecode = { "ITM", "cache", 0.0, 1 };
+            MarkLoadEnd();
+            return;
+        }
+    }
+
+    // compare and expansion need the decoded pixels, which a BC cache hit
+    // does not have
+    if (g_blockCompress && !CompareActive() && !expand) {
+        if (auto cached = g_bcCache.Find(path)) {
+            MarkLoadStart();
+            g_gif.Stop();
+            ResetView();
+            g_hdrActive = false;
+            // g_pixels no longer describes the screen; drop it rather than keep a stale copy
+            g_pixels.clear();
+            g_gainMap = GainMap{};
+            g_gainMapShown = false;
+            g_imgW = cached->imgW;
+            g_imgH = cached->imgH;
+            UpdateLetterbox();
+            UploadCompressed(cached->bc);
+            g_curBc = cached;
+            g_lastDecode = { "BC", "cache", 0.0, 1 };
+            MarkLoadEnd();
+            return;
+        }
+    }
+
+    if (LoadImage(path)) {
+        UpdateLetterbox();
+        // Upload to GPU
+        CreateTextureFromPixels();
+        RefreshCompare();
+    }
+}
+
+// Turn the current image by `turn` (after what is on screen) and remember
+// it for this file. g_pixels turns in place when resident; after a BC cache
+// hit it is not, so the file is decoded again with the new turn applied.
+static void TurnCurrentImage(Orientation turn)
+{
+    if (g_fileList.empty() || g_gridMode) return;
+    if (g_gif.Active()) {
+        ShowToast("Animations play as stored; rotate is unavailable");
+        return;
+    }
+    const std::wstring& path = g_fileList[g_currentFileIndex];
+    const auto it = g_userOrient.find(path);
+    const Orientation user = Combine(it == g_userOrient.end() ? Orientation::Normal : it->second, turn);
+    if (user == Orientation::Normal) g_userOrient.erase(path);
+    else g_userOrient[path] = user;
+    // blocks cached or being encoded for this file are of the old turn, and
+    // so is its expanded rendition
+    g_bcEncoder.Cancel();
+    g_bcCache.Erase(path);
+    g_itmCache.Erase(path);
+
+    if (!g_pixels.empty()) {
+        ResetView();
+        OrientPixels(g_pixels, g_imgW, g_imgH, turn);
+        if (g_gainMap.w > 0) OrientPixels(g_gainMap.rgba, g_gainMap.w, g_gainMap.h, turn);
+        UpdateLetterbox();
+        CreateTextureFromPixels();
+    } else if (LoadImage(path)) {
+        UpdateLetterbox();
+        CreateTextureFromPixels();
+    }
+    // cached comparisons against this file were made before the turn
+    g_cmpCache.Clear();
+    RefreshCompare();
+    ShowToast(user == Orientation::Normal ? std::string("Orientation as stored in the file")
+                                          : std::string("Orientation: ") + OrientationName(user) + " from the file");
+}
+
+// C: pin the current image as the compare reference, or stop comparing
+static void ToggleCompare()
+{
+    if (CompareActive()) {
+        if (g_cmp.tex) g_frameRetire.Push(std::move(g_cmp.tex), g_fenceValue);
+        if (g_cmp.pendingTex) g_copyRetire.Push(std::move(g_cmp.pendingTex), g_cmp.pendingFence);
+        g_cmp = CompareState{};
+        ShowToast("Compare off");
+        return;
+    }
+    if (g_fileList.empty() || g_gridMode) return;
+    if (g_gif.Active()) {
+        ShowToast("Animations cannot be compared");
+        return;
+    }
+    const std::wstring& path = g_fileList[g_currentFileIndex];
+    if (g_pixels.empty()) {
+        // shown from the BC cache: decode it again
+        if (!LoadImage(path)) return;
+        UpdateLetterbox();
+        CreateTextureFromPixels();
+    }
+    g_cmp.path   = path;
+    g_cmp.pixels = g_pixels;
+    g_cmp.w      = g_imgW;
+    g_cmp.h      = g_imgH;
+    g_cmpSplitX  = g_screenW / 2;
+    RefreshCompare();
+    ShowToast("Reference pinned: show another image to compare it, V changes the view, C stops");
+}
+
+// X: merge the exposure bracket around the current image into one float
+// image and show it in place of the file. Frames come from FindBracket;
+// without Exif exposure times the current file and the next two of the
+// same size are taken as g_hdrEvStep apart. `align` off (Ctrl+X) skips
+// the bitmap alignment for shots from a tripod.
+static void MergeCurrentBracket(bool align)
+{
+    if (g_fileList.empty() || g_gridMode) return;
+    if (CompareActive() || g_gif.Active()) {
+        ShowToast("Stop compare or the animation before merging a bracket");
+        return;
+    }
+    const std::vector<int> bracket = FindBracket(g_fileList, g_currentFileIndex, 3);
+    if (bracket.size() < 2) {
+        ShowToast("No exposure bracket around this image");
+        return;
+    }
+    std::vector<std::wstring> paths;
+    for (int i : bracket) paths.push_back(g_fileList[size_t(i)]);
+
+    MergeOptions opt;
+    opt.align  = align;
+    opt.evStep = g_hdrEvStep;
+    HdrImage hdr;
+    std::string error;
+    if (!MergeBracket(paths, opt, hdr, error)) {
+        ShowToast("Merge failed: " + error);
+        return;
+    }
+    int maxW = 0, maxH = 0;
+    if (ClampToMaxTexture(hdr.w, hdr.h, maxW, maxH)) {
+        ShowToast("Merged image is larger than one texture");
+        return;
+    }
+
+    ResetView();
+    // the merge has no RGBA8 form; the texture is the only copy
+    g_pixels.clear();
+    g_gainMap = GainMap{};
+    g_gainMapShown = false;
+    g_imgW = hdr.w;
+    g_imgH = hdr.h;
+    UpdateLetterbox();
+    UploadTexture(hdr.rgba16.data(), hdr.w, hdr.h, DXGI_FORMAT_R16G16B16A16_FLOAT,
+                  SIZE_T(hdr.w) * 8, UINT(hdr.h), 1.0f, 1.0f);
+    g_curBc.reset();
+    hdr.rgba16 = PixelBuffer();
+    g_hdr       = std::move(hdr);
+    g_hdrActive = true;
+    g_hdrEv     = 0.0f;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Merged %d frames: decode %.0f ms, align %.0f ms, merge %.0f ms  |  +/- exposure",
+             g_hdr.frames, g_hdr.decodeMs, g_hdr.alignMs, g_hdr.mergeMs);
+    ShowToast(msg);
+}
+
+// Merge details for the info line
+static std::string HdrInfo()
+{
+    std::string s = "  |  HDR";
+    char part[48];
+    for (int i = 0; i < g_hdr.frames; ++i) {
+        snprintf(part, sizeof(part), " %+.1f", g_hdr.ev[i]);
+        s += part;
+        if (g_hdr.shiftX[i] || g_hdr.shiftY[i]) {
+            snprintf(part, sizeof(part), "@%d,%d", g_hdr.shiftX[i], g_hdr.shiftY[i]);
+            s += part;
+        }
+    }
+    snprintf(part, sizeof(part), " EV%s  peak %.1f  shown at %+.2f EV",
+             g_hdr.exifExposure ? "" : " (assumed)", g_hdr.peak, g_hdrEv);
+    return s + part;
+}
+
+// ---- contact-sheet grid input ----
+
+static void ScrollGrid(float delta)
+{
+    if (delta == 0.0f) return;
+    g_gridScrollTarget = std::clamp(g_gridScrollTarget + delta, 0.0f, g_grid.MaxScroll());
+    g_gridScrollDir    = delta < 0.0f ? -1 : 1;
+}
+
+// Show the grid around the current image. A new folder or sort order
+// restarts thumbnail generation and empties the atlas.
+static void EnterGrid()
+{
+    if (g_fileList.empty()) return;
+    if (g_gridFilesDirty) {
+        g_thumbs.SetFiles(g_fileList);
+        g_atlas.Reset(int(g_fileList.size()));
+        g_atlasResetAt = g_fenceValue;
+        g_thumbFailed.assign(g_fileList.size(), 0);
+        g_gridFilesDirty = false;
+    }
+    g_gridMode = true;
+    g_gridSel  = g_currentFileIndex;
+    g_grid.Compute(g_screenW, g_screenH, int(g_fileList.size()));
+    // jump (no animation) so the selection sits mid-screen
+    const float centred = g_grid.CellY(g_gridSel, 0.0f) - (g_screenH - GridLayout::kCell) * 0.5f;
+    g_gridScroll = g_gridScrollTarget = std::clamp(centred, 0.0f, g_grid.MaxScroll());
+    g_gridPrioRow = -1;
+}
+
+static void LeaveGrid()
+{
+    g_gridMode = false;
+    // nothing is wanted any more: let the full-size decode have the cores
+    g_thumbs.Prioritize({});
+    g_gridPrioRow = -1;
+}
+
+static void OpenFromGrid(int index)
+{
+    LeaveGrid();
+    ShowImage(index);
+}
+
+// Folder picker for library roots (several may be selected at once)
+static bool PickLibraryFolders(std::vector<std::wstring>& out)
+{
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    const bool didInitCOM = SUCCEEDED(hr);
+
+    ComPtr<IFileOpenDialog> dlg;
+    ComPtr<IShellItemArray> items;
+    hr = CoCreateInstance(CLSID_FileOpenDialog, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&dlg));
+    if (SUCCEEDED(hr)) {
+        dlg->SetOptions(FOS_PICKFOLDERS | FOS_ALLOWMULTISELECT | FOS_FORCEFILESYSTEM);
+        dlg->SetTitle(L"Add folders to the library");
+        hr = dlg->Show(nullptr);
+    }
+    if (SUCCEEDED(hr)) hr = dlg->GetResults(&items);
+
+    DWORD count = 0;
+    if (SUCCEEDED(hr) && SUCCEEDED(items->GetCount(&count))) {
+        for (DWORD i = 0; i < count; ++i) {
+            ComPtr<IShellItem> item;
+            PWSTR path = nullptr;
+            if (SUCCEEDED(items->GetItemAt(i, &item)) &&
+                SUCCEEDED(item->GetDisplayName(SIGDN_FILESYSPATH, &path))) {
+                out.emplace_back(path);
+                CoTaskMemFree(path);
+            }
+        }
+    }
+    if (didInitCOM) CoUninitialize();
+    return !out.empty();
+}
+
+// L: add folders to the library and index them in the background
+static void AddLibraryFolders()
+{
+    std::vector<std::wstring> picked;
+    if (!PickLibraryFolders(picked)) return;
+    std::vector<std::wstring> roots = g_catalog.IsOpen() ? LibraryRoots()
+                                                         : std::vector<std::wstring>();
+    for (auto& p : picked)
+        if (std::find(roots.begin(), roots.end(), p) == roots.end()) roots.push_back(std::move(p));
+    g_catalogUpdater.Start(roots, DefaultCatalogPath());
+}
+
+// Called once per frame: progress while indexing, then swap in the new
+// catalog (entering library mode when the index was started with L)
+static void PollLibrary()
+{
+    if (g_catalogUpdater.Running()) {
+        if (!g_libraryMode) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Indexing library: %zu images found", g_catalogUpdater.Found());
+            ShowToast(msg);
+        }
+        return;
+    }
+    bool ok = false;
+    if (!g_catalogUpdater.TakeFinished(ok)) return;
+    if (!ok) {
+        ShowToast("Library indexing failed");
+        return;
+    }
+
+    // the old file stays mapped until here; Windows will not replace a mapped file
+    const std::wstring keep = g_fileList.empty() ? std::wstring() : g_fileList[g_currentFileIndex];
+    g_catalog.Close();
+    const bool committed = g_catalogUpdater.Commit();
+    if (!g_catalog.Open(DefaultCatalogPath()) || !committed) {
+        ShowToast("Could not update the library catalog");
+        if (!g_libraryMode) g_catalog.Close();
+        return;
+    }
+
+    const bool entering = !g_libraryMode;
+    g_libraryMode = true;
+    BuildLibraryList(keep);
+    SyncSearch(!entering);
+    if (g_gridMode) EnterGrid();
+    if (entering && !g_fileList.empty()) ShowImage(0);
+
+    const CatalogBuildStats& st = g_catalogUpdater.Stats();
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Library: %zu images in %zu folders (%zu unchanged, %zu read) in %.1f s",
+             g_catalog.Count(), st.dirs, st.reused, st.probed, st.ms / 1000.0);
+    ShowToast(msg);
+}
+
+// ---- near-duplicate navigation ----
+// D hashes the folder in the background; ] and [ then walk the groups of
+// near-identical files, member by member.
+static DuplicateFinder g_dups;
+static int g_dupGroup = -1, g_dupMember = -1;
+
+static void StartDuplicateScan()
+{
+    if (g_fileList.empty()) return;
+    g_dups.Start(g_fileList);
+    g_dupGroup = g_dupMember = -1;
+}
+
+// Called once per frame: progress while hashing, a summary when done
+static void PollDuplicateScan()
+{
+    if (g_dups.Running()) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "Finding duplicates: %d / %d files hashed", g_dups.Hashed(), g_dups.Total());
+        ShowToast(msg);
+    } else if (g_dups.TakeFinished()) {
+        const DuplicateGroups& d = g_dups.Groups();
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%d files hashed in %.1f s: %d similar groups (%d files)%s",
+                 g_dups.Total(), g_dups.Ms() / 1000.0, int(d.groups.size()), d.Files(),
+                 d.groups.empty() ? "" : "  -  ] / [ to step through");
+        ShowToast(msg);
+    }
+}
+
+static void JumpDuplicate(int dir)
+{
+    if (g_dups.Running()) return;
+    const auto& groups = g_dups.Groups().groups;
+    if (groups.empty()) {
+        ShowToast("No similar images found yet - press D to scan this folder");
+        return;
+    }
+
+    if (g_dupGroup < 0) {
+        g_dupGroup  = dir > 0 ? 0 : int(groups.size()) - 1;
+        g_dupMember = dir > 0 ? 0 : int(groups[g_dupGroup].size()) - 1;
+    } else if ((g_dupMember += dir) < 0 || g_dupMember >= int(groups[g_dupGroup].size())) {
+        const int n = int(groups.size());
+        g_dupGroup  = ((g_dupGroup + dir) % n + n) % n;
+        g_dupMember = dir > 0 ? 0 : int(groups[g_dupGroup].size()) - 1;
+    }
+
+    // the scan saw its own copy of the list; re-sorting only moves files
+    const int index = g_fileList.Find(g_dups.Files()[groups[g_dupGroup][g_dupMember]]);
+    if (index < 0) {
+        ShowToast("The folder changed since the scan - press D to rescan");
+        return;
+    }
+    if (g_gridMode) LeaveGrid();
+    ShowImage(index);
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "Similar group %d / %d: image %d of %d", g_dupGroup + 1, int(groups.size()),
+             g_dupMember + 1, int(groups[g_dupGroup].size()));
+    ShowToast(msg);
+}
+
+// Next or previous image; with a search filter, the next or previous match
+static void StepImage(int dir)
+{
+    if (g_searchQuery.empty()) {
+        ShowImage(g_currentFileIndex + dir);
+        return;
+    }
+    const std::vector<int>& m = g_searchHits.indices;
+    const int n = int(m.size());
+    if (n == 0) {
+        ShowToast("No images match \"" + NarrowAscii(g_searchQuery) + "\" - Esc clears the search");
+        return;
+    }
+
+    // from a match to its neighbour; from elsewhere to the nearest match
+    // that way in list order (fuzzy matches are ranked, so from the best)
+    int pos;
+    auto it = std::find(m.begin(), m.end(), g_currentFileIndex);
+    if (it != m.end()) {
+        pos = ((int(it - m.begin()) + dir) % n + n) % n;
+    } else if (g_searchHits.fuzzy) {
+        pos = dir > 0 ? 0 : n - 1;
+    } else if (dir > 0) {
+        pos = int(std::upper_bound(m.begin(), m.end(), g_currentFileIndex) - m.begin()) % n;
+    } else {
+        pos = (int(std::lower_bound(m.begin(), m.end(), g_currentFileIndex) - m.begin()) - 1 + n) % n;
+    }
+    ShowImage(m[pos]);
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Match %d / %d for \"%s\"", pos + 1, n, NarrowAscii(g_searchQuery).c_str());
+    ShowToast(msg);
+}
+
+// WM_CHAR while typing a query (or the / or Ctrl+F that starts one).
+// Typing takes every character, so letters do not reach the commands.
+static bool HandleSearchChar(wchar_t c)
+{
+    if (!g_searchTyping) {
+        if ((c != L'/' && c != 0x06) || g_gridMode || g_fileList.empty()) return false;
+        // reopens the current query for editing
+        g_searchTyping = true;
+        RunSearch();
+        ShowSearchToast();
+        return true;
+    }
+
+    switch (c) {
+    case L'\r':
+        g_searchTyping = false;
+        if (g_searchQuery.empty()) {
+            g_searchHits = {};
+            ShowToast("Search cleared");
+        } else if (!g_searchHits.indices.empty() &&
+                   std::find(g_searchHits.indices.begin(), g_searchHits.indices.end(), g_currentFileIndex) ==
+                       g_searchHits.indices.end()) {
+            // onto the next match after the current image
+            StepImage(+1);
+        } else {
+            ShowSearchToast();
+        }
+        return true;
+    case 0x1B:  // Esc
+        g_searchTyping = false;
+        g_searchQuery.clear();
+        g_searchHits = {};
+        ShowToast("Search cleared");
+        return true;
+    case L'\b':
+        if (!g_searchQuery.empty()) g_searchQuery.pop_back();
+        break;
+    default:
+        if (c < 32) return true;
+        g_searchQuery.push_back(c);
+        break;
+    }
+    RunSearch();
+    ShowSearchToast();
+    return true;
+}
+
+// Called once per frame: re-run the query when indexing has caught up
+// with a new list, since it answered from part of it until then
+static void PollSearch()
+{
+    if (g_searchQuery.empty() || g_search.Building() || g_search.Generation() == g_searchGen) return;
+    RunSearch();
+    if (g_searchTyping) ShowSearchToast();
+}
+
+static bool HandleGridKey(WPARAM key)
+{
+    const int n = int(g_fileList.size());
+    int sel = g_gridSel;
+    switch (key) {
+    case VK_ESCAPE:
+    case 'G':      LeaveGrid(); return true;
+    case VK_RETURN: OpenFromGrid(g_gridSel); return true;
+    case VK_LEFT:  sel -= 1; break;
+    case VK_RIGHT: sel += 1; break;
+    case VK_UP:    sel -= g_grid.cols; break;
+    case VK_DOWN:  sel += g_grid.cols; break;
+    case VK_PRIOR: sel -= g_grid.cols * g_grid.VisibleRows(); break;
+    case VK_NEXT:  sel += g_grid.cols * g_grid.VisibleRows(); break;
+    case VK_HOME:  sel = 0; break;
+    case VK_END:   sel = n - 1; break;
+    default:       return false;
+    }
+    g_gridSel = std::clamp(sel, 0, n - 1);
+    ScrollGrid(g_grid.ScrollToShow(g_gridSel, g_gridScrollTarget) - g_gridScrollTarget);
+    return true;
+}
+
 // Forward‐declare Win32 window proc
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
 {
@@ -774,6 +3222,12 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
         }
 
         UpdateClientSize(hWnd);
+
+        if (g_gridMode) {
+            const int notches = GET_WHEEL_DELTA_WPARAM(wP) / WHEEL_DELTA;
+            ScrollGrid(-notches * g_grid.Pitch());
+            return 0;
+        }
         
         // 1) Compute mouse in NDC (–1…+1)
         POINT pt; 
@@ -811,57 +3265,43 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
 
     
     case WM_RBUTTONDOWN: {
+        if (g_gridMode) return 0;
         // Right click → move backward
-        int dir = -1;
-        int n   = int(g_fileList.size());
-        g_currentFileIndex = (g_currentFileIndex + dir + n) % n;
-
-        if (LoadImage(g_fileList[g_currentFileIndex])) {
-            // Recompute aspect‐ratio letterboxing
-            float imgAspect    = float(g_imgW) / float(g_imgH);
-            float screenAspect = float(g_screenW) / float(g_screenH);
-            g_baseScaleX = g_baseScaleY = 1.0f;
-            if (imgAspect > screenAspect) {
-                // image is wider → pillarbox vertically
-                g_baseScaleY = screenAspect / imgAspect;
-            } else {
-                // image taller → letterbox horizontally
-                g_baseScaleX = imgAspect / screenAspect;
-            }
-
-            // Upload to GPU
-            CreateTextureFromPixels();
-        }
+        StepImage(-1);
         return 0;
     }
     
     case WM_LBUTTONDOWN: {
-        // Left click → move forward
-        int dir = +1;
-        int n   = int(g_fileList.size());
-        g_currentFileIndex = (g_currentFileIndex + dir + n) % n;
-
-        if (LoadImage(g_fileList[g_currentFileIndex])) {
-            // Recompute aspect‐ratio letterboxing
-            float imgAspect    = float(g_imgW) / float(g_imgH);
-            float screenAspect = float(g_screenW) / float(g_screenH);
-            g_baseScaleX = g_baseScaleY = 1.0f;
-            if (imgAspect > screenAspect) {
-                // image is wider → pillarbox vertically
-                g_baseScaleY = screenAspect / imgAspect;
-            } else {
-                // image taller → letterbox horizontally
-                g_baseScaleX = imgAspect / screenAspect;
-            }
-
-            // Upload to GPU
-            CreateTextureFromPixels();
+        if (g_gridMode) {
+            // open the clicked thumbnail
+            const int hit = g_grid.HitTest(float(GET_X_LPARAM(lP)), float(GET_Y_LPARAM(lP)), g_gridScroll);
+            if (hit >= 0) OpenFromGrid(hit);
+            return 0;
         }
+        // Left click → move forward
+        StepImage(+1);
         return 0;
     }
 
+    case WM_CHAR:
+        if (HandleSearchChar(wchar_t(wP))) return 0;
+        break;
+
     case WM_KEYDOWN:
     {
+        // while typing a query, keys arrive as WM_CHAR; only the arrows still step
+        if (g_searchTyping && wP != VK_LEFT && wP != VK_RIGHT) return 0;
+        if (g_gridMode && HandleGridKey(wP)) return 0;
+        if (wP == 'G') {
+            EnterGrid();
+            return 0;
+        }
+        if (wP == VK_ESCAPE && !g_searchQuery.empty()) {
+            g_searchQuery.clear();
+            g_searchHits = {};
+            ShowToast("Search cleared");
+            return 0;
+        }
         if (wP == VK_ESCAPE) {
             // Cleanly close the window / exit message loop
             PostQuitMessage(0);
@@ -869,25 +3309,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
         }
         if ((wP == VK_RIGHT || wP == VK_LEFT) && !g_fileList.empty()) {
             int dir = (wP == VK_RIGHT) ? +1 : -1;
-            int n   = int(g_fileList.size());
-            g_currentFileIndex = (g_currentFileIndex + dir + n) % n;
-
-            if (LoadImage(g_fileList[g_currentFileIndex])) {
-                // Recompute aspect‐ratio letterboxing
-                float imgAspect    = float(g_imgW) / float(g_imgH);
-                float screenAspect = float(g_screenW) / float(g_screenH);
-                g_baseScaleX = g_baseScaleY = 1.0f;
-                if (imgAspect > screenAspect) {
-                    // image is wider → pillarbox vertically
-                    g_baseScaleY = screenAspect / imgAspect;
-                } else {
-                    // image taller → letterbox horizontally
-                    g_baseScaleX = imgAspect / screenAspect;
-                }
-
-                // Upload to GPU
-                CreateTextureFromPixels();
-            }
+            StepImage(dir);
             return 0;
         }
         if (wP == VK_UP || wP == VK_DOWN) {
@@ -929,34 +3351,183 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
                 g_targetOffY = centerY * (1.0f - f) + g_targetOffY * f;
             }
         }
-        if (wP == 'R') {
-            // Reset zoom & pan
-            g_zoom        = g_targetZoom = 1.0f;
-            g_offX        = g_targetOffX = 0.0f;
-            g_offY        = g_targetOffY = 0.0f;
+        if (wP == 'R') {
+            // Reset zoom & pan
+            g_zoom        = g_targetZoom = 1.0f;
+            g_offX        = g_targetOffX = 0.0f;
+            g_offY        = g_targetOffY = 0.0f;
+            return 0;
+        }
+        if (wP == 'T' && !g_fileList.empty()) {
+            // cycle through Name → Modified → Created
+            g_sortMode = SortMode((int(g_sortMode) + 1) % 3);
+            // re-sort & reset index to the current file’s new position
+            // (a hash lookup, not a scan of the list):
+            const std::wstring curr = g_fileList[g_currentFileIndex];
+            sortFiles();
+            g_currentFileIndex = std::max(0, g_fileList.Find(curr));
+            g_gridFilesDirty = true;
+            SyncSearch(true);
+            if (g_gridMode) EnterGrid();
+            return 0;
+        }
+        if (wP == 'O') {
+            if (OpenFileDialogAndLoad()) {
+                if (g_gridMode) LeaveGrid();
+                UpdateLetterbox();
+                CreateTextureFromPixels();
+                RefreshCompare();
+            }
+
+            return 0;
+        }
+        if (wP == 'I') {
+            g_drawText = !g_drawText;
+        }
+        if (wP == 'H') {
+            g_drawHistogram = !g_drawHistogram;
+        }
+        if (wP == 'P') {
+            g_drawHud = !g_drawHud;
+            return 0;
+        }
+        if (wP == VK_F9) {
+            std::wstring path;
+            const bool ok = DumpTrace(path);
+            ShowToast((ok ? "Trace written to " : "Could not write ") + NarrowAscii(path));
+            return 0;
+        }
+        if (wP == 'L') {
+            AddLibraryFolders();
+            return 0;
+        }
+        if (wP == 'D') {
+            StartDuplicateScan();
+            return 0;
+        }
+        if (wP == VK_OEM_6 || wP == VK_OEM_4) {     // ] and [
+            JumpDuplicate(wP == VK_OEM_6 ? +1 : -1);
+            return 0;
+        }
+        if (wP == VK_OEM_PERIOD || wP == VK_OEM_COMMA || wP == 'M') {     // . , M
+            TurnCurrentImage(wP == VK_OEM_PERIOD ? Orientation::Rotate90
+                             : wP == VK_OEM_COMMA ? Orientation::Rotate270 : Orientation::FlipH);
+            return 0;
+        }
+        if (wP == 'C') {
+            ToggleCompare();
+            return 0;
+        }
+        if (wP == 'X') {
+            if (GetKeyState(VK_SHIFT) < 0) {
+                // fallback bracket step when the files carry no exposure times
+                g_hdrEvStep = g_hdrEvStep >= 3.0 ? 1.0 : g_hdrEvStep + 1.0;
+                char msg[64];
+                snprintf(msg, sizeof(msg), "Bracket step without Exif: %.0f EV", g_hdrEvStep);
+                ShowToast(msg);
+            } else {
+                MergeCurrentBracket(GetKeyState(VK_CONTROL) >= 0);
+            }
+            return 0;
+        }
+        if ((wP == VK_OEM_PLUS || wP == VK_OEM_MINUS) && g_hdrActive) {
+            g_hdrEv = std::clamp(g_hdrEv + (wP == VK_OEM_PLUS ? 1.0f : -1.0f) / 3.0f, -10.0f, 10.0f);
+            char msg[48];
+            snprintf(msg, sizeof(msg), "Exposure %+.2f EV", g_hdrEv);
+            ShowToast(msg);
             return 0;
         }
-        if (wP == 'T') {
-            // cycle through Name → Modified → Created
-            g_sortMode = SortMode((int(g_sortMode) + 1) % 3);
-            // re-sort & reset index to the current file’s new position:
-            std::wstring curr = g_fileList[g_currentFileIndex];
-            sortFiles();
-            auto it = std::find(g_fileList.begin(), g_fileList.end(), curr);
-            g_currentFileIndex = it == g_fileList.end()
-                ? 0
-                : int(std::distance(g_fileList.begin(), it));
+        if (wP == 'V' && CompareActive()) {
+            g_cmp.view = CompareView((int(g_cmp.view) + 1) % 3);
+            SyncCompareTexture();
+            ShowToast(std::string("Compare view: ") + CompareViewName(g_cmp.view));
             return 0;
         }
-        if (wP == 'O') {
-            if (OpenFileDialogAndLoad()) {
+        if (wP == 'F' && GetKeyState(VK_CONTROL) >= 0) {
+            // resample filter for the settled view: Lanczos3 -> Mitchell -> off
+            if (!g_viewResample) {
+                g_viewResample = true;
+                g_viewFilter   = ResampleFilter::Lanczos3;
+            } else if (g_viewFilter == ResampleFilter::Lanczos3) {
+                g_viewFilter = ResampleFilter::Mitchell;
+            } else {
+                g_viewResample = false;
+            }
+            ShowToast(g_viewResample ? std::string("View resample: ") + ResampleFilterName(g_viewFilter)
+                                     : std::string("View resample off (GPU bilinear)"));
+            return 0;
+        }
+        if (wP == 'E') {
+            if (!g_scRgb) {
+                ShowToast("Inverse tone mapping needs the HDR swap chain: start with --hdr");
+                return 0;
+            }
+            const bool shift = GetKeyState(VK_SHIFT) < 0, ctrl = GetKeyState(VK_CONTROL) < 0;
+            if (!shift && !ctrl) {
+                g_itmOn = !g_itmOn;
+                ShowImage(g_currentFileIndex);
+                ShowToast(g_itmOn ? "Inverse tone mapping on" : "Inverse tone mapping off");
+                return 0;
+            }
+            // Shift+E: next peak, Ctrl+E: next paper white
+            static const float kPeaks[]  = { 600.0f, 1000.0f, 1600.0f, 2000.0f, 4000.0f };
+            static const float kPapers[] = { 100.0f, 200.0f, 300.0f };
+            auto next = [](const float* v, size_t n, float cur) {
+                for (size_t i = 0; i < n; ++i) if (v[i] > cur) return v[i];
+                return v[0];
+            };
+            if (shift) g_itmParams.peakNits  = next(kPeaks, _countof(kPeaks), g_itmParams.peakNits);
+            else       g_itmParams.paperNits = next(kPapers, _countof(kPapers), g_itmParams.paperNits);
+            char msg[128];
+            if (g_texScRgb && g_itm) {
+                UploadItmOutput();
+                snprintf(msg, sizeof(msg), "Peak %.0f nits, paper white %.0f nits: %s pass %.1f ms (%.1f MP)",
+                         g_itmParams.peakNits, g_itmParams.paperNits, g_itm->lastPass, g_itm->lastMs,
+                         g_itm->lastPixels / 1e6);
+            } else if (g_gainMapShown && !g_pixels.empty()) {
+                // the map's weight follows the display's headroom
                 CreateTextureFromPixels();
+                snprintf(msg, sizeof(msg), "Peak %.0f nits, paper white %.0f nits: gain map weight %.2f, %.1f ms",
+                         g_itmParams.peakNits, g_itmParams.paperNits,
+                         GainMapWeight(g_gainMap.meta, g_itmParams.peakNits / g_itmParams.paperNits), g_gainMapMs);
+            } else {
+                snprintf(msg, sizeof(msg), "Peak %.0f nits, paper white %.0f nits",
+                         g_itmParams.peakNits, g_itmParams.paperNits);
             }
-
+            ShowToast(msg);
             return 0;
         }
-        if (wP == 'I') {
-            g_drawText = !g_drawText;
+        if (wP == 'U') {
+            if (!g_scRgb) {
+                ShowToast("Gain map HDR needs the HDR swap chain: start with --hdr");
+                return 0;
+            }
+            g_gainMapOn = !g_gainMapOn;
+            // cached textures of gain map files hold the other rendition
+            g_bcEncoder.Cancel();
+            g_bcCache.Clear();
+            g_itmCache.Clear();
+            PoolTrim();
+            if (!g_fileList.empty() && !g_gridMode && !g_hdrActive) {
+                if (!g_pixels.empty()) {
+                    CreateTextureFromPixels();
+                } else if (LoadImage(g_fileList[g_currentFileIndex])) {
+                    UpdateLetterbox();
+                    CreateTextureFromPixels();
+                }
+            }
+            ShowToast(g_gainMapOn ? "Gain map HDR on" : "Gain map HDR off: showing the SDR base image");
+            return 0;
+        }
+        if (wP == 'B') {
+            // toggle block-compressed uploads; re-show so the change is visible
+            g_blockCompress = !g_blockCompress;
+            if (!g_blockCompress) {
+                g_bcEncoder.Cancel();
+                g_bcCache.Clear();
+            }
+            ShowImage(g_currentFileIndex);
+            return 0;
         }
 
         break;
@@ -986,6 +3557,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
     {
         using clock = std::chrono::steady_clock;
         g_lastMouseMove = clock::now();
+        g_cmpSplitX     = GET_X_LPARAM(lP);
         if (g_cursorHidden) {
             ShowCursor(TRUE);
             g_cursorHidden = false;
@@ -1029,35 +3601,515 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wP, LPARAM lP)
 }
 
 // ------------------------------------------------
+// Command line split the way the shell does, program name first
+static std::vector<std::wstring> CommandLineArgs()
+{
+    std::vector<std::wstring> args;
+    int argc = 0;
+    if (wchar_t** argv = CommandLineToArgvW(GetCommandLineW(), &argc)) {
+        args.assign(argv, argv + argc);
+        LocalFree(argv);
+    }
+    return args;
+}
+
+// Value of a "--name=value" argument, or `fallback`
+static float ArgFloat(const std::vector<std::wstring>& args, const std::wstring& name, float fallback)
+{
+    for (const std::wstring& a : args)
+        if (a.size() > name.size() && a.compare(0, name.size(), name) == 0 && a[name.size()] == L'=')
+            return wcstof(a.c_str() + name.size() + 1, nullptr);
+    return fallback;
+}
+
+// Bench results go to the debugger output and %TEMP%\<name>
+static bool WriteBenchReport(const wchar_t* name, const std::string& report)
+{
+    OutputDebugStringA(report.c_str());
+    wchar_t dir[MAX_PATH];
+    const DWORD n = GetTempPathW(MAX_PATH, dir);
+    std::wstring path = (n > 0 && n < MAX_PATH) ? std::wstring(dir, n) : std::wstring();
+    path += name;
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, path.c_str(), L"wb") != 0 || !f) return false;
+    const bool ok = fwrite(report.data(), 1, report.size(), f) == report.size();
+    return fclose(f) == 0 && ok;
+}
+
+// --itm-bench <file>: decode `file`, run the inverse tone mapping passes
+// that opening it and changing each parameter would, and write their
+// timings to %TEMP%\HDRViewer-itm-bench.txt. No window is opened.
+static int RunItmBench(const std::wstring& file)
+{
+    if (!LoadImage(file)) return 1;
+    InverseToneMapper itm;
+    itm.SetImage(g_pixels.data(), g_imgW, g_imgH);
+
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%s  %dx%d  decode %s %.1f ms  (%u threads)\n", NarrowAscii(file).c_str(),
+             g_imgW, g_imgH, g_lastDecode.path, g_lastDecode.ms, std::thread::hardware_concurrency());
+    report += line;
+    auto run = [&](const char* what, const ItmParams& p) {
+        itm.Apply(p);
+        snprintf(line, sizeof(line), "%-24s %-10s %8.1f ms  %6.1f MP  %6.0f MP/s\n", what, itm.lastPass, itm.lastMs,
+                 itm.lastPixels / 1e6, itm.lastMs > 0.0 ? itm.lastPixels / 1e3 / itm.lastMs : 0.0);
+        report += line;
+    };
+    ItmParams p = g_itmParams;
+    run("first (index + map)", p);
+    run("same parameters", p);
+    for (float peak : { 600.0f, 1600.0f, 4000.0f }) {
+        p.peakNits = peak;
+        char what[32];
+        snprintf(what, sizeof(what), "peak %.0f nits", peak);
+        run(what, p);
+    }
+    p.paperNits += 50.0f;
+    run("paper white", p);
+    p.saturation = 0.5f;
+    run("saturation", p);
+    return WriteBenchReport(L"HDRViewer-itm-bench.txt", report) ? 0 : 1;
+}
+
+// --bc-bench <file>: decode `file` and encode it as BC1 and BC7 a few
+// times each; write encode throughput, PSNR and size against RGBA8 to
+// %TEMP%\HDRViewer-bc-bench.txt. No window is opened.
+static int RunBcBench(const std::wstring& file)
+{
+    if (!LoadImage(file)) return 1;
+    const double mp = double(g_imgW) * g_imgH / 1e6;
+    const double rgbaMB = double(g_imgW) * g_imgH * 4 / 1048576.0;
+
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%s  %dx%d  RGBA8 %.1f MB  (%u threads)\n", NarrowAscii(file).c_str(),
+             g_imgW, g_imgH, rgbaMB, std::thread::hardware_concurrency());
+    report += line;
+    for (BcFormat fmt : { BcFormat::BC1, BcFormat::BC7 }) {
+        constexpr int runs = 5;
+        std::vector<double> ms;
+        BcImage bc;
+        for (int r = 0; r < runs; ++r) {
+            const int64_t t0 = TraceNowNs();
+            EncodeBC(g_pixels.data(), g_imgW, g_imgH, fmt, bc);
+            ms.push_back((TraceNowNs() - t0) / 1e6);
+        }
+        std::sort(ms.begin(), ms.end());
+        const double median = ms[ms.size() / 2];
+        const double mb = bc.blocks.size() / 1048576.0;
+        snprintf(line, sizeof(line), "%s  median %8.1f ms  %6.0f MP/s  PSNR %5.2f dB  %6.1f MB (%.0fx smaller)\n",
+                 fmt == BcFormat::BC1 ? "BC1" : "BC7", median, median > 0.0 ? mp * 1e3 / median : 0.0,
+                 BcPsnr(g_pixels.data(), g_imgW, g_imgH, bc), mb, mb > 0.0 ? rgbaMB / mb : 0.0);
+        report += line;
+    }
+    return WriteBenchReport(L"HDRViewer-bc-bench.txt", report) ? 0 : 1;
+}
+
+// The whole of `file`, for the decoder benches
+static bool ReadBenchFile(const std::wstring& file, std::vector<uint8_t>& data)
+{
+    FILE* f = nullptr;
+    if (_wfopen_s(&f, file.c_str(), L"rb") != 0 || !f) return false;
+    uint8_t chunk[1 << 16];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0;) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+    return !data.empty();
+}
+
+// --png-bench <file>: decode a PNG `runs` times through the fast path and
+// through stb_image and write the best and median of each, and whether the
+// two agree byte for byte, to %TEMP%\HDRViewer-png-bench.txt
+static int RunPngBench(const std::wstring& file)
+{
+    std::vector<uint8_t> data;
+    if (!ReadBenchFile(file, data)) return 1;
+
+    constexpr int runs = 15;
+    std::vector<double> fastMs, stbMs;
+    PixelBuffer fast;
+    int w = 0, h = 0;
+    bool fastOk = false, same = false;
+    for (int r = 0; r < runs; ++r) {
+        int64_t t0 = TraceNowNs();
+        fastOk = DecodePngFast(data.data(), data.size(), fast, w, h);
+        if (fastOk) fastMs.push_back((TraceNowNs() - t0) / 1e6);
+
+        int sw = 0, sh = 0, sn = 0;
+        t0 = TraceNowNs();
+        stbi_uc* ref = stbi_load_from_memory(data.data(), int(data.size()), &sw, &sh, &sn, 4);
+        stbMs.push_back((TraceNowNs() - t0) / 1e6);
+        if (!ref) return 1;
+        same = fastOk && w == sw && h == sh && memcmp(fast.data(), ref, size_t(sw) * sh * 4) == 0;
+        if (!fastOk) { w = sw; h = sh; }
+        stbi_image_free(ref);
+    }
+
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%s  %dx%d  %zu bytes  %d runs\n", NarrowAscii(file).c_str(), w, h, data.size(), runs);
+    report += line;
+    auto row = [&](const char* what, std::vector<double>& ms) {
+        std::sort(ms.begin(), ms.end());
+        const double median = ms[ms.size() / 2];
+        snprintf(line, sizeof(line), "%-10s best %8.2f ms  median %8.2f ms  %7.0f MP/s\n", what, ms.front(), median,
+                 median > 0.0 ? double(w) * h / 1e3 / median : 0.0);
+        report += line;
+    };
+    if (fastOk) row("fast path", fastMs);
+    else        report += "fast path  declined (palette, 16-bit, interlaced or tRNS)\n";
+    row("stb_image", stbMs);
+    if (fastOk) report += same ? "output     identical\n" : "output     DIFFERS\n";
+    return WriteBenchReport(L"HDRViewer-png-bench.txt", report) && (!fastOk || same) ? 0 : 1;
+}
+
+// --jpeg-bench <file>: decode a JPEG through stb_image alone and through the
+// restart-marker bands at 2, 4, ... up to one band per hardware thread, and
+// write each median, its speedup over stb_image and whether the pixels
+// agree to %TEMP%\HDRViewer-jpeg-bench.txt
+static int RunJpegBench(const std::wstring& file)
+{
+    std::vector<uint8_t> data;
+    if (!ReadBenchFile(file, data)) return 1;
+
+    constexpr int runs = 7;
+    std::vector<double> stbMs;
+    int w = 0, h = 0, n = 0;
+    stbi_uc* ref = nullptr;
+    for (int r = 0; r < runs; ++r) {
+        stbi_image_free(ref);
+        const int64_t t0 = TraceNowNs();
+        ref = stbi_load_from_memory(data.data(), int(data.size()), &w, &h, &n, 4);
+        stbMs.push_back((TraceNowNs() - t0) / 1e6);
+        if (!ref) return 1;
+    }
+    std::sort(stbMs.begin(), stbMs.end());
+    const double stbMedian = stbMs[stbMs.size() / 2];
+
+    const int hw = int(std::max(1u, std::thread::hardware_concurrency()));
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%s  %dx%d  %zu bytes  %d runs  (%d threads)\n", NarrowAscii(file).c_str(), w, h,
+             data.size(), runs, hw);
+    report += line;
+    snprintf(line, sizeof(line), "stb_image        median %8.2f ms  %7.0f MP/s\n", stbMedian,
+             stbMedian > 0.0 ? double(w) * h / 1e3 / stbMedian : 0.0);
+    report += line;
+
+    bool allSame = true;
+    for (int bands = 2;; bands = std::min(bands * 2, hw)) {
+        std::vector<double> ms;
+        PixelBuffer rgba;
+        int pw = 0, ph = 0, used = 0;
+        bool ok = true;
+        for (int r = 0; r < runs && ok; ++r) {
+            const int64_t t0 = TraceNowNs();
+            ok = DecodeJpegParallel(data.data(), data.size(), rgba, pw, ph, &used, bands);
+            ms.push_back((TraceNowNs() - t0) / 1e6);
+        }
+        if (!ok) {
+            report += "parallel         declined (progressive, no restart markers, or too small)\n";
+            break;
+        }
+        std::sort(ms.begin(), ms.end());
+        const double median = ms[ms.size() / 2];
+        const bool same = pw == w && ph == h && memcmp(rgba.data(), ref, size_t(w) * h * 4) == 0;
+        allSame = allSame && same;
+        snprintf(line, sizeof(line), "%2d bands (%2d)    median %8.2f ms  %7.0f MP/s  %5.2fx  %s\n", bands, used,
+                 median, median > 0.0 ? double(w) * h / 1e3 / median : 0.0, median > 0.0 ? stbMedian / median : 0.0,
+                 same ? "identical" : "DIFFERS");
+        report += line;
+        if (bands >= hw || used < bands) break;    // more threads, or no more legal cuts
+    }
+    stbi_image_free(ref);
+    return WriteBenchReport(L"HDRViewer-jpeg-bench.txt", report) && allSame ? 0 : 1;
+}
+
+// --color-bench <file>: decode `file` and convert it from its embedded ICC
+// profile to sRGB a few times, and write the cost per megapixel to
+// %TEMP%\HDRViewer-color-bench.txt. Fails for files without a profile
+// that needs converting.
+static int RunColorBench(const std::wstring& file)
+{
+    std::vector<uint8_t> data;
+    if (!ReadBenchFile(file, data)) return 1;
+    const auto xf = EmbeddedColorTransform(data.data(), std::min(data.size(), kProfileHeadBytes));
+    if (!xf) return 1;
+    int w = 0, h = 0, n = 0;
+    stbi_uc* decoded = stbi_load_from_memory(data.data(), int(data.size()), &w, &h, &n, 4);
+    if (!decoded) return 1;
+    const std::vector<uint8_t> src(decoded, decoded + size_t(w) * h * 4);
+    stbi_image_free(decoded);
+
+    constexpr int runs = 9;
+    std::vector<double> ms;
+    std::vector<uint8_t> rgba;
+    for (int r = 0; r < runs; ++r) {
+        rgba = src;
+        const int64_t t0 = TraceNowNs();
+        xf->Apply(rgba.data(), w, h);
+        ms.push_back((TraceNowNs() - t0) / 1e6);
+    }
+    std::sort(ms.begin(), ms.end());
+    const double mp = double(w) * h / 1e6, median = ms[ms.size() / 2];
+
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%s  %dx%d  profile \"%s\"  %d runs  (%u threads)\n", NarrowAscii(file).c_str(), w, h,
+             xf->Description().c_str(), runs, std::thread::hardware_concurrency());
+    report += line;
+    snprintf(line, sizeof(line), "convert  best %8.2f ms  median %8.2f ms  %6.2f ms/MP  %7.0f MP/s\n", ms.front(),
+             median, mp > 0.0 ? median / mp : 0.0, median > 0.0 ? mp * 1e3 / median : 0.0);
+    report += line;
+    return WriteBenchReport(L"HDRViewer-color-bench.txt", report) ? 0 : 1;
+}
+
+// --compare-bench [megapixels]: compare two synthetic images of 24 MP (or
+// `megapixels`), one a noisy copy of the other, and write the median cost
+// of the comparison and of both maps to %TEMP%\HDRViewer-compare-bench.txt
+static int RunCompareBench(const std::vector<std::wstring>& args)
+{
+    double megapixels = 24.0;
+    for (size_t i = 1; i + 1 < args.size(); ++i)
+        if (args[i] == L"--compare-bench") megapixels = std::max(0.01, wcstod(args[i + 1].c_str(), nullptr));
+    const int w = std::max(1, int(std::sqrt(megapixels * 1e6 * 1.5))), h = std::max(1, int(megapixels * 1e6 / w));
+
+    std::vector<uint8_t> a(size_t(w) * h * 4), b;
+    uint32_t seed = 1;
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = &a[(size_t(y) * w + x) * 4];
+            p[0] = uint8_t(x * 255 / w);
+            p[1] = uint8_t(y * 255 / h);
+            p[2] = uint8_t((x ^ y) >> 2);
+            p[3] = 255;
+        }
+    b = a;
+    for (size_t i = 0; i < b.size(); i += 4) {
+        seed = seed * 1664525u + 1013904223u;
+        if ((seed >> 28) == 0) b[i + (seed >> 8) % 3] ^= uint8_t(1 + (seed >> 16) % 7);
+    }
+
+    constexpr int runs = 7;
+    std::vector<double> cmpMs, diffMs, ssimMs;
+    CompareResult r;
+    PixelBuffer map;
+    for (int i = 0; i < runs; ++i) {
+        int64_t t0 = TraceNowNs();
+        CompareImages(a.data(), b.data(), w, h, r);
+        cmpMs.push_back((TraceNowNs() - t0) / 1e6);
+        t0 = TraceNowNs();
+        RenderDiffMap(r, a.data(), map);
+        diffMs.push_back((TraceNowNs() - t0) / 1e6);
+        t0 = TraceNowNs();
+        RenderSsimMap(r, map);
+        ssimMs.push_back((TraceNowNs() - t0) / 1e6);
+    }
+
+    const double mp = double(w) * h / 1e6;
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%dx%d  %.1f MP  %d runs  (%u threads)  PSNR %.2f dB  SSIM %.4f  %.2f%% changed\n", w,
+             h, mp, runs, std::thread::hardware_concurrency(), r.psnr, r.ssim, r.ChangedPct());
+    report += line;
+    auto row = [&](const char* what, std::vector<double>& ms) {
+        std::sort(ms.begin(), ms.end());
+        const double median = ms[ms.size() / 2];
+        snprintf(line, sizeof(line), "%-10s best %8.2f ms  median %8.2f ms  %7.0f MP/s\n", what, ms.front(), median,
+                 median > 0.0 ? mp * 1e3 / median : 0.0);
+        report += line;
+    };
+    row("compare", cmpMs);
+    row("diff map", diffMs);
+    row("ssim map", ssimMs);
+    return WriteBenchReport(L"HDRViewer-compare-bench.txt", report) ? 0 : 1;
+}
+
+// --orient-bench [megapixels]: turn a synthetic 24 MP (or `megapixels`)
+// 3:2 image into each of the eight orientations with the per-pixel loop
+// and with OrientPixels, and write the median of each, and whether the two
+// agree byte for byte, to %TEMP%\HDRViewer-orient-bench.txt
+static int RunOrientBench(const std::vector<std::wstring>& args)
+{
+    double megapixels = 24.0;
+    for (size_t i = 1; i + 1 < args.size(); ++i)
+        if (args[i] == L"--orient-bench") megapixels = std::max(0.01, wcstod(args[i + 1].c_str(), nullptr));
+    const int w = std::max(1, int(std::sqrt(megapixels * 1e6 * 1.5))), h = std::max(1, int(megapixels * 1e6 / w));
+
+    PixelBuffer src(size_t(w) * h * 4);
+    uint32_t seed = 1;
+    for (uint8_t& v : src) {
+        seed = seed * 1664525u + 1013904223u;
+        v = uint8_t(seed >> 24);
+    }
+
+    const double mp = double(w) * h / 1e6;
+    std::string report;
+    char line[192];
+    snprintf(line, sizeof(line), "%dx%d  %.1f MP  (%u threads)\n", w, h, mp, std::thread::hardware_concurrency());
+    report += line;
+    bool allSame = true;
+    std::vector<uint8_t> naive(src.size());
+    PixelBuffer fast;
+    for (int v = 1; v <= 8; ++v) {
+        const Orientation o = Orientation(v);
+        constexpr int runs = 5;
+        std::vector<double> naiveMs, fastMs;
+        int fw = w, fh = h;
+        for (int r = 0; r < runs; ++r) {
+            int64_t t0 = TraceNowNs();
+            OrientPixelsNaive(src.data(), w, h, o, naive.data());
+            naiveMs.push_back((TraceNowNs() - t0) / 1e6);
+            fast = src;
+            fw = w;
+            fh = h;
+            t0 = TraceNowNs();
+            OrientPixels(fast, fw, fh, o);
+            fastMs.push_back((TraceNowNs() - t0) / 1e6);
+        }
+        std::sort(naiveMs.begin(), naiveMs.end());
+        std::sort(fastMs.begin(), fastMs.end());
+        const double n = naiveMs[runs / 2], f = fastMs[runs / 2];
+        const bool same = fast.size() == naive.size() && memcmp(fast.data(), naive.data(), naive.size()) == 0;
+        allSame = allSame && same;
+        snprintf(line, sizeof(line), "%-12s naive %8.2f ms  fast %8.2f ms  %7.0f MP/s  %5.1fx  %s\n",
+                 OrientationName(o), n, f, f > 0.0 ? mp * 1e3 / f : 0.0, f > 0.0 ? n / f : 0.0,
+                 same ? "same" : "DIFFERENT");
+        report += line;
+    }
+    return WriteBenchReport(L"HDRViewer-orient-bench.txt", report) && allSame ? 0 : 1;
+}
+
+// --filelist-bench [entries]: build a synthetic library of `entries` paths
+// (1M by default) as a plain vector and as a FileList, and write memory,
+// lookup and sort costs to %TEMP%\HDRViewer-filelist-bench.txt
+static int RunFileListBench(const std::vector<std::wstring>& args)
+{
+    size_t entries = 1000000;
+    for (size_t i = 1; i + 1 < args.size(); ++i)
+        if (args[i] == L"--filelist-bench") entries = size_t(std::max(1.0, wcstod(args[i + 1].c_str(), nullptr)));
+    return WriteBenchReport(L"HDRViewer-filelist-bench.txt", FileListBench(entries)) ? 0 : 1;
+}
+
 int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
 
     // Make the process DPI-aware BEFORE any windows/dialogs are created.
     EnablePerMonitorV2DpiAwarenessEarly();
-
-    // Run windows file open dialog
-    if (!OpenFileDialogAndLoad())
-    return 0;   // no file → exit
+    TraceSetThreadName("main");
+
+    // --hdr drives the display in scRGB; --itm starts with inverse tone
+    // mapping on. --itm-peak=, --itm-paper= (nits), --itm-knee= and
+    // --itm-saturation= (0..1) shape the curve.
+    const std::vector<std::wstring> args = CommandLineArgs();
+    g_scRgb = std::find(args.begin(), args.end(), L"--hdr") != args.end();
+    g_itmOn = g_scRgb && std::find(args.begin(), args.end(), L"--itm") != args.end();
+    g_itmParams.peakNits   = ArgFloat(args, L"--itm-peak", g_itmParams.peakNits);
+    g_itmParams.paperNits  = ArgFloat(args, L"--itm-paper", g_itmParams.paperNits);
+    g_itmParams.knee       = ArgFloat(args, L"--itm-knee", g_itmParams.knee);
+    g_itmParams.saturation = ArgFloat(args, L"--itm-saturation", g_itmParams.saturation);
+    for (size_t i = 1; i + 1 < args.size(); ++i)
+        if (args[i] == L"--itm-bench") return RunItmBench(args[i + 1]);
+        else if (args[i] == L"--png-bench") return RunPngBench(args[i + 1]);
+        else if (args[i] == L"--bc-bench") return RunBcBench(args[i + 1]);
+        else if (args[i] == L"--jpeg-bench") return RunJpegBench(args[i + 1]);
+        else if (args[i] == L"--color-bench") return RunColorBench(args[i + 1]);
+    if (std::find(args.begin(), args.end(), L"--filelist-bench") != args.end()) return RunFileListBench(args);
+    if (std::find(args.begin(), args.end(), L"--compare-bench") != args.end()) return RunCompareBench(args);
+    if (std::find(args.begin(), args.end(), L"--orient-bench") != args.end()) return RunOrientBench(args);
+
+    // --library starts in the catalogued library; otherwise (or when there
+    // is no catalog yet) run the windows file open dialog
+    std::wstring selected;
+    const bool library = wcsstr(GetCommandLineW(), L"--library") != nullptr &&
+                         g_catalog.Open(DefaultCatalogPath()) && g_catalog.Count() > 0;
+    if (!library) {
+        g_catalog.Close();
+        if (!PickImageFile(selected))
+        return 0;   // no file → exit
+    }
+    g_startupNs = TraceNowNs();
 
     int screenW = GetSystemMetrics(SM_CXSCREEN);
     int screenH = GetSystemMetrics(SM_CYSCREEN);
     g_screenW = screenW;
     g_screenH = screenH;
 
-    // compute image vs screen aspect once
-    {
-        float imgAspect    = float(g_imgW) / float(g_imgH);
-        float screenAspect = float(g_screenW) / float(g_screenH);
-        g_baseScaleX = 1.0f;
-        g_baseScaleY = 1.0f;
-        if (imgAspect > screenAspect) {
-            // image is wider → pillarbox vertically
-            g_baseScaleY = screenAspect / imgAspect;
+    // Startup tasks: listing the folder, decoding the picked file, device
+    // creation and shader compilation are independent, so they overlap on
+    // worker threads; pipelines wait for device + shaders and the upload for
+    // device + pixels. The window and swap chain stay on this thread.
+    TaskGraph startup;
+    ComPtr<IDXGIFactory4> factory;
+    bool decoded = false;
+    std::atomic<bool> pipelineFailed{false};
+
+    const auto scan = startup.Add("scan", [&] {
+        if (library) {
+            g_libraryMode = true;
+            BuildLibraryList(std::wstring());
+            SyncSearch(false);
         } else {
-            // image taller → letterbox horizontally
-            g_baseScaleX = imgAspect / screenAspect;
+            ScanFolder(selected);
         }
-    }
+    });
+    // the library's first image is only known after the listing
+    const auto decode = startup.Add("decode", [&] {
+        decoded = library ? LoadFirstLibraryImage() : LoadImage(selected);
+    }, library ? std::vector<TaskGraph::TaskId>{ scan } : std::vector<TaskGraph::TaskId>{});
+    const auto device = startup.Add("device", [&] {
+        CreateDXGIFactory1(IID_PPV_ARGS(&factory));
+        D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0,
+                          IID_PPV_ARGS(&g_device));
+
+        D3D12_COMMAND_QUEUE_DESC cqDesc{};
+        g_device->CreateCommandQueue(
+            &cqDesc, IID_PPV_ARGS(&g_cmdQueue));
+
+        ThrowIfFailed(g_device->CreateFence(
+        0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_fence)
+        ));
+        g_fenceValue  = 0;
+        g_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!g_fenceEvent) ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        CreateUploadQueue();
+
+        // 9) Build SRV heap for later
+        {
+            D3D12_DESCRIPTOR_HEAP_DESC srvDesc{};
+            srvDesc.NumDescriptors = 6 + kMaxAtlasPages;   // image, grid atlas pages, second image slot, two view slots, two compare slots
+            srvDesc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+            srvDesc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+            g_device->CreateDescriptorHeap(
+                &srvDesc, IID_PPV_ARGS(&g_srvHeap));
+        }
+    });
+    const auto imageShaders = startup.Add("compile image shaders", [&] {
+        if (!CompileShader(g_VS, "VSMain", "vs_5_0", g_shaders.vs) ||
+            !CompileShader(g_PS, "PSMain", "ps_5_0", g_shaders.ps)) pipelineFailed = true;
+    });
+    const auto textShaders = startup.Add("compile text shaders", [&] {
+        if (!CompileShader(g_VS_Text, "VSMain", "vs_5_0", g_shaders.textVS) ||
+            !CompileShader(g_PS_Text, "PSMain", "ps_5_0", g_shaders.textPS)) pipelineFailed = true;
+    });
+    const auto spriteShaders = startup.Add("compile sprite shaders", [&] {
+        if (!CompileShader(g_VS_Sprite, "VSMain", "vs_5_0", g_shaders.spriteVS) ||
+            !CompileShader(g_PS_Sprite, "PSMain", "ps_5_0", g_shaders.spritePS)) pipelineFailed = true;
+    });
+    startup.Add("pipelines", [&] {
+        if (pipelineFailed) return;
+        if (!CreateMainPipeline()) { pipelineFailed = true; return; }
+        CreateTextPipeline();
+        CreateSpritePipeline();
+    }, { device, imageShaders, textShaders, spriteShaders });
+    startup.Add("upload", [&] {
+        if (!decoded) return;
+        // compute image vs screen aspect once
+        UpdateLetterbox();
+        CreateTextureFromPixels();
+    }, { scan, decode, device });
+    startup.Start();
 
+    int64_t t0 = TraceNowNs();
     // 2) Win32 window setup
     WNDCLASS wc{};
     wc.lpfnWndProc   = WndProc;
@@ -1077,32 +4129,16 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
         nullptr, nullptr, hInst, nullptr
     );
     ShowWindow(hwnd, nCmdShow);
+    RecordStartupPhase("window", t0, TraceNowNs());
 
-    // 3) DX12 device + swap chain
-    ComPtr<IDXGIFactory4> factory;
-    CreateDXGIFactory1(IID_PPV_ARGS(&factory));
-    D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0,
-                      IID_PPV_ARGS(&g_device));
-
-    D3D12_COMMAND_QUEUE_DESC cqDesc{};
-    g_device->CreateCommandQueue(
-        &cqDesc, IID_PPV_ARGS(&g_cmdQueue));
-
-    ThrowIfFailed(g_device->CreateFence(
-    0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_fence)
-    ));
-    g_fenceValue  = 0;
-    g_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-    if (!g_fenceEvent) {
-        MessageBoxW(nullptr, L"Failed to create fence event", L"Error", MB_OK | MB_ICONERROR);
-        return 0;
-    }
-
+    // 3) Swap chain, once the device exists
+    startup.Wait(device);
+    t0 = TraceNowNs();
     DXGI_SWAP_CHAIN_DESC1 scd = {};
     scd.BufferCount       = FrameCount;
     scd.Width             = screenW;
     scd.Height            = screenH;
-    scd.Format            = DXGI_FORMAT_R8G8B8A8_UNORM;
+    scd.Format            = BackBufferFormat();
     scd.BufferUsage       = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     scd.SwapEffect        = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     scd.SampleDesc.Count  = 1;
@@ -1128,11 +4164,19 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
         scd.Format,
         DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH
     ));
+    // scRGB: linear, BT.709 primaries, 1.0 = 80 nits and values past it
+    // reach into the display's HDR range
+    if (g_scRgb) {
+        UINT support = 0;
+        if (SUCCEEDED(g_swapChain->CheckColorSpaceSupport(DXGI_COLOR_SPACE_RGB_FULL_G10_NONE_P709, &support)) &&
+            (support & DXGI_SWAP_CHAIN_COLOR_SPACE_SUPPORT_FLAG_PRESENT))
+            ThrowIfFailed(g_swapChain->SetColorSpace1(DXGI_COLOR_SPACE_RGB_FULL_G10_NONE_P709));
+    }
 
     // 8) Now recreate your RTV heap & views
     g_rtvHeap.Reset();
     D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-    rtvHeapDesc.NumDescriptors = FrameCount;
+    rtvHeapDesc.NumDescriptors = FrameCount * 2;     // UNORM views, then sRGB views
     rtvHeapDesc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     ThrowIfFailed(g_device->CreateDescriptorHeap(
         &rtvHeapDesc, IID_PPV_ARGS(&g_rtvHeap)
@@ -1151,165 +4195,29 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
         );
         rtvHandle.ptr += g_rtvDescSize;
     }
-
-
-    // 9) Build SRV heap for later
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC srvDesc{};
-        srvDesc.NumDescriptors = 1;
-        srvDesc.Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-        srvDesc.Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-        g_device->CreateDescriptorHeap(
-            &srvDesc, IID_PPV_ARGS(&g_srvHeap));
-    }
-
-    // MessageBoxW(nullptr, L"SRV heap created", L"Debug", MB_OK);
-
-
-    // 10) Create root signature
-    {
-        D3D12_DESCRIPTOR_RANGE range{};
-        range.RangeType                         = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-        range.NumDescriptors                    = 1;
-        range.BaseShaderRegister                = 0;
-        range.RegisterSpace                     = 0;
-        range.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-        // 1) SRV parameter (t0)
-        D3D12_ROOT_PARAMETER srvParam{};
-        srvParam.ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        srvParam.DescriptorTable.NumDescriptorRanges = 1;
-        srvParam.DescriptorTable.pDescriptorRanges   = &range;
-        srvParam.ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
-
-        // 2) 32‐bit constants for scaleX/scaleY (b0)
-        D3D12_ROOT_PARAMETER scaleParam{};
-        scaleParam.ParameterType                    = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        scaleParam.Constants.Num32BitValues         = 4;  // scaleX, scaleY, offX, offY
-        scaleParam.Constants.ShaderRegister         = 0; // b0
-        scaleParam.Constants.RegisterSpace          = 0;
-        scaleParam.ShaderVisibility                 = D3D12_SHADER_VISIBILITY_VERTEX;
-
-        // 3) Static sampler as before
-        D3D12_STATIC_SAMPLER_DESC sampDesc{};
-        sampDesc.Filter         = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
-        sampDesc.AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        sampDesc.AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        sampDesc.AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
-        sampDesc.ShaderRegister = 0;
-        sampDesc.RegisterSpace  = 0;
-        sampDesc.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
-
-        // 4) Pack into array
-        D3D12_ROOT_PARAMETER params[2] = { srvParam, scaleParam };
-
-        // 5) Build & serialize
-        D3D12_ROOT_SIGNATURE_DESC rsDesc{};
-        rsDesc.NumParameters     = 2;
-        rsDesc.pParameters       = params;
-        rsDesc.NumStaticSamplers = 1;
-        rsDesc.pStaticSamplers   = &sampDesc;
-        rsDesc.Flags             = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
-
-        ComPtr<ID3DBlob> rsBlob, errBlob;
-        D3D12SerializeRootSignature(
-          &rsDesc, D3D_ROOT_SIGNATURE_VERSION_1, &rsBlob, &errBlob);
-        g_device->CreateRootSignature(
-          0, rsBlob->GetBufferPointer(),
-          rsBlob->GetBufferSize(),
-          IID_PPV_ARGS(&g_rootSig));
-    }
-
-    // MessageBoxW(nullptr, L"Root signature created", L"Debug", MB_OK);
-
-
-    // 12) Compile & create PSO (with explicit states + error check)
-    {
-        ComPtr<ID3DBlob> vsBlob, psBlob, errBlob;
-        // Compile VS
-        HRESULT hr = D3DCompile(g_VS, strlen(g_VS), nullptr, nullptr, nullptr,
-                                "VSMain", "vs_5_0", 0, 0, &vsBlob, &errBlob);
-        if (FAILED(hr)) {
-            MessageBoxW(nullptr, L"Vertex shader compile failed", L"PSO Error", MB_OK | MB_ICONERROR);
-            return 0;
-        }
-        // Compile PS with detailed error output
-        ComPtr<ID3DBlob> psErr;
-        hr = D3DCompile(
-            g_PS, strlen(g_PS),
-            nullptr, nullptr, nullptr,
-            "PSMain", "ps_5_0",
-            0, 0,
-            &psBlob,
-            &psErr
-        );
-        if (FAILED(hr)) {
-            // Extract error message
-            const char* errMsg = psErr 
-                ? reinterpret_cast<const char*>(psErr->GetBufferPointer()) 
-                : "Unknown PS compile error";
-            MessageBoxA(nullptr, errMsg, "Pixel Shader Compile Error", MB_OK | MB_ICONERROR);
-            return 0;
-        }
-
-
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc{};
-        psoDesc.pRootSignature        = g_rootSig.Get();
-        psoDesc.VS                    = { vsBlob->GetBufferPointer(), vsBlob->GetBufferSize() };
-        psoDesc.PS                    = { psBlob->GetBufferPointer(), psBlob->GetBufferSize() };
-
-        // Explicit default rasterizer state
-        D3D12_RASTERIZER_DESC rastDesc{};
-        rastDesc.FillMode              = D3D12_FILL_MODE_SOLID;
-        rastDesc.CullMode              = D3D12_CULL_MODE_NONE;
-        rastDesc.FrontCounterClockwise = FALSE;
-        rastDesc.DepthClipEnable       = TRUE;
-        psoDesc.RasterizerState        = rastDesc;
-
-        // Explicit default blend state
-        D3D12_RENDER_TARGET_BLEND_DESC rtbd{};
-        rtbd.BlendEnable           = FALSE;
-        rtbd.LogicOpEnable         = FALSE;
-        rtbd.SrcBlend              = D3D12_BLEND_ONE;
-        rtbd.DestBlend             = D3D12_BLEND_ZERO;
-        rtbd.BlendOp               = D3D12_BLEND_OP_ADD;
-        rtbd.SrcBlendAlpha         = D3D12_BLEND_ONE;
-        rtbd.DestBlendAlpha        = D3D12_BLEND_ZERO;
-        rtbd.BlendOpAlpha          = D3D12_BLEND_OP_ADD;
-        rtbd.LogicOp               = D3D12_LOGIC_OP_NOOP;
-        rtbd.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
-
-        D3D12_BLEND_DESC blendDesc{};
-        blendDesc.AlphaToCoverageEnable   = FALSE;
-        blendDesc.IndependentBlendEnable  = FALSE;
-        blendDesc.RenderTarget[0]         = rtbd;
-        psoDesc.BlendState                = blendDesc;
-
-        psoDesc.DepthStencilState.DepthEnable   = FALSE;
-        psoDesc.DepthStencilState.StencilEnable = FALSE;
-        psoDesc.SampleMask             = UINT_MAX;
-        psoDesc.PrimitiveTopologyType  = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-        psoDesc.NumRenderTargets       = 1;
-        psoDesc.RTVFormats[0]          = DXGI_FORMAT_R8G8B8A8_UNORM;
-        psoDesc.SampleDesc.Count       = 1;
-        psoDesc.InputLayout            = { nullptr, 0 };
-
-        // Create PSO and check errors
-        hr = g_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&g_pipelineState));
-        if (FAILED(hr)) {
-            wchar_t buf[128];
-            swprintf_s(buf, L"CreateGraphicsPipelineState failed: 0x%08X", hr);
-            MessageBoxW(nullptr, buf, L"PSO Error", MB_OK | MB_ICONERROR);
-            return 0;
-        }
+    // flip-model buffers cannot be _SRGB themselves, but their views can;
+    // the image pass writes through these so the hardware encodes linear
+    // results, while overlays keep the plain views and their sRGB colors.
+    // FP16 buffers are linear already, so both sets are the same view.
+    D3D12_RENDER_TARGET_VIEW_DESC srgbDesc = {};
+    srgbDesc.Format        = ImageRtvFormat();
+    srgbDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2D;
+    for (UINT i = 0; i < FrameCount; ++i) {
+        g_device->CreateRenderTargetView(g_renderTargets[i].Get(), &srgbDesc, rtvHandle);
+        rtvHandle.ptr += g_rtvDescSize;
     }
+    RecordStartupPhase("swap chain", t0, TraceNowNs());
 
-    CreateTextPipeline();
-
-    // ——— 13) Create and upload the texture (with debug) ———
-    if (!g_pixels.empty()) {
-        CreateTextureFromPixels();
+    startup.WaitAll();
+    for (size_t i = 0; i < startup.Count(); ++i)
+        RecordStartupPhase(startup.Name(int(i)), startup.StartNs(int(i)), startup.EndNs(int(i)));
+    if (pipelineFailed) return 0;
+    if (!decoded) {
+        MessageBoxW(nullptr, L"LoadImage failed", L"Error", MB_OK | MB_ICONERROR);
+        return 0;
     }
+    // pick up changes made to the library since the catalog was written
+    if (library) g_catalogUpdater.Start(LibraryRoots(), DefaultCatalogPath());
 
     g_lastMouseMove = std::chrono::steady_clock::now();
 
@@ -1330,6 +4238,27 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         } else {
+            // 0) Next animation frame, if its delay has passed; in the grid,
+            //    steer thumbnail generation and upload what finished
+            if (g_gridMode) {
+                g_grid.Compute(g_screenW, g_screenH, int(g_fileList.size()));
+                g_gridScroll += (g_gridScrollTarget - g_gridScroll) * 0.25f;
+                if (std::fabs(g_gridScrollTarget - g_gridScroll) < 0.5f) g_gridScroll = g_gridScrollTarget;
+                UpdateGridPriority();
+                UploadThumbnails();
+            } else if (const uint8_t* frame = g_gif.Poll(std::chrono::steady_clock::now())) {
+                UpdateTexturePixels(frame, g_gif.Width(), g_gif.Height());
+            }
+            RetireUploads();
+            PublishPendingTexture();
+            PublishCompare();
+            PollDuplicateScan();
+            PollLibrary();
+            PollSearch();
+            PollBcEncode();
+
+            const int64_t tFrame = TraceNowNs();
+
              // 1) Create per‐frame allocator & command list
             ComPtr<ID3D12CommandAllocator> allocator;
             ThrowIfFailed(g_device->CreateCommandAllocator(
@@ -1344,7 +4273,7 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
 
             // 2) Determine clear color
             FLOAT clearCol[4];
-            if (g_pixels.empty()) {
+            if (!g_texture) {
                 // default “no image” color—keep as is
                 clearCol[0] = 0.0f;
                 clearCol[1] = 0.2f;
@@ -1381,6 +4310,12 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
             // 5) Clear it
             cl->ClearRenderTargetView(rtvHandle, clearCol, 0, nullptr);
 
+            // the image samples as linear (_SRGB texture) and is written
+            // through the sRGB view of the same buffer
+            D3D12_CPU_DESCRIPTOR_HANDLE srgbRtv = rtvHandle;
+            srgbRtv.ptr += FrameCount * g_rtvDescSize;
+            cl->OMSetRenderTargets(1, &srgbRtv, FALSE, nullptr);
+
             // 6) (Optional) Set viewport & scissor, if not done elsewhere
             int screenW = GetSystemMetrics(SM_CXSCREEN);
             int screenH = GetSystemMetrics(SM_CYSCREEN);
@@ -1402,13 +4337,14 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
             // slot 0 → texture SRV
             cl->SetGraphicsRootDescriptorTable(
                 0,
-                g_srvHeap->GetGPUDescriptorHandleForHeapStart()
+                ImageSrvGpu(g_imageSrvSlot)
             );
 
             const float zoomLerp = 0.1f, panLerp = 0.1f;
             g_zoom += (g_targetZoom - g_zoom) * zoomLerp;
             g_offX += (g_targetOffX - g_offX) * panLerp;
             g_offY += (g_targetOffY - g_offY) * panLerp;
+            UpdateView();
 
             // then clamp exactly as before
             // float halfW = g_baseScaleX * g_zoom;
@@ -1418,22 +4354,67 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
             // g_offX = std::clamp(g_offX, -panLimitX, panLimitX);
             // g_offY = std::clamp(g_offY, -panLimitY, panLimitY);
 
-            // 4) push the four transform constants:
-            float t[4] = { g_baseScaleX * g_zoom,
-                        g_baseScaleY * g_zoom,
+            // 4) push the transform constants:
+            float t[7] = { g_texScaleX * g_zoom,
+                        g_texScaleY * g_zoom,
                         g_offX,
-                        g_offY };
+                        g_offY,
+                        g_uvScaleX,
+                        g_uvScaleY,
+                        DisplayExposure() };
 
-            cl->SetGraphicsRoot32BitConstants(1, 4, t, 0);
+            cl->SetGraphicsRoot32BitConstants(1, 7, t, 0);
 
 
             // draw full-screen triangle
-            cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-            cl->DrawInstanced(4, 1, 0, 0);
+            if (!g_gridMode) {
+                cl->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+                if (CompareActive() && g_cmp.tex) {
+                    DrawCompare(cl.Get(), t, sc);
+                } else {
+                    cl->DrawInstanced(4, 1, 0, 0);
+                    DrawView(cl.Get());
+                }
+            }
+            cl->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+
+            // overlays append into this frame's VB from offset 0
+            BeginOverlayVB();
+
+            if (g_gridMode) DrawGrid(cl.Get(), rtvHandle, srgbRtv);
+            else if (CompareActive()) DrawCompareOverlay(cl.Get());
 
             // Build the info line for current file and draw it
-            if (!g_fileList.empty() && g_drawText) {
+            if (!g_fileList.empty() && g_drawText && !g_gridMode) {
                 std::string info = BuildInfoLine(g_fileList[g_currentFileIndex]);
+                if (g_hdrActive) info += HdrInfo();
+                if (g_gainMapShown) {
+                    char gm[160];
+                    snprintf(gm, sizeof(gm), "  |  Ultra HDR gain map %dx%d, up to %.1f stops, weight %.2f  decode %.1f ms  apply %.1f ms",
+                             g_gainMap.w, g_gainMap.h,
+                             std::max({ g_gainMap.meta.gainMapMax[0], g_gainMap.meta.gainMapMax[1], g_gainMap.meta.gainMapMax[2] }),
+                             GainMapWeight(g_gainMap.meta, g_itmParams.peakNits / g_itmParams.paperNits),
+                             g_gainMap.decodeMs, g_gainMapMs);
+                    info += gm;
+                }
+                if (g_texScRgb && g_itm) {
+                    char itm[128];
+                    snprintf(itm, sizeof(itm), "  |  ITM peak %.0f / paper %.0f nits  %s %.1f ms",
+                             g_itmParams.peakNits, g_itmParams.paperNits, g_itm->lastPass, g_itm->lastMs);
+                    info += itm;
+                }
+                if (g_curBc) {
+                    char bc[96];
+                    snprintf(bc, sizeof(bc), "  |  %s %.1f ms (%.0f MP/s)",
+                             g_curBc->bc.format == BcFormat::BC1 ? "BC1" : "BC7",
+                             g_curBc->encodeMs,
+                             double(g_curBc->bc.srcW) * g_curBc->bc.srcH / 1000.0 / std::max(0.001, g_curBc->encodeMs));
+                    info += bc;
+                    if (g_curBc->psnr > 0.0) {
+                        snprintf(bc, sizeof(bc), "  PSNR %.1f dB", g_curBc->psnr);
+                        info += bc;
+                    }
+                }
 
                 // Offsets for a crude 1-pixel border (in screen-space pixels)
                 const float scale   = 3.0f;
@@ -1443,8 +4424,28 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
 
                 // Finally the main text in green on top
                 DrawOverlayText(cl.Get(), info.c_str(), scale, cx, cy, 0,1,0,1.0f);
+
+                // decoder + buffer pool reuse under the info line
+                const PoolStats ps = GetPoolStats();
+                char pool[192];
+                snprintf(pool, sizeof(pool), "Decode: %s %s %.1f ms (%d thread%s)  |  "
+                         "Buffer pool: reuse %.0f%%  |  pooled %.0f MB  |  live %.0f MB",
+                         g_lastDecode.format, g_lastDecode.path, g_lastDecode.ms, g_lastDecode.threads,
+                         g_lastDecode.threads == 1 ? "" : "s",
+                         ps.ReuseRate() * 100.0, ps.idleBytes / 1048576.0, ps.liveBytes / 1048576.0);
+                DrawOverlayText(cl.Get(), pool, 2.0f, cx, cy + 40.0f, 0,1,0,1.0f);
+            }
+
+            if (!g_fileList.empty() && g_drawHistogram && !g_gridMode) {
+                auto it = g_statsCache.find(g_fileList[g_currentFileIndex]);
+                if (it != g_statsCache.end()) DrawHistogramOverlay(cl.Get(), it->second);
             }
 
+            if (g_drawHud) DrawPerfHud(cl.Get());
+
+            if (!g_toast.empty() && std::chrono::steady_clock::now() < g_toastUntil)
+                DrawOverlayText(cl.Get(), g_toast.c_str(), 2.0f, 0.5f * g_screenW, g_screenH - 60.0f, 1, 1, 0, 1.0f);
+
 
             // 8) Transition back into PRESENT
             cl->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
@@ -1455,11 +4456,26 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
 
             // close + submit
             cl->Close();
+            const int64_t tSubmit = TraceNowNs();
+            TraceRecord("frame record", tFrame, tSubmit);
             ID3D12CommandList* lists[] = { cl.Get() };
+            // thumbnails this frame draws may have been copied just now
+            if (g_atlasCopyFence > g_copyFence->GetCompletedValue())
+                ThrowIfFailed(g_cmdQueue->Wait(g_copyFence.Get(), g_atlasCopyFence));
             g_cmdQueue->ExecuteCommandLists(_countof(lists), lists);
+            // frame timeline: retires replaced textures and image SRV slots
+            ThrowIfFailed(g_cmdQueue->Signal(g_fence.Get(), ++g_fenceValue));
+            g_textVBs[g_textVBFrame].freeAt = g_fenceValue;
 
             // present immediately, no v-sync
             g_swapChain->Present(1, 0);
+            TraceRecord("present", tSubmit, TraceNowNs());
+            if (g_firstFrameMs == 0.0 && g_texture) {
+                // time to first frame: the first present that shows the image
+                const int64_t now = TraceNowNs();
+                g_firstFrameMs = (now - g_startupNs) / 1e6;
+                TraceRecord("time to first frame", g_startupNs, now);
+            }
 
             // frame-timing
             using clock = std::chrono::high_resolution_clock;
@@ -1468,12 +4484,22 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
             auto elapsed = std::chrono::duration<float, std::milli>(now - lastFrame).count();
             auto target  = 1000.0f / 60.0f;
             lastFrame = clock::now();
+            g_frameTimes.Push(elapsed);
 
             // swap buffer index
             g_frameIndex = g_swapChain->GetCurrentBackBufferIndex();
         }
     }
 
+    // nothing may still be copying into or reading from resources about to go away
+    WaitForFence(g_copyFence.Get(), g_copyFenceValue);
+    WaitForFence(g_fence.Get(), g_fenceValue);
+
+#ifndef HDRV_NO_TRACE
+    // leave the session's last spans behind for post-mortem of slow loads
+    std::wstring tracePath;
+    DumpTrace(tracePath);
+#endif
     return 0;
 }
 
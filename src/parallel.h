@@ -0,0 +1,51 @@
+// src/parallel.h
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Number of bands ParallelForBands will split `count` items into, so callers
+// can size per-band scratch (partial histograms etc.) up front. At most one
+// band per hardware thread, or `maxBands` when given.
+inline int ParallelBandCount(int count, int minPerBand, int maxBands = 0)
+{
+    if (count <= 0) return 0;
+    int hw = maxBands > 0 ? maxBands : int(std::thread::hardware_concurrency());
+    if (hw <= 0) hw = 1;
+    const int byWork = std::max(1, count / std::max(1, minPerBand));
+    return std::min(hw, byWork);
+}
+
+// Split [0, count) into contiguous bands and run fn(band, begin, end) on each,
+// one thread per band. Band 0 runs on the calling thread.
+template <class F>
+void ParallelForBands(int count, int minPerBand, int maxBands, F&& fn)
+{
+    const int bands = ParallelBandCount(count, minPerBand, maxBands);
+    if (bands <= 1) {
+        if (count > 0) fn(0, 0, count);
+        return;
+    }
+
+    auto bandRange = [&](int b, int& begin, int& end) {
+        begin = int((long long)count * b / bands);
+        end   = int((long long)count * (b + 1) / bands);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(size_t(bands - 1));
+    for (int b = 1; b < bands; ++b) {
+        int begin, end; bandRange(b, begin, end);
+        workers.emplace_back([&fn, b, begin, end] { fn(b, begin, end); });
+    }
+    int begin, end; bandRange(0, begin, end);
+    fn(0, begin, end);
+    for (auto& t : workers) t.join();
+}
+
+template <class F>
+void ParallelForBands(int count, int minPerBand, F&& fn)
+{
+    ParallelForBands(count, minPerBand, 0, std::forward<F>(fn));
+}
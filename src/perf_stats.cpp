@@ -0,0 +1,127 @@
+// src/perf_stats.cpp
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr int kSlots = kPerfStages + kPerfCounters;
+
+struct alignas(64) CounterBlock {
+    std::atomic<uint64_t> v[kSlots];
+    CounterBlock() { for (auto& x : v) x.store(0, std::memory_order_relaxed); }
+};
+
+struct Registry {
+    std::mutex                                 mutex;
+    std::vector<std::unique_ptr<CounterBlock>> blocks;
+};
+
+Registry& GetRegistry()
+{
+    static Registry* r = new Registry;      // never destroyed: workers may outlive main's statics
+    return *r;
+}
+
+CounterBlock& LocalBlock()
+{
+    thread_local CounterBlock* block = [] {
+        Registry& reg = GetRegistry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.blocks.push_back(std::make_unique<CounterBlock>());
+        return reg.blocks.back().get();
+    }();
+    return *block;
+}
+
+// Single writer per block: a relaxed load + store is enough and avoids a
+// locked read-modify-write on the hot path
+inline void Bump(int slot, uint64_t v)
+{
+    std::atomic<uint64_t>& a = LocalBlock().v[slot];
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+} // namespace
+
+const char* PerfStageName(PerfStage s)
+{
+    static const char* const kNames[kPerfStages] = {
+        "open", "read", "decode", "color", "orient", "stats", "resize", "encode", "upload", "gpu wait"
+    };
+    return kNames[int(s)];
+}
+
+void PerfAddStage(PerfStage s, int64_t ns)
+{
+    Bump(int(s), uint64_t(std::max<int64_t>(0, ns)));
+}
+
+void PerfAdd(PerfCounter c, uint64_t v)
+{
+    Bump(kPerfStages + int(c), v);
+}
+
+PerfSnapshot PerfSnapshot::operator-(const PerfSnapshot& earlier) const
+{
+    PerfSnapshot d;
+    for (int i = 0; i < kPerfStages; ++i)   d.stageNs[i]  = stageNs[i]  - earlier.stageNs[i];
+    for (int i = 0; i < kPerfCounters; ++i) d.counters[i] = counters[i] - earlier.counters[i];
+    return d;
+}
+
+PerfSnapshot PerfCollect()
+{
+    PerfSnapshot s;
+    Registry& reg = GetRegistry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& b : reg.blocks) {
+        for (int i = 0; i < kPerfStages; ++i)
+            s.stageNs[i] += b->v[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < kPerfCounters; ++i)
+            s.counters[i] += b->v[kPerfStages + i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void FrameTimeStats::Push(float ms)
+{
+    m_ms[m_next] = ms;
+    m_next = (m_next + 1) % kFrames;
+    m_count = std::min(m_count + 1, kFrames);
+}
+
+float FrameTimeStats::At(int i) const
+{
+    return m_ms[(m_next - m_count + i + kFrames) % kFrames];
+}
+
+float FrameTimeStats::Percentile(float p) const
+{
+    if (m_count == 0) return 0.0f;
+    float sorted[kFrames];
+    for (int i = 0; i < m_count; ++i) sorted[i] = At(i);
+    const int k = std::clamp(int(p * (m_count - 1) + 0.5f), 0, m_count - 1);
+    std::nth_element(sorted, sorted + k, sorted + m_count);
+    return sorted[k];
+}
+
+void LatencyHistogram::Add(double ms)
+{
+    int b = 0;
+    for (double edge = 25.0; b < kBuckets - 1 && ms >= edge; edge *= 2.0) ++b;
+    ++m_counts[b];
+    ++m_total;
+}
+
+const char* LatencyHistogram::Label(int i)
+{
+    static const char* const kLabels[kBuckets] = {
+        "<25", "<50", "<100", "<200", "<400", "<800", "800+"
+    };
+    return kLabels[i];
+}
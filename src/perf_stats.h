@@ -0,0 +1,94 @@
+// src/perf_stats.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "trace.h"
+
+// Always-on counters for the performance HUD (P). Every thread adds into its
+// own cache-line-aligned block of relaxed atomics, so recording never takes
+// a lock or shares a line with another writer; PerfCollect() sums the blocks
+// once per frame on the render thread. Independent of HDRV_NO_TRACE.
+
+enum class PerfStage : int {
+    Open, Read, Decode, Color, Orient, Stats, Resize, Encode, Upload, GpuWait, Count
+};
+
+enum class PerfCounter : int {
+    Loads,              // images brought to screen
+    DecodedPixels,      // source pixels decoded on the load path
+    Thumbnails,         // grid thumbnails generated
+    ThumbnailNs,        // worker time spent on them
+    Count
+};
+
+constexpr int kPerfStages   = int(PerfStage::Count);
+constexpr int kPerfCounters = int(PerfCounter::Count);
+
+const char* PerfStageName(PerfStage s);
+
+void PerfAddStage(PerfStage s, int64_t ns);
+void PerfAdd(PerfCounter c, uint64_t v);
+
+struct PerfSnapshot {
+    uint64_t stageNs[kPerfStages]    = {};
+    uint64_t counters[kPerfCounters] = {};
+
+    double   StageMs(PerfStage s) const { return stageNs[int(s)] / 1e6; }
+    uint64_t Count(PerfCounter c) const { return counters[int(c)]; }
+    PerfSnapshot operator-(const PerfSnapshot& earlier) const;
+};
+
+// Sum of every thread's counters so far
+PerfSnapshot PerfCollect();
+
+// Adds the scope's wall time to one stage
+class PerfStageScope {
+public:
+    explicit PerfStageScope(PerfStage s) : m_stage(s), m_start(TraceNowNs()) {}
+    ~PerfStageScope() { PerfAddStage(m_stage, TraceNowNs() - m_start); }
+    PerfStageScope(const PerfStageScope&) = delete;
+    PerfStageScope& operator=(const PerfStageScope&) = delete;
+private:
+    PerfStage m_stage;
+    int64_t   m_start;
+};
+
+#define HDRV_PERF_CAT2(a, b) a##b
+#define HDRV_PERF_CAT(a, b)  HDRV_PERF_CAT2(a, b)
+// A load-path stage: counted for the HUD and traced as `name`
+#define HDRV_STAGE_SCOPE(stage, name) \
+    HDRV_TRACE_SCOPE(name);           \
+    PerfStageScope HDRV_PERF_CAT(perfStage_, __LINE__)(stage)
+
+// Last kFrames frame times, for percentiles and the HUD graph
+class FrameTimeStats {
+public:
+    static constexpr int kFrames = 240;
+
+    void   Push(float ms);
+    int    Size() const { return m_count; }
+    float  At(int i) const;                 // 0 = oldest retained
+    // p in [0,1] over the retained frames (p=1 is the max)
+    float  Percentile(float p) const;
+
+private:
+    float m_ms[kFrames] = {};
+    int   m_next  = 0;
+    int   m_count = 0;
+};
+
+// Image load latencies (input to texture ready) in doubling buckets
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 7;      // <25, <50, ... <800, >=800 ms
+
+    void        Add(double ms);
+    uint32_t    Bucket(int i) const { return m_counts[i]; }
+    uint32_t    Total() const { return m_total; }
+    static const char* Label(int i);
+
+private:
+    uint32_t m_counts[kBuckets] = {};
+    uint32_t m_total = 0;
+};
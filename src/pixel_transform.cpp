@@ -0,0 +1,289 @@
+// src/pixel_transform.cpp
+#include "pixel_transform.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_ORIENT_SSE2 1
+#endif
+
+namespace {
+
+// 64x64 pixels = 16 KB per tile: a source and a destination tile sit in L1
+constexpr int kTile = 64;
+
+// Pixels per band before another thread is worth starting
+constexpr int kMinBandPixels = 256 * 1024;
+
+// Source coordinate = M * destination coordinate, about the image centre
+struct OrientMatrix { int xx, xy, yx, yy; };
+
+constexpr OrientMatrix kMatrix[8] = {
+    {  1,  0,  0,  1 },     // Normal
+    { -1,  0,  0,  1 },     // FlipH
+    { -1,  0,  0, -1 },     // Rotate180
+    {  1,  0,  0, -1 },     // FlipV
+    {  0,  1,  1,  0 },     // Transpose
+    {  0,  1, -1,  0 },     // Rotate90
+    {  0, -1, -1,  0 },     // Transverse
+    {  0, -1,  1,  0 },     // Rotate270
+};
+
+const OrientMatrix& MatrixOf(Orientation o) { return kMatrix[int(o) - 1]; }
+
+// Mirroring on each source axis: for the transposing orientations
+// dst(x, y) = src(flipX ? w-1-y : y, flipY ? h-1-x : x), otherwise
+// dst(x, y) = src(flipX ? w-1-x : x, flipY ? h-1-y : y)
+bool FlipsX(Orientation o) { const auto& m = MatrixOf(o); return m.xx + m.xy < 0; }
+bool FlipsY(Orientation o) { const auto& m = MatrixOf(o); return m.yx + m.yy < 0; }
+
+int BandRows(int rowPixels, int rowsPerItem)
+{
+    return std::max(1, kMinBandPixels / std::max(1, rowPixels * rowsPerItem));
+}
+
+#ifdef HDRV_ORIENT_SSE2
+inline __m128i Load4(const uint32_t* p)          { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void    Store4(uint32_t* p, __m128i v)    { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline __m128i Reverse4(__m128i v)               { return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)); }
+
+inline void Transpose4(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+{
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+    r0 = _mm_unpacklo_epi64(t0, t1);
+    r1 = _mm_unpackhi_epi64(t0, t1);
+    r2 = _mm_unpacklo_epi64(t2, t3);
+    r3 = _mm_unpackhi_epi64(t2, t3);
+}
+#endif
+
+// Swap a[i] with b[n-1-i] for i < n (a == b reverses a row in place)
+void SwapReversed(uint32_t* a, uint32_t* b, int n)
+{
+    int i = 0, j = n;       // a[i..], b[..j)
+#ifdef HDRV_ORIENT_SSE2
+    if (a == b) {
+        for (; j - i >= 8; i += 4, j -= 4) {
+            const __m128i lo = Load4(a + i), hi = Load4(a + j - 4);
+            Store4(a + i, Reverse4(hi));
+            Store4(a + j - 4, Reverse4(lo));
+        }
+    } else {
+        for (; i + 4 <= n; i += 4, j -= 4) {
+            const __m128i x = Load4(a + i), y = Load4(b + j - 4);
+            Store4(a + i, Reverse4(y));
+            Store4(b + j - 4, Reverse4(x));
+        }
+    }
+#endif
+    if (a == b) {
+        for (--j; i < j; ++i, --j) std::swap(a[i], a[j]);
+    } else {
+        for (; i < n; ++i) std::swap(a[i], b[n - 1 - i]);
+    }
+}
+
+// FlipH, FlipV and Rotate180, in place
+void MirrorInPlace(uint32_t* px, int w, int h, bool flipX, bool flipY)
+{
+    if (!flipY) {
+        ParallelForBands(h, BandRows(w, 1), [&](int, int begin, int end) {
+            for (int y = begin; y < end; ++y) SwapReversed(px + size_t(y) * w, px + size_t(y) * w, w);
+        });
+        return;
+    }
+    const int pairs = h / 2;
+    ParallelForBands(pairs, BandRows(w, 2), [&](int, int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            uint32_t* a = px + size_t(y) * w;
+            uint32_t* b = px + size_t(h - 1 - y) * w;
+            if (flipX) SwapReversed(a, b, w);
+            else       std::swap_ranges(a, a + w, b);
+        }
+    });
+    // the middle row of an odd height only mirrors left-right
+    if (flipX && (h & 1)) {
+        uint32_t* mid = px + size_t(h / 2) * w;
+        SwapReversed(mid, mid, w);
+    }
+}
+
+// One dst tile of a transposing orientation, out of place. dst is
+// h wide and w tall.
+void TransposeTile(const uint32_t* src, int w, int h, uint32_t* dst, bool flipX, bool flipY,
+                   int dx0, int dx1, int dy0, int dy1)
+{
+    const int dstW = h;
+    auto srcRow = [&](int dx) { return src + size_t(flipY ? h - 1 - dx : dx) * w; };
+    auto srcCol = [&](int dy) { return flipX ? w - 1 - dy : dy; };
+
+    int dx = dx0;
+#ifdef HDRV_ORIENT_SSE2
+    for (; dx + 4 <= dx1; dx += 4) {
+        const uint32_t* r[4] = { srcRow(dx), srcRow(dx + 1), srcRow(dx + 2), srcRow(dx + 3) };
+        int dy = dy0;
+        for (; dy + 4 <= dy1; dy += 4) {
+            // four source pixels along a row become one dst column
+            const int sx = flipX ? w - 4 - dy : dy;
+            __m128i r0 = Load4(r[0] + sx), r1 = Load4(r[1] + sx), r2 = Load4(r[2] + sx), r3 = Load4(r[3] + sx);
+            if (flipX) { r0 = Reverse4(r0); r1 = Reverse4(r1); r2 = Reverse4(r2); r3 = Reverse4(r3); }
+            Transpose4(r0, r1, r2, r3);
+            uint32_t* d = dst + size_t(dy) * dstW + dx;
+            Store4(d, r0);
+            Store4(d + dstW, r1);
+            Store4(d + 2 * size_t(dstW), r2);
+            Store4(d + 3 * size_t(dstW), r3);
+        }
+        for (; dy < dy1; ++dy)
+            for (int i = 0; i < 4; ++i) dst[size_t(dy) * dstW + dx + i] = r[i][srcCol(dy)];
+    }
+#endif
+    for (; dx < dx1; ++dx) {
+        const uint32_t* row = srcRow(dx);
+        for (int dy = dy0; dy < dy1; ++dy) dst[size_t(dy) * dstW + dx] = row[srcCol(dy)];
+    }
+}
+
+void TransposeInto(const uint32_t* src, int w, int h, uint32_t* dst, bool flipX, bool flipY)
+{
+    // dst is h x w; bands of dst tile rows, each walking its row of tiles
+    const int dstW = h, dstH = w;
+    const int tileRows = (dstH + kTile - 1) / kTile;
+    ParallelForBands(tileRows, BandRows(dstW, kTile), [&](int, int begin, int end) {
+        for (int ty = begin; ty < end; ++ty) {
+            const int dy0 = ty * kTile, dy1 = std::min(dstH, dy0 + kTile);
+            for (int dx0 = 0; dx0 < dstW; dx0 += kTile)
+                TransposeTile(src, w, h, dst, flipX, flipY, dx0, std::min(dstW, dx0 + kTile), dy0, dy1);
+        }
+    });
+}
+
+// Swap-transpose the n x n square at (i, j) with the one at (j, i) of a
+// square image (or transpose it in place when i == j)
+void TransposeSquarePair(uint32_t* px, int n, int i0, int i1, int j0, int j1)
+{
+    int y = i0;
+#ifdef HDRV_ORIENT_SSE2
+    for (; y + 4 <= i1; y += 4) {
+        int x = j0;
+        if (i0 == j0) {
+            // diagonal tile: the 4x4 on the diagonal transposes in place,
+            // the ones right of it trade with those below
+            __m128i r0 = Load4(px + size_t(y) * n + y), r1 = Load4(px + size_t(y + 1) * n + y);
+            __m128i r2 = Load4(px + size_t(y + 2) * n + y), r3 = Load4(px + size_t(y + 3) * n + y);
+            Transpose4(r0, r1, r2, r3);
+            Store4(px + size_t(y) * n + y, r0);
+            Store4(px + size_t(y + 1) * n + y, r1);
+            Store4(px + size_t(y + 2) * n + y, r2);
+            Store4(px + size_t(y + 3) * n + y, r3);
+            x = y + 4;
+        }
+        for (; x + 4 <= j1; x += 4) {
+            uint32_t* a = px + size_t(y) * n + x;
+            uint32_t* b = px + size_t(x) * n + y;
+            __m128i a0 = Load4(a), a1 = Load4(a + n), a2 = Load4(a + 2 * size_t(n)), a3 = Load4(a + 3 * size_t(n));
+            __m128i b0 = Load4(b), b1 = Load4(b + n), b2 = Load4(b + 2 * size_t(n)), b3 = Load4(b + 3 * size_t(n));
+            Transpose4(a0, a1, a2, a3);
+            Transpose4(b0, b1, b2, b3);
+            Store4(b, a0); Store4(b + n, a1); Store4(b + 2 * size_t(n), a2); Store4(b + 3 * size_t(n), a3);
+            Store4(a, b0); Store4(a + n, b1); Store4(a + 2 * size_t(n), b2); Store4(a + 3 * size_t(n), b3);
+        }
+        // ragged right edge of the tile
+        for (int r = y; r < y + 4; ++r)
+            for (int c = std::max(x, r + 1); c < j1; ++c) std::swap(px[size_t(r) * n + c], px[size_t(c) * n + r]);
+    }
+#endif
+    for (; y < i1; ++y)
+        for (int x = (i0 == j0 ? y + 1 : j0); x < j1; ++x) std::swap(px[size_t(y) * n + x], px[size_t(x) * n + y]);
+}
+
+void TransposeSquareInPlace(uint32_t* px, int n)
+{
+    // tile row t swaps with every tile right of the diagonal, so rows get
+    // shorter going down; pair row k with row T-1-k to even out the bands
+    const int tiles = (n + kTile - 1) / kTile;
+    auto doRow = [&](int t) {
+        const int i0 = t * kTile, i1 = std::min(n, i0 + kTile);
+        for (int j0 = i0; j0 < n; j0 += kTile) TransposeSquarePair(px, n, i0, i1, j0, std::min(n, j0 + kTile));
+    };
+    ParallelForBands((tiles + 1) / 2, BandRows(n, 2 * kTile), [&](int, int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            doRow(k);
+            if (tiles - 1 - k != k) doRow(tiles - 1 - k);
+        }
+    });
+}
+
+} // namespace
+
+Orientation OrientationFromExif(uint32_t value)
+{
+    return value >= 1 && value <= 8 ? Orientation(value) : Orientation::Normal;
+}
+
+const char* OrientationName(Orientation o)
+{
+    static const char* const kNames[8] = {
+        "normal", "mirrored", "rotated 180", "flipped", "transposed", "rotated 90", "transversed", "rotated 270"
+    };
+    return kNames[int(o) - 1];
+}
+
+Orientation Combine(Orientation first, Orientation then)
+{
+    const OrientMatrix& a = MatrixOf(first);
+    const OrientMatrix& b = MatrixOf(then);
+    const OrientMatrix m = { a.xx * b.xx + a.xy * b.yx, a.xx * b.xy + a.xy * b.yy,
+                             a.yx * b.xx + a.yy * b.yx, a.yx * b.xy + a.yy * b.yy };
+    for (int i = 0; i < 8; ++i) {
+        const OrientMatrix& k = kMatrix[i];
+        if (k.xx == m.xx && k.xy == m.xy && k.yx == m.yx && k.yy == m.yy) return Orientation(i + 1);
+    }
+    return Orientation::Normal;
+}
+
+void OrientPixels(PixelBuffer& rgba, int& w, int& h, Orientation o)
+{
+    if (o == Orientation::Normal || w <= 0 || h <= 0) return;
+    HDRV_TRACE_SCOPE("orient");
+    uint32_t* px = reinterpret_cast<uint32_t*>(rgba.data());
+    const bool flipX = FlipsX(o), flipY = FlipsY(o);
+
+    if (!SwapsAxes(o)) {
+        MirrorInPlace(px, w, h, flipX, flipY);
+        return;
+    }
+    if (w == h) {
+        // transpose, then mirror what the transpose left over:
+        // Rotate90 = transpose + FlipH, Rotate270 = transpose + FlipV
+        TransposeSquareInPlace(px, w);
+        if (flipX || flipY) MirrorInPlace(px, w, h, flipY, flipX);
+        return;
+    }
+    PixelBuffer out(rgba.size());
+    TransposeInto(px, w, h, reinterpret_cast<uint32_t*>(out.data()), flipX, flipY);
+    rgba.swap(out);
+    std::swap(w, h);
+}
+
+void OrientPixelsNaive(const uint8_t* src, int w, int h, Orientation o, uint8_t* dst)
+{
+    const uint32_t* s = reinterpret_cast<const uint32_t*>(src);
+    uint32_t*       d = reinterpret_cast<uint32_t*>(dst);
+    const bool flipX = FlipsX(o), flipY = FlipsY(o), swap = SwapsAxes(o);
+    const int dstW = swap ? h : w, dstH = swap ? w : h;
+    for (int y = 0; y < dstH; ++y) {
+        for (int x = 0; x < dstW; ++x) {
+            int sx = swap ? y : x, sy = swap ? x : y;
+            if (flipX) sx = w - 1 - sx;
+            if (flipY) sy = h - 1 - sy;
+            d[size_t(y) * dstW + x] = s[size_t(sy) * w + sx];
+        }
+    }
+}
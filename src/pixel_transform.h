@@ -0,0 +1,42 @@
+// src/pixel_transform.h
+#pragma once
+#include <cstdint>
+
+#include "buffer_pool.h"
+
+// The eight ways to lay out an image on screen, numbered as the Exif
+// Orientation tag (0x0112) numbers them. Each names what is done to the
+// stored pixels to display them upright.
+enum class Orientation : uint8_t {
+    Normal = 1,
+    FlipH,          // mirror left-right
+    Rotate180,
+    FlipV,          // mirror top-bottom
+    Transpose,      // mirror across the main diagonal
+    Rotate90,       // clockwise
+    Transverse,     // mirror across the anti-diagonal
+    Rotate270,      // clockwise, i.e. 90 counter-clockwise
+};
+
+// Orientation for a raw Exif value; anything out of range is Normal
+Orientation OrientationFromExif(uint32_t value);
+
+const char* OrientationName(Orientation o);
+
+// Width and height trade places
+inline bool SwapsAxes(Orientation o) { return uint8_t(o) >= uint8_t(Orientation::Transpose); }
+
+// `first`, then `then` applied to its result, as one orientation
+Orientation Combine(Orientation first, Orientation then);
+
+// Reorient w*h RGBA8 pixels and update w/h. Flips and 180 degrees swap
+// pixels in place, as do the transposing orientations on square images
+// (a blocked in-place transpose plus a flip); other shapes go through one
+// pooled buffer of the same size. Work is cut into 64x64-pixel tiles
+// moved as SSE2 4x4 transposes, so every cache line read or written is
+// used whole, with tile rows split across all cores.
+void OrientPixels(PixelBuffer& rgba, int& w, int& h, Orientation o);
+
+// Straight per-pixel loop from `src` into a separate `dst`; the reference
+// OrientPixels is checked and timed against under HDRV_DECODE_VERIFY
+void OrientPixelsNaive(const uint8_t* src, int w, int h, Orientation o, uint8_t* dst);
@@ -0,0 +1,322 @@
+// src/png_fast.cpp
+#include "png_fast.h"
+#include "inflate.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define HDRV_PNG_SSE2 1
+#endif
+
+namespace {
+
+const uint8_t kSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+constexpr uint32_t kMaxDim = 1u << 24;      // same limit as stb_image
+
+inline uint32_t ReadBE32(const uint8_t* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+inline uint32_t ChunkType(const char* s)
+{
+    return ReadBE32(reinterpret_cast<const uint8_t*>(s));
+}
+
+inline int Paeth(int a, int b, int c)
+{
+    const int p  = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// Reference kernels, any bpp. `prev` is the unfiltered row above (all zero
+// for the first row, which is what the PNG spec's first-row rules reduce to).
+bool UnfilterScalar(int filter, uint8_t* cur, const uint8_t* prev, size_t n, int bpp)
+{
+    switch (filter) {
+    case 0:
+        return true;
+    case 1:
+        for (size_t i = size_t(bpp); i < n; ++i) cur[i] = uint8_t(cur[i] + cur[i - bpp]);
+        return true;
+    case 2:
+        for (size_t i = 0; i < n; ++i) cur[i] = uint8_t(cur[i] + prev[i]);
+        return true;
+    case 3:
+        for (size_t i = 0; i < size_t(bpp); ++i) cur[i] = uint8_t(cur[i] + (prev[i] >> 1));
+        for (size_t i = size_t(bpp); i < n; ++i)
+            cur[i] = uint8_t(cur[i] + ((cur[i - bpp] + prev[i]) >> 1));
+        return true;
+    case 4:
+        for (size_t i = 0; i < size_t(bpp); ++i) cur[i] = uint8_t(cur[i] + prev[i]);
+        for (size_t i = size_t(bpp); i < n; ++i)
+            cur[i] = uint8_t(cur[i] + Paeth(cur[i - bpp], prev[i], prev[i - bpp]));
+        return true;
+    default:
+        return false;
+    }
+}
+
+#ifdef HDRV_PNG_SSE2
+// Sub/Avg/Paeth depend on the pixel to the left, so these work one pixel at
+// a time with the 3 or 4 channels side by side in a register (as libpng's
+// SSE2 filters do). Up has no dependency and goes 16 bytes at a time.
+// 3-byte pixels are assembled in registers: a 3-byte memcpy goes through the
+// stack and the 4-byte reload misses store forwarding on every pixel.
+template <int BPP>
+inline __m128i LoadPx(const uint8_t* p)
+{
+    if constexpr (BPP == 4) {
+        int v;
+        std::memcpy(&v, p, 4);
+        return _mm_cvtsi32_si128(v);
+    } else {
+        return _mm_cvtsi32_si128(int(p[0] | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16)));
+    }
+}
+
+template <int BPP>
+inline void StorePx(uint8_t* p, __m128i v)
+{
+    const int x = _mm_cvtsi128_si32(v);
+    if constexpr (BPP == 4) {
+        std::memcpy(p, &x, 4);
+    } else {
+        p[0] = uint8_t(x);
+        p[1] = uint8_t(x >> 8);
+        p[2] = uint8_t(x >> 16);
+    }
+}
+
+inline __m128i Abs16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void UpSse2(uint8_t* cur, const uint8_t* prev, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(cur + i), _mm_add_epi8(x, b));
+    }
+    for (; i < n; ++i) cur[i] = uint8_t(cur[i] + prev[i]);
+}
+
+template <int BPP>
+void SubSse2(uint8_t* cur, size_t n)
+{
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i < n; i += BPP) {
+        a = _mm_add_epi8(a, LoadPx<BPP>(cur + i));
+        StorePx<BPP>(cur + i, a);
+    }
+}
+
+template <int BPP>
+void AvgSse2(uint8_t* cur, const uint8_t* prev, size_t n)
+{
+    // (a + b) >> 1 without widening: pavgb rounds up, so take the carry back off
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (size_t i = 0; i < n; i += BPP) {
+        const __m128i b   = LoadPx<BPP>(prev + i);
+        const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+                                         _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(avg, LoadPx<BPP>(cur + i));
+        StorePx<BPP>(cur + i, a);
+    }
+}
+
+template <int BPP>
+void PaethSse2(uint8_t* cur, const uint8_t* prev, size_t n)
+{
+    // 16-bit lanes so the predictor distances can go negative.
+    //   pa = |p - a| = |b - c|,  pb = |p - b| = |a - c|,  pc = |p - c| = |pa + pb| (signed)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero, c = zero;
+    for (size_t i = 0; i < n; i += BPP) {
+        const __m128i b = _mm_unpacklo_epi8(LoadPx<BPP>(prev + i), zero);
+        const __m128i x = _mm_unpacklo_epi8(LoadPx<BPP>(cur + i), zero);
+
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = Abs16(_mm_add_epi16(pa, pb));
+        pa = Abs16(pa);
+        pb = Abs16(pb);
+
+        const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        const __m128i nearest  = Select(_mm_cmpeq_epi16(smallest, pa), a,
+                                 Select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+        // byte add wraps mod 256 in the low half; the high halves are zero
+        a = _mm_add_epi8(x, nearest);
+        StorePx<BPP>(cur + i, _mm_packus_epi16(a, a));
+        c = b;
+    }
+}
+
+template <int BPP>
+bool UnfilterSse2(int filter, uint8_t* cur, const uint8_t* prev, size_t n)
+{
+    switch (filter) {
+    case 0: return true;
+    case 1: SubSse2<BPP>(cur, n);         return true;
+    case 2: UpSse2(cur, prev, n);         return true;
+    case 3: AvgSse2<BPP>(cur, prev, n);   return true;
+    case 4: PaethSse2<BPP>(cur, prev, n); return true;
+    default: return false;
+    }
+}
+#endif
+
+bool Unfilter(int filter, uint8_t* cur, const uint8_t* prev, size_t n, int bpp)
+{
+#ifdef HDRV_PNG_SSE2
+    if (bpp == 4) return UnfilterSse2<4>(filter, cur, prev, n);
+    if (bpp == 3) return UnfilterSse2<3>(filter, cur, prev, n);
+    if (filter == 2) { UpSse2(cur, prev, n); return true; }
+#endif
+    return UnfilterScalar(filter, cur, prev, n, bpp);
+}
+
+// One unfiltered scanline -> RGBA8, using stb_image's channel expansion
+void ExpandRow(const uint8_t* src, uint8_t* dst, int w, int bpp)
+{
+    switch (bpp) {
+    case 4:
+        std::memcpy(dst, src, size_t(w) * 4);
+        break;
+    case 3:
+        for (int x = 0; x < w; ++x, src += 3, dst += 4) {
+            dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = 255;
+        }
+        break;
+    case 2:
+        for (int x = 0; x < w; ++x, src += 2, dst += 4) {
+            dst[0] = dst[1] = dst[2] = src[0]; dst[3] = src[1];
+        }
+        break;
+    default:
+        for (int x = 0; x < w; ++x, ++src, dst += 4) {
+            dst[0] = dst[1] = dst[2] = src[0]; dst[3] = 255;
+        }
+        break;
+    }
+}
+
+} // namespace
+
+bool IsPng(const uint8_t* data, size_t len)
+{
+    return len >= 8 && std::memcmp(data, kSignature, 8) == 0;
+}
+
+bool DecodePngFast(const uint8_t* data, size_t len, PixelBuffer& rgba, int& outW, int& outH)
+{
+    if (!IsPng(data, len)) return false;
+
+    uint32_t w = 0, h = 0;
+    int bpp = 0;
+    bool sawHeader = false;
+    const uint8_t* firstIdat = nullptr;
+    size_t idatBytes = 0, idatChunks = 0;
+
+    // Chunk walk. Anything stb_image would treat specially (palettes, tRNS,
+    // Apple's CgBI) or reject (unknown critical chunks) sends us back to stb.
+    size_t pos = 8;
+    for (;;) {
+        if (len - pos < 12) return false;
+        const uint32_t clen = ReadBE32(data + pos);
+        const uint32_t type = ReadBE32(data + pos + 4);
+        if (clen > len - pos - 12) return false;
+        const uint8_t* body = data + pos + 8;
+
+        if (!sawHeader && type != ChunkType("IHDR")) return false;
+
+        if (type == ChunkType("IHDR")) {
+            if (sawHeader || clen != 13) return false;
+            sawHeader = true;
+            w = ReadBE32(body);
+            h = ReadBE32(body + 4);
+            const int depth = body[8], color = body[9];
+            if (depth != 8 || body[10] != 0 || body[11] != 0 || body[12] != 0) return false;
+            switch (color) {
+            case 0: bpp = 1; break;
+            case 2: bpp = 3; break;
+            case 4: bpp = 2; break;
+            case 6: bpp = 4; break;
+            default: return false;
+            }
+            if (w == 0 || h == 0 || w > kMaxDim || h > kMaxDim) return false;
+        } else if (type == ChunkType("IDAT")) {
+            if (!firstIdat) firstIdat = body;
+            idatBytes += clen;
+            ++idatChunks;
+        } else if (type == ChunkType("IEND")) {
+            break;
+        } else if (type == ChunkType("tRNS") || type == ChunkType("PLTE") || type == ChunkType("CgBI")) {
+            return false;
+        } else if (!(type & 0x20000000u)) {
+            return false;                   // unknown critical chunk
+        }
+        pos += size_t(clen) + 12;
+    }
+    if (!idatChunks) return false;
+
+    // Gather the zlib stream. A single IDAT is used in place; the usual 8-64 KB
+    // chunking needs one copy with the chunk headers stripped.
+    PixelBuffer joined;
+    const uint8_t* zdata = firstIdat;
+    if (idatChunks > 1) {
+        joined.resize(idatBytes);
+        size_t off = 0;
+        for (size_t p = 8; off < idatBytes; ) {
+            const uint32_t clen = ReadBE32(data + p);
+            if (ReadBE32(data + p + 4) == ChunkType("IDAT")) {
+                std::memcpy(joined.data() + off, data + p + 8, clen);
+                off += clen;
+            }
+            p += size_t(clen) + 12;
+        }
+        zdata = joined.data();
+    }
+
+    const size_t stride = size_t(w) * size_t(bpp);
+    const size_t rawLen = size_t(h) * (stride + 1);
+    PixelBuffer raw(rawLen);
+    if (!InflateZlib(zdata, idatBytes, raw.data(), rawLen)) return false;
+    PixelBuffer().swap(joined);
+
+    // Unfilter and expand row by row so each scanline is converted while it
+    // is still in L1. The first row filters against a zeroed "row -1".
+    PixelBuffer out(size_t(w) * size_t(h) * 4);
+    std::vector<uint8_t> zeroRow(stride, 0);
+    const uint8_t* prev = zeroRow.data();
+    for (uint32_t y = 0; y < h; ++y) {
+        uint8_t* line = raw.data() + size_t(y) * (stride + 1);
+        uint8_t* cur  = line + 1;
+        if (!Unfilter(line[0], cur, prev, stride, bpp)) return false;
+        ExpandRow(cur, out.data() + size_t(y) * size_t(w) * 4, int(w), bpp);
+        prev = cur;
+    }
+
+    rgba.swap(out);
+    outW = int(w);
+    outH = int(h);
+    return true;
+}
@@ -0,0 +1,18 @@
+// src/png_fast.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "buffer_pool.h"
+
+bool IsPng(const uint8_t* data, size_t len);
+
+// Accelerated PNG decode for the common case: 8-bit, non-interlaced gray,
+// gray+alpha, RGB or RGBA without tRNS. Chunk parsing mirrors stb_image;
+// inflate goes straight into an exactly-sized buffer and the Sub/Up/Avg/
+// Paeth unfilters run as SSE2 kernels. Output matches stbi_load_from_memory
+// with 4 requested channels bit for bit.
+// Returns false for anything else (palette, 16-bit, interlaced, tRNS, CgBI,
+// corrupt data) without touching the outputs, so the caller can hand the
+// file to stb_image for the canonical result or error message.
+bool DecodePngFast(const uint8_t* data, size_t len, PixelBuffer& rgba, int& w, int& h);
@@ -0,0 +1,393 @@
+// src/raw_preview.cpp
+#include "raw_preview.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int      kMaxIfds        = 32;                    // per TIFF walk, guards against loops
+constexpr uint64_t kMaxPreviewBytes = 256ull * 1024 * 1024;
+
+// Random access to the container: a file through seeks and small reads,
+// or a buffer already in memory
+class Source {
+public:
+    Source(const uint8_t* data, size_t len) : m_data(data), m_size(len) {}
+    explicit Source(FILE* f) : m_file(f)
+    {
+        if (_fseeki64(f, 0, SEEK_END) == 0) m_size = uint64_t(std::max<int64_t>(0, _ftelli64(f)));
+    }
+
+    uint64_t Size() const      { return m_size; }
+    uint64_t BytesRead() const { return m_read; }
+
+    bool Read(uint64_t off, void* dst, size_t n)
+    {
+        if (off > m_size || n > m_size - off) return false;
+        m_read += n;
+        if (m_data) {
+            std::memcpy(dst, m_data + off, n);
+            return true;
+        }
+        return _fseeki64(m_file, int64_t(off), SEEK_SET) == 0 && fread(dst, 1, n, m_file) == n;
+    }
+
+private:
+    const uint8_t* m_data = nullptr;
+    FILE*          m_file = nullptr;
+    uint64_t       m_size = 0;
+    uint64_t       m_read = 0;
+};
+
+inline uint32_t BE16(const uint8_t* p) { return uint32_t((p[0] << 8) | p[1]); }
+inline uint32_t BE32(const uint8_t* p) { return (BE16(p) << 16) | BE16(p + 2); }
+inline uint64_t BE64(const uint8_t* p) { return (uint64_t(BE32(p)) << 32) | BE32(p + 4); }
+
+struct Candidate { uint64_t offset, size; };
+
+// Frame size of the JPEG at `c`, walking its markers up to the first SOF.
+// Only what stb decodes counts: baseline, extended and progressive
+// Huffman frames; lossless sensor data fails here.
+bool ProbeJpeg(Source& src, const Candidate& c, int& w, int& h)
+{
+    uint8_t b[9];
+    if (c.size < 4 || !src.Read(c.offset, b, 2) || b[0] != 0xFF || b[1] != 0xD8) return false;
+    uint64_t pos = c.offset + 2;
+    const uint64_t end = c.offset + c.size;
+    while (pos + 4 <= end) {
+        if (!src.Read(pos, b, 4) || b[0] != 0xFF) return false;
+        const int m = b[1];
+        if (m == 0xFF) { ++pos; continue; }     // fill byte
+        const uint32_t segLen = BE16(b + 2);
+        if (segLen < 2 || m == 0xDA || m == 0xD9) return false;
+        if (m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) {
+            if (m > 0xC2 || !src.Read(pos + 4, b, 5)) return false;
+            h = int(BE16(b + 1));
+            w = int(BE16(b + 3));
+            return w > 0 && h > 0;
+        }
+        pos += 2 + segLen;
+    }
+    return false;
+}
+
+// ---- TIFF: IFD0 and its chain, plus SubIFDs ----
+
+struct TiffWalk {
+    Source&  src;
+    uint64_t base;                  // offsets in the structure count from here
+    bool     le = true;
+
+    uint32_t U16(const uint8_t* p) const { return le ? uint32_t(p[0] | (p[1] << 8)) : BE16(p); }
+    uint32_t U32(const uint8_t* p) const { return le ? U16(p) | (U16(p + 2) << 16) : (U16(p) << 16) | U16(p + 2); }
+
+    bool Header(uint32_t& ifd0)
+    {
+        uint8_t h[8];
+        if (!src.Read(base, h, 8)) return false;
+        if (h[0] == 'I' && h[1] == 'I')      le = true;
+        else if (h[0] == 'M' && h[1] == 'M') le = false;
+        else return false;
+        const uint32_t magic = U16(h + 2);
+        // 42, or ORF's "RO"/"RS" and RW2's 0x55
+        if (magic != 42 && magic != 0x4F52 && magic != 0x5352 && magic != 0x55) return false;
+        ifd0 = U32(h + 4);
+        return true;
+    }
+
+    // First `max` SHORT/LONG values of the entry at `e`
+    int Values(const uint8_t* e, uint32_t* out, int max)
+    {
+        const uint32_t type = U16(e + 2), count = U32(e + 4);
+        const size_t unit = type == 3 ? 2 : type == 4 || type == 13 ? 4 : 0;
+        if (unit == 0 || count == 0) return 0;
+        const int n = int(std::min<uint32_t>(count, uint32_t(max)));
+        uint8_t buf[64];
+        const uint8_t* p = e + 8;
+        if (unit * count > 4) {
+            if (!src.Read(base + U32(e + 8), buf, unit * n)) return 0;
+            p = buf;
+        }
+        for (int i = 0; i < n; ++i) out[i] = unit == 2 ? U16(p + i * 2) : U32(p + i * 4);
+        return n;
+    }
+
+    // Preview candidates of every IFD reachable from IFD0, and IFD0's
+    // orientation. `found` may be null to read only the orientation.
+    void Walk(uint32_t ifd0, std::vector<Candidate>* found, uint32_t& orientation)
+    {
+        // the IFD0 chain is followed (IFD1 holds the thumbnail); SubIFD chains are not
+        struct Item { uint32_t ifd; bool chain; };
+        std::vector<Item> queue{ { ifd0, true } };
+        std::vector<uint32_t> seen;
+        for (size_t q = 0; q < queue.size() && int(seen.size()) < kMaxIfds; ++q) {
+            const uint32_t ifd = queue[q].ifd;
+            if (ifd == 0 || std::find(seen.begin(), seen.end(), ifd) != seen.end()) continue;
+            seen.push_back(ifd);
+            uint8_t cnt[2];
+            if (!src.Read(base + ifd, cnt, 2)) continue;
+            const uint32_t n = U16(cnt);
+            if (n == 0 || n > 1000) continue;
+            std::vector<uint8_t> entries(size_t(n) * 12 + 4);
+            if (!src.Read(base + ifd + 2, entries.data(), entries.size())) continue;
+
+            uint32_t jpegOff = 0, jpegLen = 0, strips = 0, stripOff = 0, stripLen = 0;
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint8_t* e = entries.data() + size_t(i) * 12;
+                uint32_t v[16];
+                switch (U16(e)) {
+                case 0x0112:    // Orientation
+                    if (q == 0 && Values(e, v, 1) == 1 && v[0] >= 1 && v[0] <= 8) orientation = v[0];
+                    break;
+                case 0x0201: if (Values(e, v, 1) == 1) jpegOff = v[0]; break;
+                case 0x0202: if (Values(e, v, 1) == 1) jpegLen = v[0]; break;
+                case 0x0111: strips = U32(e + 4); if (Values(e, v, 1) == 1) stripOff = v[0]; break;
+                case 0x0117: if (Values(e, v, 1) == 1) stripLen = v[0]; break;
+                case 0x014A: {  // SubIFDs
+                    const int k = Values(e, v, 16);
+                    for (int j = 0; j < k; ++j) queue.push_back({ v[j], false });
+                    break;
+                }
+                case 0x002E:    // RW2 JpgFromRaw: a whole JPEG as UNDEFINED bytes
+                    if (found && U16(e + 2) == 7 && U32(e + 4) > 4)
+                        found->push_back({ base + U32(e + 8), U32(e + 4) });
+                    break;
+                }
+            }
+            if (found && jpegOff && jpegLen) found->push_back({ base + jpegOff, jpegLen });
+            if (found && strips == 1 && stripOff && stripLen) found->push_back({ base + stripOff, stripLen });
+            if (queue[q].chain) queue.push_back({ U32(entries.data() + size_t(n) * 12), true });
+        }
+    }
+};
+
+bool WalkTiff(Source& src, std::vector<Candidate>& found, uint32_t& orientation)
+{
+    TiffWalk t{ src, 0 };
+    uint32_t ifd0 = 0;
+    if (!t.Header(ifd0)) return false;
+    t.Walk(ifd0, &found, orientation);
+    return true;
+}
+
+// ---- CR3: ISO-BMFF boxes ----
+
+const uint8_t kCanonUuid[16] = { 0x85, 0xC0, 0xB6, 0x87, 0x82, 0x0F, 0x11, 0xE0,
+                                 0x81, 0x11, 0xF4, 0xCE, 0x46, 0x2B, 0x6A, 0x48 };
+const uint8_t kPreviewUuid[16] = { 0xEA, 0xF4, 0x2B, 0x5E, 0x1C, 0xEB, 0x4B, 0x88,
+                                   0xB9, 0xFB, 0xB7, 0xDC, 0x40, 0x6E, 0x4D, 0x16 };
+
+struct Box {
+    char     type[5] = {};
+    uint64_t start = 0, payload = 0, end = 0;
+};
+
+bool ReadBox(Source& src, uint64_t pos, uint64_t limit, Box& b)
+{
+    uint8_t h[16];
+    if (pos > limit || limit - pos < 8 || !src.Read(pos, h, 8)) return false;
+    uint64_t size = BE32(h);
+    std::memcpy(b.type, h + 4, 4);
+    b.start   = pos;
+    b.payload = pos + 8;
+    if (size == 1) {
+        if (!src.Read(pos + 8, h + 8, 8)) return false;
+        size = BE64(h + 8);
+        b.payload += 8;
+    } else if (size == 0) {
+        size = limit - pos;
+    }
+    // a 64-bit largesize can be anything; compare before adding so pos + size
+    // cannot wrap around to a small end
+    if (size > limit - pos || size < b.payload - pos) return false;
+    b.end = pos + size;
+    return b.end > pos;
+}
+
+// The JPEG inside a THMB or PRVW box starts after a small fixed header
+// and runs to the end of the box
+void BoxJpeg(Source& src, const Box& b, std::vector<Candidate>& found)
+{
+    uint8_t p[48];
+    const size_t n = size_t(std::min<uint64_t>(sizeof(p), b.end - b.payload));
+    if (!src.Read(b.payload, p, n)) return;
+    for (size_t i = 0; i + 3 <= n; ++i) {
+        if (p[i] == 0xFF && p[i + 1] == 0xD8 && p[i + 2] == 0xFF) {
+            found.push_back({ b.payload + i, b.end - b.payload - i });
+            return;
+        }
+    }
+}
+
+// First sample of a track: the full-size JPEG lives in trak 1; the raw
+// tracks are not JPEG and drop out in ProbeJpeg
+void TrackSample(Source& src, const Box& trak, std::vector<Candidate>& found)
+{
+    uint64_t offset = 0, size = 0;
+    const char* path[] = { "mdia", "minf", "stbl" };
+    Box cur = trak;
+    for (const char* name : path) {
+        Box child;
+        bool hit = false;
+        for (uint64_t pos = cur.payload; ReadBox(src, pos, cur.end, child); pos = child.end) {
+            if (std::memcmp(child.type, name, 4) == 0) { hit = true; break; }
+        }
+        if (!hit) return;
+        cur = child;
+    }
+    Box child;
+    uint8_t v[16];
+    for (uint64_t pos = cur.payload; ReadBox(src, pos, cur.end, child); pos = child.end) {
+        if (std::memcmp(child.type, "stsz", 4) == 0 && src.Read(child.payload, v, 12)) {
+            size = BE32(v + 4);     // one size for every sample, else a table follows
+            if (size == 0 && BE32(v + 8) && src.Read(child.payload + 12, v, 4)) size = BE32(v);
+        } else if (std::memcmp(child.type, "co64", 4) == 0 && src.Read(child.payload, v, 16))
+            offset = BE64(v + 8);
+        else if (std::memcmp(child.type, "stco", 4) == 0 && src.Read(child.payload, v, 12))
+            offset = BE32(v + 8);
+    }
+    if (offset && size) found.push_back({ offset, size });
+}
+
+bool WalkCr3(Source& src, std::vector<Candidate>& found, uint32_t& orientation)
+{
+    const uint64_t fileEnd = src.Size();
+    Box top;
+    for (uint64_t pos = 0; ReadBox(src, pos, fileEnd, top); pos = top.end) {
+        if (std::memcmp(top.type, "moov", 4) == 0) {
+            Box b;
+            for (uint64_t p = top.payload; ReadBox(src, p, top.end, b); p = b.end) {
+                uint8_t uuid[16];
+                if (std::memcmp(b.type, "trak", 4) == 0) {
+                    TrackSample(src, b, found);
+                } else if (std::memcmp(b.type, "uuid", 4) == 0 && src.Read(b.payload, uuid, 16) &&
+                           std::memcmp(uuid, kCanonUuid, 16) == 0) {
+                    Box c;
+                    for (uint64_t cp = b.payload + 16; ReadBox(src, cp, b.end, c); cp = c.end) {
+                        if (std::memcmp(c.type, "THMB", 4) == 0) {
+                            BoxJpeg(src, c, found);
+                        } else if (std::memcmp(c.type, "CMT1", 4) == 0) {
+                            TiffWalk t{ src, c.payload };
+                            uint32_t ifd0 = 0;
+                            if (t.Header(ifd0)) t.Walk(ifd0, nullptr, orientation);
+                        }
+                    }
+                }
+            }
+        } else if (std::memcmp(top.type, "uuid", 4) == 0) {
+            uint8_t uuid[16];
+            if (!src.Read(top.payload, uuid, 16) || std::memcmp(uuid, kPreviewUuid, 16) != 0) continue;
+            // 8 bytes of Canon header, then the PRVW box
+            Box c;
+            for (uint64_t cp = top.payload + 24; ReadBox(src, cp, top.end, c); cp = c.end)
+                if (std::memcmp(c.type, "PRVW", 4) == 0) BoxJpeg(src, c, found);
+        }
+    }
+    return true;
+}
+
+// ---- RAF: fixed header with the JPEG's offset and length ----
+
+bool WalkRaf(Source& src, std::vector<Candidate>& found)
+{
+    uint8_t h[92];
+    if (!src.Read(0, h, sizeof(h))) return false;
+    const uint32_t off = BE32(h + 84), len = BE32(h + 88);
+    if (off && len) found.push_back({ off, len });
+    return true;
+}
+
+bool FindPreview(Source& src, int minSize, RawPreview& out)
+{
+    HDRV_TRACE_SCOPE("raw preview find");
+    uint8_t head[16] = {};
+    if (!src.Read(0, head, std::min<uint64_t>(sizeof(head), src.Size()))) return false;
+    std::vector<Candidate> found;
+    uint32_t orientation = 0;
+    if (std::memcmp(head, "FUJIFILMCCD-RAW", 15) == 0) {
+        out.container = "RAF";
+        WalkRaf(src, found);
+    } else if (std::memcmp(head + 4, "ftypcrx ", 8) == 0) {
+        out.container = "CR3";
+        WalkCr3(src, found, orientation);
+    } else {
+        out.container = "TIFF";
+        if (!WalkTiff(src, found, orientation)) return false;
+    }
+
+    // several IFDs may point at the same JPEG
+    std::sort(found.begin(), found.end(), [](const Candidate& a, const Candidate& b) {
+        return a.offset < b.offset;
+    });
+    found.erase(std::unique(found.begin(), found.end(), [](const Candidate& a, const Candidate& b) {
+        return a.offset == b.offset;
+    }), found.end());
+
+    int bestW = 0, bestH = 0;
+    const Candidate* best = nullptr;
+    out.candidates = 0;
+    for (const Candidate& c : found) {
+        int w = 0, h = 0;
+        if (c.size > kMaxPreviewBytes || !ProbeJpeg(src, c, w, h)) continue;
+        ++out.candidates;
+        if (!best) { best = &c; bestW = w; bestH = h; continue; }
+        const int64_t area = int64_t(w) * h, bestArea = int64_t(bestW) * bestH;
+        const bool fits = minSize > 0 && std::max(w, h) >= minSize;
+        const bool bestFits = minSize > 0 && std::max(bestW, bestH) >= minSize;
+        // smallest that reaches minSize, else the largest
+        const bool better = fits ? (!bestFits || area < bestArea) : (!bestFits && area > bestArea);
+        if (better) { best = &c; bestW = w; bestH = h; }
+    }
+    if (!best) return false;
+    out.offset      = best->offset;
+    out.size        = std::min(best->size, src.Size() - best->offset);
+    out.w           = bestW;
+    out.h           = bestH;
+    out.orientation = orientation;
+    out.bytesRead   = src.BytesRead();
+    return true;
+}
+
+} // namespace
+
+bool IsRawFile(const uint8_t* head, size_t len)
+{
+    if (len >= 15 && std::memcmp(head, "FUJIFILMCCD-RAW", 15) == 0) return true;
+    if (len >= 12 && std::memcmp(head + 4, "ftypcrx ", 8) == 0) return true;
+    if (len < 8) return false;
+    const bool le = head[0] == 'I' && head[1] == 'I', be = head[0] == 'M' && head[1] == 'M';
+    if (!le && !be) return false;
+    const uint32_t magic = le ? uint32_t(head[2] | (head[3] << 8)) : BE16(head + 2);
+    return magic == 42 || magic == 0x4F52 || magic == 0x5352 || magic == 0x55;
+}
+
+bool FindRawPreview(const uint8_t* data, size_t len, int minSize, RawPreview& out)
+{
+    Source src(data, len);
+    return FindPreview(src, minSize, out);
+}
+
+bool ReadRawPreview(const std::wstring& path, int minSize, PixelBuffer& jpeg, RawPreview& out, std::wstring& err)
+{
+    HDRV_TRACE_SCOPE("raw preview read");
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file) {
+        err = L"Failed to open RAW file";
+        return false;
+    }
+    Source src(file);
+    bool ok = FindPreview(src, minSize, out);
+    if (!ok) {
+        err = L"No embedded JPEG preview in this RAW file";
+    } else {
+        jpeg.resize(size_t(out.size));
+        ok = src.Read(out.offset, jpeg.data(), jpeg.size());
+        if (!ok) err = L"Failed to read the RAW file's preview";
+    }
+    fclose(file);
+    return ok;
+}
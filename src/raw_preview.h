@@ -0,0 +1,34 @@
+// src/raw_preview.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "buffer_pool.h"
+
+// Camera RAW files carry JPEG previews rendered by the camera: TIFF-based
+// ones (CR2, NEF, ARW, DNG, ORF, RW2, PEF, SRW) in their IFDs and SubIFDs,
+// Canon CR3 in ISO-BMFF boxes and tracks, Fujifilm RAF behind a fixed
+// header. These walk the container's directories only, so showing a RAW
+// file costs a few small reads plus one JPEG, with no demosaic.
+
+// Container magic: TIFF (including the ORF and RW2 variants), CR3 or RAF
+bool IsRawFile(const uint8_t* head, size_t len);
+
+struct RawPreview {
+    uint64_t    offset = 0, size = 0;   // JPEG byte range in the file
+    int         w = 0, h = 0;           // from the JPEG's frame header
+    uint32_t    orientation = 0;        // Exif-style 1-8 from the container; 0 when it has none
+    const char* container = "";         // "TIFF", "CR3" or "RAF"
+    int         candidates = 0;         // decodable JPEGs found
+    uint64_t    bytesRead = 0;          // container structure and JPEG headers
+};
+
+// Pick the smallest preview whose long side reaches `minSize`, or the
+// largest when none does (or minSize <= 0). Lossless JPEG sensor data
+// (CR2, DNG) is never picked.
+bool FindRawPreview(const uint8_t* data, size_t len, int minSize, RawPreview& out);
+
+// Same from the file at `path` through seeks and small reads; `jpeg`
+// receives only the chosen preview's bytes
+bool ReadRawPreview(const std::wstring& path, int minSize, PixelBuffer& jpeg, RawPreview& out, std::wstring& err);
@@ -0,0 +1,129 @@
+// src/stream_decode.cpp
+#include "stream_decode.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <cstring>
+
+#include "stb_image_resize2.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+// Source rows for stbir, decoded a strip at a time. stbir's downsampler
+// walks input rows in order, so each strip is decoded exactly once.
+struct StripSource {
+    IWICBitmapSource*    src = nullptr;
+    int                  w = 0, h = 0;
+    int                  stripRows = 0;
+    int                  y0 = -1, rows = 0;    // rows currently held
+    PixelBuffer          strip;
+    HRESULT              hr = S_OK;
+};
+
+const void* InputRows(void* /*optional_output*/, const void* /*input_ptr*/,
+                      int /*num_pixels*/, int x, int y, void* context)
+{
+    auto* s = static_cast<StripSource*>(context);
+    if (y < s->y0 || y >= s->y0 + s->rows) {
+        s->y0   = (y / s->stripRows) * s->stripRows;
+        s->rows = std::min(s->stripRows, s->h - s->y0);
+        WICRect rc{ 0, s->y0, s->w, s->rows };
+        const UINT stride = UINT(s->w) * 4;
+        HRESULT hr = s->src->CopyPixels(&rc, stride, stride * UINT(s->rows), s->strip.data());
+        if (FAILED(hr)) {
+            // keep going with black rows; the caller reports the failure
+            if (SUCCEEDED(s->hr)) s->hr = hr;
+            std::memset(s->strip.data(), 0, size_t(stride) * size_t(s->rows));
+        }
+    }
+    return s->strip.data() + (size_t(y - s->y0) * size_t(s->w) + size_t(x)) * 4;
+}
+
+} // namespace
+
+bool StreamDecodeResized(const std::wstring& path, int dstW, int dstH,
+                         PixelBuffer& out, std::wstring& err)
+{
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    const bool didInitCOM = SUCCEEDED(hr);
+    struct ComScope { bool on; ~ComScope() { if (on) CoUninitialize(); } } comScope{ didInitCOM };
+
+    ComPtr<IWICImagingFactory> factory;
+    ComPtr<IWICBitmapDecoder> decoder;
+    ComPtr<IWICBitmapFrameDecode> frame;
+    ComPtr<IWICBitmapScaler> scaler;
+    ComPtr<IWICFormatConverter> rgba;
+
+    hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+    if (SUCCEEDED(hr))
+        hr = factory->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ,
+                                                WICDecodeMetadataCacheOnDemand, &decoder);
+    if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, &frame);
+
+    // Shrink by 1/2, 1/4 or 1/8 inside WIC first when the target allows it:
+    // the scaler hands that to codecs with native scaled decode (JPEG does
+    // it in the DCT domain), so thumbnails skip most of the full decode.
+    // stbir then does the exact, filtered resize from there.
+    IWICBitmapSource* source = frame.Get();
+    UINT fw = 0, fh = 0;
+    if (SUCCEEDED(hr)) hr = frame->GetSize(&fw, &fh);
+    int shift = 0;
+    while (shift < 3 && int(fw >> (shift + 1)) >= dstW && int(fh >> (shift + 1)) >= dstH) ++shift;
+    if (SUCCEEDED(hr) && shift > 0) {
+        hr = factory->CreateBitmapScaler(&scaler);
+        if (SUCCEEDED(hr))
+            hr = scaler->Initialize(frame.Get(), fw >> shift, fh >> shift, WICBitmapInterpolationModeFant);
+        source = scaler.Get();
+    }
+
+    if (SUCCEEDED(hr)) hr = factory->CreateFormatConverter(&rgba);
+    if (SUCCEEDED(hr))
+        hr = rgba->Initialize(source, GUID_WICPixelFormat32bppRGBA,
+                              WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+    UINT w = 0, h = 0;
+    if (SUCCEEDED(hr)) hr = rgba->GetSize(&w, &h);
+    if (FAILED(hr)) {
+        wchar_t buf[96];
+        swprintf_s(buf, L"Streaming decode failed: 0x%08X", hr);
+        err = buf;
+        return false;
+    }
+
+    StripSource src;
+    src.src = rgba.Get();
+    src.w   = int(w);
+    src.h   = int(h);
+    // ~16 MB strips: few enough WIC calls, small next to the output
+    src.stripRows = std::max(16, int((16u << 20) / (size_t(w) * 4)));
+    try {
+        src.strip.resize(size_t(w) * 4 * size_t(std::min(src.stripRows, src.h)));
+        out.resize(size_t(dstW) * size_t(dstH) * 4);
+    } catch (const std::bad_alloc&) {
+        err = L"Out of memory while streaming image";
+        return false;
+    }
+
+    STBIR_RESIZE r;
+    stbir_resize_init(&r, nullptr, src.w, src.h, src.w * 4,
+                      out.data(), dstW, dstH, dstW * 4,
+                      STBIR_RGBA, STBIR_TYPE_UINT8_SRGB);
+    stbir_set_pixel_callbacks(&r, InputRows, nullptr);
+    r.user_data = &src;
+
+    if (!stbir_resize_extended(&r)) {
+        err = L"Resize failed while streaming image";
+        return false;
+    }
+    if (FAILED(src.hr)) {
+        wchar_t buf[96];
+        swprintf_s(buf, L"Streaming decode failed: 0x%08X", src.hr);
+        err = buf;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+// src/stream_decode.h
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// Decode `path` straight to dstW x dstH RGBA8 without ever holding the
+// full-size image: WIC hands out source rows in strips and
+// stb_image_resize2 pulls them through its input callback. Peak memory is
+// the output plus one strip. Used for images past the texture size limit
+// and for grid thumbnails; large reductions first use the codec's own
+// scaled decode where it has one.
+bool StreamDecodeResized(const std::wstring& path, int dstW, int dstH,
+                         PixelBuffer& out, std::wstring& err);
@@ -0,0 +1,65 @@
+// src/task_graph.cpp
+#include "task_graph.h"
+#include "trace.h"
+
+#include <algorithm>
+
+TaskGraph::TaskId TaskGraph::Add(const char* name, std::function<void()> fn, std::vector<TaskId> deps)
+{
+    const TaskId id = TaskId(m_tasks.size());
+    Task t;
+    t.name    = name;
+    t.fn      = std::move(fn);
+    t.pending = int(deps.size());
+    m_tasks.push_back(std::move(t));
+    for (TaskId d : deps) m_tasks[d].dependents.push_back(id);
+    if (deps.empty()) m_ready.push_back(id);
+    return id;
+}
+
+void TaskGraph::Start(int threads)
+{
+    if (threads <= 0) threads = std::max(2, int(std::thread::hardware_concurrency()));
+    threads = std::min(threads, int(m_tasks.size()));
+    // first-added ready tasks run first: callers list the critical path first
+    std::reverse(m_ready.begin(), m_ready.end());
+    for (int i = 0; i < threads; ++i) m_threads.emplace_back([this] { Worker(); });
+}
+
+void TaskGraph::Wait(TaskId id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return m_tasks[id].done; });
+}
+
+void TaskGraph::WaitAll()
+{
+    for (auto& t : m_threads) t.join();
+    m_threads.clear();
+}
+
+void TaskGraph::Worker()
+{
+    TraceSetThreadName("startup");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] { return !m_ready.empty() || m_finished == m_tasks.size(); });
+        if (m_ready.empty()) return;            // everything has finished
+        const TaskId id = m_ready.back();
+        m_ready.pop_back();
+        Task& t = m_tasks[id];
+        lock.unlock();
+
+        t.startNs = TraceNowNs();
+        t.fn();
+        t.endNs = TraceNowNs();
+        TraceRecord(t.name, t.startNs, t.endNs);
+
+        lock.lock();
+        t.done = true;
+        ++m_finished;
+        for (TaskId d : t.dependents)
+            if (--m_tasks[d].pending == 0) m_ready.push_back(d);
+        m_cv.notify_all();
+    }
+}
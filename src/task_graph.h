@@ -0,0 +1,59 @@
+// src/task_graph.h
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One-shot tasks with explicit dependencies, for overlapping startup work.
+// Tasks are added up front with the ids of the tasks they need; Start()
+// runs every task whose dependencies have finished on a few worker threads
+// while the caller carries on with thread-affine work (the window) and
+// Wait()s for the results it needs next. Each task is recorded as a trace
+// span and keeps its start/end time for the startup report.
+class TaskGraph {
+public:
+    using TaskId = int;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+    ~TaskGraph() { WaitAll(); }
+
+    // Only before Start(); deps must already have been added
+    TaskId Add(const char* name, std::function<void()> fn, std::vector<TaskId> deps = {});
+
+    // threads = 0: one per core (at least two, so a task waiting on the
+    // driver or the disk does not hold up the rest), at most one per task
+    void Start(int threads = 0);
+
+    void Wait(TaskId id);
+    void WaitAll();
+
+    size_t      Count()            const { return m_tasks.size(); }
+    const char* Name(TaskId id)    const { return m_tasks[id].name; }
+    // TraceNowNs() clock; valid once the task has finished
+    int64_t     StartNs(TaskId id) const { return m_tasks[id].startNs; }
+    int64_t     EndNs(TaskId id)   const { return m_tasks[id].endNs; }
+
+private:
+    struct Task {
+        const char*           name;
+        std::function<void()> fn;
+        std::vector<TaskId>   dependents;
+        int                   pending = 0;      // unfinished dependencies
+        bool                  done    = false;
+        int64_t               startNs = 0, endNs = 0;
+    };
+
+    void Worker();
+
+    std::vector<Task>        m_tasks;
+    std::vector<TaskId>      m_ready;
+    size_t                   m_finished = 0;
+    std::mutex               m_mutex;
+    std::condition_variable  m_cv;
+    std::vector<std::thread> m_threads;
+};
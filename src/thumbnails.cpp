@@ -0,0 +1,271 @@
+// src/thumbnails.cpp
+#include "thumbnails.h"
+#include "color_profile.h"
+#include "exif.h"
+#include "image_formats.h"
+#include "perf_stats.h"
+#include "pixel_transform.h"
+#include "trace.h"
+
+#define NOMINMAX
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "stb_image.h"
+#include "stb_image_resize2.h"
+
+namespace {
+
+// Enough for the Exif segment (64 KB max), the headers before it and
+// usually an ICC profile after it
+constexpr size_t kHeadBytes = 128 * 1024;
+
+void FitInside(int w, int h, int maxSize, int& fw, int& fh)
+{
+    const double s = std::min(1.0, std::min(double(maxSize) / w, double(maxSize) / h));
+    fw = std::max(1, int(w * s + 0.5));
+    fh = std::max(1, int(h * s + 0.5));
+}
+
+// Shrink (never enlarge) decoded RGBA into out
+bool FitPixels(const uint8_t* rgba, int w, int h, int maxSize, Thumbnail& out)
+{
+    FitInside(w, h, maxSize, out.w, out.h);
+    try {
+        out.rgba.resize(size_t(out.w) * out.h * 4);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    if (out.w == w && out.h == h) {
+        std::memcpy(out.rgba.data(), rgba, out.rgba.size());
+        return true;
+    }
+    return stbir_resize_uint8_srgb(rgba, w, h, w * 4, out.rgba.data(), out.w, out.h, out.w * 4,
+                                   STBIR_RGBA) != nullptr;
+}
+
+bool FromExif(const uint8_t* head, size_t len, int maxSize, Thumbnail& out)
+{
+    const uint8_t* thumb = nullptr;
+    size_t thumbLen = 0;
+    if (!FindExifThumbnail(head, len, thumb, thumbLen)) return false;
+    int w = 0, h = 0, comp = 0;
+    unsigned char* px = stbi_load_from_memory(thumb, int(thumbLen), &w, &h, &comp, 4);
+    if (!px) return false;
+    // a preview far below the cell size would look mushy; decode instead
+    const bool ok = std::max(w, h) * 2 >= maxSize && FitPixels(px, w, h, maxSize, out);
+    stbi_image_free(px);
+    if (ok) out.source = "EXIF";
+    return ok;
+}
+
+// Same conversion to sRGB and upright turn as the full view, from the
+// profile and Exif orientation in `head` (the Exif preview is stored in
+// the main image's orientation)
+void ToDisplay(const uint8_t* head, size_t len, Thumbnail& out, uint32_t orientation = 0)
+{
+    if (const auto xf = EmbeddedColorTransform(head, len))
+        xf->Apply(out.rgba.data(), out.w, out.h);
+    if (orientation != 0 || FindExifOrientation(head, len, orientation))
+        OrientPixels(out.rgba, out.w, out.h, OrientationFromExif(orientation));
+}
+
+// RAW files: the smallest embedded preview that fills the cell, turned the
+// way the container says (or the preview's own Exif, without one)
+bool FromEmbedded(const std::wstring& path, const ImageFormat& wrapper, int maxSize, Thumbnail& out)
+{
+    PixelBuffer bytes, decoded;
+    uint32_t orientation = 0;
+    std::wstring err;
+    DecodeResult res;
+    try {
+        if (!wrapper.readEmbedded(path, maxSize, bytes, orientation, err)) return false;
+        const ImageFormat* format = SniffImageFormat(bytes.data(), std::min(bytes.size(), kSniffBytes));
+        if (!format || format->readEmbedded || !format->decode(bytes.data(), bytes.size(), decoded, res)) return false;
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+    if (!FitPixels(decoded.data(), res.w, res.h, maxSize, out)) return false;
+    out.source = "RAW preview";
+    ToDisplay(bytes.data(), std::min(bytes.size(), kHeadBytes), out, orientation);
+    return true;
+}
+
+} // namespace
+
+bool MakeThumbnail(const std::wstring& path, int maxSize, Thumbnail& out, bool allowExif)
+{
+    HDRV_TRACE_SCOPE("thumbnail");
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file) return false;
+
+    std::vector<uint8_t> head(kHeadBytes);
+    head.resize(fread(head.data(), 1, head.size(), file));
+    const ImageFormat* format = SniffImageFormat(head.data(), std::min(head.size(), kSniffBytes));
+    if (!format) { fclose(file); return false; }
+    if (format->readEmbedded) {
+        fclose(file);
+        return FromEmbedded(path, *format, maxSize, out);
+    }
+
+    if (allowExif && std::strcmp(format->name, "JPEG") == 0 && FromExif(head.data(), head.size(), maxSize, out)) {
+        fclose(file);
+        ToDisplay(head.data(), head.size(), out);
+        return true;
+    }
+
+    // Big enough to be worth it: let the codec decode straight to thumbnail size
+    int w = 0, h = 0, comp = 0;
+    if (format->decodeReduced &&
+        stbi_info_from_memory(head.data(), int(head.size()), &w, &h, &comp) &&
+        std::max(w, h) > maxSize) {
+        fclose(file);
+        FitInside(w, h, maxSize, out.w, out.h);
+        std::wstring err;
+        if (!format->decodeReduced(path, out.w, out.h, out.rgba, err)) return false;
+        out.source = "reduced";
+        ToDisplay(head.data(), head.size(), out);
+        return true;
+    }
+
+    PixelBuffer bytes, decoded;
+    DecodeResult res;
+    bool ok = false;
+    try {
+        fseek(file, 0, SEEK_END);
+        const long fileLen = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        bytes.resize(fileLen > 0 ? size_t(fileLen) : 0);
+        ok = fread(bytes.data(), 1, bytes.size(), file) == bytes.size() &&
+             format->decode(bytes.data(), bytes.size(), decoded, res);
+    } catch (const std::bad_alloc&) {
+        ok = false;
+    }
+    fclose(file);
+    if (!ok || !FitPixels(decoded.data(), res.w, res.h, maxSize, out)) return false;
+    out.source = "full";
+    ToDisplay(head.data(), head.size(), out);
+    return true;
+}
+
+void ThumbnailPipeline::SetFiles(const FileList& files)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_files = files;
+        m_state.assign(files.size(), State::Idle);
+        m_order.clear();
+        m_cursor = 0;
+        m_results.clear();
+        ++m_generation;     // in-flight results for the old list are dropped
+        m_generated = m_fromExif = 0;
+        m_totalMs = 0.0;
+    }
+    if (m_threads.empty()) {
+        m_stop = false;
+        const int workers = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+        for (int i = 0; i < workers; ++i) m_threads.emplace_back([this] { Worker(); });
+    }
+}
+
+void ThumbnailPipeline::Prioritize(std::vector<int> order)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_order  = std::move(order);
+        m_cursor = 0;
+    }
+    m_cv.notify_all();
+}
+
+void ThumbnailPipeline::Invalidate(int index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (index >= 0 && size_t(index) < m_state.size() && m_state[index] == State::Done)
+        m_state[index] = State::Idle;
+}
+
+size_t ThumbnailPipeline::TakeResults(std::vector<ThumbResult>& out, size_t maxCount)
+{
+    size_t taken = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (taken < maxCount && !m_results.empty()) {
+            ThumbResult& r = m_results.front();
+            if (r.ok) {
+                ++m_generated;
+                m_totalMs += r.ms;
+                if (std::strcmp(r.thumb.source, "EXIF") == 0) ++m_fromExif;
+            }
+            out.push_back(std::move(r));
+            m_results.pop_front();
+            ++taken;
+        }
+    }
+    if (taken) m_cv.notify_all();   // room in the queue again
+    return taken;
+}
+
+void ThumbnailPipeline::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads) t.join();
+    m_threads.clear();
+}
+
+// Next wanted file that nobody has started, or -1. Skipped entries stay
+// skipped until the next Prioritize() rewinds the cursor.
+int ThumbnailPipeline::PeekJob()
+{
+    while (m_cursor < m_order.size()) {
+        const int i = m_order[m_cursor];
+        if (i >= 0 && size_t(i) < m_state.size() && m_state[i] == State::Idle) return i;
+        ++m_cursor;
+    }
+    return -1;
+}
+
+void ThumbnailPipeline::Worker()
+{
+    // decoding must never compete with the render thread for a core
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+    TraceSetThreadName("thumbnail");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] {
+            return m_stop || (m_results.size() < kMaxQueued && PeekJob() >= 0);
+        });
+        if (m_stop) return;
+
+        const int index = m_order[m_cursor++];
+        m_state[index] = State::Working;
+        const std::wstring path = m_files[index];
+        const uint32_t generation = m_generation;
+        lock.unlock();
+
+        ThumbResult r;
+        r.index = index;
+        const auto t0 = std::chrono::steady_clock::now();
+        r.ok = MakeThumbnail(path, kThumbSize, r.thumb);
+        r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (r.ok) {
+            PerfAdd(PerfCounter::Thumbnails, 1);
+            PerfAdd(PerfCounter::ThumbnailNs, uint64_t(r.ms * 1e6));
+        }
+
+        lock.lock();
+        if (generation != m_generation) continue;
+        // failures are reported too, so the grid can stop showing a placeholder
+        m_state[index] = State::Done;
+        m_results.push_back(std::move(r));
+    }
+}
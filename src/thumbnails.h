@@ -0,0 +1,91 @@
+// src/thumbnails.h
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "file_list.h"
+
+// Longest side of a generated thumbnail (one atlas slot)
+constexpr int kThumbSize = 256;
+
+struct Thumbnail {
+    int         w = 0, h = 0;
+    PixelBuffer rgba;
+    const char* source = "";    // "EXIF", "reduced", "full" or "RAW preview"
+};
+
+// RGBA8 thumbnail of `path` fitting maxSize x maxSize, cheapest source
+// first: the JPEG's embedded Exif preview, then the format's reduced
+// decode (WIC scaled decode + streamed resize), then a full decode. RAW
+// files use their smallest embedded preview that covers maxSize.
+// allowExif = false skips the preview, whose framing (black bars, camera
+// crop) differs from the main image.
+bool MakeThumbnail(const std::wstring& path, int maxSize, Thumbnail& out, bool allowExif = true);
+
+struct ThumbResult {
+    int       index = -1;       // into the list given to SetFiles
+    bool      ok    = false;
+    Thumbnail thumb;
+    double    ms    = 0.0;      // generation time on the worker
+};
+
+// Generates thumbnails on (cores - 1) below-normal-priority workers in the
+// order the grid asks for. The grid re-sends the order whenever the visible
+// rows or the scroll direction change, so work always goes to what is on
+// screen next; each file is generated at most once until Invalidate().
+// Finished thumbnails wait in a bounded queue for the render thread, which
+// keeps memory flat however fast the workers run ahead.
+class ThumbnailPipeline {
+public:
+    static constexpr size_t kMaxQueued = 64;
+
+    ~ThumbnailPipeline() { Stop(); }
+
+    // New folder or sort order: drops all state, queued and in-flight work
+    void SetFiles(const FileList& files);
+
+    // File indices wanted, most urgent first; replaces the previous order
+    void Prioritize(std::vector<int> order);
+
+    // Forget a finished thumbnail (its atlas slot was reused), so the next
+    // Prioritize() that lists it generates it again
+    void Invalidate(int index);
+
+    // Move up to maxCount finished thumbnails into `out` (appended)
+    size_t TakeResults(std::vector<ThumbResult>& out, size_t maxCount);
+
+    void Stop();
+
+    int    Workers()   const { return int(m_threads.size()); }
+    int    Generated() const { return m_generated; }
+    int    FromExif()  const { return m_fromExif; }
+    double AvgMs()     const { return m_generated ? m_totalMs / m_generated : 0.0; }
+
+private:
+    enum class State : uint8_t { Idle, Working, Done };
+
+    void Worker();
+    int  PeekJob();
+
+    FileList                  m_files;
+    std::vector<State>        m_state;
+    std::vector<int>          m_order;
+    size_t                    m_cursor = 0;
+    std::deque<ThumbResult>   m_results;
+    uint32_t                  m_generation = 0;
+    bool                      m_stop = false;
+
+    int    m_generated = 0;     // render-thread stats, updated in TakeResults
+    int    m_fromExif  = 0;
+    double m_totalMs   = 0.0;
+
+    std::mutex                m_mutex;
+    std::condition_variable   m_cv;
+    std::vector<std::thread>  m_threads;
+};
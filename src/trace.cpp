@@ -0,0 +1,151 @@
+// src/trace.cpp
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t     startNs;
+    int64_t     endNs;
+};
+
+// Single writer (the owning thread), any number of readers in TraceWriteJson
+struct ThreadRing {
+    int                   tid = 0;
+    std::atomic<const char*> threadName{ nullptr };
+    std::atomic<uint64_t> head{ 0 };        // total spans ever written
+    TraceEvent            events[kTraceRingSize];
+};
+
+struct Registry {
+    std::mutex                               mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    std::vector<std::shared_ptr<ThreadRing>> idle;     // of threads that have exited
+    int64_t                                  originNs = TraceNowNs();
+};
+
+Registry& GetRegistry()
+{
+    static Registry* r = new Registry;      // never destroyed: dumps may run during exit
+    return *r;
+}
+
+// Hands the thread's ring back when the thread exits. Band workers live for
+// one call, so the next thread takes over an idle ring (and its tid) rather
+// than adding one per thread ever started.
+struct RingOwner {
+    std::shared_ptr<ThreadRing> ring;
+    ~RingOwner()
+    {
+        if (!ring) return;
+        Registry& reg = GetRegistry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.idle.push_back(std::move(ring));
+    }
+};
+
+ThreadRing& LocalRing()
+{
+    thread_local RingOwner owner;
+    if (!owner.ring) {
+        Registry& reg = GetRegistry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (!reg.idle.empty()) {
+            owner.ring = std::move(reg.idle.back());
+            reg.idle.pop_back();
+            owner.ring->threadName.store(nullptr, std::memory_order_relaxed);
+        } else {
+            owner.ring = std::make_shared<ThreadRing>();
+            owner.ring->tid = int(reg.rings.size()) + 1;
+            reg.rings.push_back(owner.ring);
+        }
+    }
+    return *owner.ring;
+}
+
+// Names are literals in this code base, but stay valid JSON regardless
+void WriteJsonString(FILE* out, const char* s)
+{
+    fputc('"', out);
+    for (; *s; ++s) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') { fputc('\\', out); fputc(c, out); }
+        else if (c < 0x20)         fprintf(out, "\\u%04x", c);
+        else                       fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+} // namespace
+
+void TraceRecord(const char* name, int64_t startNs, int64_t endNs)
+{
+#ifndef HDRV_NO_TRACE
+    ThreadRing& r = LocalRing();
+    const uint64_t h = r.head.load(std::memory_order_relaxed);
+    r.events[h % kTraceRingSize] = { name, startNs, endNs };
+    r.head.store(h + 1, std::memory_order_release);
+#else
+    (void)name; (void)startNs; (void)endNs;
+#endif
+}
+
+void TraceSetThreadName(const char* name)
+{
+#ifndef HDRV_NO_TRACE
+    LocalRing().threadName.store(name, std::memory_order_relaxed);
+#else
+    (void)name;
+#endif
+}
+
+bool TraceWriteJson(FILE* out)
+{
+    Registry& reg = GetRegistry();
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        rings = reg.rings;
+    }
+
+    fputs("{\"traceEvents\":[\n", out);
+    bool first = true;
+    auto sep = [&] { if (!first) fputs(",\n", out); first = false; };
+
+    std::vector<TraceEvent> copy;
+    for (const auto& r : rings) {
+        const char* threadName = r->threadName.load(std::memory_order_relaxed);
+        sep();
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", r->tid);
+        WriteJsonString(out, threadName ? threadName : ("thread " + std::to_string(r->tid)).c_str());
+        fputs("}}", out);
+
+        // Copy the retained window, then drop whatever the owner may have
+        // overwritten while we were copying, including the slot of event
+        // `after`, which it may be writing before publishing head
+        const uint64_t before = r->head.load(std::memory_order_acquire);
+        const uint64_t begin  = before > kTraceRingSize ? before - kTraceRingSize : 0;
+        copy.clear();
+        for (uint64_t i = begin; i < before; ++i) copy.push_back(r->events[i % kTraceRingSize]);
+        const uint64_t after = r->head.load(std::memory_order_acquire);
+        const uint64_t valid = after + 1 > kTraceRingSize ? after + 1 - kTraceRingSize : 0;
+
+        for (uint64_t i = std::max(begin, valid); i < before; ++i) {
+            const TraceEvent& e = copy[size_t(i - begin)];
+            sep();
+            fputs("{\"name\":", out);
+            WriteJsonString(out, e.name);
+            fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    r->tid, (e.startNs - reg.originNs) / 1000.0, (e.endNs - e.startNs) / 1000.0);
+        }
+    }
+    fputs("\n]}\n", out);
+    return fflush(out) == 0 && !ferror(out);
+}
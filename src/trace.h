@@ -0,0 +1,59 @@
+// src/trace.h
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Scoped-span tracing for load, resize, upload and frame phases.
+//
+//     HDRV_TRACE_SCOPE("decode");
+//
+// records one complete event from there to the end of the enclosing block.
+// Each thread writes into its own fixed ring (the newest kTraceRingSize
+// spans are kept), so recording is two clock reads and a store with no
+// locking; the rings outlive their threads so worker spans still show up in
+// a dump taken later. A ring whose thread has exited goes to the next new
+// thread, so short-lived band workers do not pile up rings. TraceWriteJson
+// emits Chrome trace-event JSON, which chrome://tracing and
+// ui.perfetto.dev both open.
+//
+// Build with HDRV_NO_TRACE (CMake: -DHDRV_TRACE=OFF) to compile every span
+// out; the functions then exist but record and write nothing.
+
+constexpr uint32_t kTraceRingSize = 1u << 14;
+
+// Span names must be string literals (or otherwise live forever)
+void TraceRecord(const char* name, int64_t startNs, int64_t endNs);
+
+// Label the calling thread in the dump ("main", "thumbnail", ...)
+void TraceSetThreadName(const char* name);
+
+// Nanoseconds on the steady clock, the time base of every span
+inline int64_t TraceNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Write every thread's retained spans as {"traceEvents":[...]}; false on a
+// write error. Safe to call while other threads keep recording.
+bool TraceWriteJson(FILE* out);
+
+#ifndef HDRV_NO_TRACE
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : m_name(name), m_start(TraceNowNs()) {}
+    ~TraceScope() { TraceRecord(m_name, m_start, TraceNowNs()); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+private:
+    const char* m_name;
+    int64_t     m_start;
+};
+
+#define HDRV_TRACE_CAT2(a, b) a##b
+#define HDRV_TRACE_CAT(a, b)  HDRV_TRACE_CAT2(a, b)
+#define HDRV_TRACE_SCOPE(name) TraceScope HDRV_TRACE_CAT(traceScope_, __LINE__)(name)
+#else
+#define HDRV_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,35 @@
+// src/upload_ring.cpp
+#include "upload_ring.h"
+
+bool UploadRing::Allocate(uint64_t size, uint64_t align, uint64_t& offset)
+{
+    if (size == 0 || size > m_capacity) return false;
+
+    uint64_t start = (m_head + align - 1) & ~(align - 1);
+    // never split a region across the end of the buffer: skip to the start
+    const uint64_t inBuffer = start % m_capacity;
+    if (inBuffer + size > m_capacity) start += m_capacity - inBuffer;
+
+    if (start + size - m_tail > m_capacity) return false;
+    m_head = start + size;
+    offset = start % m_capacity;
+    return true;
+}
+
+void UploadRing::Submit(uint64_t fenceValue)
+{
+    if (m_head == m_submitted) return;
+    m_marks.push_back({ fenceValue, m_head });
+    m_submitted = m_head;
+}
+
+void UploadRing::Retire(uint64_t completedValue)
+{
+    while (!m_marks.empty() && m_marks.front().fence <= completedValue) {
+        m_tail = m_marks.front().end;
+        m_marks.pop_front();
+    }
+    // nothing in flight or pending: restart at offset 0 to keep regions whole
+    if (m_marks.empty() && m_head == m_submitted) m_tail = m_head = m_submitted =
+        (m_head + m_capacity - 1) / m_capacity * m_capacity;
+}
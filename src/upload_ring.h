@@ -0,0 +1,73 @@
+// src/upload_ring.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Linear sub-allocator over one persistent staging buffer, retired by a
+// fence timeline. Allocations since the last Submit() belong to the fence
+// value passed to it; Retire(completed) frees every region whose value has
+// been reached. Space is handed out in submission order and freed in the
+// same order, so bookkeeping is two positions and a queue of fence marks.
+// Knows nothing about the graphics API: callers map offsets into their own
+// buffer and read the completed value from their own fence.
+class UploadRing {
+public:
+    // `capacity` must be a multiple of every alignment asked for
+    explicit UploadRing(uint64_t capacity) : m_capacity(capacity) {}
+
+    // Reserve `size` bytes aligned to `align` (a power of two). False when
+    // the request is larger than the ring or the space is still in flight;
+    // the caller retires, waits or falls back to a dedicated buffer.
+    bool Allocate(uint64_t size, uint64_t align, uint64_t& offset);
+
+    // Everything allocated since the previous Submit completes at `fenceValue`
+    void Submit(uint64_t fenceValue);
+
+    // Free all regions submitted with a value <= completedValue
+    void Retire(uint64_t completedValue);
+
+    // Fence value that frees the oldest in-flight region (0 if none)
+    uint64_t OldestFence() const { return m_marks.empty() ? 0 : m_marks.front().fence; }
+
+    uint64_t Capacity() const { return m_capacity; }
+    uint64_t Used()     const { return m_head - m_tail; }
+
+private:
+    struct Mark { uint64_t fence; uint64_t end; };
+
+    uint64_t         m_capacity;
+    uint64_t         m_head = 0;    // monotonic byte positions; offset = pos % capacity
+    uint64_t         m_tail = 0;
+    uint64_t         m_submitted = 0;
+    std::deque<Mark> m_marks;
+};
+
+// Objects (command allocators, textures, dedicated staging buffers) that the
+// GPU may still use until a fence reaches the value they were queued with
+template <class T>
+class FenceRetireQueue {
+public:
+    void Push(T obj, uint64_t fenceValue) { m_items.emplace_back(fenceValue, std::move(obj)); }
+
+    // Hand back the oldest object whose fence has completed, for reuse
+    bool PopCompleted(uint64_t completedValue, T& out)
+    {
+        if (m_items.empty() || m_items.front().first > completedValue) return false;
+        out = std::move(m_items.front().second);
+        m_items.pop_front();
+        return true;
+    }
+
+    // Drop every object whose fence has completed
+    void Release(uint64_t completedValue)
+    {
+        while (!m_items.empty() && m_items.front().first <= completedValue) m_items.pop_front();
+    }
+
+    size_t Size() const { return m_items.size(); }
+
+private:
+    std::deque<std::pair<uint64_t, T>> m_items;     // fence values non-decreasing
+};
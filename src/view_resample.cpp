@@ -0,0 +1,200 @@
+// src/view_resample.cpp
+#include "view_resample.h"
+#include "parallel.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include "stb_image_resize2.h"
+
+namespace {
+
+constexpr float kPi = 3.14159265358979f;
+
+float Sinc(float x)
+{
+    if (std::fabs(x) < 1e-6f) return 1.0f;
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+// Windowed sinc with three lobes; stb scales the kernel for downsampling
+float Lanczos3(float x, float, void*)
+{
+    return std::fabs(x) < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+}
+
+float Lanczos3Support(float, void*) { return 3.0f; }
+
+// Output rows per split: small enough that a cancel lands within a few ms
+constexpr int kRowsPerSplit = 32;
+
+// The viewport is polish; never compete with the render thread
+void LowerThreadPriority()
+{
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#endif
+}
+
+} // namespace
+
+const char* ResampleFilterName(ResampleFilter f)
+{
+    return f == ResampleFilter::Lanczos3 ? "Lanczos3" : "Mitchell";
+}
+
+bool ViewRequest::Same(const ViewRequest& o) const
+{
+    const double ts = 0.01 / std::max(1, srcW), tt = 0.01 / std::max(1, srcH);
+    return pixels == o.pixels && srcW == o.srcW && srcH == o.srcH && filter == o.filter &&
+           dstX == o.dstX && dstY == o.dstY && dstW == o.dstW && dstH == o.dstH &&
+           std::fabs(s0 - o.s0) < ts && std::fabs(s1 - o.s1) < ts &&
+           std::fabs(t0 - o.t0) < tt && std::fabs(t1 - o.t1) < tt;
+}
+
+void ViewResampler::Request(const ViewRequest& req)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        m_hasJob = false;
+        m_result.reset();
+        for (auto it = m_cache.begin(); it != m_cache.end(); ++it) {
+            if (!(*it)->request.Same(req)) continue;
+            auto hit = *it;
+            m_cache.erase(it);
+            m_cache.push_back(hit);
+            m_result = hit;
+            return;
+        }
+        m_job           = req;
+        m_jobGeneration = m_generation.load();
+        m_hasJob        = true;
+        if (!m_thread.joinable()) {
+            m_stop   = false;
+            m_thread = std::thread(&ViewResampler::Worker, this);
+        }
+    }
+    m_cv.notify_all();
+}
+
+void ViewResampler::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_hasJob = false;
+    m_result.reset();
+}
+
+void ViewResampler::Reset()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_hasJob = false;
+    m_result.reset();
+    m_cache.clear();
+    m_cv.wait(lock, [&] { return !m_running; });
+}
+
+bool ViewResampler::TakeResult(std::shared_ptr<const ViewResult>& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_result) return false;
+    out = std::move(m_result);
+    m_result.reset();
+    return true;
+}
+
+bool ViewResampler::Pending(const ViewRequest& req)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_hasJob || m_running) && m_jobGeneration == m_generation.load() && m_job.Same(req);
+}
+
+void ViewResampler::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        ++m_generation;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void ViewResampler::Worker()
+{
+    LowerThreadPriority();
+    TraceSetThreadName("view resample");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, [&] { return m_stop || m_hasJob; });
+        if (m_stop) return;
+
+        const ViewRequest req = m_job;
+        const uint32_t generation = m_jobGeneration;
+        m_hasJob  = false;
+        m_running = true;
+        lock.unlock();
+
+        auto result = std::make_shared<ViewResult>();
+        const bool done = Resample(req, generation, *result);
+
+        lock.lock();
+        m_running = false;
+        m_cv.notify_all();      // Reset() may be waiting
+        if (!done || generation != m_generation.load()) continue;
+        m_result = result;
+        m_cache.push_back(std::move(result));
+        if (m_cache.size() > kCachedViews) m_cache.pop_front();
+    }
+}
+
+bool ViewResampler::Resample(const ViewRequest& req, uint32_t generation, ViewResult& out) const
+{
+    HDRV_TRACE_SCOPE("view resample");
+    const int64_t t0 = TraceNowNs();
+    out.request = req;
+    try {
+        out.rgba.resize(size_t(req.dstW) * size_t(req.dstH) * 4);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+
+    STBIR_RESIZE r;
+    stbir_resize_init(&r, req.pixels, req.srcW, req.srcH, req.srcW * 4,
+                      out.rgba.data(), req.dstW, req.dstH, req.dstW * 4,
+                      STBIR_RGBA, STBIR_TYPE_UINT8_SRGB);
+    if (!stbir_set_input_subrect(&r, req.s0, req.t0, req.s1, req.t1)) return false;
+    if (req.filter == ResampleFilter::Lanczos3)
+        stbir_set_filter_callbacks(&r, Lanczos3, Lanczos3Support, Lanczos3, Lanczos3Support);
+    else
+        stbir_set_filters(&r, STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL);
+
+    const int splits = stbir_build_samplers_with_splits(&r, std::max(1, req.dstH / kRowsPerSplit));
+    if (splits <= 0) return false;
+
+    // splits in order on each band, checking for a cancel between them
+    std::atomic<bool> cancelled{ false };
+    ParallelForBands(splits, 1, [&](int band, int begin, int end) {
+        if (band > 0) LowerThreadPriority();
+        for (int s = begin; s < end; ++s) {
+            if (cancelled.load(std::memory_order_relaxed) || m_generation.load() != generation) {
+                cancelled = true;
+                return;
+            }
+            stbir_resize_extended_split(&r, s, 1);
+        }
+    });
+    stbir_free_samplers(&r);
+    out.ms = (TraceNowNs() - t0) / 1e6;
+    return !cancelled;
+}
@@ -0,0 +1,83 @@
+// src/view_resample.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "buffer_pool.h"
+
+enum class ResampleFilter : uint8_t { Lanczos3, Mitchell };
+
+const char* ResampleFilterName(ResampleFilter f);
+
+// The part of the source image behind one screen rectangle
+struct ViewRequest {
+    const uint8_t* pixels = nullptr;    // RGBA8 source, srcW x srcH
+    int    srcW = 0, srcH = 0;
+    double s0 = 0.0, t0 = 0.0, s1 = 1.0, t1 = 1.0;   // source region, normalized
+    int    dstX = 0, dstY = 0, dstW = 0, dstH = 0;   // screen pixels it covers
+    ResampleFilter filter = ResampleFilter::Lanczos3;
+
+    // Same view within a hundredth of a source pixel, so float drift from
+    // zooming in and back out still finds the cached result
+    bool Same(const ViewRequest& o) const;
+};
+
+struct ViewResult {
+    ViewRequest request;
+    PixelBuffer rgba;                   // dstW x dstH, sRGB RGBA8
+    double      ms = 0.0;
+};
+
+// Resamples the visible region of the image at exact screen resolution on a
+// background thread, with stb_image_resize2 in linear light. One job at a
+// time: a new Request() or Cancel() abandons the one in flight at its next
+// split (the output is cut into a few rows per split, run across all
+// cores), so a viewport that starts moving again costs at most a few ms of
+// wasted work. The last kCachedViews results are kept for back-and-forth.
+class ViewResampler {
+public:
+    static constexpr size_t kCachedViews = 4;
+
+    ~ViewResampler() { Stop(); }
+
+    // Replace the job in flight with `req`; a cached view is returned by the
+    // next TakeResult() without resampling
+    void Request(const ViewRequest& req);
+
+    // Abandon the job in flight without waiting for it
+    void Cancel();
+
+    // Cancel, wait until the worker no longer reads the source, and forget
+    // cached views: the source pixels are about to change
+    void Reset();
+
+    // Finished (or cached) view for the latest request; shared with the cache
+    bool TakeResult(std::shared_ptr<const ViewResult>& out);
+
+    // A job is queued or running for a view Same() as `req`
+    bool Pending(const ViewRequest& req);
+
+    void Stop();
+
+private:
+    void Worker();
+    bool Resample(const ViewRequest& req, uint32_t generation, ViewResult& out) const;
+
+    ViewRequest             m_job;
+    uint32_t                m_jobGeneration = 0;
+    bool                    m_hasJob  = false;
+    bool                    m_running = false;      // worker is reading m_job's source
+    std::shared_ptr<const ViewResult>             m_result;
+    std::deque<std::shared_ptr<const ViewResult>> m_cache;     // most recent last
+    std::atomic<uint32_t>   m_generation{ 0 };
+    bool                    m_stop = false;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::thread             m_thread;
+};
@@ -0,0 +1,176 @@
+// tests/bc_encode_test.cpp
+#include "bc_encode.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Smooth gradients, a hard edge and a little noise: photo-like enough that
+// PSNR says something about the encoder
+std::vector<uint8_t> TestImage(int w, int h, bool alpha)
+{
+    std::vector<uint8_t> rgba(size_t(w) * h * 4);
+    std::mt19937 rng(7);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = &rgba[(size_t(y) * w + x) * 4];
+            const float fx = float(x) / w, fy = float(y) / h;
+            const int n = int(rng() % 7) - 3;
+            p[0] = uint8_t(std::clamp(int(255 * fx) + n, 0, 255));
+            p[1] = uint8_t(std::clamp(int(255 * fy) + n, 0, 255));
+            p[2] = uint8_t(std::clamp(int(128 + 100 * std::sin(fx * 9.0f + fy * 5.0f)) + n, 0, 255));
+            if (x > w / 2 && y > h / 2) p[2] = 255 - p[2];
+            p[3] = alpha ? uint8_t(255 * fy) : 255;
+        }
+    }
+    return rgba;
+}
+
+// A BC1 block written by hand: red and blue endpoints in four-colour mode,
+// then three-colour mode whose index 3 is transparent black
+void TestBc1Decode()
+{
+    BcImage img;
+    img.format = BcFormat::BC1;
+    img.srcW = img.width = 4;
+    img.srcH = img.height = 4;
+    img.blocks = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };   // indices 0 1 2 3 per row
+    std::vector<uint8_t> px;
+    DecodeBC(img, px);
+    const uint8_t four[4][4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 170, 0, 85, 255 }, { 85, 0, 170, 255 } };
+    for (int i = 0; i < 16; ++i) CHECK(std::memcmp(&px[size_t(i) * 4], four[i % 4], 4) == 0);
+
+    std::swap(img.blocks[0], img.blocks[2]);
+    std::swap(img.blocks[1], img.blocks[3]);
+    DecodeBC(img, px);
+    const uint8_t three[4][4] = { { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, { 127, 0, 127, 255 }, { 0, 0, 0, 0 } };
+    for (int i = 0; i < 16; ++i) CHECK(std::memcmp(&px[size_t(i) * 4], three[i % 4], 4) == 0);
+}
+
+// A BC7 mode 6 block written by hand: endpoints 0 and 255 on every channel,
+// pixel i at index i, so the output is the format's weight table
+void TestBc7Decode()
+{
+    uint64_t w[2] = {};
+    int pos = 0;
+    const auto put = [&](uint32_t v, int n) {
+        for (int b = 0; b < n; ++b, ++pos)
+            if ((v >> b) & 1) w[pos >> 6] |= uint64_t(1) << (pos & 63);
+    };
+    put(1u << 6, 7);
+    for (int c = 0; c < 4; ++c) { put(0, 7); put(127, 7); }
+    put(0, 1);
+    put(1, 1);
+    put(0, 3);
+    for (int i = 1; i < 16; ++i) put(uint32_t(i), 4);
+
+    BcImage img;
+    img.format = BcFormat::BC7;
+    img.srcW = img.width = 4;
+    img.srcH = img.height = 4;
+    img.blocks.resize(16);
+    std::memcpy(img.blocks.data(), w, 16);
+    std::vector<uint8_t> px;
+    DecodeBC(img, px);
+    static const int kWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c) CHECK(px[size_t(i) * 4 + c] == uint8_t((kWeights[i] * 255 + 32) >> 6));
+}
+
+// Flat colours a format can hold come back exactly (BC1: 565 values)
+// or within the endpoint rounding (BC7: 7 bits and a shared p-bit)
+void TestSolidBlocks()
+{
+    const uint8_t colors[][4] = { { 0, 0, 0, 255 }, { 255, 255, 255, 255 }, { 132, 130, 74, 255 }, { 16, 200, 99, 40 } };
+    for (const auto& c : colors) {
+        std::vector<uint8_t> rgba(8 * 8 * 4);
+        for (size_t i = 0; i < rgba.size(); i += 4) std::memcpy(&rgba[i], c, 4);
+
+        BcImage bc1, bc7;
+        EncodeBC(rgba.data(), 8, 8, BcFormat::BC1, bc1);
+        EncodeBC(rgba.data(), 8, 8, BcFormat::BC7, bc7);
+        std::vector<uint8_t> d1, d7;
+        DecodeBC(bc1, d1);
+        DecodeBC(bc7, d7);
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            for (int k = 0; k < 3; ++k) {
+                const float exact565 = k == 1 ? 255.0f / 63 : 255.0f / 31;
+                CHECK(std::abs(int(d1[i + k]) - int(c[k])) <= int(exact565 / 2 + 1));
+                CHECK(std::abs(int(d7[i + k]) - int(c[k])) <= 1);
+            }
+            CHECK(d1[i + 3] == 255);
+            CHECK(std::abs(int(d7[i + 3]) - int(c[3])) <= 1);
+        }
+    }
+    // 565-exact colours survive BC1 bit for bit
+    std::vector<uint8_t> rgba(4 * 4 * 4);
+    for (size_t i = 0; i < rgba.size(); i += 4) { rgba[i] = 132; rgba[i + 1] = 130; rgba[i + 2] = 74; rgba[i + 3] = 255; }
+    BcImage bc;
+    EncodeBC(rgba.data(), 4, 4, BcFormat::BC1, bc);
+    CHECK(BcPsnr(rgba.data(), 4, 4, bc) == 99.0);
+}
+
+// Sizes that are not whole blocks are padded, and the decode is the
+// source size again
+void TestPadding()
+{
+    const std::vector<uint8_t> rgba = TestImage(13, 6, false);
+    for (BcFormat f : { BcFormat::BC1, BcFormat::BC7 }) {
+        BcImage bc;
+        EncodeBC(rgba.data(), 13, 6, f, bc);
+        CHECK(bc.srcW == 13 && bc.srcH == 6 && bc.width == 16 && bc.height == 8);
+        CHECK(bc.blocks.size() == bc.RowPitch() * size_t(bc.BlockRows()));
+        CHECK(bc.RowPitch() == size_t(4 * bc.BlockBytes()));
+        std::vector<uint8_t> dec;
+        DecodeBC(bc, dec);
+        CHECK(dec.size() == rgba.size());
+    }
+}
+
+// Quality floors on the test image, and output that does not depend on how
+// the rows were split across threads
+void TestQuality()
+{
+    const int w = 509, h = 317;
+    const std::vector<uint8_t> opaque = TestImage(w, h, false);
+    const std::vector<uint8_t> alpha  = TestImage(w, h, true);
+
+    BcImage bc1, bc7, again;
+    EncodeBC(opaque.data(), w, h, BcFormat::BC1, bc1);
+    EncodeBC(alpha.data(), w, h, BcFormat::BC7, bc7);
+    const double psnr1 = BcPsnr(opaque.data(), w, h, bc1);
+    const double psnr7 = BcPsnr(alpha.data(), w, h, bc7);
+    std::printf("PSNR  BC1 %.2f dB  BC7 %.2f dB\n", psnr1, psnr7);
+    CHECK(psnr1 > 40.0);
+    CHECK(psnr7 > 45.0);
+    CHECK(bc1.blocks.size() == size_t(bc1.width) * bc1.height / 2);     // 8x smaller than RGBA8
+    CHECK(bc7.blocks.size() == size_t(bc7.width) * bc7.height);         // 4x
+
+    // the top 64 rows alone make the same blocks, however the bands fell
+    EncodeBC(alpha.data(), w, 64, BcFormat::BC7, again);
+    CHECK(std::equal(again.blocks.begin(), again.blocks.end(), bc7.blocks.begin()));
+
+    std::vector<uint8_t> dec;
+    DecodeBC(bc7, dec);
+    double alphaErr = 0.0;
+    for (size_t i = 3; i < dec.size(); i += 4) alphaErr = std::max(alphaErr, std::fabs(double(dec[i]) - alpha[i]));
+    CHECK(alphaErr <= 8.0);
+}
+
+} // namespace
+
+int main()
+{
+    TestBc1Decode();
+    TestBc7Decode();
+    TestSolidBlocks();
+    TestPadding();
+    TestQuality();
+    return TestResult();
+}
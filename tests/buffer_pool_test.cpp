@@ -0,0 +1,76 @@
+// tests/buffer_pool_test.cpp
+#include "buffer_pool.h"
+#include "test.h"
+
+#include <vector>
+
+namespace {
+
+constexpr size_t kMB = size_t(1) << 20;
+
+// A freed buffer is handed out again for a request of the same class
+void TestReuse()
+{
+    PoolTrim();
+    const PoolStats before = GetPoolStats();
+    void* a = PoolAlloc(10 * kMB);
+    CHECK(a != nullptr);
+    PoolFree(a);
+    CHECK(GetPoolStats().idleBytes > 0);
+    void* b = PoolAlloc(10 * kMB - 4096);           // same class
+    CHECK(b == a);
+    CHECK(GetPoolStats().reused == before.reused + 1);
+    PoolFree(b);
+    PoolTrim();
+    CHECK(GetPoolStats().idleBytes == 0);
+}
+
+// Once the idle cap is full of one class, a newly used class evicts the
+// least recently used buffers instead of being returned to the OS itself
+void TestEvictsLeastRecentClass()
+{
+    PoolTrim();
+    std::vector<void*> big;
+    for (int i = 0; i < 4; ++i) big.push_back(PoolAlloc(256 * kMB));
+    for (void* p : big) CHECK(p != nullptr);
+    for (void* p : big) PoolFree(p);                // the fourth exceeds the cap
+    const size_t full = GetPoolStats().idleBytes;
+    CHECK(full == 3 * 256 * kMB);
+
+    void* small = PoolAlloc(64 * kMB);
+    PoolFree(small);
+    CHECK(GetPoolStats().idleBytes == 2 * 256 * kMB + 64 * kMB);
+    const PoolStats before = GetPoolStats();
+    void* again = PoolAlloc(64 * kMB);
+    CHECK(again == small && GetPoolStats().reused == before.reused + 1);
+    PoolFree(again);
+
+    // the remaining big buffers are still there for the class they serve
+    void* b = PoolAlloc(256 * kMB);
+    CHECK(GetPoolStats().reused == before.reused + 2);
+    PoolFree(b);
+    PoolTrim();
+    CHECK(GetPoolStats().idleBytes == 0 && GetPoolStats().liveBytes == 0);
+}
+
+// Small requests bypass the pool
+void TestSmall()
+{
+    const PoolStats before = GetPoolStats();
+    void* p = PoolAlloc(1000);
+    CHECK(p != nullptr);
+    p = PoolRealloc(p, 5000);
+    CHECK(p != nullptr);
+    PoolFree(p);
+    CHECK(GetPoolStats().largeAllocs == before.largeAllocs);
+}
+
+} // namespace
+
+int main()
+{
+    TestReuse();
+    TestEvictsLeastRecentClass();
+    TestSmall();
+    return TestResult();
+}
@@ -0,0 +1,375 @@
+// tests/color_profile_test.cpp
+#include "color_profile.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Synthetic matrix/TRC profiles, and the conversion they describe worked out
+// in double precision straight from the profile's (quantised) numbers
+// ---------------------------------------------------------------------------
+
+struct Curve {
+    int                   type = 0;         // para function 0..4, or -1: sampled curv
+    std::vector<double>   params;           // para
+    std::vector<uint16_t> table;            // curv; one entry: gamma in u8.8
+};
+
+struct Profile {
+    const char* description;
+    double      colorants[3][3];            // rows rXYZ, gXYZ, bXYZ
+    Curve       trc;                        // shared by the three channels
+};
+
+void Put32(std::vector<uint8_t>& v, size_t at, uint32_t x)
+{
+    v[at] = uint8_t(x >> 24); v[at + 1] = uint8_t(x >> 16); v[at + 2] = uint8_t(x >> 8); v[at + 3] = uint8_t(x);
+}
+void Append16(std::vector<uint8_t>& v, uint32_t x) { v.push_back(uint8_t(x >> 8)); v.push_back(uint8_t(x)); }
+void Append32(std::vector<uint8_t>& v, uint32_t x) { Append16(v, x >> 16); Append16(v, x & 0xFFFF); }
+void AppendSig(std::vector<uint8_t>& v, const char* s) { v.insert(v.end(), s, s + 4); }
+int32_t S15F16(double x) { return int32_t(std::lround(x * 65536.0)); }
+
+std::vector<uint8_t> BuildIcc(const Profile& p)
+{
+    struct Tag { const char* sig; std::vector<uint8_t> body; };
+    std::vector<Tag> tags;
+
+    std::vector<uint8_t> desc;
+    AppendSig(desc, "desc");
+    Append32(desc, 0);
+    Append32(desc, uint32_t(std::strlen(p.description) + 1));
+    desc.insert(desc.end(), p.description, p.description + std::strlen(p.description) + 1);
+    tags.push_back({ "desc", desc });
+
+    const char* xyzSigs[3] = { "rXYZ", "gXYZ", "bXYZ" };
+    for (int k = 0; k < 3; ++k) {
+        std::vector<uint8_t> xyz;
+        AppendSig(xyz, "XYZ ");
+        Append32(xyz, 0);
+        for (int r = 0; r < 3; ++r) Append32(xyz, uint32_t(S15F16(p.colorants[k][r])));
+        tags.push_back({ xyzSigs[k], xyz });
+    }
+
+    std::vector<uint8_t> trc;
+    if (p.trc.type < 0) {
+        AppendSig(trc, "curv");
+        Append32(trc, 0);
+        Append32(trc, uint32_t(p.trc.table.size()));
+        for (uint16_t e : p.trc.table) Append16(trc, e);
+    } else {
+        AppendSig(trc, "para");
+        Append32(trc, 0);
+        Append16(trc, uint32_t(p.trc.type));
+        Append16(trc, 0);
+        for (double x : p.trc.params) Append32(trc, uint32_t(S15F16(x)));
+    }
+    for (const char* sig : { "rTRC", "gTRC", "bTRC" }) tags.push_back({ sig, trc });
+
+    std::vector<uint8_t> icc(128 + 4 + tags.size() * 12, 0);
+    Put32(icc, 8, 0x02100000);
+    std::memcpy(&icc[12], "mntr", 4);
+    std::memcpy(&icc[16], "RGB ", 4);
+    std::memcpy(&icc[20], "XYZ ", 4);
+    std::memcpy(&icc[36], "acsp", 4);
+    Put32(icc, 128, uint32_t(tags.size()));
+    for (size_t i = 0; i < tags.size(); ++i) {
+        while (icc.size() % 4) icc.push_back(0);
+        const size_t e = 132 + i * 12;
+        std::memcpy(&icc[e], tags[i].sig, 4);
+        Put32(icc, e + 4, uint32_t(icc.size()));
+        Put32(icc, e + 8, uint32_t(tags[i].body.size()));
+        icc.insert(icc.end(), tags[i].body.begin(), tags[i].body.end());
+    }
+    Put32(icc, 0, uint32_t(icc.size()));
+    return icc;
+}
+
+// The curve as stored: para parameters and colorants through s15Fixed16,
+// curv entries through u16
+double EvalCurve(const Curve& c, double x)
+{
+    if (c.type < 0) {
+        if (c.table.size() == 1) return std::pow(x, c.table[0] / 256.0);
+        const double pos = x * double(c.table.size() - 1);
+        const size_t i = std::min(size_t(pos), c.table.size() - 2);
+        return (c.table[i] + (c.table[i + 1] - double(c.table[i])) * (pos - double(i))) / 65535.0;
+    }
+    double v[7] = { 1, 1, 0, 0, 0, 0, 0 };
+    for (size_t i = 0; i < c.params.size(); ++i) v[i] = S15F16(c.params[i]) / 65536.0;
+    const double g = v[0], a = v[1], b = v[2], cc = v[3], d = v[4];
+    switch (c.type) {
+    case 0:  return std::pow(x, g);
+    case 3:  return x >= d ? std::pow(a * x + b, g) : cc * x;
+    default: return -1.0;                               // not used here
+    }
+}
+
+// sRGB colorants adapted to D50, the destination every profile converts to
+const double kSrgbColorants[3][3] = {
+    { 0.4360747, 0.2225045, 0.0139322 },
+    { 0.3850649, 0.7168786, 0.0971045 },
+    { 0.1430804, 0.0606169, 0.7141733 },
+};
+
+// Reference conversion: linearise, source RGB -> XYZ (D50) -> linear sRGB,
+// clamp, encode, round
+struct Reference {
+    double linear[256];
+    double matrix[3][3];                    // linear source -> linear sRGB
+
+    explicit Reference(const Profile& p)
+    {
+        for (int i = 0; i < 256; ++i) linear[i] = EvalCurve(p.trc, i / 255.0);
+        double toXyz[3][3], fromXyz[3][3];
+        for (int r = 0; r < 3; ++r)
+            for (int k = 0; k < 3; ++k) toXyz[r][k] = S15F16(p.colorants[k][r]) / 65536.0;
+        double s[3][3];
+        for (int r = 0; r < 3; ++r)
+            for (int k = 0; k < 3; ++k) s[r][k] = kSrgbColorants[k][r];
+        const double det = s[0][0] * (s[1][1] * s[2][2] - s[1][2] * s[2][1]) -
+                           s[0][1] * (s[1][0] * s[2][2] - s[1][2] * s[2][0]) +
+                           s[0][2] * (s[1][0] * s[2][1] - s[1][1] * s[2][0]);
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c) {
+                const int r1 = (c + 1) % 3, r2 = (c + 2) % 3, c1 = (r + 1) % 3, c2 = (r + 2) % 3;
+                fromXyz[r][c] = (s[r1][c1] * s[r2][c2] - s[r1][c2] * s[r2][c1]) / det;
+            }
+        for (int r = 0; r < 3; ++r)
+            for (int c = 0; c < 3; ++c)
+                matrix[r][c] = fromXyz[r][0] * toXyz[0][c] + fromXyz[r][1] * toXyz[1][c] + fromXyz[r][2] * toXyz[2][c];
+    }
+
+    void Convert(const uint8_t* in, double out[3]) const
+    {
+        for (int r = 0; r < 3; ++r) {
+            double v = matrix[r][0] * linear[in[0]] + matrix[r][1] * linear[in[1]] + matrix[r][2] * linear[in[2]];
+            v = std::clamp(v, 0.0, 1.0);
+            out[r] = 255.0 * (v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055);
+        }
+    }
+};
+
+const double kSrgbCurve[5] = { 2.4, 1.0 / 1.055, 0.055 / 1.055, 1.0 / 12.92, 0.04045 };
+
+Profile DisplayP3()
+{
+    return { "Display P3 (test)",
+             { { 0.5151, 0.2412, -0.0011 }, { 0.2920, 0.6922, 0.0419 }, { 0.1571, 0.0666, 0.7841 } },
+             { 3, std::vector<double>(kSrgbCurve, kSrgbCurve + 5), {} } };
+}
+
+Profile AdobeRgb()
+{
+    return { "Adobe RGB (test)",
+             { { 0.6097, 0.3111, 0.0195 }, { 0.2053, 0.6257, 0.0609 }, { 0.1492, 0.0632, 0.7446 } },
+             { -1, {}, { 563 } } };                                    // gamma 2.2 as u8.8
+}
+
+// Wider than sRGB in every direction, so clamping matters, with a sampled curve
+Profile ProPhotoSampled()
+{
+    Profile p = { "ProPhoto, sampled (test)",
+                  { { 0.7977, 0.2880, 0.0 }, { 0.1352, 0.7119, 0.0 }, { 0.0313, 0.0001, 0.8249 } },
+                  { -1, {}, {} } };
+    for (int i = 0; i < 1024; ++i) p.trc.table.push_back(uint16_t(std::lround(std::pow(i / 1023.0, 1.8) * 65535.0)));
+    return p;
+}
+
+Profile Srgb()
+{
+    Profile p = { "sRGB (test)", {}, { 3, std::vector<double>(kSrgbCurve, kSrgbCurve + 5), {} } };
+    for (int k = 0; k < 3; ++k)
+        for (int r = 0; r < 3; ++r) p.colorants[k][r] = kSrgbColorants[k][r];
+    return p;
+}
+
+// ---------------------------------------------------------------------------
+
+// Converts `pixels` and compares each with the reference: never more than a
+// code off, alpha untouched
+void CheckAgainstReference(const Profile& p, std::vector<uint8_t> rgba, int w, int h)
+{
+    const std::vector<uint8_t> icc = BuildIcc(p);
+    const auto xf = GetColorTransform(icc);
+    CHECK(xf != nullptr);
+    if (!xf) return;
+    CHECK(xf->Description() == p.description);
+
+    const std::vector<uint8_t> src = rgba;
+    xf->Apply(rgba.data(), w, h);
+    const Reference ref(p);
+    double maxErr = 0.0;
+    size_t exact = 0;
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        double want[3];
+        ref.Convert(&src[i], want);
+        for (int k = 0; k < 3; ++k) {
+            const double err = std::fabs(rgba[i + k] - want[k]);
+            maxErr = std::max(maxErr, err);
+            exact += rgba[i + k] == uint8_t(want[k] + 0.5);
+        }
+        CHECK(rgba[i + 3] == src[i + 3]);
+    }
+    std::printf("%-26s %8zu px  max error %.3f codes  %.2f%% rounded exactly\n", p.description, rgba.size() / 4,
+                maxErr, 100.0 * double(exact) / double(rgba.size() / 4 * 3));
+    CHECK(maxErr < 1.0);
+}
+
+// Every 8-bit input for one profile, random ones for the others
+void TestConversion()
+{
+    std::vector<uint8_t> cube(size_t(1) << 26);
+    std::mt19937 rng(3);
+    for (uint32_t i = 0; i < (1u << 24); ++i) {
+        cube[size_t(i) * 4 + 0] = uint8_t(i);
+        cube[size_t(i) * 4 + 1] = uint8_t(i >> 8);
+        cube[size_t(i) * 4 + 2] = uint8_t(i >> 16);
+        cube[size_t(i) * 4 + 3] = uint8_t(rng());
+    }
+    CheckAgainstReference(DisplayP3(), cube, 4096, 4096);
+
+    std::vector<uint8_t> random(size_t(1) << 20);
+    for (uint8_t& b : random) b = uint8_t(rng());
+    CheckAgainstReference(AdobeRgb(), random, 512, 512);
+    CheckAgainstReference(ProPhotoSampled(), random, 512, 512);
+}
+
+// sRGB needs no transform; the same bytes give the same cached transform
+void TestCacheAndIdentity()
+{
+    CHECK(GetColorTransform(BuildIcc(Srgb())) == nullptr);
+    const std::vector<uint8_t> icc = BuildIcc(AdobeRgb());
+    const auto a = GetColorTransform(icc);
+    const auto b = GetColorTransform(std::vector<uint8_t>(icc));
+    CHECK(a && a == b);
+    CHECK(GetColorTransform(BuildIcc(DisplayP3())) != a);
+}
+
+// Damaged or unsupported profiles are ignored, whatever is wrong with them
+void TestMalformed()
+{
+    const std::vector<uint8_t> icc = BuildIcc(DisplayP3());
+    for (size_t cut = 0; cut < icc.size(); cut += 7)
+        CHECK(GetColorTransform(std::vector<uint8_t>(icc.begin(), icc.begin() + cut)) == nullptr);
+
+    std::vector<uint8_t> gray(icc);
+    std::memcpy(&gray[16], "GRAY", 4);
+    CHECK(GetColorTransform(gray) == nullptr);
+
+    std::vector<uint8_t> farTag(icc);
+    Put32(farTag, 132 + 12 * 2 + 4, 0x7FFFFFF0);                  // gXYZ offset past the end
+    CHECK(GetColorTransform(farTag) == nullptr);
+
+    std::vector<uint8_t> tooManyTags(icc);
+    Put32(tooManyTags, 128, 0x10000000);
+    CHECK(GetColorTransform(tooManyTags) == nullptr);
+
+    std::vector<uint8_t> noBlueCurve(icc);
+    std::memcpy(&noBlueCurve[132 + 12 * 6], "xTRC", 4);
+    CHECK(GetColorTransform(noBlueCurve) == nullptr);
+
+    std::vector<uint8_t> badPara(icc);
+    const size_t trcAt = (size_t(badPara[132 + 12 * 4 + 4]) << 24 | size_t(badPara[132 + 12 * 4 + 5]) << 16 |
+                          size_t(badPara[132 + 12 * 4 + 6]) << 8 | badPara[132 + 12 * 4 + 7]);
+    badPara[trcAt + 9] = 9;                                         // no such para function
+    CHECK(GetColorTransform(badPara) == nullptr);
+}
+
+uint32_t Crc32(const uint8_t* p, size_t n)
+{
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) {
+        c ^= p[i];
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+    }
+    return ~c;
+}
+
+void AppendPngChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& body)
+{
+    Append32(png, uint32_t(body.size()));
+    const size_t start = png.size();
+    AppendSig(png, type);
+    png.insert(png.end(), body.begin(), body.end());
+    Append32(png, Crc32(&png[start], png.size() - start));
+}
+
+// The profile comes back out of a JPEG's APP2 chunks (in any order) and a
+// PNG's iCCP chunk
+void TestContainers()
+{
+    const std::vector<uint8_t> icc = BuildIcc(ProPhotoSampled());
+    const size_t half = icc.size() / 2;
+
+    std::vector<uint8_t> jpeg = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    const auto app2 = [&](int seq, size_t from, size_t to) {
+        jpeg.insert(jpeg.end(), { 0xFF, 0xE2 });
+        Append16(jpeg, uint32_t(2 + 14 + (to - from)));
+        const char tag[] = "ICC_PROFILE";
+        jpeg.insert(jpeg.end(), tag, tag + 12);
+        jpeg.insert(jpeg.end(), { uint8_t(seq), 2 });
+        jpeg.insert(jpeg.end(), icc.begin() + ptrdiff_t(from), icc.begin() + ptrdiff_t(to));
+    };
+    app2(2, half, icc.size());
+    app2(1, 0, half);
+    jpeg.insert(jpeg.end(), { 0xFF, 0xDA, 0x00, 0x08, 1, 1, 0, 0, 63, 0, 0x12, 0x34, 0xFF, 0xD9 });
+
+    std::vector<uint8_t> found;
+    CHECK(FindIccProfile(jpeg.data(), jpeg.size(), found) && found == icc);
+    CHECK(EmbeddedColorTransform(jpeg.data(), jpeg.size()) == GetColorTransform(icc));
+
+    // a chunk missing: no profile
+    std::vector<uint8_t> oneChunk(jpeg);
+    const size_t firstApp2End = 20 + 4 + 14 + (icc.size() - half);
+    oneChunk.erase(oneChunk.begin() + 20, oneChunk.begin() + ptrdiff_t(firstApp2End));
+    CHECK(!FindIccProfile(oneChunk.data(), oneChunk.size(), found));
+
+    // PNG: the profile deflated as stored blocks, which is still zlib
+    std::vector<uint8_t> z = { 0x78, 0x01 };
+    uint32_t s1 = 1, s2 = 0;
+    for (size_t at = 0; at < icc.size();) {
+        const size_t n = std::min<size_t>(icc.size() - at, 1000);
+        z.push_back(at + n == icc.size() ? 1 : 0);
+        z.insert(z.end(), { uint8_t(n), uint8_t(n >> 8), uint8_t(~n), uint8_t(~n >> 8) });
+        z.insert(z.end(), icc.begin() + ptrdiff_t(at), icc.begin() + ptrdiff_t(at + n));
+        for (size_t i = at; i < at + n; ++i) { s1 = (s1 + icc[i]) % 65521; s2 = (s2 + s1) % 65521; }
+        at += n;
+    }
+    Append32(z, s2 << 16 | s1);
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<uint8_t> ihdr;
+    Append32(ihdr, 1);
+    Append32(ihdr, 1);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });
+    AppendPngChunk(png, "IHDR", ihdr);
+    std::vector<uint8_t> iccp = { 'w', 'i', 'd', 'e', 0, 0 };
+    iccp.insert(iccp.end(), z.begin(), z.end());
+    AppendPngChunk(png, "iCCP", iccp);
+    AppendPngChunk(png, "IEND", {});
+    found.clear();
+    CHECK(FindIccProfile(png.data(), png.size(), found) && found == icc);
+
+    // cut before the end of the iCCP chunk: no profile, no overrun
+    for (size_t cut = 8; cut < png.size() - 12; cut += 97) CHECK(!FindIccProfile(png.data(), cut, found));
+}
+
+} // namespace
+
+int main()
+{
+    TestConversion();
+    TestCacheAndIdentity();
+    TestMalformed();
+    TestContainers();
+    return TestResult();
+}
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# Writes the PNG corpus png_test decodes: every color type at every bit depth
+# PNG allows, each scanline filter on its own and mixed per row, Adam7
+# interlacing, tRNS, stored and compressed zlib streams and IDAT split over
+# several chunks. File names spell out the variant. Run from this directory;
+# the output is deterministic.
+import random
+import struct
+import zlib
+
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+DEPTHS = {0: (1, 2, 4, 8, 16), 2: (8, 16), 3: (1, 2, 4, 8), 4: (8, 16), 6: (8, 16)}
+ADAM7 = ((0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2))
+
+
+def chunk(kind, data):
+    body = kind + data
+    return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def sample(rng, x, y, c, depth):
+    # gradients with a little noise: compressible, yet every filter sees
+    # nonzero differences
+    top = (1 << depth) - 1
+    v = (x * (37 + 11 * c) + y * (23 + 7 * c)) * top // 500 + rng.randrange(0, max(2, top // 16))
+    return v % (top + 1)
+
+
+def pack_row(values, depth):
+    if depth == 16:
+        return b"".join(struct.pack(">H", v) for v in values)
+    if depth == 8:
+        return bytes(values)
+    out, acc, bits = bytearray(), 0, 0
+    for v in values:
+        acc = (acc << depth) | v
+        bits += depth
+        if bits == 8:
+            out.append(acc)
+            acc, bits = 0, 0
+    if bits:
+        out.append(acc << (8 - bits))
+    return bytes(out)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_rows(rows, bpp, filt):
+    out = bytearray()
+    prev = bytes(len(rows[0])) if rows else b""
+    for i, row in enumerate(rows):
+        f = i % 5 if filt == "mixed" else filt
+        line = bytearray(len(row))
+        for j, x in enumerate(row):
+            a = row[j - bpp] if j >= bpp else 0
+            b = prev[j]
+            c = prev[j - bpp] if j >= bpp else 0
+            pred = (0, a, b, (a + b) // 2, paeth(a, b, c))[f]
+            line[j] = (x - pred) & 0xFF
+        out.append(f)
+        out += line
+        prev = row
+    return bytes(out)
+
+
+def write(name, w, h, ctype, depth, filt="mixed", interlace=False, trns=False, level=9, split=0, seed=1):
+    rng = random.Random(seed)
+    ch = CHANNELS[ctype]
+    palette_size = min(256, 1 << depth) if ctype == 3 else 0
+    pixels = [[[sample(rng, x, y, c, depth) for c in range(ch)] for x in range(w)] for y in range(h)]
+    if ctype == 3:
+        pixels = [[[(x * 3 + y * 5 + rng.randrange(3)) % palette_size] for x in range(w)] for y in range(h)]
+    bpp = max(1, ch * depth // 8)
+
+    def rows_of(xs, ys):
+        return [pack_row([v for x in xs for v in pixels[y][x]], depth) for y in ys]
+
+    if interlace:
+        data = b""
+        for x0, y0, dx, dy in ADAM7:
+            xs, ys = range(x0, w, dx), range(y0, h, dy)
+            if len(xs) and len(ys):
+                data += filter_rows(rows_of(xs, ys), bpp, filt)
+    else:
+        data = filter_rows(rows_of(range(w), range(h)), bpp, filt)
+
+    png = b"\x89PNG\r\n\x1a\n"
+    png += chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, depth, ctype, 0, 0, 1 if interlace else 0))
+    if ctype == 3:
+        png += chunk(b"PLTE", bytes(rng.randrange(256) for _ in range(3 * palette_size)))
+        if trns:
+            png += chunk(b"tRNS", bytes(rng.randrange(256) for _ in range(palette_size // 2 or 1)))
+    elif trns:
+        key = pixels[h // 2][w // 2]
+        png += chunk(b"tRNS", b"".join(struct.pack(">H", v) for v in key))
+    z = zlib.compress(data, level)
+    parts = [z] if not split else [z[i:i + split] for i in range(0, len(z), split)]
+    for p in parts:
+        png += chunk(b"IDAT", p)
+    png += chunk(b"IEND", b"")
+    with open(name, "wb") as f:
+        f.write(png)
+
+
+TYPE_NAME = {0: "gray", 2: "rgb", 3: "palette", 4: "grayalpha", 6: "rgba"}
+FILTER_NAME = {0: "none", 1: "sub", 2: "up", 3: "avg", 4: "paeth", "mixed": "mixed"}
+
+# The fast path's cases: 8-bit, non-interlaced, each filter alone, at an odd
+# width and at one past the SSE2 kernels' 16-byte step
+for ctype in (0, 2, 4, 6):
+    for filt in FILTER_NAME:
+        for w, h in ((37, 23), (65, 9)):
+            write(f"{TYPE_NAME[ctype]}8_{FILTER_NAME[filt]}_{w}x{h}.png", w, h, ctype, 8, filt, seed=w + ctype)
+
+# Every other depth, interlaced or not
+for ctype, depths in DEPTHS.items():
+    for depth in depths:
+        for interlace in (False, True):
+            if depth == 8 and not interlace and ctype != 3:
+                continue
+            suffix = "_adam7" if interlace else ""
+            write(f"{TYPE_NAME[ctype]}{depth}{suffix}_19x13.png", 19, 13, ctype, depth, interlace=interlace, seed=depth)
+
+# Sizes smaller than an Adam7 block, where some passes are empty
+for w, h in ((1, 1), (2, 3), (5, 1)):
+    write(f"rgba8_adam7_{w}x{h}.png", w, h, 6, 8, interlace=True)
+    write(f"rgba8_{w}x{h}.png", w, h, 6, 8)
+
+# Transparency keys and palette alpha
+write("gray8_trns_17x9.png", 17, 9, 0, 8, trns=True)
+write("rgb8_trns_17x9.png", 17, 9, 2, 8, trns=True)
+write("rgb16_trns_17x9.png", 17, 9, 2, 16, trns=True)
+write("palette8_trns_17x9.png", 17, 9, 3, 8, trns=True)
+write("palette4_trns_17x9.png", 17, 9, 3, 4, trns=True)
+
+# zlib streams: stored blocks, fast compression, and IDAT split into chunks
+# of a few bytes
+write("rgba8_stored_33x17.png", 33, 17, 6, 8, level=0)
+write("rgb8_level1_33x17.png", 33, 17, 2, 8, level=1)
+write("rgba8_split_33x17.png", 33, 17, 6, 8, split=7)
+write("gray8_split_33x17.png", 33, 17, 0, 8, split=1)
+
+# A wider image, so the unfilter kernels run many steps per row
+write("rgba8_mixed_301x41.png", 301, 41, 6, 8)
+write("rgb8_paeth_301x41.png", 301, 41, 2, 8, 4)
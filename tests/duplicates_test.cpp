@@ -0,0 +1,274 @@
+// tests/duplicates_test.cpp
+#include "duplicates.h"
+#include "test.h"
+#include "thumbnails.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_RESIZE2_IMPLEMENTATION
+#include "stb_image_resize2.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// A photo-like scene evaluated at any size: a tilted gradient under a few
+// soft blobs, so the same scene at two sizes is a resized copy
+void DrawScene(int scene, int w, int h, int brighten, int noise, std::vector<uint8_t>& rgba)
+{
+    std::mt19937 rng(uint32_t(scene) * 7919u + 1);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    struct Blob { float x, y, r, c[3]; } blobs[6];
+    for (Blob& b : blobs) b = { u(rng), u(rng), 0.08f + 0.25f * u(rng), { u(rng), u(rng), u(rng) } };
+    const float gx = u(rng) - 0.5f, gy = u(rng) - 0.5f;
+
+    std::mt19937 grain(uint32_t(w * 31 + h));
+    rgba.resize(size_t(w) * h * 4);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            const float fx = (x + 0.5f) / float(w), fy = (y + 0.5f) / float(h);
+            float c[3];
+            for (int k = 0; k < 3; ++k) c[k] = 0.35f + 0.3f * (gx * fx + gy * fy);
+            for (const Blob& b : blobs) {
+                const float d2 = ((fx - b.x) * (fx - b.x) + (fy - b.y) * (fy - b.y)) / (b.r * b.r);
+                const float wgt = std::exp(-d2);
+                for (int k = 0; k < 3; ++k) c[k] += (b.c[k] - 0.5f) * wgt;
+            }
+            uint8_t* p = &rgba[(size_t(y) * w + x) * 4];
+            for (int k = 0; k < 3; ++k) {
+                int v = int(c[k] * 255.0f) + brighten;
+                if (noise) v += int(grain() % uint32_t(2 * noise + 1)) - noise;
+                p[k] = uint8_t(std::clamp(v, 0, 255));
+            }
+            p[3] = 255;
+        }
+}
+
+// Variants of one scene, as a library holds them: the original, a smaller
+// re-export, a brighter edit, and a grainy copy; drawn to fit maxSize as
+// a reduced decode would
+void DrawVariant(int scene, int variant, std::vector<uint8_t>& rgba, int& w, int& h, int maxSize = 1 << 16)
+{
+    w = variant == 1 ? 97 : 160;
+    h = variant == 1 ? 73 : 120;
+    if (w > maxSize) {
+        h = std::max(1, h * maxSize / w);
+        w = maxSize;
+    }
+    DrawScene(scene, w, h, variant == 2 ? 12 : 0, variant == 3 ? 6 : 0, rgba);
+}
+
+} // namespace
+
+// Stands in for the real decoder: "s<scene>_<variant>.png" is drawn,
+// anything else fails to decode
+bool MakeThumbnail(const std::wstring& path, int maxSize, Thumbnail& out, bool)
+{
+    const size_t slash = path.find_last_of(L"\\/");
+    const std::wstring name = path.substr(slash == std::wstring::npos ? 0 : slash + 1);
+    int scene = 0, variant = 0;
+    if (std::swscanf(name.c_str(), L"s%d_%d.png", &scene, &variant) != 2) return false;
+    std::vector<uint8_t> rgba;
+    DrawVariant(scene, variant, rgba, out.w, out.h, maxSize);
+    out.rgba.assign(rgba.begin(), rgba.end());
+    out.source = "full";
+    return true;
+}
+
+namespace {
+
+uint64_t HashOf(int scene, int variant)
+{
+    std::vector<uint8_t> rgba;
+    int w, h;
+    DrawVariant(scene, variant, rgba, w, h);
+    return PerceptualHash(rgba.data(), w, h);
+}
+
+void TestPerceptualHash()
+{
+    const int scenes = 12;
+    std::vector<uint64_t> originals;
+    for (int s = 0; s < scenes; ++s) {
+        originals.push_back(HashOf(s, 0));
+        CHECK(HashOf(s, 0) == originals.back());
+        CHECK((originals.back() & 1) == 0);                     // DC is not a bit
+        for (int v = 1; v < 4; ++v) CHECK(HammingDistance(HashOf(s, v), originals.back()) <= kDuplicateDistance);
+    }
+    for (int a = 0; a < scenes; ++a)
+        for (int b = a + 1; b < scenes; ++b) CHECK(HammingDistance(originals[size_t(a)], originals[size_t(b)]) > kDuplicateDistance);
+
+    // above the median: about half of the 63 AC bits are set
+    for (uint64_t hsh : originals) CHECK(HammingDistance(hsh, 0) >= 20 && HammingDistance(hsh, 0) <= 31);
+
+    // a 1x1 and a flat image still hash
+    std::vector<uint8_t> flat(64 * 64 * 4, 128);
+    CHECK(PerceptualHash(flat.data(), 1, 1) == PerceptualHash(flat.data(), 64, 64));
+}
+
+// Clusters of hashes a few bits around random centres
+std::vector<uint64_t> ClusteredHashes(std::mt19937_64& rng, int clusters, int perCluster, int spread)
+{
+    std::vector<uint64_t> hashes;
+    for (int c = 0; c < clusters; ++c) {
+        const uint64_t centre = rng();
+        for (int i = 0; i < perCluster; ++i) {
+            uint64_t hsh = centre;
+            for (int k = int(rng() % uint64_t(spread + 1)); k > 0; --k) hsh ^= uint64_t(1) << (rng() % 64);
+            hashes.push_back(hsh);
+        }
+    }
+    std::shuffle(hashes.begin(), hashes.end(), rng);
+    return hashes;
+}
+
+void TestHashIndex()
+{
+    CHECK(HammingDistance(0, ~uint64_t(0)) == 64 && HammingDistance(0x5, 0x3) == 2);
+
+    std::mt19937_64 rng(3);
+    const std::vector<uint64_t> hashes = ClusteredHashes(rng, 60, 20, 14);
+    HashIndex index;
+    std::vector<int> out;
+    index.Query(hashes[0], 64, out);
+    CHECK(out.empty());
+    for (size_t i = 0; i < hashes.size(); ++i) index.Insert(hashes[i], int(i));
+    CHECK(index.Size() == hashes.size());
+
+    for (int q = 0; q < 200; ++q) {
+        const uint64_t query = q % 2 ? hashes[rng() % hashes.size()] : rng();
+        for (int maxDist : { 0, 3, kDuplicateDistance, 20 }) {
+            std::vector<int> want;
+            for (size_t i = 0; i < hashes.size(); ++i)
+                if (HammingDistance(query, hashes[i]) <= maxDist) want.push_back(int(i));
+            out.clear();
+            index.Query(query, maxDist, out);
+            std::sort(out.begin(), out.end());
+            CHECK(out == want);
+        }
+    }
+}
+
+// Groups are the connected components of "within maxDist", each in index
+// order, ordered by first member, singletons and invalid files left out
+std::vector<std::vector<int>> NaiveGroups(const std::vector<uint64_t>& hashes, const std::vector<uint8_t>& valid,
+                                          int maxDist)
+{
+    const int n = int(hashes.size());
+    std::vector<int> comp(size_t(n), -1);
+    std::vector<std::vector<int>> groups;
+    for (int i = 0; i < n; ++i) {
+        if (!valid[size_t(i)] || comp[size_t(i)] >= 0) continue;
+        std::vector<int> members{ i }, todo{ i };
+        comp[size_t(i)] = i;
+        while (!todo.empty()) {
+            const int a = todo.back();
+            todo.pop_back();
+            for (int b = 0; b < n; ++b)
+                if (valid[size_t(b)] && comp[size_t(b)] < 0 && HammingDistance(hashes[size_t(a)], hashes[size_t(b)]) <= maxDist) {
+                    comp[size_t(b)] = i;
+                    members.push_back(b);
+                    todo.push_back(b);
+                }
+        }
+        std::sort(members.begin(), members.end());
+        if (members.size() > 1) groups.push_back(members);
+    }
+    return groups;
+}
+
+void TestGroups()
+{
+    std::mt19937_64 rng(9);
+    for (int spread : { 4, 12 }) {
+        const std::vector<uint64_t> hashes = ClusteredHashes(rng, 80, 6, spread);
+        std::vector<uint8_t> valid(hashes.size());
+        for (uint8_t& v : valid) v = rng() % 10 != 0;
+        const DuplicateGroups g = FindDuplicateGroups(hashes, valid, kDuplicateDistance);
+        CHECK(g.groups == NaiveGroups(hashes, valid, kDuplicateDistance));
+        int files = 0;
+        for (const auto& grp : g.groups) files += int(grp.size());
+        CHECK(g.Files() == files);
+    }
+
+    // a chain links transitively, however far apart its ends are
+    std::vector<uint64_t> chain;
+    uint64_t hsh = 0;
+    for (int i = 0; i < 6; ++i, hsh |= uint64_t(0xFF) << (8 * i)) chain.push_back(hsh);
+    const DuplicateGroups g = FindDuplicateGroups(chain, std::vector<uint8_t>(chain.size(), 1), 8);
+    CHECK(g.groups.size() == 1 && g.groups[0].size() == chain.size());
+    CHECK(FindDuplicateGroups({}, {}, kDuplicateDistance).groups.empty());
+}
+
+bool WaitFinished(DuplicateFinder& finder)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 30s;
+    while (!finder.TakeFinished()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+// A folder of scenes in several variants, shuffled, with files that do not
+// decode: each scene's variants form one group
+void TestFinder()
+{
+    std::mt19937 rng(4);
+    std::vector<std::wstring> paths;
+    for (int s = 0; s < 30; ++s)
+        for (int v = 0; v < 1 + s % 4; ++v) paths.push_back(L"C:\\lib\\s" + std::to_wstring(s) + L"_" + std::to_wstring(v) + L".png");
+    paths.push_back(L"C:\\lib\\notes.txt");
+    paths.push_back(L"C:\\lib\\broken.png");
+    std::shuffle(paths.begin(), paths.end(), rng);
+    FileList files;
+    for (const std::wstring& p : paths) files.push_back(p);
+
+    DuplicateFinder finder;
+    CHECK(!finder.Running() && !finder.TakeFinished());
+    finder.Start(files);
+    CHECK(WaitFinished(finder));
+    CHECK(!finder.TakeFinished());                          // once per run
+    CHECK(!finder.Running() && finder.Hashed() == finder.Total() && finder.Total() == int(files.size()));
+    CHECK(finder.Ms() >= 0.0);
+
+    // expected: positions of each scene with two or more variants
+    std::vector<std::vector<int>> want;
+    for (int s = 0; s < 30; ++s) {
+        std::vector<int> members;
+        for (size_t i = 0; i < files.size(); ++i) {
+            int scene = -1, variant = -1;
+            if (std::swscanf(files.Name(files.IdAt(i)).c_str(), L"s%d_%d.png", &scene, &variant) == 2 && scene == s)
+                members.push_back(int(i));
+        }
+        if (members.size() > 1) want.push_back(members);
+    }
+    std::sort(want.begin(), want.end());
+    CHECK(finder.Groups().groups == want);
+    CHECK(finder.Files().size() == files.size());
+
+    // stopped part way, then run again from the start
+    finder.Start(files);
+    finder.Stop();
+    finder.Start(files);
+    CHECK(WaitFinished(finder));
+    CHECK(finder.Groups().groups == want);
+}
+
+} // namespace
+
+int main()
+{
+    TestPerceptualHash();
+    TestHashIndex();
+    TestGroups();
+    TestFinder();
+    return TestResult();
+}
@@ -0,0 +1,202 @@
+// tests/file_search_test.cpp
+#include "file_search.h"
+#include "test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cwctype>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+std::wstring Lower(std::wstring s)
+{
+    for (wchar_t& c : s) c = wchar_t(std::towlower(c));
+    return s;
+}
+
+bool ContainsNoCase(const std::wstring& name, const std::wstring& query)
+{
+    return Lower(name).find(Lower(query)) != std::wstring::npos;
+}
+
+void TestSubstring()
+{
+    NameIndex index;
+    const std::vector<std::wstring> names = { L"IMG_0001.JPG", L"img_0002.jpg", L"Holiday 2019.png", L"DSC01234.NEF",
+                                              L"abcXbcd.gif",  L"holiday.jpg",  L"x.y" };
+    for (const std::wstring& n : names) index.Add(n);
+    CHECK(index.Size() == names.size());
+
+    std::vector<uint32_t> out;
+    CHECK(index.Query(L"img_", out) && (out == std::vector<uint32_t>{ 0, 1 }));
+    CHECK(index.Query(L"HOLIDAY", out) && (out == std::vector<uint32_t>{ 2, 5 }));
+    CHECK(index.Query(L".jpg", out) && (out == std::vector<uint32_t>{ 0, 1, 5 }));
+    CHECK(index.Query(L"y", out) && (out == std::vector<uint32_t>{ 2, 5, 6 }));          // too short for a trigram
+    CHECK(index.Query(L"", out) && out.empty());
+
+    // both trigrams of "abcd" are in "abcXbcd", but not next to each other
+    CHECK(!index.Query(L"abcd", out));
+    CHECK(!out.empty() && out[0] == 4);
+
+    index.Remove(1);
+    index.Remove(1);
+    CHECK(index.Size() == names.size() - 1);
+    CHECK(index.Query(L"img_", out) && (out == std::vector<uint32_t>{ 0 }));
+    CHECK(index.Add(L"img_0003.jpg") == names.size());                  // ids are never reused
+}
+
+// Typos and swapped digits find the name they were meant for first
+void TestFuzzy()
+{
+    NameIndex index;
+    for (int i = 0; i < 2000; ++i) index.Add(L"IMG_" + std::to_wstring(10000 + i) + L".jpg");
+    index.Add(L"Wedding speech final.mp4.png");
+    std::vector<uint32_t> out;
+
+    CHECK(!index.Query(L"weding speech", out) && !out.empty() && out[0] == 2000);
+    CHECK(!index.Query(L"IMG_11243.jgp", out) && !out.empty() && out[0] == 1243);    // jpg, not jgp
+    CHECK(!index.Query(L"qqqqzzzz", out) && out.empty());
+    CHECK(out.size() <= 500);
+}
+
+// Random names and queries against a brute-force scan, with removals
+// enough to compact the index along the way
+void TestAgainstBruteForce()
+{
+    std::mt19937 rng(11);
+    const wchar_t alphabet[] = L"abcdeABCDE_0123 .";
+    const auto randomString = [&](size_t len) {
+        std::wstring s;
+        for (size_t i = 0; i < len; ++i) s += alphabet[rng() % (sizeof(alphabet) / sizeof(wchar_t) - 1)];
+        return s;
+    };
+
+    NameIndex index;
+    std::vector<std::wstring> names;
+    std::vector<bool> alive;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 6000; ++i) {
+            names.push_back(randomString(4 + rng() % 20));
+            alive.push_back(true);
+            CHECK(index.Add(names.back()) == names.size() - 1);
+        }
+        for (int i = 0; i < 5000; ++i) {
+            const uint32_t id = uint32_t(rng() % names.size());
+            if (alive[id]) index.Remove(id);
+            alive[id] = false;
+        }
+        CHECK(index.Size() == size_t(std::count(alive.begin(), alive.end(), true)));
+
+        for (int q = 0; q < 300; ++q) {
+            std::wstring query;
+            if (q % 2) {
+                const std::wstring& n = names[rng() % names.size()];
+                const size_t at = rng() % n.size();
+                query = n.substr(at, 1 + rng() % (n.size() - at));
+            } else {
+                query = randomString(1 + rng() % 5);
+            }
+            std::vector<uint32_t> want;
+            for (uint32_t id = 0; id < names.size(); ++id)
+                if (alive[id] && ContainsNoCase(names[id], query)) want.push_back(id);
+
+            std::vector<uint32_t> got;
+            const bool exact = index.Query(query, got);
+            if (!want.empty()) {
+                CHECK(exact && got == want);
+            } else {
+                CHECK(!exact || query.size() < 3);
+                for (uint32_t id : got) CHECK(alive[id] && !ContainsNoCase(names[id], query));
+            }
+        }
+    }
+}
+
+// Waits for the worker to finish the list given last
+bool WaitIndexed(const FileSearch& search, uint32_t generation)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 20s;
+    while (search.Building() || search.Generation() == generation) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+// Positions in list order, for the names a plain scan of the list finds
+std::vector<int> ScanList(const FileList& files, const std::wstring& query)
+{
+    std::vector<int> out;
+    for (size_t i = 0; i < files.size(); ++i)
+        if (ContainsNoCase(files.Name(files.IdAt(i)), query)) out.push_back(int(i));
+    return out;
+}
+
+void TestFileSearch()
+{
+    FileList files;
+    for (int d = 0; d < 20; ++d)
+        for (int i = 0; i < 500; ++i)
+            files.push_back(L"D:\\Photos\\" + std::to_wstring(2000 + d) + L"\\IMG_" + std::to_wstring(d * 1000 + i) + L".JPG");
+
+    FileSearch search;
+    uint32_t gen = search.Generation();
+    search.SetFiles(files);
+    CHECK(WaitIndexed(search, gen));
+    CHECK(search.Indexed() == int(files.size()) && search.Total() == int(files.size()));
+    CHECK(search.Added() == int(files.size()) && search.Removed() == 0);
+
+    FileSearch::Result r;
+    search.Query(L"img_1901", r);
+    CHECK(!r.fuzzy && r.indices == ScanList(files, L"img_1901"));
+    CHECK(r.indices.size() == 10);                      // IMG_19010..IMG_19019
+    search.Query(L"IMG_19015.jpx", r);
+    CHECK(r.fuzzy && !r.indices.empty() && files.Name(files.IdAt(size_t(r.indices[0]))) == L"IMG_19015.JPG");
+
+    // re-sorted, a folder gone and one new: only the difference is indexed,
+    // and answers are positions in the new list
+    FileList next;
+    for (int d = 20; d >= 1; --d)
+        for (int i = 0; i < 500; ++i)
+            next.push_back(L"D:\\Photos\\" + std::to_wstring(2000 + d) + L"\\IMG_" + std::to_wstring(d * 1000 + i) + L".JPG");
+    gen = search.Generation();
+    search.SetFiles(next);
+    CHECK(WaitIndexed(search, gen));
+    CHECK(search.Added() == 500 && search.Removed() == 500);
+    for (const wchar_t* q : { L"img_0", L"img_20", L"img_19", L"img_1901", L".jpg", L"1" }) {
+        search.Query(q, r);
+        const std::vector<int> want = ScanList(next, q);
+        CHECK(r.fuzzy == want.empty());
+        if (!r.fuzzy) CHECK(r.indices == want);
+    }
+
+    // a list replaced while it is still being indexed: the last one wins
+    FileList big;
+    for (int i = 0; i < 200000; ++i) big.push_back(L"E:\\big\\frame_" + std::to_wstring(i) + L".png");
+    gen = search.Generation();
+    search.SetFiles(big);
+    search.SetFiles(files);
+    CHECK(WaitIndexed(search, gen));
+    CHECK(search.Total() == int(files.size()) && search.Removed() == 500 && search.Added() == 500);
+    search.Query(L"frame_", r);
+    CHECK(r.indices.empty());
+    search.Query(L"img_1901", r);
+    CHECK(r.indices == ScanList(files, L"img_1901"));
+}
+
+} // namespace
+
+int main()
+{
+    TestSubstring();
+    TestFuzzy();
+    TestAgainstBruteForce();
+    TestFileSearch();
+    return TestResult();
+}
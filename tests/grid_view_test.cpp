@@ -0,0 +1,193 @@
+// tests/grid_view_test.cpp
+#include "grid_view.h"
+#include "test.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void TestLayout()
+{
+    GridLayout g;
+    g.Compute(1920, 1080, 100);
+    CHECK(g.cols == 8 && g.rows == 13);
+    CHECK(g.left == 104.0f);                            // (1920 - 8 * 216 + 16) / 2
+    CHECK(g.MaxScroll() == 48.0f * 2 + 13 * 216.0f - 16 - 1080);
+    CHECK(g.VisibleRows() == 4);
+
+    // the middle of every cell hits it, gaps and the margins hit nothing
+    for (int i = 0; i < g.count; ++i) {
+        const float scrollY = g.ScrollToShow(i, 0.0f);
+        const float x = g.CellX(i) + GridLayout::kCell / 2, y = g.CellY(i, scrollY) + GridLayout::kCell / 2;
+        CHECK(g.HitTest(x, y, scrollY) == i);
+        CHECK(g.HitTest(x + GridLayout::kCell / 2 + GridLayout::kGap / 2, y, scrollY) == -1);
+        CHECK(g.HitTest(x, y + GridLayout::kCell / 2 + GridLayout::kGap / 2, scrollY) == -1);
+    }
+    CHECK(g.HitTest(g.left - 1, 100, 0) == -1);
+    CHECK(g.HitTest(g.left + 1, GridLayout::kMargin - 1, 0) == -1);
+
+    // the last row is partly empty: 100 = 12 * 8 + 4
+    const float lastRowY = g.MaxScroll();
+    CHECK(g.HitTest(g.CellX(3) + 10, g.CellY(99, lastRowY) + 10, lastRowY) == 99);
+    CHECK(g.HitTest(g.CellX(4) + 10, g.CellY(99, lastRowY) + 10, lastRowY) == -1);
+
+    // too narrow for one column still makes one; an empty grid never scrolls
+    g.Compute(100, 600, 5);
+    CHECK(g.cols == 1 && g.rows == 5);
+    g.Compute(1920, 1080, 0);
+    CHECK(g.rows == 0 && g.MaxScroll() == 0.0f);
+    CHECK(ThumbnailPriority(g, 0.0f, 1, 4).empty());
+}
+
+// ScrollToShow brings any cell fully on screen, stays put when it already
+// is, and never leaves [0, MaxScroll]
+void TestScrollToShow()
+{
+    GridLayout g;
+    g.Compute(1280, 720, 1000);
+    float scrollY = 0.0f;
+    for (int i : { 0, 7, 500, 999, 998, 3, 250, 251 }) {
+        scrollY = g.ScrollToShow(i, scrollY);
+        CHECK(scrollY >= 0.0f && scrollY <= g.MaxScroll());
+        CHECK(g.CellY(i, scrollY) >= 0.0f && g.CellY(i, scrollY) + GridLayout::kCell <= g.screenH);
+        CHECK(g.ScrollToShow(i, scrollY) == scrollY);
+
+        int first, last;
+        g.VisibleRange(scrollY, first, last);
+        CHECK(first <= i / g.cols && i / g.cols <= last);
+    }
+    // a gap's width clear of the edge
+    CHECK(g.ScrollToShow(0, 12345.0f) == GridLayout::kMargin - GridLayout::kGap);
+    CHECK(g.ScrollToShow(999, 0.0f) == GridLayout::kMargin + g.rows * g.Pitch() - g.screenH);
+}
+
+// Visible rows intersect the screen, the rows just outside do not
+void TestVisibleRange()
+{
+    GridLayout g;
+    g.Compute(1920, 1080, 500);
+    for (float scrollY = 0.0f; scrollY <= g.MaxScroll(); scrollY += 37.0f) {
+        int first, last;
+        g.VisibleRange(scrollY, first, last);
+        CHECK(first >= 0 && last < g.rows && first <= last);
+        if (first > 0) CHECK(g.CellY((first - 1) * g.cols, scrollY) + g.Pitch() <= 0.0f);
+        CHECK(g.CellY(first * g.cols, scrollY) + g.Pitch() > 0.0f);
+        CHECK(g.CellY(last * g.cols, scrollY) <= g.screenH);
+        if (last + 1 < g.rows) CHECK(g.CellY((last + 1) * g.cols, scrollY) > g.screenH);
+    }
+}
+
+// Every cell at most once; the visible ones first, from the middle row
+// out; then the rows ahead in the direction of travel, then half as many
+// behind
+void TestPriority()
+{
+    GridLayout g;
+    g.Compute(1920, 1080, 400);                       // 8 columns, 50 rows
+    const float scrollY = g.ScrollToShow(200, 0.0f);
+    int first, last;
+    g.VisibleRange(scrollY, first, last);
+    const int visible = (last - first + 1) * g.cols;
+
+    for (int dir : { 1, -1 }) {
+        const std::vector<int> order = ThumbnailPriority(g, scrollY, dir, 4);
+        const std::set<int> unique(order.begin(), order.end());
+        CHECK(unique.size() == order.size());
+        CHECK(int(order.size()) == visible + (4 + 2) * g.cols);
+
+        const auto rowOf = [&](int k) { return order[size_t(k)] / g.cols; };
+        CHECK(rowOf(0) == (first + last) / 2);
+        for (int k = 0; k < visible; ++k) CHECK(rowOf(k) >= first && rowOf(k) <= last);
+        for (int k = 1; k < visible; ++k)
+            CHECK(std::abs(rowOf(k) - (first + last) / 2) >= std::abs(rowOf(k - 1) - (first + last) / 2));
+        for (int k = visible; k < visible + 4 * g.cols; ++k) CHECK(dir > 0 ? rowOf(k) > last : rowOf(k) < first);
+        for (int k = visible + 4 * g.cols; k < int(order.size()); ++k)
+            CHECK(dir > 0 ? rowOf(k) < first : rowOf(k) > last);
+    }
+
+    // at the top nothing lies behind, and the partial last row is cut short
+    g.Compute(1920, 1080, 30);
+    const std::vector<int> order = ThumbnailPriority(g, 0.0f, -1, 8);
+    CHECK(order.size() == 30);
+    CHECK(*std::max_element(order.begin(), order.end()) == 29);
+}
+
+void TestAtlasFill()
+{
+    ThumbAtlas atlas(2);
+    atlas.Reset(1000);
+    CHECK(atlas.MaxPages() == 2 && atlas.PagesUsed() == 0);
+    CHECK(atlas.Find(5) == -1 && atlas.Find(-1) == -1 && atlas.Find(1000) == -1);
+
+    // slots in order, so the first page fills before the second is needed
+    int evicted;
+    for (int i = 0; i < ThumbAtlas::kSlotsPerPage; ++i) {
+        CHECK(atlas.Allocate(i, 300, 120, 1, evicted) == i && evicted == -1);
+        CHECK(atlas.PagesUsed() == 1);
+    }
+    CHECK(atlas.Allocate(900, 64, 64, 1, evicted) == ThumbAtlas::kSlotsPerPage && atlas.PagesUsed() == 2);
+
+    // thumbnails larger than a slot are clipped to it
+    const ThumbAtlas::Slot& s = atlas.Get(atlas.Find(3));
+    CHECK(s.file == 3 && s.w == ThumbAtlas::kSlotSize && s.h == 120);
+
+    // a file already in the atlas keeps its slot
+    CHECK(atlas.Allocate(3, 100, 100, 2, evicted) == 3 && evicted == -1 && atlas.Get(3).w == 100);
+    CHECK(atlas.Allocate(1000, 64, 64, 2, evicted) == -1 && atlas.Allocate(-1, 64, 64, 2, evicted) == -1);
+
+    // slots tile their pages without overlap
+    std::set<std::pair<int, int>> corners;
+    for (int slot = 0; slot < 2 * ThumbAtlas::kSlotsPerPage; ++slot) {
+        const int x = ThumbAtlas::SlotX(slot), y = ThumbAtlas::SlotY(slot);
+        CHECK(x % ThumbAtlas::kSlotSize == 0 && x + ThumbAtlas::kSlotSize <= ThumbAtlas::kPageSize);
+        CHECK(y % ThumbAtlas::kSlotSize == 0 && y + ThumbAtlas::kSlotSize <= ThumbAtlas::kPageSize);
+        CHECK(ThumbAtlas::Page(slot) == slot / ThumbAtlas::kSlotsPerPage);
+        corners.insert({ ThumbAtlas::Page(slot) * ThumbAtlas::kPageSize + x, y });
+    }
+    CHECK(int(corners.size()) == 2 * ThumbAtlas::kSlotsPerPage);
+
+    atlas.Reset(10);
+    CHECK(atlas.PagesUsed() == 0 && atlas.Find(3) == -1);
+    CHECK(atlas.Allocate(9, 64, 64, 1, evicted) == 0);
+}
+
+// Once full, the least recently drawn slot goes, never one drawn this frame
+void TestAtlasEviction()
+{
+    ThumbAtlas atlas(1);
+    const int slots = ThumbAtlas::kSlotsPerPage;
+    atlas.Reset(slots * 3);
+    int evicted;
+    for (int i = 0; i < slots; ++i) atlas.Allocate(i, 64, 64, 1, evicted);
+    for (int i = 0; i < slots; ++i)
+        if (i != 17) atlas.Touch(i, 10 + uint64_t(i));
+
+    CHECK(atlas.Allocate(slots, 64, 64, 100, evicted) == 17 && evicted == 17);
+    CHECK(atlas.Find(17) == -1 && atlas.Find(slots) == 17);
+    CHECK(atlas.Allocate(slots + 1, 64, 64, 100, evicted) == 0 && evicted == 0);
+    CHECK(atlas.Allocate(slots + 2, 64, 64, 100, evicted) == 1 && evicted == 1);
+    CHECK(atlas.PagesUsed() == 1);
+
+    // everything drawn this frame: nothing to give
+    for (int i = 0; i < slots; ++i) atlas.Touch(i, 200);
+    CHECK(atlas.Allocate(slots * 2, 64, 64, 200, evicted) == -1 && evicted == -1);
+    CHECK(atlas.Find(slots * 2) == -1);
+    CHECK(atlas.Allocate(slots * 2, 64, 64, 201, evicted) >= 0 && evicted >= 0);
+    CHECK(atlas.Find(evicted) == -1);
+}
+
+} // namespace
+
+int main()
+{
+    TestLayout();
+    TestScrollToShow();
+    TestVisibleRange();
+    TestPriority();
+    TestAtlasFill();
+    TestAtlasEviction();
+    return TestResult();
+}
@@ -0,0 +1,144 @@
+// tests/image_cache_test.cpp
+#include "image_cache.h"
+#include "test.h"
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+std::vector<uint8_t> TestImage(int w, int h, uint32_t seed)
+{
+    std::vector<uint8_t> rgba(size_t(w) * h * 4);
+    std::mt19937 rng(seed);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = &rgba[(size_t(y) * w + x) * 4];
+            p[0] = uint8_t(x * 255 / w);
+            p[1] = uint8_t(y * 255 / h);
+            p[2] = uint8_t(rng() & 0x3F);
+            p[3] = 255;
+        }
+    return rgba;
+}
+
+std::shared_ptr<CachedImage> Entry(size_t bytes)
+{
+    auto img = std::make_shared<CachedImage>();
+    img->bc.blocks.resize(bytes);
+    return img;
+}
+
+// Least recently used entries go once the budget is exceeded, the newest
+// always stays
+void TestCache()
+{
+    CompressedImageCache cache(1000);
+    const auto a = Entry(400), b = Entry(400), c = Entry(400), huge = Entry(5000);
+    cache.Insert(L"a", a);
+    cache.Insert(L"b", b);
+    CHECK(cache.Find(L"a") == a);                   // a is now the most recent
+    cache.Insert(L"c", c);
+    CHECK(cache.Find(L"b") == nullptr && cache.Find(L"a") == a && cache.Find(L"c") == c);
+    CHECK(cache.Count() == 2 && cache.Bytes() == 800);
+    CHECK(cache.Hits() == 3 && cache.Misses() == 1);
+
+    cache.Insert(L"a", b);                          // replaced, not added
+    CHECK(cache.Find(L"a") == b && cache.Bytes() == 800);
+    cache.Insert(L"huge", huge);
+    CHECK(cache.Count() == 1 && cache.Find(L"huge") == huge);
+    cache.Insert(L"none", nullptr);
+    CHECK(cache.Count() == 1);
+    cache.Erase(L"none");
+    cache.Erase(L"huge");
+    CHECK(cache.Count() == 0 && cache.Bytes() == 0 && cache.Find(L"huge") == nullptr);
+    cache.Insert(L"a", a);
+    cache.Clear();
+    CHECK(cache.Count() == 0 && cache.Bytes() == 0);
+}
+
+bool WaitResult(BcEncodeWorker& worker, BcEncodeResult& out)
+{
+    const auto deadline = std::chrono::steady_clock::now() + 20s;
+    while (!worker.TakeResult(out)) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+BcEncodeJob Job(const std::wstring& path, const std::vector<uint8_t>& rgba, int w, int h, BcFormat f, uint64_t tag)
+{
+    BcEncodeJob job;
+    job.path = path;
+    job.rgba.assign(rgba.begin(), rgba.end());
+    job.w = job.imgW = w;
+    job.h = job.imgH = h;
+    job.format      = f;
+    job.measurePsnr = true;
+    job.tag         = tag;
+    return job;
+}
+
+// The worker's blocks are the ones EncodeBC makes on the caller's thread
+void TestWorkerMatchesDirect()
+{
+    BcEncodeWorker worker;
+    BcEncodeResult r;
+    CHECK(!worker.TakeResult(r));
+    for (BcFormat f : { BcFormat::BC1, BcFormat::BC7 }) {
+        const int w = 301, h = 199;
+        const std::vector<uint8_t> rgba = TestImage(w, h, 1);
+        worker.Request(Job(L"x.png", rgba, w, h, f, 7));
+        CHECK(WaitResult(worker, r));
+        BcEncodeResult again;
+        CHECK(!worker.TakeResult(again));           // taken once
+        if (!r.img) continue;
+
+        BcImage want;
+        EncodeBC(rgba.data(), w, h, f, want);
+        CHECK(r.path == L"x.png" && r.tag == 7);
+        CHECK(r.img->imgW == w && r.img->imgH == h && r.img->encodeMs >= 0.0);
+        CHECK(r.img->bc.format == f && r.img->bc.width == want.width && r.img->bc.height == want.height);
+        CHECK(r.img->bc.blocks == want.blocks);
+        CHECK(r.img->psnr == BcPsnr(rgba.data(), w, h, want));
+    }
+}
+
+// Only the latest request delivers; a cancelled one never does
+void TestWorkerReplace()
+{
+    const int w = 2048, h = 1536;
+    const std::vector<uint8_t> big = TestImage(w, h, 2), small = TestImage(64, 48, 3);
+    BcEncodeWorker worker;
+    BcEncodeResult r;
+
+    worker.Request(Job(L"big.png", big, w, h, BcFormat::BC7, 1));
+    worker.Request(Job(L"small.png", small, 64, 48, BcFormat::BC1, 2));
+    CHECK(WaitResult(worker, r) && r.path == L"small.png" && r.tag == 2);
+    std::this_thread::sleep_for(50ms);
+    CHECK(!worker.TakeResult(r));
+
+    worker.Request(Job(L"big.png", big, w, h, BcFormat::BC7, 3));
+    worker.Cancel();
+    worker.Stop();                                  // waits for the encode in flight
+    CHECK(!worker.TakeResult(r));
+
+    // usable again after Stop()
+    worker.Request(Job(L"small.png", small, 64, 48, BcFormat::BC7, 4));
+    CHECK(WaitResult(worker, r) && r.tag == 4 && r.img->bc.format == BcFormat::BC7);
+}
+
+} // namespace
+
+int main()
+{
+    TestCache();
+    TestWorkerMatchesDirect();
+    TestWorkerReplace();
+    return TestResult();
+}
@@ -0,0 +1,218 @@
+// tests/image_compare_test.cpp
+#include "image_compare.h"
+#include "image_stats.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The comparison one pixel and one window at a time, in double
+struct Naive {
+    double   psnr = 0.0, ssim = 1.0, minSsim = 1.0;
+    uint8_t  maxDiff = 0;
+    uint64_t changed = 0;
+    std::vector<uint8_t> diff;
+    std::vector<double>  ssimMap;
+};
+
+Naive NaiveCompare(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int w, int h)
+{
+    Naive n;
+    n.diff.resize(size_t(w) * h);
+    double sse = 0.0;
+    for (size_t i = 0; i < n.diff.size(); ++i) {
+        int m = 0;
+        for (int c = 0; c < 3; ++c) {
+            const int d = std::abs(int(a[i * 4 + c]) - int(b[i * 4 + c]));
+            sse += double(d) * d;
+            m = std::max(m, d);
+        }
+        n.diff[i] = uint8_t(m);
+        n.changed += m != 0;
+        n.maxDiff = std::max(n.maxDiff, uint8_t(m));
+    }
+    const double mse = sse / (double(w) * h * 3.0);
+    n.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+
+    const int bw = w / kSsimWindow, bh = h / kSsimWindow;
+    double sum = 0.0;
+    for (int by = 0; by < bh; ++by) {
+        for (int bx = 0; bx < bw; ++bx) {
+            std::vector<double> la, lb;
+            for (int y = by * kSsimWindow; y < (by + 1) * kSsimWindow; ++y)
+                for (int x = bx * kSsimWindow; x < (bx + 1) * kSsimWindow; ++x) {
+                    const uint8_t* pa = &a[(size_t(y) * w + x) * 4];
+                    const uint8_t* pb = &b[(size_t(y) * w + x) * 4];
+                    la.push_back(Luma709(pa[0], pa[1], pa[2]));
+                    lb.push_back(Luma709(pb[0], pb[1], pb[2]));
+                }
+            const double cnt = double(la.size());
+            double ma = 0, mb = 0;
+            for (size_t i = 0; i < la.size(); ++i) { ma += la[i]; mb += lb[i]; }
+            ma /= cnt;
+            mb /= cnt;
+            double va = 0, vb = 0, cov = 0;
+            for (size_t i = 0; i < la.size(); ++i) {
+                va  += (la[i] - ma) * (la[i] - ma);
+                vb  += (lb[i] - mb) * (lb[i] - mb);
+                cov += (la[i] - ma) * (lb[i] - mb);
+            }
+            va /= cnt;
+            vb /= cnt;
+            cov /= cnt;
+            const double c1 = 0.01 * 255 * 0.01 * 255, c2 = 0.03 * 255 * 0.03 * 255;
+            const double s = ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            n.ssimMap.push_back(s);
+            sum += s;
+            n.minSsim = std::min(n.minSsim, s);
+        }
+    }
+    if (!n.ssimMap.empty()) n.ssim = sum / double(n.ssimMap.size());
+    return n;
+}
+
+// A photo-like image, and a copy changed by `noise` codes here and there
+// plus a block that is clipped to white
+void MakePair(int w, int h, int noise, std::vector<uint8_t>& a, std::vector<uint8_t>& b)
+{
+    std::mt19937 rng(uint32_t(w * 7 + h));
+    a.resize(size_t(w) * h * 4);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = &a[(size_t(y) * w + x) * 4];
+            p[0] = uint8_t(x * 251 / std::max(1, w));
+            p[1] = uint8_t(128 + 100 * std::sin(x * 0.07 + y * 0.05));
+            p[2] = uint8_t((x ^ y) & 0xFF);
+            p[3] = uint8_t(rng());
+        }
+    b = a;
+    if (noise == 0) return;
+    for (size_t i = 0; i < b.size(); ++i) {
+        if (rng() % 5) continue;
+        b[i] = uint8_t(std::clamp(int(b[i]) + int(rng() % uint32_t(2 * noise + 1)) - noise, 0, 255));
+    }
+    for (int y = h / 3; y < std::min(h, h / 3 + 12); ++y)
+        for (int x = 0; x < std::min(w, 40); ++x) std::memset(&b[(size_t(y) * w + x) * 4], 255, 3);
+}
+
+void CheckAgainstNaive(int w, int h, int noise)
+{
+    std::vector<uint8_t> a, b;
+    MakePair(w, h, noise, a, b);
+    CompareResult r;
+    CompareImages(a.data(), b.data(), w, h, r);
+    const Naive n = NaiveCompare(a, b, w, h);
+
+    CHECK(r.w == w && r.h == h);
+    CHECK(r.blocksW == w / kSsimWindow && r.blocksH == h / kSsimWindow);
+    CHECK(r.psnr == n.psnr || std::fabs(r.psnr - n.psnr) < 1e-9);
+    CHECK(r.maxDiff == n.maxDiff && r.changed == n.changed);
+    CHECK(r.diff.size() == n.diff.size() && std::memcmp(r.diff.data(), n.diff.data(), n.diff.size()) == 0);
+    CHECK(r.ssimMap.size() == n.ssimMap.size());
+    double worst = 0.0;
+    for (size_t i = 0; i < n.ssimMap.size() && i < r.ssimMap.size(); ++i)
+        worst = std::max(worst, std::fabs(double(r.ssimMap[i]) - n.ssimMap[i]));
+    CHECK(worst < 1e-5);
+    CHECK(std::fabs(r.ssim - n.ssim) < 1e-6 && std::fabs(r.minSsim - n.minSsim) < 1e-5);
+    if (worst >= 1e-5 || r.psnr != n.psnr)
+        std::fprintf(stderr, "%dx%d noise %d: PSNR %.6f / %.6f, SSIM off by %g\n", w, h, noise, r.psnr, n.psnr, worst);
+}
+
+// Widths that leave SIMD tails, heights that leave partial windows, a row
+// long enough to spill the 32-bit squared-error lanes, and saturated errors
+void TestAgainstNaive()
+{
+    CheckAgainstNaive(1, 1, 3);
+    CheckAgainstNaive(5, 3, 40);                // no whole window at all
+    CheckAgainstNaive(16, 8, 2);
+    CheckAgainstNaive(333, 250, 1);
+    CheckAgainstNaive(640, 480, 20);
+    CheckAgainstNaive(9001, 19, 255);           // > 512 SSE2 steps per row
+    CheckAgainstNaive(1024, 1027, 6);
+}
+
+void TestIdentical()
+{
+    std::vector<uint8_t> a, b;
+    MakePair(300, 200, 0, a, b);
+    for (size_t i = 3; i < b.size(); i += 4) b[i] = uint8_t(~b[i]);      // alpha is ignored
+    CompareResult r;
+    CompareImages(a.data(), b.data(), 300, 200, r);
+    CHECK(std::isinf(r.psnr) && r.ssim == 1.0 && r.minSsim == 1.0);
+    CHECK(r.maxDiff == 0 && r.changed == 0 && r.ChangedPct() == 0.0);
+
+    // nothing to compare
+    CompareImages(a.data(), b.data(), 0, 10, r);
+    CHECK(r.w == 0 && r.diff.empty() && r.ssim == 1.0);
+}
+
+// The maps are image-sized; unchanged pixels show A's luma dimmed, changed
+// ones the ramp, which grows brighter with the difference
+void TestMaps()
+{
+    const int w = 100, h = 60;
+    std::vector<uint8_t> a, b;
+    MakePair(w, h, 0, a, b);
+    b[(size_t(10) * w + 10) * 4] ^= 1;
+    b[(size_t(20) * w + 20) * 4] ^= 0x80;
+    CompareResult r;
+    CompareImages(a.data(), b.data(), w, h, r);
+    CHECK(r.changed == 2);
+
+    PixelBuffer map;
+    RenderDiffMap(r, a.data(), map);
+    CHECK(map.size() == size_t(w) * h * 4);
+    const auto px = [&](int x, int y) { return &map[(size_t(y) * w + x) * 4]; };
+    const uint8_t* same = px(50, 50);
+    const uint8_t* pa = &a[(size_t(50) * w + 50) * 4];
+    const int dim = Luma709(pa[0], pa[1], pa[2]) / 4;
+    CHECK(same[0] == dim && same[1] == dim && same[2] == dim && same[3] == 255);
+    const auto brightness = [](const uint8_t* p) { return int(p[0]) + p[1] + p[2]; };
+    CHECK(brightness(px(10, 10)) > 3 * 64 && brightness(px(20, 20)) > brightness(px(10, 10)));
+
+    RenderSsimMap(r, map);
+    CHECK(map.size() == size_t(w) * h * 4);
+    // untouched windows share one colour, the window with the large change
+    // another; the 4 columns right of the last whole window repeat it
+    CHECK(std::memcmp(px(0, 0), px(99, 59), 4) == 0);
+    CHECK(std::memcmp(px(20, 20), px(0, 0), 4) != 0);
+    CHECK(std::memcmp(px(96, 0), px(99, 0), 4) == 0);
+}
+
+void TestCache()
+{
+    CompareCache cache;
+    std::vector<std::shared_ptr<const CompareResult>> results;
+    for (size_t i = 0; i <= CompareCache::kEntries; ++i) {
+        results.push_back(std::make_shared<CompareResult>());
+        cache.Insert(L"ref", L"b" + std::to_wstring(i), results.back());
+    }
+    CHECK(cache.Find(L"ref", L"b0") == nullptr);                // oldest went
+    CHECK(cache.Find(L"ref", L"b1") == results[1]);
+    CHECK(cache.Find(L"b1", L"ref") == nullptr);                // pairs are ordered
+    cache.Insert(L"ref", L"b7", results[0]);                     // b1 was just used, b2 goes
+    CHECK(cache.Find(L"ref", L"b1") == results[1] && cache.Find(L"ref", L"b2") == nullptr);
+    cache.Insert(L"ref", L"b7", nullptr);
+    CHECK(cache.Find(L"ref", L"b7") == results[0]);
+    cache.Clear();
+    CHECK(cache.Find(L"ref", L"b1") == nullptr);
+}
+
+} // namespace
+
+int main()
+{
+    TestAgainstNaive();
+    TestIdentical();
+    TestMaps();
+    TestCache();
+    return TestResult();
+}
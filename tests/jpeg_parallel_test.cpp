@@ -0,0 +1,276 @@
+// tests/jpeg_parallel_test.cpp
+#include "jpeg_parallel.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// A small baseline encoder, so the test makes its own restart-marker JPEGs
+// in whatever sampling and interval it needs. One quantisation table and
+// fixed Huffman tables (every DC category 4 bits, AC symbols 8 or 9 bits):
+// large files, but valid ones.
+// ---------------------------------------------------------------------------
+
+const int kZigZag[64] = { 0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+                          12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+                          35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+                          58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t acc = 0;
+    int      bits = 0;
+
+    void Put(uint32_t v, int n)
+    {
+        for (int i = n - 1; i >= 0; --i) {
+            acc = (acc << 1) | ((v >> i) & 1);
+            if (++bits == 8) {
+                out.push_back(uint8_t(acc));
+                if (acc == 0xFF) out.push_back(0);
+                acc = 0;
+                bits = 0;
+            }
+        }
+    }
+    void Flush() { while (bits) Put(1, 1); }
+};
+
+int Category(int v)
+{
+    int n = 0;
+    for (v = std::abs(v); v; v >>= 1) ++n;
+    return n;
+}
+
+void Segment(std::vector<uint8_t>& out, uint8_t marker, const std::vector<uint8_t>& body)
+{
+    const size_t len = body.size() + 2;
+    out.insert(out.end(), { 0xFF, marker, uint8_t(len >> 8), uint8_t(len) });
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+// `comps` 1 or 3; luma sampled hs x vs against chroma; a restart marker
+// every `restart` MCUs (0: none)
+std::vector<uint8_t> EncodeJpeg(int w, int h, int comps, int hs, int vs, int restart)
+{
+    // YCbCr planes of a synthetic photo: gradients, a wave, a checker and noise
+    std::vector<float> plane[3];
+    for (auto& p : plane) p.resize(size_t(w) * h);
+    std::mt19937 rng(uint32_t(w * 31 + h));
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const float r = 128 + 100 * std::sin(x * 0.013f + y * 0.021f) + float(rng() % 20);
+            const float g = 255.0f * x / w;
+            const float b = 255.0f * y / h + ((x / 37 + y / 29) & 1 ? -60.0f : 0.0f);
+            const size_t i = size_t(y) * w + x;
+            plane[0][i] = 0.299f * r + 0.587f * g + 0.114f * b;
+            plane[1][i] = -0.1687f * r - 0.3313f * g + 0.5f * b + 128;
+            plane[2][i] = 0.5f * r - 0.4187f * g - 0.0813f * b + 128;
+        }
+    }
+    if (comps == 1) hs = vs = 1;
+    const int sampH[3] = { hs, 1, 1 }, sampV[3] = { vs, 1, 1 };
+    const int mcusPerRow = (w + 8 * hs - 1) / (8 * hs), mcuRows = (h + 8 * vs - 1) / (8 * vs);
+
+    uint8_t quant[64];
+    for (int i = 0; i < 64; ++i) quant[i] = uint8_t(2 + i / 8 + i % 8);
+    float basis[8][8];
+    for (int x = 0; x < 8; ++x)
+        for (int u = 0; u < 8; ++u)
+            basis[x][u] = std::cos((2 * x + 1) * u * 3.14159265f / 16) * (u ? 0.5f : 0.35355339f);
+
+    std::vector<uint8_t> out = { 0xFF, 0xD8 };
+    std::vector<uint8_t> dqt = { 0 };
+    for (int i = 0; i < 64; ++i) dqt.push_back(quant[kZigZag[i]]);
+    Segment(out, 0xDB, dqt);
+    std::vector<uint8_t> sof = { 8, uint8_t(h >> 8), uint8_t(h), uint8_t(w >> 8), uint8_t(w), uint8_t(comps) };
+    for (int c = 0; c < comps; ++c) sof.insert(sof.end(), { uint8_t(c + 1), uint8_t(sampH[c] << 4 | sampV[c]), 0 });
+    Segment(out, 0xC0, sof);
+    std::vector<uint8_t> dht = { 0x00 };
+    for (int l = 1; l <= 16; ++l) dht.push_back(l == 4 ? 12 : 0);
+    for (int s = 0; s < 12; ++s) dht.push_back(uint8_t(s));
+    dht.push_back(0x10);
+    for (int l = 1; l <= 16; ++l) dht.push_back(l == 8 ? 200 : l == 9 ? 56 : 0);
+    for (int s = 0; s < 256; ++s) dht.push_back(uint8_t(s));
+    Segment(out, 0xC4, dht);
+    if (restart) Segment(out, 0xDD, { uint8_t(restart >> 8), uint8_t(restart) });
+    std::vector<uint8_t> sos = { uint8_t(comps) };
+    for (int c = 0; c < comps; ++c) sos.insert(sos.end(), { uint8_t(c + 1), 0 });
+    sos.insert(sos.end(), { 0, 63, 0 });
+    Segment(out, 0xDA, sos);
+
+    // canonical codes of the two tables above
+    uint32_t acCode[256];
+    for (int s = 0, code = 0; s < 256; ++s) {
+        if (s == 200) code <<= 1;
+        acCode[s] = uint32_t(code++);
+    }
+    const auto putAc = [&](BitWriter& bw, int s) { bw.Put(acCode[s], s < 200 ? 8 : 9); };
+
+    BitWriter bw{ out };
+    int pred[3] = {}, rst = 0;
+    const long long total = (long long)mcusPerRow * mcuRows;
+    for (long long m = 0; m < total; ++m) {
+        const int mx = int(m % mcusPerRow), my = int(m / mcusPerRow);
+        for (int c = 0; c < comps; ++c) {
+            const int sx = hs / sampH[c], sy = vs / sampV[c];     // pixels per sample
+            for (int bv = 0; bv < sampV[c]; ++bv) {
+                for (int bh = 0; bh < sampH[c]; ++bh) {
+                    float blk[64];
+                    const int bx = (mx * sampH[c] + bh) * 8, by = (my * sampV[c] + bv) * 8;
+                    for (int y = 0; y < 8; ++y) {
+                        for (int x = 0; x < 8; ++x) {
+                            float s = 0;
+                            for (int j = 0; j < sy; ++j)
+                                for (int i = 0; i < sx; ++i) {
+                                    const int px = std::min(w - 1, (bx + x) * sx + i);
+                                    const int py = std::min(h - 1, (by + y) * sy + j);
+                                    s += plane[c][size_t(py) * w + px];
+                                }
+                            blk[y * 8 + x] = s / float(sx * sy) - 128;
+                        }
+                    }
+                    // separable forward DCT, then quantise
+                    float rows[64];
+                    for (int y = 0; y < 8; ++y)
+                        for (int u = 0; u < 8; ++u) {
+                            float s = 0;
+                            for (int x = 0; x < 8; ++x) s += blk[y * 8 + x] * basis[x][u];
+                            rows[y * 8 + u] = s;
+                        }
+                    int coef[64];
+                    for (int v = 0; v < 8; ++v)
+                        for (int u = 0; u < 8; ++u) {
+                            float s = 0;
+                            for (int y = 0; y < 8; ++y) s += rows[y * 8 + u] * basis[y][v];
+                            coef[v * 8 + u] = int(std::lround(s / quant[v * 8 + u]));
+                        }
+
+                    const auto putValue = [&](int v, int n) { if (n) bw.Put(uint32_t(v > 0 ? v : v + (1 << n) - 1), n); };
+                    const int dc = coef[0] - pred[c];
+                    pred[c] = coef[0];
+                    bw.Put(uint32_t(Category(dc)), 4);
+                    putValue(dc, Category(dc));
+                    int run = 0;
+                    for (int i = 1; i < 64; ++i) {
+                        const int v = coef[kZigZag[i]];
+                        if (!v) { ++run; continue; }
+                        for (; run > 15; run -= 16) putAc(bw, 0xF0);
+                        putAc(bw, run << 4 | Category(v));
+                        putValue(v, Category(v));
+                        run = 0;
+                    }
+                    if (run) putAc(bw, 0x00);
+                }
+            }
+        }
+        if (restart && (m + 1) % restart == 0 && m + 1 < total) {
+            bw.Flush();
+            out.insert(out.end(), { 0xFF, uint8_t(0xD0 + rst) });
+            rst = (rst + 1) & 7;
+            pred[0] = pred[1] = pred[2] = 0;
+        }
+    }
+    bw.Flush();
+    out.insert(out.end(), { 0xFF, 0xD9 });
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+
+// Decodes `jpeg` with `maxBands` threads. Either the parallel path declines
+// without touching its outputs, or its RGBA equals stb_image's byte for byte.
+bool Decode(const char* name, const std::vector<uint8_t>& jpeg, int maxBands, int* bandsUsed = nullptr)
+{
+    PixelBuffer rgba;
+    int w = -1, h = -1, bands = 0;
+    const bool decoded = DecodeJpegParallel(jpeg.data(), jpeg.size(), rgba, w, h, &bands, maxBands);
+    if (!decoded) {
+        CHECK(w == -1 && h == -1 && rgba.empty() && bands == 0);
+        return false;
+    }
+    int sw = 0, sh = 0, sn = 0;
+    stbi_uc* ref = stbi_load_from_memory(jpeg.data(), int(jpeg.size()), &sw, &sh, &sn, 4);
+    CHECK(ref && w == sw && h == sh);
+    const bool same = ref && rgba.size() == size_t(sw) * sh * 4 && std::memcmp(rgba.data(), ref, rgba.size()) == 0;
+    if (!same) std::fprintf(stderr, "%s, %d bands: differs from stb_image\n", name, bands);
+    CHECK(same);
+    CHECK(bands >= 2 && bands <= maxBands);
+    stbi_image_free(ref);
+    if (bandsUsed) *bandsUsed = bands;
+    return true;
+}
+
+// Every sampling the band splitter treats differently, with intervals that
+// fall on MCU-row boundaries every row, every few rows or mid-row, and
+// band counts up to more than there are hardware threads
+void TestMatchesStb()
+{
+    struct Case { const char* name; int w, h, comps, hs, vs, restart; };
+    const Case cases[] = {
+        { "4:2:0, interval = row",          1600, 1320, 3, 2, 2, 100 },
+        { "4:2:0, interval = 1/4 row",      1600, 1320, 3, 2, 2, 25 },
+        { "4:2:0, odd size",                1601, 1317, 3, 2, 2, 101 },
+        { "4:2:0, interval = 2.5 rows",     1600, 1320, 3, 2, 2, 250 },
+        { "4:2:2, interval = 7 MCUs",       1530, 1400, 3, 2, 1, 7 },
+        { "4:4:0, interval = row",          1500, 1410, 3, 1, 2, 188 },
+        { "4:4:4, interval = 1 MCU",        1450, 1450, 3, 1, 1, 1 },
+        { "grey, interval = 2 rows",        1800, 1201, 1, 1, 1, 450 },
+    };
+    for (const Case& c : cases) {
+        const std::vector<uint8_t> jpeg = EncodeJpeg(c.w, c.h, c.comps, c.hs, c.vs, c.restart);
+        for (int maxBands : { 3, 8 }) {
+            int bands = 0;
+            const bool decoded = Decode(c.name, jpeg, maxBands, &bands);
+            if (!decoded) std::fprintf(stderr, "%s, %d bands: declined\n", c.name, maxBands);
+            CHECK(decoded);
+        }
+        // one band is no parallel decode at all
+        CHECK(!Decode(c.name, jpeg, 1));
+    }
+}
+
+// Files the parallel path must hand back to stb_image untouched
+void TestDeclines()
+{
+    const std::vector<uint8_t> good = EncodeJpeg(1600, 1320, 3, 2, 2, 100);
+    CHECK(Decode("good", good, 4));
+
+    CHECK(!Decode("no DRI", EncodeJpeg(1600, 1320, 3, 2, 2, 0), 4));
+    CHECK(!Decode("small", EncodeJpeg(640, 480, 3, 2, 2, 40), 4));
+    CHECK(!Decode("not a JPEG", std::vector<uint8_t>(good.begin() + 2, good.end()), 4));
+
+    // cut short anywhere: in the headers, mid-scan, or just the EOI missing
+    for (size_t cut : { size_t(3), size_t(200), good.size() / 3, good.size() - 2 })
+        CHECK(!Decode("truncated", std::vector<uint8_t>(good.begin(), good.begin() + cut), 4));
+
+    // a restart marker lost, or one too many: the intervals no longer add up
+    std::vector<uint8_t> lost(good), extra(good);
+    const uint8_t rst3[2] = { 0xFF, 0xD3 };
+    const size_t at = size_t(std::search(lost.begin(), lost.end(), rst3, rst3 + 2) - lost.begin());
+    CHECK(at < lost.size());
+    lost.erase(lost.begin() + at, lost.begin() + at + 2);
+    CHECK(!Decode("lost RST", lost, 4));
+    extra.insert(extra.end() - 2, { 0xFF, 0xD0 });
+    CHECK(!Decode("extra RST", extra, 4));
+}
+
+} // namespace
+
+int main()
+{
+    TestMatchesStb();
+    TestDeclines();
+    return TestResult();
+}
@@ -0,0 +1,102 @@
+// tests/png_test.cpp
+#include "png_fast.h"
+#include "test.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+inline uint32_t ReadBE32(const uint8_t* p) { return uint32_t(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+
+// What DecodePngFast promises to take: 8-bit, non-interlaced, not palette,
+// no tRNS. Read from the file itself rather than trusting its name.
+bool FastPathCase(const std::vector<uint8_t>& png)
+{
+    if (png.size() < 33) return false;
+    const uint8_t depth = png[24], type = png[25], interlace = png[28];
+    if (depth != 8 || type == 3 || interlace) return false;
+    for (size_t p = 8; p + 8 <= png.size();) {
+        const uint32_t len = ReadBE32(&png[p]);
+        if (std::memcmp(&png[p + 4], "tRNS", 4) == 0) return false;
+        p += 12 + size_t(len);
+    }
+    return true;
+}
+
+// Decodes `png` both ways. The fast path either declines without touching
+// its outputs, or produces exactly stb_image's RGBA; `decoded` tells which.
+void Compare(const std::string& name, const std::vector<uint8_t>& png, bool& decoded)
+{
+    int sw = 0, sh = 0, sn = 0;
+    stbi_uc* ref = stbi_load_from_memory(png.data(), int(png.size()), &sw, &sh, &sn, 4);
+
+    PixelBuffer rgba;
+    int w = -1, h = -1;
+    decoded = DecodePngFast(png.data(), png.size(), rgba, w, h);
+    if (!decoded) {
+        CHECK(w == -1 && h == -1 && rgba.empty());
+    } else if (!ref) {
+        std::fprintf(stderr, "%s: decoded, but stb_image rejects it\n", name.c_str());
+        CHECK(ref);
+    } else {
+        CHECK(w == sw && h == sh);
+        const size_t bytes = size_t(sw) * size_t(sh) * 4;
+        const bool same = rgba.size() == bytes && std::memcmp(rgba.data(), ref, bytes) == 0;
+        if (!same) std::fprintf(stderr, "%s: differs from stb_image\n", name.c_str());
+        CHECK(same);
+    }
+    stbi_image_free(ref);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::filesystem::path dir = argc > 1 ? argv[1] : "data/png";
+    int files = 0, fast = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() != ".png") continue;
+        const std::string name = entry.path().filename().string();
+        const std::vector<uint8_t> png = ReadFile(entry.path());
+        ++files;
+
+        // every file is valid: stb_image decodes all of them, and the fast
+        // path exactly the ones it claims
+        int sw, sh, sn;
+        CHECK(stbi_info_from_memory(png.data(), int(png.size()), &sw, &sh, &sn));
+        bool decoded = false;
+        Compare(name, png, decoded);
+        if (decoded != FastPathCase(png))
+            std::fprintf(stderr, "%s: fast path %s\n", name.c_str(), decoded ? "took it" : "declined");
+        CHECK(decoded == FastPathCase(png));
+        fast += decoded;
+
+        // damaged copies: cut short anywhere, or a byte of the data changed
+        for (size_t cut = 8; cut < png.size(); cut += 1 + png.size() / 13) {
+            const std::vector<uint8_t> part(png.begin(), png.begin() + cut);
+            Compare(name + " cut at " + std::to_string(cut), part, decoded);
+        }
+        for (size_t at = 41; at + 16 < png.size(); at += 1 + png.size() / 11) {
+            std::vector<uint8_t> bad(png);
+            bad[at] ^= 0x5A;
+            Compare(name + " byte " + std::to_string(at), bad, decoded);
+        }
+    }
+    std::printf("%d files, %d through the fast path\n", files, fast);
+    CHECK(files > 0 && fast > 0);
+    return TestResult();
+}
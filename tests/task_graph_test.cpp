@@ -0,0 +1,137 @@
+// tests/task_graph_test.cpp
+#include "task_graph.h"
+#include "test.h"
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// On one thread, ready tasks run in the order they were added, and a task
+// made ready by the one just finished runs next
+void TestOrderOneThread()
+{
+    TaskGraph g;
+    std::vector<int> order;
+    const auto task = [&](int n) { return [&order, n] { order.push_back(n); }; };
+    const int a = g.Add("a", task(0));
+    const int b = g.Add("b", task(1));
+    g.Add("c", task(2), { a });
+    g.Add("d", task(3), { a, b });
+    g.Add("e", task(4));
+    g.Start(1);
+    g.WaitAll();
+    CHECK((order == std::vector<int>{ 0, 2, 1, 3, 4 }));
+}
+
+// A random DAG on several threads: every task runs once, after all of its
+// dependencies have ended
+void TestRandomDag()
+{
+    for (int threads : { 1, 2, 8 }) {
+        std::mt19937 rng{ uint32_t(threads) };
+        TaskGraph g;
+        const int n = 300;
+        std::vector<std::vector<int>> deps(n);
+        std::vector<std::atomic<int>> runs(n);
+        std::vector<std::atomic<bool>> done(n);
+        std::atomic<int> early{ 0 };
+        for (int i = 0; i < n; ++i) {
+            for (int k = int(rng() % 4); k > 0 && i > 0; --k) deps[size_t(i)].push_back(int(rng() % uint32_t(i)));
+            const bool yield = rng() % 16 == 0;
+            g.Add("task", [&, i, yield] {
+                for (int d : deps[size_t(i)]) if (!done[size_t(d)]) ++early;
+                ++runs[size_t(i)];
+                if (yield) std::this_thread::yield();
+                done[size_t(i)] = true;
+            }, deps[size_t(i)]);
+        }
+        CHECK(g.Count() == size_t(n));
+        g.Start(threads);
+        g.WaitAll();
+        CHECK(early == 0);
+        for (int i = 0; i < n; ++i) {
+            CHECK(runs[size_t(i)] == 1);
+            for (int d : deps[size_t(i)]) CHECK(g.StartNs(i) >= g.EndNs(d));
+        }
+    }
+}
+
+// Wait() returns as soon as its task is done, while others still run; the
+// caller's own work overlaps the graph
+void TestWaitOne()
+{
+    TaskGraph g;
+    std::atomic<bool> release{ false };
+    const int quick = g.Add("quick", [] {});
+    const int slow  = g.Add("slow", [&] { while (!release) std::this_thread::sleep_for(1ms); });
+    const int after = g.Add("after", [] {}, { quick });
+    g.Start(2);
+    g.Wait(quick);
+    g.Wait(after);
+    CHECK(!release);
+    release = true;
+    g.Wait(slow);
+    g.WaitAll();
+    CHECK(std::string(g.Name(slow)) == "slow");
+}
+
+// Independent tasks really run side by side: two that each wait for the
+// other to start would stall on one thread
+void TestConcurrent()
+{
+    TaskGraph g;
+    std::atomic<int> started{ 0 };
+    std::atomic<int> met{ 0 };
+    const auto meet = [&] {
+        ++started;
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (started < 2 && std::chrono::steady_clock::now() < deadline) std::this_thread::sleep_for(1ms);
+        if (started == 2) ++met;
+    };
+    g.Add("left", meet);
+    g.Add("right", meet);
+    g.Start(2);
+    g.WaitAll();
+    CHECK(met == 2);
+}
+
+// Start and end times bracket the work, on the trace clock
+void TestTimings()
+{
+    TaskGraph g;
+    const int64_t before = TraceNowNs();
+    const int sleep = g.Add("sleep", [] { std::this_thread::sleep_for(20ms); });
+    const int next  = g.Add("next", [] {}, { sleep });
+    g.Start();
+    g.WaitAll();
+    CHECK(g.StartNs(sleep) >= before);
+    CHECK(g.EndNs(sleep) - g.StartNs(sleep) >= 20000000);
+    CHECK(g.StartNs(next) >= g.EndNs(sleep) && g.EndNs(next) >= g.StartNs(next));
+    CHECK(g.EndNs(next) <= TraceNowNs());
+
+    // an empty graph starts and finishes
+    TaskGraph empty;
+    empty.Start();
+    empty.WaitAll();
+    CHECK(empty.Count() == 0);
+}
+
+} // namespace
+
+int main()
+{
+    TestOrderOneThread();
+    TestRandomDag();
+    TestWaitOne();
+    TestConcurrent();
+    TestTimings();
+    return TestResult();
+}
@@ -0,0 +1,28 @@
+// tests/test.h
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// Checks for the standalone test programs: a failure prints the condition and
+// where it is, and the program goes on so one run reports every failure.
+// Each test's main() returns TestResult().
+inline int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++TestFailures();                                                         \
+        }                                                                             \
+    } while (0)
+
+inline int TestResult()
+{
+    if (TestFailures()) std::fprintf(stderr, "%d check(s) failed\n", TestFailures());
+    else                std::puts("ok");
+    return TestFailures() ? 1 : 0;
+}
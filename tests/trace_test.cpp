@@ -0,0 +1,72 @@
+// tests/trace_test.cpp
+#include "trace.h"
+#include "test.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string Dump()
+{
+    FILE* f = std::tmpfile();
+    CHECK(f != nullptr);
+    if (!f) return {};
+    CHECK(TraceWriteJson(f));
+    std::string json;
+    std::rewind(f);
+    char buf[4096];
+    for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;) json.append(buf, n);
+    std::fclose(f);
+    return json;
+}
+
+size_t Count(const std::string& s, const std::string& what)
+{
+    size_t n = 0;
+    for (size_t at = s.find(what); at != std::string::npos; at = s.find(what, at + 1)) ++n;
+    return n;
+}
+
+// Spans of a thread that has exited stay in the dump
+void TestWorkerSpansKept()
+{
+    TraceSetThreadName("main");
+    { HDRV_TRACE_SCOPE("on main"); }
+    std::thread([] {
+        TraceSetThreadName("worker");
+        HDRV_TRACE_SCOPE("on worker");
+    }).join();
+    const std::string json = Dump();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(Count(json, "\"on main\"") == 1 && Count(json, "\"on worker\"") == 1);
+    CHECK(Count(json, "\"main\"") == 1 && Count(json, "\"worker\"") == 1);
+}
+
+// Waves of short-lived band threads, as ParallelForBands starts per call,
+// reuse the rings of the ones before instead of adding one each
+void TestRingsRecycled()
+{
+    const size_t before = Count(Dump(), "\"thread_name\"");
+    for (int call = 0; call < 200; ++call) {
+        std::vector<std::thread> bands;
+        for (int b = 0; b < 8; ++b) bands.emplace_back([] { HDRV_TRACE_SCOPE("band"); });
+        for (auto& t : bands) t.join();
+    }
+    const std::string json = Dump();
+    CHECK(Count(json, "\"thread_name\"") <= before + 8);
+    CHECK(Count(json, "\"band\"") == 1600);
+    // a reused ring does not carry the name of the thread that had it
+    CHECK(Count(json, "\"worker\"") == 0);
+}
+
+} // namespace
+
+int main()
+{
+    TestWorkerSpansKept();
+    TestRingsRecycled();
+    return TestResult();
+}
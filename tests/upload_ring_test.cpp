@@ -0,0 +1,227 @@
+// tests/upload_ring_test.cpp
+#include "upload_ring.h"
+#include "test.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Stands in for an ID3D12Fence and the queue signalling it: Signal() hands
+// out the next value, Complete() is the GPU reaching one
+struct MockFence {
+    uint64_t signalled = 0;
+    uint64_t completed = 0;
+
+    uint64_t Signal() { return ++signalled; }
+    void     Complete(uint64_t value) { if (value > completed) completed = value; }
+};
+
+constexpr uint64_t kAlign = 512;
+
+void TestAlignment()
+{
+    UploadRing ring(4096);
+    uint64_t off = 1;
+    CHECK(!ring.Allocate(0, kAlign, off));
+    CHECK(!ring.Allocate(4097, kAlign, off));
+    CHECK(ring.Allocate(1, kAlign, off) && off == 0);
+    CHECK(ring.Allocate(100, kAlign, off) && off == 512);
+    CHECK(ring.Allocate(512, kAlign, off) && off == 1024);
+    CHECK(ring.Used() == 1536);
+}
+
+void TestWrapAround()
+{
+    MockFence fence;
+    UploadRing ring(4096);
+    uint64_t off;
+    CHECK(ring.Allocate(1000, kAlign, off) && off == 0);
+    ring.Submit(fence.Signal());                        // [0, 1000) at 1
+    CHECK(ring.Allocate(2500, kAlign, off) && off == 1024);
+    ring.Submit(fence.Signal());                        // [1024, 3524) at 2
+
+    // what fits in the 572 bytes left before the end still goes there
+    CHECK(ring.Allocate(512, kAlign, off) && off == 3584);
+    ring.Submit(fence.Signal());                        // [3584, 4096) at 3
+
+    // a region is never split across the end but starts over at 0, which is
+    // still in flight until fence 1
+    CHECK(!ring.Allocate(1000, kAlign, off));
+    fence.Complete(1);
+    ring.Retire(fence.completed);
+    CHECK(ring.Allocate(1000, kAlign, off) && off == 0);
+    ring.Submit(fence.Signal());                        // [0, 1000) at 4
+
+    // the next bytes are fence 2's region
+    CHECK(!ring.Allocate(1, kAlign, off));
+    fence.Complete(2);
+    ring.Retire(fence.completed);
+    CHECK(ring.Allocate(2048, kAlign, off) && off == 1024);
+}
+
+void TestRetireOrder()
+{
+    MockFence fence;
+    UploadRing ring(4096);
+    uint64_t off;
+    for (int i = 0; i < 4; ++i) {
+        CHECK(ring.Allocate(1024, kAlign, off) && off == uint64_t(i) * 1024);
+        ring.Submit(fence.Signal());
+    }
+    CHECK(ring.Used() == 4096);
+
+    // nothing is freed before its fence, and each value frees only its own
+    // region and those submitted before it
+    ring.Retire(0);
+    CHECK(ring.Used() == 4096);
+    fence.Complete(2);
+    ring.Retire(fence.completed);
+    CHECK(ring.Used() == 2048);
+    CHECK(ring.Allocate(2048, kAlign, off) && off == 0);
+    CHECK(!ring.Allocate(1, kAlign, off));
+    ring.Submit(fence.Signal());
+    fence.Complete(3);
+    ring.Retire(fence.completed);
+    CHECK(ring.Used() == 3072);
+
+    // a Submit with nothing allocated since the last adds no mark
+    ring.Submit(fence.Signal());
+    CHECK(ring.OldestFence() == 4);
+
+    // idle again: the next region starts at 0 whatever the positions were
+    fence.Complete(fence.signalled);
+    ring.Retire(fence.completed);
+    CHECK(ring.Used() == 0 && ring.OldestFence() == 0);
+    CHECK(ring.Allocate(4096, kAlign, off) && off == 0);
+}
+
+void TestOldestFence()
+{
+    MockFence fence;
+    UploadRing ring(8192);
+    uint64_t off;
+    CHECK(ring.OldestFence() == 0);
+    ring.Allocate(100, kAlign, off);
+    CHECK(ring.OldestFence() == 0);                     // allocated, not yet submitted
+    ring.Submit(fence.Signal());
+    CHECK(ring.OldestFence() == 1);
+    ring.Allocate(100, kAlign, off);
+    ring.Submit(fence.Signal());
+    ring.Allocate(100, kAlign, off);
+    ring.Submit(fence.Signal());
+    CHECK(ring.OldestFence() == 1);
+    fence.Complete(2);
+    ring.Retire(fence.completed);
+    CHECK(ring.OldestFence() == 3);
+    fence.Complete(3);
+    ring.Retire(fence.completed);
+    CHECK(ring.OldestFence() == 0);
+}
+
+// The loop AllocateStaging runs in main.cpp: retire, and while the ring is
+// still full wait for its oldest fence. The mock GPU finishes a submission
+// only when waited on, so every wait must name a fence that frees space.
+void TestBackPressure()
+{
+    MockFence fence;
+    UploadRing ring(1 << 16);
+    uint64_t off;
+    int waits = 0;
+    const auto allocate = [&](uint64_t size) {
+        ring.Retire(fence.completed);
+        while (!ring.Allocate(size, kAlign, off)) {
+            const uint64_t oldest = ring.OldestFence();
+            CHECK(oldest > fence.completed && oldest <= fence.signalled);
+            if (oldest <= fence.completed || oldest > fence.signalled) return false;
+            fence.Complete(oldest);
+            ++waits;
+            ring.Retire(fence.completed);
+        }
+        ring.Submit(fence.Signal());
+        return true;
+    };
+
+    // a full ring of 16 KB uploads, then one more waits for the first only
+    for (int i = 0; i < 4; ++i) CHECK(allocate(16384));
+    CHECK(waits == 0 && ring.Used() == ring.Capacity());
+    CHECK(allocate(16384) && off == 0);
+    CHECK(waits == 1 && fence.completed == 1);
+
+    // one the size of the ring drains everything before it
+    CHECK(allocate(ring.Capacity()) && off == 0);
+    CHECK(fence.completed == fence.signalled - 1);
+
+    // a request the ring can never hold is refused, not waited on
+    CHECK(!ring.Allocate(ring.Capacity() + 1, kAlign, off));
+}
+
+// Random sizes against a lagging fence: live regions never overlap, never
+// cross the end of the buffer and are freed only once their fence completes
+void TestRandomized()
+{
+    MockFence fence;
+    const uint64_t capacity = 1 << 20;
+    UploadRing ring(capacity);
+    std::mt19937 rng(1);
+    struct Region { uint64_t off, size, fence; };
+    std::vector<Region> live;
+    uint64_t off;
+
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t size = 1 + rng() % (capacity / 4);
+        if (ring.Allocate(size, kAlign, off)) {
+            CHECK(off % kAlign == 0 && off + size <= capacity);
+            for (const Region& r : live) CHECK(off + size <= r.off || r.off + r.size <= off);
+            live.push_back({ off, size, fence.signalled + 1 });
+            if (rng() % 3 == 0) ring.Submit(fence.Signal());
+            continue;
+        }
+        ring.Submit(fence.Signal());
+        CHECK(ring.OldestFence() != 0);
+        fence.Complete(std::min(fence.signalled, ring.OldestFence() + rng() % 3));
+        ring.Retire(fence.completed);
+        std::vector<Region> still;
+        for (const Region& r : live)
+            if (r.fence > fence.completed) still.push_back(r);
+        live.swap(still);
+    }
+}
+
+void TestFenceRetireQueue()
+{
+    FenceRetireQueue<std::unique_ptr<int>> queue;
+    queue.Push(std::make_unique<int>(1), 1);
+    queue.Push(std::make_unique<int>(2), 2);
+    queue.Push(std::make_unique<int>(3), 2);
+    queue.Push(std::make_unique<int>(4), 5);
+
+    std::unique_ptr<int> out;
+    CHECK(!queue.PopCompleted(0, out) && !out);
+    CHECK(queue.PopCompleted(2, out) && *out == 1);
+    CHECK(queue.PopCompleted(2, out) && *out == 2);
+    CHECK(queue.Size() == 2);
+
+    queue.Release(4);
+    CHECK(queue.Size() == 1);
+    CHECK(!queue.PopCompleted(4, out));
+    queue.Release(5);
+    CHECK(queue.Size() == 0);
+    CHECK(!queue.PopCompleted(100, out));
+}
+
+} // namespace
+
+int main()
+{
+    TestAlignment();
+    TestWrapAround();
+    TestRetireOrder();
+    TestOldestFence();
+    TestBackPressure();
+    TestRandomized();
+    TestFenceRetireQueue();
+    return TestResult();
+}
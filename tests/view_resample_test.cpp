@@ -0,0 +1,197 @@
+// tests/view_resample_test.cpp
+#include "view_resample.h"
+#include "test.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define STB_IMAGE_RESIZE2_IMPLEMENTATION
+#include "stb_image_resize2.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+std::vector<uint8_t> TestImage(int w, int h)
+{
+    std::vector<uint8_t> rgba(size_t(w) * h * 4);
+    std::mt19937 rng(5);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            uint8_t* p = &rgba[(size_t(y) * w + x) * 4];
+            p[0] = uint8_t(x * 255 / w);
+            p[1] = uint8_t(((x / 9) ^ (y / 9)) & 1 ? 230 : 20);     // hard edges ring with Lanczos
+            p[2] = uint8_t(128 + 120 * std::sin(x * 0.05 + y * 0.03));
+            p[3] = uint8_t(rng());
+        }
+    return rgba;
+}
+
+// The kernel ViewResampler uses for Lanczos3, restated
+float Sinc(float x)
+{
+    if (std::fabs(x) < 1e-6f) return 1.0f;
+    x *= 3.14159265358979f;
+    return std::sin(x) / x;
+}
+float Lanczos3(float x, float, void*) { return std::fabs(x) < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f; }
+float Lanczos3Support(float, void*) { return 3.0f; }
+
+// The same view in one plain stb_image_resize2 call
+std::vector<uint8_t> Direct(const ViewRequest& req)
+{
+    std::vector<uint8_t> out(size_t(req.dstW) * req.dstH * 4);
+    STBIR_RESIZE r;
+    stbir_resize_init(&r, req.pixels, req.srcW, req.srcH, req.srcW * 4, out.data(), req.dstW, req.dstH,
+                      req.dstW * 4, STBIR_RGBA, STBIR_TYPE_UINT8_SRGB);
+    stbir_set_input_subrect(&r, req.s0, req.t0, req.s1, req.t1);
+    if (req.filter == ResampleFilter::Lanczos3)
+        stbir_set_filter_callbacks(&r, Lanczos3, Lanczos3Support, Lanczos3, Lanczos3Support);
+    else
+        stbir_set_filters(&r, STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL);
+    CHECK(stbir_resize_extended(&r));
+    return out;
+}
+
+// Polls for the latest request's result, as the render loop does
+bool WaitResult(ViewResampler& vr, std::shared_ptr<const ViewResult>& out, std::chrono::milliseconds limit = 20s)
+{
+    const auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!vr.TakeResult(out)) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+ViewRequest View(const std::vector<uint8_t>& src, int w, int h, double s0, double t0, double s1, double t1, int dw,
+                 int dh, ResampleFilter f)
+{
+    ViewRequest req;
+    req.pixels = src.data();
+    req.srcW = w;
+    req.srcH = h;
+    req.s0 = s0; req.t0 = t0; req.s1 = s1; req.t1 = t1;
+    req.dstW = dw;
+    req.dstH = dh;
+    req.filter = f;
+    return req;
+}
+
+// Split across bands and cores, the result is byte for byte one direct call
+void TestMatchesDirect()
+{
+    const int w = 1200, h = 900;
+    const std::vector<uint8_t> src = TestImage(w, h);
+    ViewResampler vr;
+    for (ResampleFilter f : { ResampleFilter::Lanczos3, ResampleFilter::Mitchell }) {
+        const ViewRequest views[] = {
+            View(src, w, h, 0.0, 0.0, 1.0, 1.0, 640, 480, f),           // whole image, down
+            View(src, w, h, 0.21, 0.37, 0.46, 0.58, 1000, 700, f),      // zoomed in, up
+            View(src, w, h, 0.5, 0.0, 1.0, 1.0, 333, 517, f),           // odd sizes, squeezed
+        };
+        for (const ViewRequest& req : views) {
+            vr.Request(req);
+            std::shared_ptr<const ViewResult> res;
+            CHECK(WaitResult(vr, res));
+            if (!res) continue;
+            CHECK(res->request.Same(req));
+            const std::vector<uint8_t> want = Direct(req);
+            CHECK(res->rgba.size() == want.size() && std::memcmp(res->rgba.data(), want.data(), want.size()) == 0);
+            CHECK(res->ms >= 0.0);
+        }
+    }
+}
+
+// Recent views come back from the cache at once, the same object; the
+// oldest is dropped after kCachedViews; drift within Same() still hits
+void TestCache()
+{
+    const int w = 800, h = 600;
+    const std::vector<uint8_t> src = TestImage(w, h);
+    ViewResampler vr;
+    std::vector<ViewRequest> views;
+    std::vector<std::shared_ptr<const ViewResult>> results;
+    for (size_t i = 0; i <= ViewResampler::kCachedViews; ++i) {
+        views.push_back(View(src, w, h, 0.05 * double(i), 0.0, 0.5 + 0.05 * double(i), 0.5, 400, 300,
+                             ResampleFilter::Lanczos3));
+        vr.Request(views.back());
+        std::shared_ptr<const ViewResult> res;
+        CHECK(WaitResult(vr, res));
+        results.push_back(res);
+    }
+
+    ViewRequest drifted = views[2];
+    drifted.s0 += 0.001 / w;
+    drifted.t1 -= 0.001 / h;
+    vr.Request(drifted);
+    std::shared_ptr<const ViewResult> hit;
+    CHECK(vr.TakeResult(hit) && hit == results[2]);
+    CHECK(!vr.Pending(drifted));
+    CHECK(!vr.TakeResult(hit));                     // taken once
+
+    // views[0] fell out: it is resampled again
+    vr.Request(views[0]);
+    CHECK(WaitResult(vr, hit) && hit != results[0]);
+    CHECK(hit->rgba.size() == results[0]->rgba.size() &&
+          std::memcmp(hit->rgba.data(), results[0]->rgba.data(), hit->rgba.size()) == 0);
+
+    // a different filter or a whole pixel of movement is a different view
+    ViewRequest other = views[2];
+    other.filter = ResampleFilter::Mitchell;
+    CHECK(!other.Same(views[2]));
+    other = views[2];
+    other.s0 += 1.0 / w;
+    CHECK(!other.Same(views[2]));
+}
+
+// A cancelled or replaced job never delivers; Reset() waits until the
+// worker has let go of the source and forgets the cache
+void TestCancel()
+{
+    const int w = 3000, h = 2000;
+    const std::vector<uint8_t> src = TestImage(w, h);
+    const ViewRequest big = View(src, w, h, 0.0, 0.0, 1.0, 1.0, 2900, 1900, ResampleFilter::Lanczos3);
+    const ViewRequest small = View(src, w, h, 0.4, 0.4, 0.6, 0.6, 200, 200, ResampleFilter::Mitchell);
+
+    ViewResampler vr;
+    vr.Request(big);
+    CHECK(vr.Pending(big));
+    vr.Cancel();
+    CHECK(!vr.Pending(big));
+    vr.Reset();
+    std::shared_ptr<const ViewResult> res;
+    CHECK(!vr.TakeResult(res));
+
+    // replaced while running: only the new view arrives
+    vr.Request(big);
+    std::this_thread::sleep_for(5ms);
+    vr.Request(small);
+    CHECK(!vr.Pending(big) && vr.Pending(small));
+    CHECK(WaitResult(vr, res) && res->request.Same(small));
+    std::this_thread::sleep_for(20ms);
+    CHECK(!vr.TakeResult(res));
+
+    // cached until Reset()
+    vr.Request(small);
+    std::shared_ptr<const ViewResult> cached;
+    CHECK(vr.TakeResult(cached) && cached == res);
+    vr.Reset();
+    vr.Request(small);
+    CHECK(WaitResult(vr, res) && res != cached && res->request.Same(small));
+    vr.Stop();
+}
+
+} // namespace
+
+int main()
+{
+    TestMatchesDirect();
+    TestCache();
+    TestCancel();
+    return TestResult();
+}